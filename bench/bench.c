@@ -0,0 +1,458 @@
+#include "corpus.h"
+#include "compile.h"
+#include "comp_ctx.h"
+#include "source_buf.h"
+#include "out_buf.h"
+#include "time_report.h"
+#include "safe_mem.h"
+#include "bool.h"
+#include "comp_dependent/ints.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* runs the whole pipeline in-process on generated sources and writes the
+ * throughput of every stage as JSON, so it can be compared to a baseline */
+
+struct BenchArgs {
+
+    unsigned n_reps;
+    unsigned n_warmups;
+    u32 scale;
+    bool optimize;
+
+    /* NULL means stdout */
+    const char *out_path;
+    /* only run this corpus if it's set */
+    const char *only_corpus;
+    /* write the corpora to this directory instead of benchmarking them */
+    const char *corpus_dir;
+    /* instead of the usual results, check that this stage takes time linear
+     * in its items, see check_linear */
+    const char *linear_stage;
+
+};
+
+struct BenchResult {
+
+    u32 n_lines;
+    u32 n_bytes;
+    u32 n_tokens;
+
+    double stage_seconds[TimeStage_COUNT];
+    /* the quickest of the reps, the least noisy for comparing sizes */
+    double stage_min_seconds[TimeStage_COUNT];
+    u32 stage_items[TimeStage_COUNT];
+    bool stage_ran[TimeStage_COUNT];
+
+    double total_seconds;
+    double min_seconds;
+
+};
+
+static void print_usage(void) {
+
+    printf("usage: mcc-bench [options]\n"
+            "  -n <reps>              Timed repetitions of each corpus (10).\n"
+            "  -w <warmups>           Untimed runs before the timed ones (2).\n"
+            "  -s <scale>             Multiplies the size of the corpora (1).\n"
+            "  -O                     Benchmarks with optimizations on.\n"
+            "  -o <file>              Writes the results there, not stdout.\n"
+            "  --corpus <name>        Only runs the given corpus.\n"
+            "  --write-corpus <dir>   Writes the corpora to dir as .c files\n"
+            "                         and exits.\n");
+    printf("  --check-linear <stage> Runs each corpus at the scale and 4x\n"
+            "                         it, and fails if the stage's time per\n"
+            "                         byte of source more than doubles.\n");
+
+}
+
+/* returns 0 if str isn't a positive number */
+static unsigned read_count(const char *arg, const char *str) {
+
+    char *end = NULL;
+    long count = strtol(str, &end, 10);
+
+    if (*str == '\0' || *end != '\0' || count <= 0 || count > 100000) {
+        fprintf(stderr, "error: '%s' isn't a valid operand for '%s'.\n",
+                str, arg);
+        return 0;
+    }
+
+    return count;
+
+}
+
+/* returns false if the args aren't valid */
+static bool get_args(struct BenchArgs *args, int argc, char **argv) {
+
+    int i;
+
+    memset(args, 0, sizeof(*args));
+    args->n_reps = 10;
+    args->n_warmups = 2;
+    args->scale = 1;
+
+    for (i = 1; i < argc; i++) {
+        const char *operand = i+1 < argc ? argv[i+1] : NULL;
+        bool has_operand = strcmp(argv[i], "-n") == 0 ||
+            strcmp(argv[i], "-w") == 0 || strcmp(argv[i], "-s") == 0 ||
+            strcmp(argv[i], "-o") == 0 || strcmp(argv[i], "--corpus") == 0 ||
+            strcmp(argv[i], "--write-corpus") == 0 ||
+            strcmp(argv[i], "--check-linear") == 0;
+
+        if (has_operand && !operand) {
+            fprintf(stderr, "error: '%s' is missing an operand.\n", argv[i]);
+            return false;
+        }
+
+        if (strcmp(argv[i], "-n") == 0)
+            args->n_reps = read_count(argv[i], operand);
+        else if (strcmp(argv[i], "-w") == 0) {
+            /* no warm-up at all is fine */
+            args->n_warmups = strcmp(operand, "0") == 0 ? 0 :
+                read_count(argv[i], operand);
+            if (args->n_warmups == 0 && strcmp(operand, "0") != 0)
+                return false;
+        }
+        else if (strcmp(argv[i], "-s") == 0)
+            args->scale = read_count(argv[i], operand);
+        else if (strcmp(argv[i], "-o") == 0)
+            args->out_path = operand;
+        else if (strcmp(argv[i], "--corpus") == 0)
+            args->only_corpus = operand;
+        else if (strcmp(argv[i], "--write-corpus") == 0)
+            args->corpus_dir = operand;
+        else if (strcmp(argv[i], "--check-linear") == 0)
+            args->linear_stage = operand;
+        else if (strcmp(argv[i], "-O") == 0)
+            args->optimize = true;
+        else if (strcmp(argv[i], "-h") == 0 ||
+                strcmp(argv[i], "--help") == 0) {
+            print_usage();
+            exit(0);
+        }
+        else {
+            fprintf(stderr, "error: command line argument '%s' doesn't"
+                    " exist.\n", argv[i]);
+            return false;
+        }
+
+        if (has_operand)
+            ++i;
+    }
+
+    return args->n_reps > 0 && args->scale > 0;
+
+}
+
+static u32 count_lines(const char *src, u32 len) {
+
+    u32 n_lines = 0;
+    u32 i;
+
+    for (i = 0; i < len; i++)
+        n_lines += src[i] == '\n';
+
+    return n_lines;
+
+}
+
+/* compiles the source once. returns true if it failed to compile */
+static bool run_once(const struct BenchArgs *args, const char *name,
+        const char *src, u32 src_len, struct TimeReport *report,
+        double *seconds) {
+
+    struct CompilerCtx ctx = CompilerCtx_init();
+    struct SourceBuf src_buf = SourceBuf_init();
+    struct OutBuf output = OutBuf_create(-1);
+    bool error_occurred = false;
+    double start;
+
+    src_buf.src = src;
+    src_buf.len = src_len;
+
+    ctx.args.src_path = name;
+    ctx.args.optimize = args->optimize;
+    ctx.time_report.enabled = true;
+
+    start = TimeReport_now();
+    Compile_src(&ctx, &src_buf, &output, &error_occurred);
+    *seconds = TimeReport_now()-start;
+
+    *report = ctx.time_report;
+    CompilerCtx_free(&ctx);
+    OutBuf_free(&output);
+
+    return error_occurred;
+
+}
+
+/* returns true if the corpus failed to compile */
+static bool bench_corpus(const struct BenchArgs *args, enum CorpusKind kind,
+        struct BenchResult *result) {
+
+    const char *name = CorpusKind_name(kind);
+    u32 src_len = 0;
+    char *src = Corpus_generate(kind, args->scale, &src_len);
+    struct TimeReport report;
+    double seconds;
+    unsigned i;
+    unsigned j;
+
+    memset(result, 0, sizeof(*result));
+    result->n_lines = count_lines(src, src_len);
+    result->n_bytes = src_len;
+
+    for (i = 0; i < args->n_warmups + args->n_reps; i++) {
+        if (run_once(args, name, src, src_len, &report, &seconds)) {
+            fprintf(stderr, "error: corpus '%s' failed to compile.\n", name);
+            safe_free(src);
+            return true;
+        }
+        if (i < args->n_warmups)
+            continue;
+
+        for (j = 0; j < TimeStage_COUNT; j++) {
+            result->stage_seconds[j] += report.seconds[j];
+            if (i == args->n_warmups ||
+                    report.seconds[j] < result->stage_min_seconds[j])
+                result->stage_min_seconds[j] = report.seconds[j];
+            result->stage_items[j] = report.n_items[j];
+            result->stage_ran[j] = report.ran[j];
+        }
+        result->total_seconds += seconds;
+        if (i == args->n_warmups || seconds < result->min_seconds)
+            result->min_seconds = seconds;
+    }
+
+    result->n_tokens = result->stage_items[TimeStage_LEX];
+
+    safe_free(src);
+    return false;
+
+}
+
+/* n/seconds, or 0 if the stage was too quick to measure */
+static double per_second(double n, double seconds) {
+
+    return seconds > 0 ? n/seconds : 0;
+
+}
+
+static void print_result(const struct BenchArgs *args,
+        const struct BenchResult *result, enum CorpusKind kind,
+        FILE *stream) {
+
+    double mean = result->total_seconds/args->n_reps;
+    unsigned i;
+    bool first_stage = true;
+
+    fprintf(stream, "    {\n");
+    fprintf(stream, "      \"name\": \"%s\",\n", CorpusKind_name(kind));
+    fprintf(stream, "      \"lines\": %u, \"bytes\": %u, \"tokens\": %u,\n",
+            result->n_lines, result->n_bytes, result->n_tokens);
+    fprintf(stream, "      \"total\": {\"mean_ms\": %.3f, \"min_ms\": %.3f,"
+            " \"lines_per_sec\": %.0f, \"tokens_per_sec\": %.0f},\n",
+            mean*1e3, result->min_seconds*1e3,
+            per_second(result->n_lines, mean),
+            per_second(result->n_tokens, mean));
+    fprintf(stream, "      \"stages\": [");
+
+    for (i = 0; i < TimeStage_COUNT; i++) {
+        double stage_mean = result->stage_seconds[i]/args->n_reps;
+
+        if (!result->stage_ran[i])
+            continue;
+
+        fprintf(stream, "%s\n        {\"name\": \"%s\", \"mean_ms\": %.3f,"
+                " \"lines_per_sec\": %.0f, \"tokens_per_sec\": %.0f,"
+                " \"items\": %u, \"unit\": \"%s\","
+                " \"items_per_sec\": %.0f}", first_stage ? "" : ",",
+                TimeStage_name(i), stage_mean*1e3,
+                per_second(result->n_lines, stage_mean),
+                per_second(result->n_tokens, stage_mean),
+                result->stage_items[i], TimeStage_unit(i),
+                per_second(result->stage_items[i], stage_mean));
+        first_stage = false;
+    }
+
+    fprintf(stream, "\n      ]\n    }");
+
+}
+
+/* the stage called name, TimeStage_COUNT if there isn't one */
+static enum TimeStage find_stage(const char *name) {
+
+    unsigned i;
+
+    for (i = 0; i < TimeStage_COUNT; i++) {
+        if (strcmp(TimeStage_name(i), name) == 0)
+            break;
+    }
+
+    return i;
+
+}
+
+/* the fastest time the stage took per byte of source, in nanoseconds. the
+ * stages' own items don't always grow with the source, merging strings leaves
+ * fewer tokens the longer the chains get */
+static double ns_per_byte(const struct BenchResult *result,
+        enum TimeStage stage) {
+
+    return result->stage_min_seconds[stage]*1e9/result->n_bytes;
+
+}
+
+/* runs the corpus at args->scale and at 4 times that. returns true if either
+ * failed to compile */
+static bool bench_scales(const struct BenchArgs *args, enum CorpusKind kind,
+        struct BenchResult *small, struct BenchResult *big) {
+
+    struct BenchArgs big_args = *args;
+
+    big_args.scale = args->scale*4;
+
+    return bench_corpus(args, kind, small) ||
+        bench_corpus(&big_args, kind, big);
+
+}
+
+/* a stage that's linear takes about the same time per byte at both scales, a
+ * quadratic one 4 times as long, so more than twice as long fails. returns
+ * true if it failed. */
+static bool print_linear_check(const struct BenchArgs *args,
+        const struct BenchResult *small, const struct BenchResult *big,
+        enum CorpusKind kind, enum TimeStage stage, FILE *stream) {
+
+    double growth = ns_per_byte(small, stage) > 0 ?
+        ns_per_byte(big, stage)/ns_per_byte(small, stage) : 0;
+    bool linear = growth <= 2;
+
+    fprintf(stream, "    {\"name\": \"%s\", \"stage\": \"%s\",\n",
+            CorpusKind_name(kind), TimeStage_name(stage));
+    fprintf(stream, "      \"small\": {\"scale\": %u, \"bytes\": %u,"
+            " \"ns_per_byte\": %.3f},\n", args->scale, small->n_bytes,
+            ns_per_byte(small, stage));
+    fprintf(stream, "      \"big\": {\"scale\": %u, \"bytes\": %u,"
+            " \"ns_per_byte\": %.3f},\n", args->scale*4, big->n_bytes,
+            ns_per_byte(big, stage));
+    fprintf(stream, "      \"growth\": %.2f, \"linear\": %s}", growth,
+            linear ? "true" : "false");
+
+    if (!linear) {
+        fprintf(stderr, "error: '%s' of corpus '%s' isn't linear, it takes"
+                " %.2fx the time per byte at 4x the size.\n",
+                TimeStage_name(stage), CorpusKind_name(kind), growth);
+    }
+
+    return !linear;
+
+}
+
+static bool write_corpora(const struct BenchArgs *args) {
+
+    unsigned i;
+
+    for (i = 0; i < CorpusKind_COUNT; i++) {
+        const char *name = CorpusKind_name(i);
+        char *path = NULL;
+        char *src = NULL;
+        u32 src_len = 0;
+        FILE *file = NULL;
+
+        if (args->only_corpus && strcmp(args->only_corpus, name) != 0)
+            continue;
+
+        path = safe_malloc(strlen(args->corpus_dir)+strlen(name)+4,
+                MemTag_DRIVER);
+        sprintf(path, "%s/%s.c", args->corpus_dir, name);
+
+        file = fopen(path, "w");
+        if (!file) {
+            fprintf(stderr, "can't open file '%s'\n", path);
+            m_free(path);
+            return false;
+        }
+        src = Corpus_generate(i, args->scale, &src_len);
+        fwrite(src, 1, src_len, file);
+        fclose(file);
+
+        safe_free(src);
+        m_free(path);
+    }
+
+    return true;
+
+}
+
+int main(int argc, char *argv[]) {
+
+    struct BenchArgs args;
+    struct BenchResult result;
+    struct BenchResult big_result;
+    FILE *out_stream = stdout;
+    bool error_occurred = false;
+    bool first_corpus = true;
+    enum TimeStage linear_stage = TimeStage_COUNT;
+    unsigned i;
+
+    if (!get_args(&args, argc, argv))
+        return 1;
+
+    if (args.corpus_dir)
+        return !write_corpora(&args);
+
+    if (args.linear_stage) {
+        linear_stage = find_stage(args.linear_stage);
+        if (linear_stage == TimeStage_COUNT) {
+            fprintf(stderr, "error: there's no stage called '%s'.\n",
+                    args.linear_stage);
+            return 1;
+        }
+    }
+
+    if (args.out_path) {
+        out_stream = fopen(args.out_path, "w");
+        if (!out_stream) {
+            fprintf(stderr, "can't open file '%s'\n", args.out_path);
+            return 1;
+        }
+    }
+
+    fprintf(out_stream, "{\n");
+    fprintf(out_stream, "  \"scale\": %u, \"reps\": %u, \"warmups\": %u,"
+            " \"optimize\": %s,\n", args.scale, args.n_reps, args.n_warmups,
+            args.optimize ? "true" : "false");
+    fprintf(out_stream, "  \"corpora\": [");
+
+    for (i = 0; i < CorpusKind_COUNT; i++) {
+        if (args.only_corpus &&
+                strcmp(args.only_corpus, CorpusKind_name(i)) != 0)
+            continue;
+
+        if (linear_stage == TimeStage_COUNT ?
+                bench_corpus(&args, i, &result) :
+                bench_scales(&args, i, &result, &big_result)) {
+            error_occurred = true;
+            continue;
+        }
+
+        fprintf(out_stream, "%s\n", first_corpus ? "" : ",");
+        if (linear_stage == TimeStage_COUNT)
+            print_result(&args, &result, i, out_stream);
+        else
+            error_occurred |= print_linear_check(&args, &result, &big_result,
+                    i, linear_stage, out_stream);
+        first_corpus = false;
+    }
+
+    fprintf(out_stream, "\n  ]\n}\n");
+
+    if (out_stream != stdout)
+        fclose(out_stream);
+
+    return error_occurred;
+
+}
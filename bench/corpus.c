@@ -0,0 +1,349 @@
+#include "corpus.h"
+#include "out_buf.h"
+#include "comp_dependent/ints.h"
+#include "bool.h"
+
+static const char *kind_names[CorpusKind_COUNT] = {
+    "funcs",
+    "exprs",
+    "defines",
+    "arrays",
+    "strings",
+    "nesting",
+    "resource",
+    "macros",
+    "func_macros",
+    "expansions",
+};
+
+const char* CorpusKind_name(enum CorpusKind kind) {
+
+    return kind_names[kind];
+
+}
+
+static void append_i32_str(struct OutBuf *out, const char *before, i32 value,
+        const char *after) {
+
+    OutBuf_append_str(out, before);
+    OutBuf_append_i32(out, value);
+    OutBuf_append_str(out, after);
+
+}
+
+static void gen_funcs(struct OutBuf *out, u32 scale) {
+
+    u32 n_funcs = 100*scale;
+    u32 i;
+
+    OutBuf_append_str(out, "int printf(char *fmt, ...);\n\n");
+
+    for (i = 0; i < n_funcs; i++) {
+        append_i32_str(out, "static int f", i, "(int a, int b) {\n\n");
+        append_i32_str(out, "    int x = a*", i%13+1, " + b;\n");
+        OutBuf_append_str(out, "    int i;\n\n");
+        OutBuf_append_str(out, "    for (i = 0; i < 8; i++) {\n");
+        append_i32_str(out, "        x = x + i * (a - ", i%7, ");\n");
+        append_i32_str(out, "        if (x > ", i%50, " && a < b || !b)\n");
+        OutBuf_append_str(out, "            x = x - 1;\n");
+        OutBuf_append_str(out, "        else\n");
+        OutBuf_append_str(out, "            x = x + 2;\n");
+        OutBuf_append_str(out, "    }\n\n");
+        OutBuf_append_str(out, "    while (x > 100)\n");
+        OutBuf_append_str(out, "        x = x / 2;\n\n");
+        if (i > 0)
+            append_i32_str(out, "    x = x + f", i-1, "(b, x % 5);\n");
+        append_i32_str(out, "    printf(\"f", i, " %d\\n\", x);\n");
+        OutBuf_append_str(out, "    return x % 1000;\n\n");
+        OutBuf_append_str(out, "}\n\n");
+    }
+
+    OutBuf_append_str(out, "int main(void) {\n\n");
+    append_i32_str(out, "    return f", n_funcs-1, "(1, 2);\n\n");
+    OutBuf_append_str(out, "}\n");
+
+}
+
+/* a chain of operators, each operand being another parenthesized chain until
+ * depth runs out */
+static void gen_expr(struct OutBuf *out, u32 depth, u32 seed) {
+
+    /* no division, the constant folder would choke on dividing by zero. no
+     * ||, the code generated for it grows exponentially with the depth. */
+    static const char *ops[] = {" + ", " - ", " * ", " < ", " != "};
+
+    if (depth == 0) {
+        if (seed % 3 == 0)
+            OutBuf_append_char(out, 'a');
+        else if (seed % 3 == 1)
+            OutBuf_append_char(out, 'b');
+        else
+            OutBuf_append_u32(out, seed % 97 + 1);
+        return;
+    }
+
+    OutBuf_append_char(out, '(');
+    gen_expr(out, depth-1, seed*7+1);
+    OutBuf_append_str(out, ops[seed % (sizeof(ops)/sizeof(*ops))]);
+    /* keeps the tree from blowing up, only the left side goes deep */
+    gen_expr(out, depth > 2 ? 1 : 0, seed*13+5);
+    OutBuf_append_char(out, ')');
+
+}
+
+static void gen_exprs(struct OutBuf *out, u32 scale) {
+
+    u32 n_funcs = 20*scale;
+    u32 i;
+    u32 j;
+
+    for (i = 0; i < n_funcs; i++) {
+        append_i32_str(out, "int e", i, "(int a, int b) {\n\n");
+        OutBuf_append_str(out, "    int x = 0;\n");
+        for (j = 0; j < 16; j++) {
+            OutBuf_append_str(out, "    x = x + ");
+            gen_expr(out, 8 + j, i*31+j);
+            OutBuf_append_str(out, ";\n");
+        }
+        OutBuf_append_str(out, "    return x;\n\n");
+        OutBuf_append_str(out, "}\n\n");
+    }
+
+    OutBuf_append_str(out, "int main(void) {\n\n");
+    append_i32_str(out, "    return e", n_funcs-1, "(3, 4);\n\n");
+    OutBuf_append_str(out, "}\n");
+
+}
+
+static void gen_defines(struct OutBuf *out, u32 scale) {
+
+    u32 n_defines = 1000*scale;
+    u32 i;
+
+    for (i = 0; i < n_defines; i++) {
+        append_i32_str(out, "#define m_def_", i, " ");
+        append_i32_str(out, "(", i%17, " * 3 + ");
+        append_i32_str(out, "", i%5+1, ")\n");
+    }
+
+    OutBuf_append_str(out, "\nint main(void) {\n\n");
+    OutBuf_append_str(out, "    int x = 0;\n");
+    for (i = 0; i < n_defines; i++)
+        append_i32_str(out, "    x = x + m_def_", i, ";\n");
+    OutBuf_append_str(out, "    return x;\n\n");
+    OutBuf_append_str(out, "}\n");
+
+}
+
+static void gen_arrays(struct OutBuf *out, u32 scale) {
+
+    u32 n_arrays = 20*scale;
+    u32 array_len = 256;
+    u32 i;
+    u32 j;
+
+    OutBuf_append_str(out, "int main(void) {\n\n");
+    OutBuf_append_str(out, "    int x;\n");
+    for (i = 0; i < n_arrays; i++) {
+        append_i32_str(out, "    int arr", i, "");
+        append_i32_str(out, "[", array_len, "] = {");
+        for (j = 0; j < array_len; j++) {
+            if (j % 16 == 0)
+                OutBuf_append_str(out, "\n        ");
+            append_i32_str(out, "", (i*array_len+j) % 1000,
+                    j+1 < array_len ? ", " : "");
+        }
+        OutBuf_append_str(out, "\n    };\n");
+    }
+
+    /* the subscripts stay on the right, the parser doesn't handle a binary
+     * operator after one yet */
+    OutBuf_append_str(out, "\n    x = 0;\n");
+    for (i = 0; i < n_arrays; i++)
+        append_i32_str(out, "    x = x + arr", i, "[1];\n");
+    OutBuf_append_str(out, "    return x;\n\n}\n");
+
+}
+
+static void gen_strings(struct OutBuf *out, u32 scale) {
+
+    u32 n_strings = 40*scale;
+    u32 chain_len = 64;
+    u32 i;
+    u32 j;
+
+    OutBuf_append_str(out, "int printf(char *fmt, ...);\n\n");
+    OutBuf_append_str(out, "int main(void) {\n\n");
+    for (i = 0; i < n_strings; i++) {
+        OutBuf_append_str(out, "    printf(");
+        for (j = 0; j < chain_len; j++) {
+            append_i32_str(out, "\n        \"string ", i, "");
+            append_i32_str(out, " part ", j, " of the chain\\n\"");
+        }
+        OutBuf_append_str(out, ");\n");
+    }
+    OutBuf_append_str(out, "    return 0;\n\n}\n");
+
+}
+
+static void gen_nesting(struct OutBuf *out, u32 scale) {
+
+    u32 n_funcs = 10*scale;
+    u32 depth = 48;
+    u32 i;
+    u32 j;
+    u32 k;
+
+    for (i = 0; i < n_funcs; i++) {
+        append_i32_str(out, "int n", i, "(int a) {\n\n");
+        OutBuf_append_str(out, "    int x = 0;\n");
+        for (j = 0; j < depth; j++) {
+            for (k = 0; k < j+1; k++)
+                OutBuf_append_str(out, "    ");
+            if (j % 3 == 0)
+                append_i32_str(out, "if (a > ", j, ") {\n");
+            else if (j % 3 == 1)
+                append_i32_str(out, "while (x < ", j, ") {\n");
+            else {
+                OutBuf_append_str(out, "{\n");
+            }
+            for (k = 0; k < j+2; k++)
+                OutBuf_append_str(out, "    ");
+            append_i32_str(out, "x = x + ", j+1, ";\n");
+        }
+        for (j = depth; j > 0; j--) {
+            for (k = 0; k < j; k++)
+                OutBuf_append_str(out, "    ");
+            OutBuf_append_str(out, "}\n");
+        }
+        OutBuf_append_str(out, "    return x;\n\n");
+        OutBuf_append_str(out, "}\n\n");
+    }
+
+    OutBuf_append_str(out, "int main(void) {\n\n");
+    append_i32_str(out, "    return n", n_funcs-1, "(1);\n\n");
+    OutBuf_append_str(out, "}\n");
+
+}
+
+static void gen_resource(struct OutBuf *out, u32 scale) {
+
+    u32 chain_len = 2000*scale;
+    u32 i;
+
+    OutBuf_append_str(out, "int printf(char *fmt, ...);\n\n");
+    OutBuf_append_str(out, "int main(void) {\n\n");
+    OutBuf_append_str(out, "    printf(");
+    for (i = 0; i < chain_len; i++)
+        append_i32_str(out, "\n        \"line ", i, " of the resource\\n\"");
+    OutBuf_append_str(out, ");\n");
+    OutBuf_append_str(out, "    return 0;\n\n}\n");
+
+}
+
+/* the function-like macros expand to the same code as the object-like ones,
+ * they just get a and b as arguments. their preproc stage takes about 3x as
+ * long, since every use's arguments have to be lexed, but the whole compile
+ * is only 4-8% slower */
+static void gen_macros(struct OutBuf *out, u32 scale, bool func_like) {
+
+    u32 n_macros = 8;
+    u32 n_funcs = 20*scale;
+    u32 uses_per_func = 100;
+    u32 i;
+    u32 j;
+
+    for (i = 0; i < n_macros; i++) {
+        append_i32_str(out, "#define m_mix_", i,
+                func_like ? "(a, b) " : " ");
+        append_i32_str(out, "(a * ", i+2, " + b - (a < b) * ");
+        append_i32_str(out, "", i+5, " + (b - a) * (a + ");
+        append_i32_str(out, "", i+1, "))\n");
+    }
+
+    for (i = 0; i < n_funcs; i++) {
+        append_i32_str(out, "\nint u", i, "(int a, int b) {\n\n");
+        OutBuf_append_str(out, "    int x = 0;\n");
+        for (j = 0; j < uses_per_func; j++)
+            append_i32_str(out, "    x = x + m_mix_", (i+j) % n_macros,
+                    func_like ? "(a, b);\n" : ";\n");
+        OutBuf_append_str(out, "    return x;\n\n");
+        OutBuf_append_str(out, "}\n");
+    }
+
+    OutBuf_append_str(out, "\nint main(void) {\n\n");
+    append_i32_str(out, "    return u", n_funcs-1, "(3, 4);\n\n");
+    OutBuf_append_str(out, "}\n");
+
+}
+
+static void gen_expansions(struct OutBuf *out, u32 scale) {
+
+    u32 n_uses = 4000*scale;
+    u32 i;
+
+    OutBuf_append_str(out, "#define m_step (1 + 2)\n\n");
+    OutBuf_append_str(out, "int main(void) {\n\n");
+    OutBuf_append_str(out, "    int x = 0;\n");
+    for (i = 0; i < n_uses; i++)
+        OutBuf_append_str(out, "    x = x + m_step;\n");
+    OutBuf_append_str(out, "    return x;\n\n}\n");
+
+}
+
+char* Corpus_generate(enum CorpusKind kind, u32 scale, u32 *len) {
+
+    struct OutBuf out = OutBuf_create(-1);
+
+    switch (kind) {
+
+    case CorpusKind_FUNCS:
+        gen_funcs(&out, scale);
+        break;
+
+    case CorpusKind_EXPRS:
+        gen_exprs(&out, scale);
+        break;
+
+    case CorpusKind_DEFINES:
+        gen_defines(&out, scale);
+        break;
+
+    case CorpusKind_ARRAYS:
+        gen_arrays(&out, scale);
+        break;
+
+    case CorpusKind_STRINGS:
+        gen_strings(&out, scale);
+        break;
+
+    case CorpusKind_NESTING:
+        gen_nesting(&out, scale);
+        break;
+
+    case CorpusKind_RESOURCE:
+        gen_resource(&out, scale);
+        break;
+
+    case CorpusKind_MACROS:
+        gen_macros(&out, scale, false);
+        break;
+
+    case CorpusKind_FUNC_MACROS:
+        gen_macros(&out, scale, true);
+        break;
+
+    case CorpusKind_EXPANSIONS:
+        gen_expansions(&out, scale);
+        break;
+
+    case CorpusKind_COUNT:
+        break;
+
+    }
+
+    *len = out.size;
+    OutBuf_append_char(&out, '\0');
+    return out.buf;
+
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+/* generates synthetic C sources for mcc-bench. they only use what the
+ * compiler supports, and each kind stresses a different part of it. */
+
+#include "comp_dependent/ints.h"
+
+enum CorpusKind {
+
+    /* lots of small functions with loops, ifs and calls */
+    CorpusKind_FUNCS,
+    /* long and deeply parenthesized expressions */
+    CorpusKind_EXPRS,
+    /* a long list of #defines that all get used */
+    CorpusKind_DEFINES,
+    /* big array literals */
+    CorpusKind_ARRAYS,
+    /* long chains of string literals that have to be merged */
+    CorpusKind_STRINGS,
+    /* deeply nested blocks */
+    CorpusKind_NESTING,
+    /* one string literal chain, like an embedded file. unlike the other kinds
+     * the chain itself gets longer with the scale, so merging the strings
+     * has to stay linear in their length */
+    CorpusKind_RESOURCE,
+    /* a few macros that each get used thousands of times */
+    CorpusKind_MACROS,
+    /* the same, with function-like macros */
+    CorpusKind_FUNC_MACROS,
+    /* one macro used over and over in a single function. the number of uses
+     * grows with the scale, so finding each one has to stay constant time */
+    CorpusKind_EXPANSIONS,
+
+    CorpusKind_COUNT
+
+};
+
+const char* CorpusKind_name(enum CorpusKind kind);
+
+/* returns a '\0' terminated source that has to be freed with safe_free.
+ * scale multiplies how much code gets generated, 1 gives a few thousand
+ * lines. */
+char* Corpus_generate(enum CorpusKind kind, u32 scale, u32 *len);
@@ -0,0 +1,130 @@
+#include "arena.h"
+#include "safe_mem.h"
+#include <string.h>
+
+struct ArenaBlock {
+
+    struct ArenaBlock *next;
+    size_t size;
+    size_t used;
+
+};
+
+/* every allocation gets aligned to this */
+union ArenaAlign {
+
+    long l;
+    double d;
+    long double ld;
+    void *ptr;
+    void (*func_ptr)(void);
+
+};
+
+#define m_arena_align sizeof(union ArenaAlign)
+
+/* the data of a block starts right after the header */
+#define m_arena_header_size \
+    ((sizeof(struct ArenaBlock)+m_arena_align-1) / m_arena_align * \
+     m_arena_align)
+
+struct Arena Arena_create(enum MemTag tag) {
+
+    struct Arena arena;
+    arena.blocks = NULL;
+    arena.tag = tag;
+    return arena;
+
+}
+
+static struct ArenaBlock* new_block(struct Arena *self, size_t size) {
+
+    struct ArenaBlock *block =
+        safe_malloc(m_arena_header_size+size, self->tag);
+    block->size = size;
+    block->used = 0;
+    return block;
+
+}
+
+void* Arena_alloc(struct Arena *self, size_t size) {
+
+    struct ArenaBlock *block = NULL;
+
+    size = (size+m_arena_align-1) / m_arena_align * m_arena_align;
+    if (size == 0)
+        size = m_arena_align;
+
+    /* the newest block is always a normal sized one */
+    if (!self->blocks) {
+        self->blocks = new_block(self, m_arena_block_size);
+        self->blocks->next = NULL;
+    }
+    block = self->blocks;
+
+    if (size > m_arena_block_size/4) {
+        /* big allocations get their own block behind the current one, so
+         * what's left of the current one doesn't go to waste */
+        struct ArenaBlock *big_block = new_block(self, size);
+        big_block->next = block->next;
+        block->next = big_block;
+        big_block->used = size;
+        return (char *)big_block + m_arena_header_size;
+    }
+
+    if (block->size - block->used < size) {
+        block = new_block(self, m_arena_block_size);
+        block->next = self->blocks;
+        self->blocks = block;
+    }
+
+    block->used += size;
+    return (char *)block + m_arena_header_size + block->used - size;
+
+}
+
+void* Arena_copy(struct Arena *self, const void *ptr, size_t size) {
+
+    void *copy = NULL;
+
+    if (size > 0) {
+        copy = Arena_alloc(self, size);
+        memcpy(copy, ptr, size);
+    }
+
+    return copy;
+
+}
+
+void* Arena_take(struct Arena *self, void *ptr, size_t size) {
+
+    void *copy = Arena_copy(self, ptr, size);
+
+    safe_free(ptr);
+    return copy;
+
+}
+
+void Arena_reset(struct Arena *self) {
+
+    if (!self->blocks)
+        return;
+
+    while (self->blocks->next) {
+        struct ArenaBlock *next = self->blocks->next;
+        self->blocks->next = next->next;
+        safe_free(next);
+    }
+    self->blocks->used = 0;
+
+}
+
+void Arena_free(struct Arena *self) {
+
+    while (self->blocks) {
+        struct ArenaBlock *next = self->blocks->next;
+        safe_free(self->blocks);
+        self->blocks = next;
+    }
+
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+/* a bump-pointer allocator. everything allocated from an arena is released at
+ * once by Arena_reset or Arena_free, there's no freeing single allocations. */
+
+#include "safe_mem.h"
+#include <stddef.h>
+
+/* how big the blocks the arena gets its memory from are. bigger allocations
+ * get a block of their own */
+#define m_arena_block_size 65536
+
+struct ArenaBlock;
+
+struct Arena {
+
+    /* the newest block first. allocations are made from the newest one */
+    struct ArenaBlock *blocks;
+    enum MemTag tag;
+
+};
+
+/* doesn't allocate anything until the first Arena_alloc */
+struct Arena Arena_create(enum MemTag tag);
+
+/* returns memory aligned for any type. never returns NULL, runs out of memory
+ * the same way safe_malloc does */
+void* Arena_alloc(struct Arena *self, size_t size);
+
+/* copies size bytes from ptr into the arena and frees ptr, which has to come
+ * from the safe_* functions. for moving finished lists and strings into the
+ * arena so they don't need freeing later. returns NULL if size is 0. */
+void* Arena_take(struct Arena *self, void *ptr, size_t size);
+
+/* like Arena_take, but ptr is left alone */
+void* Arena_copy(struct Arena *self, const void *ptr, size_t size);
+
+/* releases every allocation. the first block is kept around so an arena that
+ * gets reused doesn't have to allocate it again */
+void Arena_reset(struct Arena *self);
+
+void Arena_free(struct Arena *self);
+
+/* moves the elements of a vector that's done growing into the arena. nothing
+ * can be pushed to the vector after that, and it must not be freed. growing
+ * it trips the assert in the vector's set_capacity */
+#define m_arena_take_vec(arena, vec) \
+    do { \
+        (vec).elems = Arena_take(arena, (vec).elems, \
+                (vec).size*sizeof(*(vec).elems)); \
+        (vec).capacity = (vec).size; \
+    } while (0)
+
+/* m_arena_take_vec for SmallVecImpl vectors. the elements get copied if
+ * they're still on the caller's storage, and taken if they're on the heap */
+#define m_arena_take_small_vec(arena, vec) \
+    do { \
+        if (m_small_vec_is_inline(&(vec))) { \
+            (vec).elems = Arena_copy(arena, (vec).elems, \
+                    (vec).size*sizeof(*(vec).elems)); \
+        } \
+        else { \
+            (vec).elems = Arena_take(arena, (vec).elems, \
+                    (vec).size*sizeof(*(vec).elems)); \
+        } \
+        (vec).capacity = (vec).size; \
+        (vec).inline_elems = NULL; \
+    } while (0)
@@ -25,15 +25,4 @@ struct ArrayLit ArrayLit_create(struct Expr **values, u32 n_values,
 
 }
 
-void ArrayLit_free(struct ArrayLit *self) {
-
-    u32 i;
-    for (i = 0; i < self->n_values; i++) {
-        Expr_recur_free_w_self(self->values[i]);
-    }
-
-    m_free(self->values);
-
-}
-
-m_define_VectorImpl_funcs(ArrayLitList, struct ArrayLit)
+m_define_VectorImpl_funcs(ArrayLitList, struct ArrayLit, MemTag_IR)
@@ -21,7 +21,6 @@ struct ArrayLit {
 struct ArrayLit ArrayLit_init(void);
 struct ArrayLit ArrayLit_create(struct Expr **values, u32 n_values,
         unsigned elem_size);
-void ArrayLit_free(struct ArrayLit *self);
 
 struct ArrayLitList {
 
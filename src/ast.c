@@ -5,6 +5,7 @@
 #include "parser_var.h"
 #include "prim_type.h"
 #include "safe_mem.h"
+#include "interner.h"
 #include "token.h"
 #include "type_mods.h"
 #include "vector_impl.h"
@@ -13,7 +14,6 @@
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <string.h>
 
 struct ASTNode ASTNode_init(void) {
 
@@ -38,54 +38,26 @@ struct ASTNode ASTNode_create(unsigned line_num, unsigned column_num,
 
 }
 
-void ASTNode_free(struct ASTNode node) {
-
-    if (node.node_struct) {
-        if (node.type == ASTType_EXPR)
-            ExprNode_free_w_self(node.node_struct);
-        else if (node.type == ASTType_VAR_DECL)
-            VarDeclNode_free_w_self(node.node_struct);
-        else if (node.type == ASTType_FUNC)
-            FuncDeclNode_free_w_self(node.node_struct);
-        else if (node.type == ASTType_BLOCK)
-            BlockNode_free_w_self(node.node_struct);
-        else if (node.type == ASTType_RETURN)
-            RetNode_free_w_self(node.node_struct);
-        else if (node.type == ASTType_IF_STMT)
-            IfNode_free_w_self(node.node_struct);
-        else if (node.type == ASTType_WHILE_STMT)
-            WhileNode_free_w_self(node.node_struct);
-        else if (node.type == ASTType_FOR_STMT)
-            ForNode_free_w_self(node.node_struct);
-
-        else if (node.type == ASTType_DEBUG_RAX)
-            m_free(node.node_struct);
-        else
-            assert(false);
-    }
-
-}
-
 void ASTNode_get_array_lits(const struct ASTNode *self,
-        struct ArrayLitList *list) {
+        const struct ExprTable *exprs, struct ArrayLitList *list) {
 
     if (self->node_struct) {
         if (self->type == ASTType_EXPR)
-            ExprNode_get_array_lits(self->node_struct, list);
+            ExprNode_get_array_lits(self->node_struct, exprs, list);
         else if (self->type == ASTType_VAR_DECL)
-            VarDeclNode_get_array_lits(self->node_struct, list);
+            VarDeclNode_get_array_lits(self->node_struct, exprs, list);
         else if (self->type == ASTType_FUNC)
-            FuncDeclNode_get_array_lits(self->node_struct, list);
+            FuncDeclNode_get_array_lits(self->node_struct, exprs, list);
         else if (self->type == ASTType_BLOCK)
-            BlockNode_get_array_lits(self->node_struct, list);
+            BlockNode_get_array_lits(self->node_struct, exprs, list);
         else if (self->type == ASTType_RETURN)
-            RetNode_get_array_lits(self->node_struct, list);
+            RetNode_get_array_lits(self->node_struct, exprs, list);
         else if (self->type == ASTType_IF_STMT)
-            IfNode_get_array_lits(self->node_struct, list);
+            IfNode_get_array_lits(self->node_struct, exprs, list);
         else if (self->type == ASTType_WHILE_STMT)
-            WhileNode_get_array_lits(self->node_struct, list);
+            WhileNode_get_array_lits(self->node_struct, exprs, list);
         else if (self->type == ASTType_FOR_STMT)
-            ForNode_get_array_lits(self->node_struct, list);
+            ForNode_get_array_lits(self->node_struct, exprs, list);
     }
 
 }
@@ -145,120 +117,187 @@ bool ExprType_is_valid_unary_ptr_operation(enum ExprType type) {
 
 }
 
+struct ExprTable ExprTable_init(void) {
+
+    struct ExprTable table;
+    table.tokens = NULL;
+    table.tok_idxs = ExprTokIdxList_init();
+    table.extras = ExprExtraList_init();
+    return table;
+
+}
+
+/* the args lists and array literal values are in the AST arena, so there's
+ * nothing in the extras to free */
+void ExprTable_clear(struct ExprTable *self) {
+
+    self->tokens = NULL;
+    ExprTokIdxList_clear(&self->tok_idxs, NULL);
+    ExprExtraList_clear(&self->extras, NULL);
+
+}
+
+void ExprTable_truncate(struct ExprTable *self, u32 n_exprs) {
+
+    if (n_exprs >= self->tok_idxs.size)
+        return;
+
+    self->tok_idxs.size = n_exprs;
+    while (self->extras.size > 0 &&
+            ExprExtraList_back(&self->extras).expr_id >= n_exprs)
+        ExprExtraList_pop_back(&self->extras, NULL);
+
+}
+
+void ExprTable_free(struct ExprTable *self) {
+
+    ExprTokIdxList_free(&self->tok_idxs);
+    ExprExtraList_free(&self->extras);
+
+}
+
+/* returns NULL if the expr has no extra */
+static struct ExprExtra* find_extra(const struct ExprTable *exprs, u32 id) {
+
+    u32 low = 0;
+    u32 high = exprs->extras.size;
+
+    while (low < high) {
+        u32 mid = low + (high-low)/2;
+        if (exprs->extras.elems[mid].expr_id < id)
+            low = mid+1;
+        else
+            high = mid;
+    }
+
+    if (low < exprs->extras.size && exprs->extras.elems[low].expr_id == id)
+        return &exprs->extras.elems[low];
+    return NULL;
+
+}
+
 struct Expr Expr_init(void) {
 
     struct Expr expr;
-    expr.line_num = 0;
-    expr.column_num = 0;
-    expr.src_start = NULL;
-    expr.src_len = 0;
-    expr.file_path = NULL;
     expr.lhs = NULL;
     expr.rhs = NULL;
-    expr.lhs_lvls_of_indir = 0;
-    expr.rhs_lvls_of_indir = 0;
+    expr.int_value = 0;
+    expr.bp_offset = 0;
+    expr.id = m_u32_max;
+    expr.expr_type = ExprType_INVALID;
     expr.lhs_og_type = PrimType_INVALID;
     expr.rhs_og_type = PrimType_INVALID;
     expr.lhs_type = expr.lhs_og_type;
     expr.rhs_type = expr.rhs_og_type;
-    expr.args = ExprPtrList_init();
-    expr.expr_type = ExprType_INVALID;
-    expr.int_value = 0;
-    expr.array_value = ArrayLit_init();
-    expr.bp_offset = 0;
-    expr.is_array = false;
-    expr.array_len = 0;
-    expr.lvls_of_indir = 0;
     expr.prim_type = PrimType_INVALID;
     expr.non_prom_prim_type = PrimType_INVALID;
+    expr.lhs_lvls_of_indir = 0;
+    expr.rhs_lvls_of_indir = 0;
+    expr.lvls_of_indir = 0;
+    expr.is_array = false;
     return expr;
 
 }
 
-struct Expr Expr_create(unsigned line_num, unsigned column_num,
-        const char *src_start, unsigned src_len, const char *file_path,
+struct Expr Expr_create_w_tok(struct ExprTable *exprs, u32 tok_idx,
         struct Expr *lhs, struct Expr *rhs, unsigned lhs_lvls_of_indir,
         unsigned rhs_lvls_of_indir, enum PrimitiveType lhs_type,
         enum PrimitiveType rhs_type, struct ExprPtrList args, u32 int_value,
         struct ArrayLit array_value, i32 bp_offset, enum ExprType expr_type,
-        bool is_array, u32 array_len) {
+        bool is_array) {
 
     struct Expr expr;
-    expr.line_num = line_num;
-    expr.column_num = column_num;
-    expr.src_start = src_start;
-    expr.src_len = src_len;
-    expr.file_path = file_path;
     expr.lhs = lhs;
     expr.rhs = rhs;
-    expr.lhs_lvls_of_indir = lhs_lvls_of_indir;
-    expr.rhs_lvls_of_indir = rhs_lvls_of_indir;
+    expr.int_value = int_value;
+    expr.bp_offset = bp_offset;
+    expr.id = exprs->tok_idxs.size;
+    expr.expr_type = expr_type;
     expr.lhs_og_type = lhs_type;
     expr.rhs_og_type = rhs_type;
     expr.lhs_type = lhs_type == PrimType_INVALID ? PrimType_INVALID :
-        PrimitiveType_promote(lhs_type, expr.lhs_lvls_of_indir);
+        PrimitiveType_promote(lhs_type, lhs_lvls_of_indir);
     expr.rhs_type = rhs_type == PrimType_INVALID ? PrimType_INVALID :
-        PrimitiveType_promote(rhs_type, expr.rhs_lvls_of_indir);
-    expr.args = args;
-    expr.int_value = int_value;
-    expr.array_value = array_value;
-    expr.bp_offset = bp_offset;
-    expr.expr_type = expr_type;
-    expr.is_array = is_array;
-    expr.array_len = array_len;
-    expr.lvls_of_indir = 0;
+        PrimitiveType_promote(rhs_type, rhs_lvls_of_indir);
     expr.prim_type = PrimType_INVALID;
     expr.non_prom_prim_type = PrimType_INVALID;
+    expr.lhs_lvls_of_indir = lhs_lvls_of_indir;
+    expr.rhs_lvls_of_indir = rhs_lvls_of_indir;
+    expr.lvls_of_indir = 0;
+    expr.is_array = is_array;
+
+    ExprTokIdxList_push_back(&exprs->tok_idxs, tok_idx);
+    /* func calls get their args after they're created, but the extra has to
+     * be added now to keep the list sorted */
+    if (expr_type == ExprType_FUNC_CALL || expr_type == ExprType_ARRAY_LIT) {
+        struct ExprExtra extra;
+        extra.expr_id = expr.id;
+        extra.args = args;
+        extra.array_value = array_value;
+        ExprExtraList_push_back(&exprs->extras, extra);
+    }
+    else
+        assert(args.size == 0 && array_value.n_values == 0);
+
     return expr;
 
 }
 
-struct Expr Expr_create_w_tok(struct Token token, struct Expr *lhs,
-        struct Expr *rhs, unsigned lhs_lvls_of_indir,
-        unsigned rhs_lvls_of_indir, enum PrimitiveType lhs_type,
-        enum PrimitiveType rhs_type, struct ExprPtrList args, u32 int_value,
-        struct ArrayLit array_value, i32 bp_offset, enum ExprType expr_type,
-        bool is_array, u32 array_len) {
+struct TokenPos Expr_pos(const struct ExprTable *exprs,
+        const struct Expr *self) {
 
-    return Expr_create(token.line_num, token.column_num, token.src_start,
-            token.src_len, token.file_path, lhs, rhs, lhs_lvls_of_indir,
-            rhs_lvls_of_indir, lhs_type, rhs_type, args, int_value,
-            array_value, bp_offset,
-            expr_type, is_array, array_len);
+    return TokenList_pos(exprs->tokens, exprs->tok_idxs.elems[self->id]);
 
 }
 
-void Expr_recur_free_w_self(struct Expr *self) {
+const struct ExprPtrList* Expr_args(const struct ExprTable *exprs,
+        const struct Expr *self) {
 
-    if (!self)
-        return;
+    static const struct ExprPtrList no_args = {NULL, 0, 0, NULL};
+    const struct ExprExtra *extra;
 
-    if (self->lhs)
-        Expr_recur_free_w_self(self->lhs);
-    if (self->rhs)
-        Expr_recur_free_w_self(self->rhs);
+    if (self->expr_type != ExprType_FUNC_CALL)
+        return &no_args;
+
+    extra = find_extra(exprs, self->id);
+    assert(extra);
+    return &extra->args;
+
+}
+
+void Expr_set_args(struct ExprTable *exprs, const struct Expr *self,
+        struct ExprPtrList args) {
 
-    while (self->args.size > 0)
-        ExprPtrList_pop_back(&self->args, Expr_recur_free_w_self);
-    ExprPtrList_free(&self->args);
-    ArrayLit_free(&self->array_value);
-    m_free(self);
+    struct ExprExtra *extra = find_extra(exprs, self->id);
+    assert(self->expr_type == ExprType_FUNC_CALL && extra);
+    extra->args = args;
 
 }
 
-unsigned Expr_lvls_of_indir(struct Expr *self, const struct ParVarList *vars) {
+struct ArrayLit* Expr_array_lit(const struct ExprTable *exprs,
+        const struct Expr *self) {
+
+    struct ExprExtra *extra;
+
+    if (self->expr_type != ExprType_ARRAY_LIT)
+        return NULL;
+
+    extra = find_extra(exprs, self->id);
+    assert(extra);
+    return &extra->array_value;
+
+}
+
+unsigned Expr_lvls_of_indir(struct Expr *self, const struct ExprTable *exprs,
+        const struct ParVarList *vars) {
 
     if (self->expr_type == ExprType_TYPECAST) {
     }
     else if (self->expr_type == ExprType_FUNC_CALL) {
-        char *expr_src = Expr_src(self);
-
-        u32 var_idx = ParVarList_find_var(vars, expr_src);
+        u32 var_idx = ParVarList_find_var(vars, Expr_sym(exprs, self));
         unsigned lvls_of_indir =
             var_idx == m_u32_max ? 0 : vars->elems[var_idx].lvls_of_indir;
 
-        m_free(expr_src);
-
         self->lvls_of_indir = lvls_of_indir;
     }
     else if (self->expr_type == ExprType_ARRAY_LIT) {
@@ -284,7 +323,7 @@ unsigned Expr_lvls_of_indir(struct Expr *self, const struct ParVarList *vars) {
 
 }
 
-enum PrimitiveType Expr_type(struct Expr *self,
+enum PrimitiveType Expr_type(struct Expr *self, const struct ExprTable *exprs,
         const struct ParVarList *vars) {
 
     if (self->expr_type == ExprType_TYPECAST) {
@@ -315,14 +354,12 @@ enum PrimitiveType Expr_type(struct Expr *self,
         }
 
         if (self->expr_type == ExprType_L_ARR_SUBSCR &&
-                Expr_lvls_of_indir(self, vars) == 0) {
+                Expr_lvls_of_indir(self, exprs, vars) == 0) {
             self->prim_type = PrimitiveType_promote(self->prim_type, 0);
         }
     }
     else if (self->expr_type == ExprType_FUNC_CALL) {
-        char *expr_src = Expr_src(self);
-
-        u32 var_idx = ParVarList_find_var(vars, expr_src);
+        u32 var_idx = ParVarList_find_var(vars, Expr_sym(exprs, self));
         enum PrimitiveType type;
         unsigned lvls_of_indir;
 
@@ -335,8 +372,6 @@ enum PrimitiveType Expr_type(struct Expr *self,
             lvls_of_indir = vars->elems[var_idx].lvls_of_indir;
         }
 
-        m_free(expr_src);
-
         if (type == PrimType_VOID)
             self->prim_type = PrimType_VOID;
         else
@@ -348,7 +383,7 @@ enum PrimitiveType Expr_type(struct Expr *self,
     }
     else {
         self->prim_type = PrimitiveType_promote(self->lhs_type,
-                    Expr_lvls_of_indir(self, vars));
+                    Expr_lvls_of_indir(self, exprs, vars));
     }
 
     return self->prim_type;
@@ -356,19 +391,15 @@ enum PrimitiveType Expr_type(struct Expr *self,
 }
 
 enum PrimitiveType Expr_type_no_prom(struct Expr *self,
-        const struct ParVarList *vars) {
+        const struct ExprTable *exprs, const struct ParVarList *vars) {
 
     if (self->expr_type == ExprType_TYPECAST) {
     }
     else if (self->expr_type == ExprType_FUNC_CALL) {
-        char *expr_src = Expr_src(self);
-
-        u32 var_idx = ParVarList_find_var(vars, expr_src);
+        u32 var_idx = ParVarList_find_var(vars, Expr_sym(exprs, self));
         enum PrimitiveType type =
             var_idx == m_u32_max ? PrimType_INT : vars->elems[var_idx].type;
 
-        m_free(expr_src);
-
         self->non_prom_prim_type = type;
     }
     else if (self->expr_type == ExprType_ARRAY_LIT) {
@@ -482,41 +513,45 @@ u32 Expr_evaluate(const struct Expr *self) {
         return lhs_val;
 
     default:
-        fprintf(stderr, "%s, %u,%u\n", self->file_path, self->line_num,
-                self->column_num);
+        fprintf(stderr, "can't evaluate an expr of type %u\n",
+                self->expr_type);
         assert(false);
 
     }
 
 }
 
-char* Expr_src(const struct Expr *self) {
+char* Expr_src(const struct ExprTable *exprs, const struct Expr *self) {
+
+    return TokenList_src(exprs->tokens, exprs->tok_idxs.elems[self->id]);
+
+}
 
-    char *str = malloc((self->src_len+1)*sizeof(*str));
-    strncpy(str, self->src_start, self->src_len);
-    str[self->src_len] = '\0';
+u32 Expr_sym(const struct ExprTable *exprs, const struct Expr *self) {
 
-    return str;
+    return TokenList_sym(exprs->tokens, exprs->tok_idxs.elems[self->id]);
 
 }
 
-void Expr_get_array_lits(const struct Expr *self, struct ArrayLitList *list) {
+void Expr_get_array_lits(const struct Expr *self,
+        const struct ExprTable *exprs, struct ArrayLitList *list) {
 
+    const struct ExprPtrList *args = Expr_args(exprs, self);
     u32 i;
 
     if (self->lhs)
-        Expr_get_array_lits(self->lhs, list);
+        Expr_get_array_lits(self->lhs, exprs, list);
     if (self->rhs)
-        Expr_get_array_lits(self->rhs, list);
+        Expr_get_array_lits(self->rhs, exprs, list);
 
-    for (i = 0; i < self->args.size; i++) {
-        Expr_get_array_lits(self->args.elems[i], list);
+    for (i = 0; i < args->size; i++) {
+        Expr_get_array_lits(args->elems[i], exprs, list);
     }
 
     if (self->expr_type != ExprType_ARRAY_LIT)
         return;
 
-    ArrayLitList_push_back(list, self->array_value);
+    ArrayLitList_push_back(list, *Expr_array_lit(exprs, self));
 
 }
 
@@ -526,6 +561,7 @@ bool Expr_statically_evaluatable(const struct Expr *self) {
             self->expr_type == ExprType_REFERENCE ||
             self->expr_type == ExprType_DEREFERENCE ||
             self->expr_type == ExprType_L_ARR_SUBSCR ||
+            self->expr_type == ExprType_ARRAY_LIT ||
             ExprType_is_inc_or_dec_operator(self->expr_type) ||
             self->expr_type == ExprType_FUNC_CALL)
         return false;
@@ -555,18 +591,11 @@ struct ExprNode ExprNode_create(struct Expr *expr) {
 
 }
 
-void ExprNode_free_w_self(struct ExprNode *self) {
-
-    Expr_recur_free_w_self(self->expr);
-    m_free(self);
-
-}
-
 void ExprNode_get_array_lits(const struct ExprNode *self,
-        struct ArrayLitList *list) {
+        const struct ExprTable *exprs, struct ArrayLitList *list) {
 
     if (self->expr)
-        Expr_get_array_lits(self->expr, list);
+        Expr_get_array_lits(self->expr, exprs, list);
 
 }
 
@@ -588,28 +617,124 @@ struct BlockNode BlockNode_create(struct ASTNodeList nodes, u32 var_bytes) {
 
 }
 
-void BlockNode_free_w_self(struct BlockNode *self) {
+void BlockNode_get_array_lits(const struct BlockNode *self,
+        const struct ExprTable *exprs, struct ArrayLitList *list) {
+
+    u32 i;
+
+    for (i = 0; i < self->nodes.size; i++) {
+
+        ASTNode_get_array_lits(&self->nodes.elems[i], exprs, list);
 
-    while (self->nodes.size > 0) {
-        ASTNodeList_pop_back(&self->nodes, ASTNode_free);
     }
 
-    ASTNodeList_free(&self->nodes);
-    m_free(self);
+}
+
+/* the expr itself, its operands, the args of a call and the values of an
+ * array literal */
+static u32 Expr_n_nodes(const struct Expr *self,
+        const struct ExprTable *exprs) {
+
+    const struct ExprPtrList *args = NULL;
+    const struct ArrayLit *array_lit = NULL;
+    u32 n_nodes = 1;
+    u32 i;
+
+    if (!self)
+        return 0;
+
+    n_nodes += Expr_n_nodes(self->lhs, exprs);
+    n_nodes += Expr_n_nodes(self->rhs, exprs);
+
+    args = Expr_args(exprs, self);
+    for (i = 0; i < args->size; i++)
+        n_nodes += Expr_n_nodes(args->elems[i], exprs);
+
+    array_lit = Expr_array_lit(exprs, self);
+    if (array_lit) {
+        for (i = 0; i < array_lit->n_values; i++)
+            n_nodes += Expr_n_nodes(array_lit->values[i], exprs);
+    }
+
+    return n_nodes;
 
 }
 
-void BlockNode_get_array_lits(const struct BlockNode *self,
-        struct ArrayLitList *list) {
+/* some of the bodies are NULL, like a missing else */
+static u32 body_n_nodes(const struct BlockNode *body,
+        const struct ExprTable *exprs) {
 
+    return body ? BlockNode_n_nodes(body, exprs) : 0;
+
+}
+
+static u32 ASTNode_n_nodes(const struct ASTNode *self,
+        const struct ExprTable *exprs) {
+
+    const void *node = self->node_struct;
+    u32 n_nodes = 1;
     u32 i;
 
-    for (i = 0; i < self->nodes.size; i++) {
+    if (!node)
+        return 1;
+
+    switch (self->type) {
 
-        ASTNode_get_array_lits(&self->nodes.elems[i], list);
+    case ASTType_EXPR:
+        return 1 + Expr_n_nodes(((const struct ExprNode *)node)->expr, exprs);
 
+    case ASTType_VAR_DECL: {
+        const struct DeclList *decls =
+            &((const struct VarDeclNode *)node)->decls;
+        for (i = 0; i < decls->size; i++)
+            n_nodes += Expr_n_nodes(decls->elems[i].value, exprs);
+        return n_nodes;
     }
 
+    case ASTType_FUNC:
+        return 1 + body_n_nodes(((const struct FuncDeclNode *)node)->body,
+                exprs);
+
+    case ASTType_BLOCK:
+        return 1 + BlockNode_n_nodes(node, exprs);
+
+    case ASTType_RETURN:
+        return 1 + Expr_n_nodes(((const struct RetNode *)node)->value, exprs);
+
+    case ASTType_IF_STMT:
+        return 1 + Expr_n_nodes(((const struct IfNode *)node)->expr, exprs) +
+            body_n_nodes(((const struct IfNode *)node)->body, exprs) +
+            body_n_nodes(((const struct IfNode *)node)->else_body, exprs);
+
+    case ASTType_WHILE_STMT:
+        return 1 + Expr_n_nodes(((const struct WhileNode *)node)->expr,
+                exprs) +
+            body_n_nodes(((const struct WhileNode *)node)->body, exprs);
+
+    case ASTType_FOR_STMT:
+        return 1 + Expr_n_nodes(((const struct ForNode *)node)->init, exprs) +
+            Expr_n_nodes(((const struct ForNode *)node)->condition, exprs) +
+            Expr_n_nodes(((const struct ForNode *)node)->inc, exprs) +
+            body_n_nodes(((const struct ForNode *)node)->body, exprs);
+
+    default:
+        return 1;
+
+    }
+
+}
+
+u32 BlockNode_n_nodes(const struct BlockNode *self,
+        const struct ExprTable *exprs) {
+
+    u32 n_nodes = 0;
+    u32 i;
+
+    for (i = 0; i < self->nodes.size; i++)
+        n_nodes += ASTNode_n_nodes(&self->nodes.elems[i], exprs);
+
+    return n_nodes;
+
 }
 
 enum ExprType tok_t_to_expr_t(enum TokenType type) {
@@ -845,7 +970,7 @@ struct Declarator Declarator_init(void) {
 
 }
 
-struct Declarator Declarator_create(struct Expr *value, char *ident,
+struct Declarator Declarator_create(struct Expr *value, const char *ident,
         unsigned lvls_of_indir, bool is_array, u32 array_len, u32 bp_offset) {
 
     struct Declarator decl;
@@ -859,20 +984,13 @@ struct Declarator Declarator_create(struct Expr *value, char *ident,
 
 }
 
-void Declarator_free(struct Declarator decl) {
-
-    Expr_recur_free_w_self(decl.value);
-    m_free(decl.ident);
-
-}
-
 void Declarator_get_array_lits(const struct Declarator *self,
-        struct ArrayLitList *list) {
+        const struct ExprTable *exprs, struct ArrayLitList *list) {
 
     if (!self->value)
         return;
 
-    Expr_get_array_lits(self->value, list);
+    Expr_get_array_lits(self->value, exprs, list);
 
 }
 
@@ -897,28 +1015,20 @@ struct VarDeclNode VarDeclNode_create(struct DeclList decls,
 
 }
 
-void VarDeclNode_free_w_self(struct VarDeclNode *self) {
-
-    while (self->decls.size > 0)
-        DeclList_pop_back(&self->decls, Declarator_free);
-    DeclList_free(&self->decls);
-    m_free(self);
-
-}
-
 void VarDeclNode_get_array_lits(const struct VarDeclNode *self,
-        struct ArrayLitList *list) {
+        const struct ExprTable *exprs, struct ArrayLitList *list) {
 
     u32 i;
 
     for (i = 0; i < self->decls.size; i++) {
-        Declarator_get_array_lits(&self->decls.elems[i], list);
+        Declarator_get_array_lits(&self->decls.elems[i], exprs, list);
     }
 
 }
 
 bool VarDeclPtrList_equivalent_expr(const struct VarDeclPtrList *self,
-        const struct ExprPtrList *other, const struct ParVarList *vars,
+        const struct ExprPtrList *other, const struct ExprTable *exprs,
+        const struct ParVarList *vars,
         bool self_is_variadic) {
 
     u32 i;
@@ -940,17 +1050,10 @@ bool VarDeclPtrList_equivalent_expr(const struct VarDeclPtrList *self,
 
             if (PrimitiveType_promote(self->elems[i]->type,
                         self->elems[i]->decls.elems[j].lvls_of_indir) !=
-                    Expr_type(other->elems[i], vars) ||
+                    Expr_type(other->elems[i], exprs, vars) ||
                     self->elems[i]->decls.elems[j].lvls_of_indir !=
-                    other->elems[i]->lvls_of_indir) {
-                /* print stmts for debugging */
-                printf("left indir = %d, right indir = %d.\n",
-                        self->elems[i]->decls.elems[j].lvls_of_indir,
-                        other->elems[i]->lvls_of_indir);
-                printf("other type = %d\n",
-                        Expr_type(other->elems[i], vars));
+                    other->elems[i]->lvls_of_indir)
                 return false;
-            }
         }
 
     }
@@ -969,7 +1072,8 @@ struct FuncDeclNode FuncDeclNode_init(void) {
     func_decl.ret_type_mods = TypeModifiers_init();
     func_decl.ret_type = PrimType_INVALID;
     func_decl.body = NULL;
-    func_decl.name = NULL;
+    func_decl.name = m_interner_no_id;
+    func_decl.body_streamed = false;
     return func_decl;
 
 }
@@ -977,7 +1081,7 @@ struct FuncDeclNode FuncDeclNode_init(void) {
 struct FuncDeclNode FuncDeclNode_create(struct VarDeclPtrList args,
         bool variadic_args, bool void_args, unsigned ret_lvls_of_indir,
         struct TypeModifiers ret_type_mods,
-        enum PrimitiveType ret_type, struct BlockNode *body, char *name) {
+        enum PrimitiveType ret_type, struct BlockNode *body, u32 name) {
 
     struct FuncDeclNode func_decl;
     func_decl.args = args;
@@ -988,38 +1092,27 @@ struct FuncDeclNode FuncDeclNode_create(struct VarDeclPtrList args,
     func_decl.ret_type = ret_type;
     func_decl.body = body;
     func_decl.name = name;
+    func_decl.body_streamed = false;
     return func_decl;
 
 }
 
-void FuncDeclNode_free_w_self(struct FuncDeclNode *self) {
-
-    while (self->args.size > 0) {
-        VarDeclPtrList_pop_back(&self->args, VarDeclNode_free_w_self);
-    }
-    VarDeclPtrList_free(&self->args);
-
-    m_free(self->name);
-    if (self->body)
-        BlockNode_free_w_self(self->body);
-    m_free(self);
-
-}
-
 void FuncDeclNode_get_array_lits(const struct FuncDeclNode *self,
-        struct ArrayLitList *list) {
+        const struct ExprTable *exprs, struct ArrayLitList *list) {
 
     if (self->body)
-        BlockNode_get_array_lits(self->body, list);
+        BlockNode_get_array_lits(self->body, exprs, list);
 
 }
 
+m_define_VectorImpl_funcs(SymFlagList, bool, MemTag_SYMBOLS)
+
 bool FuncDeclNode_defined(const struct FuncDeclNode *self,
         const struct BlockNode *transl_unit) {
 
     u32 i;
 
-    if (self->body)
+    if (self->body || self->body_streamed)
         return true;
 
     for (i = 0; i < transl_unit->nodes.size; i++) {
@@ -1031,10 +1124,10 @@ bool FuncDeclNode_defined(const struct FuncDeclNode *self,
 
         func = transl_unit->nodes.elems[i].node_struct;
 
-        if (!func->body)
+        if (!func->body && !func->body_streamed)
             continue;
 
-        if (strcmp(self->name, func->name) == 0)
+        if (self->name == func->name)
             return true;
 
     }
@@ -1066,18 +1159,11 @@ struct RetNode RetNode_create(struct Expr *value, unsigned lvls_of_indir,
 
 }
 
-void RetNode_free_w_self(struct RetNode *self) {
-
-    Expr_recur_free_w_self(self->value);
-    m_free(self);
-
-}
-
 void RetNode_get_array_lits(const struct RetNode *self,
-        struct ArrayLitList *list) {
+        const struct ExprTable *exprs, struct ArrayLitList *list) {
 
     if (self->value)
-        Expr_get_array_lits(self->value, list);
+        Expr_get_array_lits(self->value, exprs, list);
 
 }
 
@@ -1107,27 +1193,15 @@ struct IfNode IfNode_create(struct Expr *expr, struct BlockNode *body,
 
 }
 
-void IfNode_free_w_self(struct IfNode *self) {
-
-    if (self->expr)
-        Expr_recur_free_w_self(self->expr);
-    if (self->body)
-        BlockNode_free_w_self(self->body);
-    if (self->else_body)
-        BlockNode_free_w_self(self->else_body);
-    m_free(self);
-
-}
-
 void IfNode_get_array_lits(const struct IfNode *self,
-        struct ArrayLitList *list) {
+        const struct ExprTable *exprs, struct ArrayLitList *list) {
 
     if (self->expr)
-        Expr_get_array_lits(self->expr, list);
+        Expr_get_array_lits(self->expr, exprs, list);
     if (self->body)
-        BlockNode_get_array_lits(self->body, list);
+        BlockNode_get_array_lits(self->body, exprs, list);
     if (self->else_body)
-        BlockNode_get_array_lits(self->else_body, list);
+        BlockNode_get_array_lits(self->else_body, exprs, list);
 
 }
 
@@ -1152,24 +1226,13 @@ struct WhileNode WhileNode_create(struct Expr *expr, struct BlockNode *body,
 
 }
 
-void WhileNode_free_w_self(struct WhileNode *self) {
-
-    if (self->expr)
-        Expr_recur_free_w_self(self->expr);
-    if (self->body)
-        BlockNode_free_w_self(self->body);
-
-    m_free(self);
-
-}
-
 void WhileNode_get_array_lits(const struct WhileNode *self,
-        struct ArrayLitList *list) {
+        const struct ExprTable *exprs, struct ArrayLitList *list) {
 
     if (self->expr)
-        Expr_get_array_lits(self->expr, list);
+        Expr_get_array_lits(self->expr, exprs, list);
     if (self->body)
-        BlockNode_get_array_lits(self->body, list);
+        BlockNode_get_array_lits(self->body, exprs, list);
 
 }
 
@@ -1198,39 +1261,25 @@ struct ForNode ForNode_create(struct Expr *init, struct Expr *condition,
 
 }
 
-void ForNode_free_w_self(struct ForNode *self) {
-
-    if (self->init)
-        Expr_recur_free_w_self(self->init);
-    if (self->condition)
-        Expr_recur_free_w_self(self->condition);
-    if (self->inc)
-        Expr_recur_free_w_self(self->inc);
-
-    if (self->body)
-        BlockNode_free_w_self(self->body);
-
-    m_free(self);
-
-}
-
 void ForNode_get_array_lits(const struct ForNode *self,
-        struct ArrayLitList *list) {
+        const struct ExprTable *exprs, struct ArrayLitList *list) {
 
     if (self->init)
-        Expr_get_array_lits(self->init, list);
+        Expr_get_array_lits(self->init, exprs, list);
     if (self->condition)
-        Expr_get_array_lits(self->condition, list);
+        Expr_get_array_lits(self->condition, exprs, list);
     if (self->inc)
-        Expr_get_array_lits(self->inc, list);
+        Expr_get_array_lits(self->inc, exprs, list);
 
     if (self->body)
-        BlockNode_get_array_lits(self->body, list);
+        BlockNode_get_array_lits(self->body, exprs, list);
 
 }
 
-m_define_VectorImpl_funcs(ASTNodeList, struct ASTNode)
-m_define_VectorImpl_funcs(DeclList, struct Declarator)
-m_define_VectorImpl_funcs(VarDeclPtrList, struct VarDeclNode*)
-m_define_VectorImpl_funcs(ExprPtrList, struct Expr*)
-m_define_VectorImpl_funcs(ExprList, struct Expr)
+m_define_VectorImpl_funcs(ASTNodeList, struct ASTNode, MemTag_AST)
+m_define_SmallVecImpl_funcs(DeclList, struct Declarator, MemTag_AST)
+m_define_VectorImpl_funcs(VarDeclPtrList, struct VarDeclNode*, MemTag_AST)
+m_define_SmallVecImpl_funcs(ExprPtrList, struct Expr*, MemTag_AST)
+m_define_VectorImpl_funcs(ExprList, struct Expr, MemTag_AST)
+m_define_VectorImpl_funcs(ExprTokIdxList, u32, MemTag_AST)
+m_define_VectorImpl_funcs(ExprExtraList, struct ExprExtra, MemTag_AST)
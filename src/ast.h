@@ -8,8 +8,18 @@
 #include "parser_var.h"
 #include "array_lit.h"
 
+struct CompilerCtx;
+struct ExprTable;
+
+/* the most levels of indirection a type can have, an Expr keeps them in a
+ * byte. TypeSpec_read, array declarators and '&' give an error past it */
+#define m_max_lvls_of_indir 255
+
+/* every node, and the lists and strings hanging off of it, is allocated from
+ * the compiler context's ast_arena. nothing in the AST gets freed on its own */
+
 /* make sure to update:
- *    ASTNode_free, ASTNode_get_array_lits, ASTNode_const_fold */
+ *    ASTNode_get_array_lits, ASTNode_const_fold */
 enum ASTNodeType {
 
     ASTType_INVALID,
@@ -38,9 +48,8 @@ struct ASTNode {
 struct ASTNode ASTNode_init(void);
 struct ASTNode ASTNode_create(unsigned line_num, unsigned column_num,
         enum ASTNodeType type, void *node_struct);
-void ASTNode_free(struct ASTNode node);
 void ASTNode_get_array_lits(const struct ASTNode *self,
-        struct ArrayLitList *list);
+        const struct ExprTable *exprs, struct ArrayLitList *list);
 
 struct ASTNodeList {
 
@@ -62,9 +71,11 @@ struct BlockNode {
 
 struct BlockNode BlockNode_init(void);
 struct BlockNode BlockNode_create(struct ASTNodeList nodes, u32 var_bytes);
-void BlockNode_free_w_self(struct BlockNode *self);
 void BlockNode_get_array_lits(const struct BlockNode *self,
-        struct ArrayLitList *list);
+        const struct ExprTable *exprs, struct ArrayLitList *list);
+/* the number of statement and expr nodes in the block, nested ones included */
+u32 BlockNode_n_nodes(const struct BlockNode *self,
+        const struct ExprTable *exprs);
 
 /* when adding a new type make sure to update:
  *  tok_t_to_expr_t, expr_t_to_tok_t, Expr_evaluate
@@ -133,10 +144,12 @@ struct ExprPtrList {
     struct Expr **elems;
     u32 size;
     u32 capacity;
+    /* storage the list starts out on, see SmallVecImpl */
+    struct Expr **inline_elems;
 
 };
 
-m_declare_VectorImpl_funcs(ExprPtrList, struct Expr*)
+m_declare_SmallVecImpl_funcs(ExprPtrList, struct Expr*)
 
 struct ExprList {
 
@@ -148,77 +161,134 @@ struct ExprList {
 
 m_declare_VectorImpl_funcs(ExprList, struct Expr)
 
+/* only what most passes over an expr tree need is kept in the node itself, the
+ * rest is in the ExprTable, looked up by the expr's id */
 struct Expr {
 
-    unsigned line_num, column_num;
-    /* Region of the source code that corresponds to this node's corresponding
-     * token */
-    const char *src_start; unsigned src_len;
+    struct Expr *lhs, *rhs;
 
-    /* the file the expr is in */
-    const char *file_path;
+    u32 int_value;
+    i32 bp_offset;
 
-    struct Expr *lhs, *rhs;
-    unsigned lhs_lvls_of_indir, rhs_lvls_of_indir;
-    enum PrimitiveType lhs_type, rhs_type;
-    /* doesn't factor in type promotions or lvls of indir */
-    unsigned lhs_og_type, rhs_og_type;
-    struct ExprPtrList args; /* used by function calls */
+    /* the expr's index in its ExprTable */
+    u32 id;
 
-    bool is_array;
-    u32 array_len;
+    /* the enums and levels of indirection only take up a byte each. none of
+     * the enums get anywhere close to 255, and the levels of indirection are
+     * kept to m_max_lvls_of_indir */
 
-    /* gets set via Expr_lvls_of_indir */
-    unsigned lvls_of_indir;
+    u8 expr_type; /* enum ExprType */
+
+    /* enum PrimitiveType */
+    u8 lhs_type, rhs_type;
+    /* doesn't factor in type promotions or lvls of indir */
+    u8 lhs_og_type, rhs_og_type;
     /* gets set via Expr_type */
-    enum PrimitiveType prim_type;
+    u8 prim_type;
     /* gets set via Expr_type_no_prom */
-    enum PrimitiveType non_prom_prim_type;
+    u8 non_prom_prim_type;
 
-    u32 int_value;
+    u8 lhs_lvls_of_indir, rhs_lvls_of_indir;
+    /* gets set via Expr_lvls_of_indir */
+    u8 lvls_of_indir;
+
+    u8 is_array; /* bool */
+
+};
+
+struct ExprTokIdxList {
+
+    u32 *elems;
+    u32 size;
+    u32 capacity;
+
+};
+
+m_declare_VectorImpl_funcs(ExprTokIdxList, u32)
+
+/* what only func calls and array literals have */
+struct ExprExtra {
+
+    u32 expr_id;
+    struct ExprPtrList args; /* used by function calls */
     struct ArrayLit array_value;
 
-    i32 bp_offset;
+};
+
+struct ExprExtraList {
+
+    struct ExprExtra *elems;
+    u32 size;
+    u32 capacity;
+
+};
+
+m_declare_VectorImpl_funcs(ExprExtraList, struct ExprExtra)
 
-    enum ExprType expr_type;
+/* the parts of the exprs that are rarely needed or only used by some kinds of
+ * exprs. indexed by Expr.id, and cleared along with the AST arena. */
+struct ExprTable {
+
+    /* the token table the exprs get made from. the lexer keeps it around until
+     * the code has been generated */
+    const struct TokenList *tokens;
+    /* the token each expr was made from, its line, column and src come from
+     * there */
+    struct ExprTokIdxList tok_idxs;
+    /* sorted by expr_id, since they get added as the exprs are created */
+    struct ExprExtraList extras;
 
 };
 
+struct ExprTable ExprTable_init(void);
+void ExprTable_clear(struct ExprTable *self);
+/* forgets every expr from the id n_exprs onwards, for once they've been
+ * thrown away */
+void ExprTable_truncate(struct ExprTable *self, u32 n_exprs);
+void ExprTable_free(struct ExprTable *self);
+
 struct Expr Expr_init(void);
-/* automatically promotes the lhs and rhs types */
-struct Expr Expr_create(unsigned line_num, unsigned column_num,
-        const char *src_start, unsigned src_len, const char *file_path,
+/* automatically promotes the lhs and rhs types. adds the expr to exprs, made
+ * from the token at tok_idx in exprs->tokens. */
+struct Expr Expr_create_w_tok(struct ExprTable *exprs, u32 tok_idx,
         struct Expr *lhs, struct Expr *rhs, unsigned lhs_lvls_of_indir,
-        unsigned rhs_lvls_of_indir, enum PrimitiveType lhs_type, 
-        enum PrimitiveType rhs_type,
-        struct ExprPtrList args, u32 int_value, struct ArrayLit array_value,
-        i32 bp_offset, enum ExprType expr_type, bool is_array, u32 array_len);
-/* Uses the passed, tok_t_to_expr_td column numbers aswell as src_start and
- * src_len. */
-struct Expr Expr_create_w_tok(struct Token token, struct Expr *lhs,
-        struct Expr *rhs, unsigned lhs_lvls_of_indir,
         unsigned rhs_lvls_of_indir, enum PrimitiveType lhs_type,
         enum PrimitiveType rhs_type,
         struct ExprPtrList args, u32 int_value, struct ArrayLit array_value,
-        i32 bp_offset, enum ExprType expr_type, bool is_array, u32 array_len);
-/* Also frees self */
-void Expr_recur_free_w_self(struct Expr *self);
-unsigned Expr_lvls_of_indir(struct Expr *self, const struct ParVarList *vars);
-enum PrimitiveType Expr_type(struct Expr *self,
+        i32 bp_offset, enum ExprType expr_type, bool is_array);
+/* where the expr's token is, for diagnostics */
+struct TokenPos Expr_pos(const struct ExprTable *exprs,
+        const struct Expr *self);
+/* empty for anything but a function call */
+const struct ExprPtrList* Expr_args(const struct ExprTable *exprs,
+        const struct Expr *self);
+void Expr_set_args(struct ExprTable *exprs, const struct Expr *self,
+        struct ExprPtrList args);
+/* NULL for anything but an array literal */
+struct ArrayLit* Expr_array_lit(const struct ExprTable *exprs,
+        const struct Expr *self);
+unsigned Expr_lvls_of_indir(struct Expr *self, const struct ExprTable *exprs,
+        const struct ParVarList *vars);
+enum PrimitiveType Expr_type(struct Expr *self, const struct ExprTable *exprs,
         const struct ParVarList *vars);
 /* works differently from Expr_type. uses lhs_og_type and rhs_og_type instead,
  * and inherits directly from whichever operand has the highest level of indir.
  * If both have the same, then it's inherited from the left operand by default.
  */
 enum PrimitiveType Expr_type_no_prom(struct Expr *self,
-        const struct ParVarList *vars);
+        const struct ExprTable *exprs, const struct ParVarList *vars);
 u32 Expr_evaluate(const struct Expr *expr);
-char* Expr_src(const struct Expr *expr); /* same as Token_src */
+/* same as TokenList_src */
+char* Expr_src(const struct ExprTable *exprs, const struct Expr *expr);
+/* same as TokenList_sym */
+u32 Expr_sym(const struct ExprTable *exprs, const struct Expr *expr);
 /* checks if there are any errors in the expression that the shunting yard
  * function couldn't catch */
-bool Expr_verify(const struct Expr *expr, const struct ParVarList *vars,
+bool Expr_verify(struct CompilerCtx *ctx, const struct Expr *expr,
+        const struct ParVarList *vars,
         bool is_initializer);
-void Expr_get_array_lits(const struct Expr *self, struct ArrayLitList *list);
+void Expr_get_array_lits(const struct Expr *self,
+        const struct ExprTable *exprs, struct ArrayLitList *list);
 bool Expr_statically_evaluatable(const struct Expr *self);
 
 struct ExprNode {
@@ -229,14 +299,14 @@ struct ExprNode {
 
 struct ExprNode ExprNode_init(void);
 struct ExprNode ExprNode_create(struct Expr *expr);
-void ExprNode_free_w_self(struct ExprNode *self);
 void ExprNode_get_array_lits(const struct ExprNode *self,
-        struct ArrayLitList *list);
+        const struct ExprTable *exprs, struct ArrayLitList *list);
 
 struct Declarator {
 
     struct Expr *value;
-    char *ident;
+    /* interned, lives as long as the compiler context */
+    const char *ident;
     unsigned lvls_of_indir;
     bool is_array;
     u32 array_len;
@@ -245,21 +315,22 @@ struct Declarator {
 };
 
 struct Declarator Declarator_init(void);
-struct Declarator Declarator_create(struct Expr *value, char *ident,
+struct Declarator Declarator_create(struct Expr *value, const char *ident,
         unsigned lvls_of_indir, bool is_array, u32 array_len, u32 bp_offset);
-void Declarator_free(struct Declarator decl);
 void Declarator_get_array_lits(const struct Declarator *self,
-        struct ArrayLitList *list);
+        const struct ExprTable *exprs, struct ArrayLitList *list);
 
 struct DeclList {
 
     struct Declarator *elems;
     u32 size;
     u32 capacity;
+    /* storage the list starts out on, see SmallVecImpl */
+    struct Declarator *inline_elems;
 
 };
 
-m_declare_VectorImpl_funcs(DeclList, struct Declarator)
+m_declare_SmallVecImpl_funcs(DeclList, struct Declarator)
 
 struct VarDeclNode {
 
@@ -272,9 +343,8 @@ struct VarDeclNode {
 struct VarDeclNode VarDeclNode_init(void);
 struct VarDeclNode VarDeclNode_create(struct DeclList decls,
         enum PrimitiveType type, struct TypeModifiers mods);
-void VarDeclNode_free_w_self(struct VarDeclNode *self);
 void VarDeclNode_get_array_lits(const struct VarDeclNode *self,
-        struct ArrayLitList *list);
+        const struct ExprTable *exprs, struct ArrayLitList *list);
 
 struct VarDeclPtrList {
 
@@ -285,7 +355,8 @@ struct VarDeclPtrList {
 };
 
 bool VarDeclPtrList_equivalent_expr(const struct VarDeclPtrList *self,
-        const struct ExprPtrList *other, const struct ParVarList *vars,
+        const struct ExprPtrList *other, const struct ExprTable *exprs,
+        const struct ParVarList *vars,
         bool self_is_variadic);
 m_declare_VectorImpl_funcs(VarDeclPtrList, struct VarDeclNode*)
 
@@ -298,7 +369,11 @@ struct FuncDeclNode {
     struct TypeModifiers ret_type_mods;
     enum PrimitiveType ret_type;
     struct BlockNode *body;
-    char *name;
+    /* the interned id of the name */
+    u32 name;
+    /* -fstream-funcs throws the body away once its code has been generated.
+     * the func still counts as defined after that */
+    bool body_streamed;
 
 };
 
@@ -306,13 +381,23 @@ struct FuncDeclNode FuncDeclNode_init(void);
 struct FuncDeclNode FuncDeclNode_create(struct VarDeclPtrList args,
         bool variadic_args, bool void_args, unsigned ret_lvls_of_indir,
         struct TypeModifiers ret_type_mods,
-        enum PrimitiveType ret_type, struct BlockNode *body, char *name);
-void FuncDeclNode_free_w_self(struct FuncDeclNode *self);
+        enum PrimitiveType ret_type, struct BlockNode *body, u32 name);
 void FuncDeclNode_get_array_lits(const struct FuncDeclNode *self,
-        struct ArrayLitList *list);
+        const struct ExprTable *exprs, struct ArrayLitList *list);
 bool FuncDeclNode_defined(const struct FuncDeclNode *self,
         const struct BlockNode *transl_unit);
 
+/* a flag for every interned id */
+struct SymFlagList {
+
+    bool *elems;
+    u32 size;
+    u32 capacity;
+
+};
+
+m_declare_VectorImpl_funcs(SymFlagList, bool)
+
 struct RetNode {
 
     struct Expr *value;
@@ -325,9 +410,8 @@ struct RetNode {
 struct RetNode RetNode_init(void);
 struct RetNode RetNode_create(struct Expr *value, unsigned lvls_of_indir,
         enum PrimitiveType type, u32 n_stack_frames_deep);
-void RetNode_free_w_self(struct RetNode *self);
 void RetNode_get_array_lits(const struct RetNode *self,
-        struct ArrayLitList *list);
+        const struct ExprTable *exprs, struct ArrayLitList *list);
 
 struct IfNode {
 
@@ -344,9 +428,8 @@ struct IfNode IfNode_init(void);
 struct IfNode IfNode_create(struct Expr *expr, struct BlockNode *body,
         struct BlockNode *else_body, bool body_in_block,
         bool else_body_in_block);
-void IfNode_free_w_self(struct IfNode *self);
 void IfNode_get_array_lits(const struct IfNode *self,
-        struct ArrayLitList *list);
+        const struct ExprTable *exprs, struct ArrayLitList *list);
 
 struct WhileNode {
 
@@ -360,9 +443,8 @@ struct WhileNode {
 struct WhileNode WhileNode_init(void);
 struct WhileNode WhileNode_create(struct Expr *expr, struct BlockNode *body,
         bool body_in_block);
-void WhileNode_free_w_self(struct WhileNode *self);
 void WhileNode_get_array_lits(const struct WhileNode *self,
-        struct ArrayLitList *list);
+        const struct ExprTable *exprs, struct ArrayLitList *list);
 
 struct ForNode {
 
@@ -378,9 +460,8 @@ struct ForNode {
 struct ForNode ForNode_init(void);
 struct ForNode ForNode_create(struct Expr *init, struct Expr *condition,
         struct Expr *inc, struct BlockNode *body, bool body_in_block);
-void ForNode_free_w_self(struct ForNode *self);
 void ForNode_get_array_lits(const struct ForNode *self,
-        struct ArrayLitList *list);
+        const struct ExprTable *exprs, struct ArrayLitList *list);
 
 struct DebugPrintRAX {
 
@@ -0,0 +1,177 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "batch.h"
+#include "compile.h"
+#include "comp_ctx.h"
+#include "safe_mem.h"
+#include "comp_dependent/ints.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+struct BatchJob {
+
+    const char *src_path;
+    char *asm_out_path;
+
+    /* stdout and stderr of the job. they're kept in memory until every job
+     * before this one has been printed */
+    char *out_text;
+    size_t out_len;
+    char *err_text;
+    size_t err_len;
+
+    bool error_occurred;
+    /* set under the queue's lock once the job has been run */
+    bool done;
+
+};
+
+struct BatchQueue {
+
+    const struct CompArgs *args;
+
+    struct BatchJob *jobs;
+    u32 n_jobs;
+
+    /* the index of the next job nobody has picked up yet */
+    u32 next_job;
+    pthread_mutex_t lock;
+    /* signaled every time a job is done */
+    pthread_cond_t job_done;
+
+};
+
+char* Batch_asm_path(const char *src_path) {
+
+    const char *slash = strrchr(src_path, '/');
+    const char *dot = strrchr(src_path, '.');
+    size_t base_len = strlen(src_path);
+    char *asm_path = NULL;
+
+    if (dot && (!slash || dot > slash+1))
+        base_len = dot-src_path;
+
+    asm_path = safe_malloc(base_len+3, MemTag_DRIVER);
+    memcpy(asm_path, src_path, base_len);
+    strcpy(&asm_path[base_len], ".s");
+
+    return asm_path;
+
+}
+
+static void BatchJob_run(struct BatchJob *self, struct CompilerCtx *ctx) {
+
+    FILE *out_stream = open_memstream(&self->out_text, &self->out_len);
+    FILE *err_stream = open_memstream(&self->err_text, &self->err_len);
+
+    if (!out_stream || !err_stream) {
+        perror("open_memstream failed");
+        exit(EXIT_FAILURE);
+    }
+
+    self->error_occurred = Compile_file(ctx, self->src_path,
+            self->asm_out_path, out_stream, err_stream);
+
+    fclose(out_stream);
+    fclose(err_stream);
+
+}
+
+static void* worker(void *queue_ptr) {
+
+    struct BatchQueue *queue = queue_ptr;
+    /* one context per thread, reused for every job it runs */
+    struct CompilerCtx ctx = CompilerCtx_create(*queue->args);
+
+    while (true) {
+        u32 job_idx;
+
+        pthread_mutex_lock(&queue->lock);
+        job_idx = queue->next_job;
+        if (job_idx < queue->n_jobs)
+            ++queue->next_job;
+        pthread_mutex_unlock(&queue->lock);
+
+        if (job_idx >= queue->n_jobs)
+            break;
+
+        BatchJob_run(&queue->jobs[job_idx], &ctx);
+
+        pthread_mutex_lock(&queue->lock);
+        queue->jobs[job_idx].done = true;
+        pthread_cond_broadcast(&queue->job_done);
+        pthread_mutex_unlock(&queue->lock);
+    }
+
+    CompilerCtx_free(&ctx);
+    return NULL;
+
+}
+
+bool Batch_compile(const struct CompArgs *args) {
+
+    struct BatchQueue queue;
+    pthread_t *threads = NULL;
+    unsigned n_threads = args->n_jobs;
+    unsigned n_started = 0;
+    bool error_occurred = false;
+    u32 i;
+
+    queue.args = args;
+    queue.n_jobs = args->n_src_paths;
+    queue.next_job = 0;
+    queue.jobs = safe_calloc(queue.n_jobs, sizeof(*queue.jobs), MemTag_DRIVER);
+    pthread_mutex_init(&queue.lock, NULL);
+    pthread_cond_init(&queue.job_done, NULL);
+
+    for (i = 0; i < queue.n_jobs; i++) {
+        queue.jobs[i].src_path = args->src_paths[i];
+        queue.jobs[i].asm_out_path = Batch_asm_path(args->src_paths[i]);
+    }
+
+    if (n_threads > queue.n_jobs)
+        n_threads = queue.n_jobs;
+    threads = safe_malloc(n_threads * sizeof(*threads), MemTag_DRIVER);
+
+    for (n_started = 0; n_started < n_threads; n_started++) {
+        if (pthread_create(&threads[n_started], NULL, worker, &queue) != 0)
+            break;
+    }
+
+    /* whatever's left over if no threads could be started */
+    if (n_started == 0)
+        worker(&queue);
+
+    /* each job gets printed as soon as it and every job before it are done,
+     * while the threads keep going on the ones after it */
+    for (i = 0; i < queue.n_jobs; i++) {
+        struct BatchJob *job = &queue.jobs[i];
+
+        pthread_mutex_lock(&queue.lock);
+        while (!job->done)
+            pthread_cond_wait(&queue.job_done, &queue.lock);
+        pthread_mutex_unlock(&queue.lock);
+
+        fwrite(job->out_text, 1, job->out_len, stdout);
+        fwrite(job->err_text, 1, job->err_len, stderr);
+        fflush(stdout);
+        error_occurred |= job->error_occurred;
+
+        /* these come from open_memstream, not safe_malloc */
+        free(job->out_text);
+        free(job->err_text);
+        m_free(job->asm_out_path);
+    }
+
+    for (i = 0; i < n_started; i++)
+        pthread_join(threads[i], NULL);
+
+    pthread_cond_destroy(&queue.job_done);
+    pthread_mutex_destroy(&queue.lock);
+    m_free(threads);
+    m_free(queue.jobs);
+
+    return error_occurred;
+
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+/* compiling several source files at once in a single process */
+
+#include "comp_args.h"
+#include "bool.h"
+
+/* compiles every file in args->src_paths on a pool of args->n_jobs threads.
+ * the assembly of each file gets written next to it, see Batch_asm_path. the
+ * messages of every file get printed once it's done, in the same order the
+ * files were passed in, so the output is the same as compiling them one by
+ * one. returns true if any of the files failed to compile. */
+bool Batch_compile(const struct CompArgs *args);
+
+/* the file extension gets replaced with .s, or .s gets appended if there
+ * isn't one. the returned string has to be freed. */
+char* Batch_asm_path(const char *src_path);
@@ -11,13 +11,13 @@ static bool is_typecast(const struct TokenList *token_tbl, u32 r_paren_idx) {
     if (r_paren_idx < 2)
         return false;
 
-    while (token_tbl->elems[r_paren_idx-n_asterisks-1].type == TokenType_MUL ||
-            token_tbl->elems[r_paren_idx-n_asterisks-1].type ==
+    while (token_tbl->types[r_paren_idx-n_asterisks-1] == TokenType_MUL ||
+            token_tbl->types[r_paren_idx-n_asterisks-1] ==
             TokenType_DEREFERENCE)
         ++n_asterisks;
 
-    ret = token_tbl->elems[r_paren_idx-n_asterisks-1].type == TokenType_IDENT &&
-            token_tbl->elems[r_paren_idx-n_asterisks-2].type == TokenType_L_PAREN;
+    ret = token_tbl->types[r_paren_idx-n_asterisks-1] == TokenType_IDENT &&
+            token_tbl->types[r_paren_idx-n_asterisks-2] == TokenType_L_PAREN;
 
     return ret;
 
@@ -30,27 +30,21 @@ void BinToUnary_convert(struct TokenList *token_tbl) {
     for (i = 0; i < token_tbl->size; i++) {
 
         bool should_convert;
-        char *prev_token_src = NULL;
 
-        if (!Token_is_bin_operator(token_tbl->elems[i].type) ||
-                !Token_has_unary_version(token_tbl->elems[i].type))
+        if (!Token_is_bin_operator(token_tbl->types[i]) ||
+                !Token_has_unary_version(token_tbl->types[i]))
             continue;
 
-        prev_token_src = Token_src(&token_tbl->elems[i-1]);
-
         should_convert = i == 0 ||
-            ((token_tbl->elems[i-1].type != TokenType_R_PAREN ||
+            ((token_tbl->types[i-1] != TokenType_R_PAREN ||
               is_typecast(token_tbl, i-1)) &&
-            !Token_is_literal(token_tbl->elems[i-1].type) &&
-            token_tbl->elems[i-1].type != TokenType_IDENT);
-
-        m_free(prev_token_src);
+            !Token_is_literal(token_tbl->types[i-1]) &&
+            token_tbl->types[i-1] != TokenType_IDENT);
 
         if (!should_convert)
             continue;
     
-        token_tbl->elems[i].type =
-            Token_convert_to_unary(token_tbl->elems[i].type);
+        token_tbl->types[i] = Token_convert_to_unary(token_tbl->types[i]);
 
     }
 
@@ -0,0 +1,379 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include "cache.h"
+#include "sha256.h"
+#include "safe_mem.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+
+/* bump this whenever the key or the entry format changes */
+#define m_cache_version "mcc cache 1"
+
+/* evicting goes down to this fraction of the max size, so it doesn't have to
+ * happen again on the very next store */
+#define m_cache_evict_percent 75
+
+struct CacheStats {
+
+    unsigned long hits;
+    unsigned long misses;
+    /* the total size of all the entries in bytes */
+    unsigned long size;
+
+};
+
+struct CacheEntry {
+
+    char name[m_cache_key_len+3];
+    time_t last_used;
+    unsigned long size;
+
+};
+
+/* the stats file gets locked with fcntl against other processes, but fcntl
+ * locks don't do anything between threads of the same process */
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+/* makes the names of temporary files unique between threads */
+static unsigned long tmp_counter = 0;
+
+/* returns dir/name, which has to be freed */
+static char* join_path(const char *dir, const char *name) {
+
+    char *path = safe_malloc(strlen(dir)+strlen(name)+2, MemTag_DRIVER);
+    sprintf(path, "%s/%s", dir, name);
+    return path;
+
+}
+
+static bool write_all(int fd, const char *buf, u32 len) {
+
+    while (len > 0) {
+        ssize_t n = write(fd, buf, len);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        buf += n;
+        len -= n;
+    }
+
+    return true;
+
+}
+
+static bool copy_file(const char *src_path, const char *dst_path) {
+
+    char buf[16384];
+    int src_fd = open(src_path, O_RDONLY);
+    int dst_fd = -1;
+    bool failed = false;
+
+    if (src_fd < 0)
+        return false;
+
+    dst_fd = open(dst_path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (dst_fd < 0) {
+        close(src_fd);
+        return false;
+    }
+
+    while (!failed) {
+        ssize_t n = read(src_fd, buf, sizeof(buf));
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0) {
+            failed = n < 0;
+            break;
+        }
+        failed = !write_all(dst_fd, buf, n);
+    }
+
+    close(src_fd);
+    failed |= close(dst_fd) != 0;
+
+    return !failed;
+
+}
+
+void Cache_key(const struct CompArgs *args, const char *src, u32 src_len,
+        const struct MacroIncludeList *includes, char key[m_cache_key_len+1]) {
+
+    struct Sha256 sha = Sha256_init();
+    u8 digest[m_sha256_digest_size];
+    char buf[128];
+    struct stat exe_stat;
+    unsigned i;
+
+    Sha256_update(&sha, m_cache_version, strlen(m_cache_version)+1);
+
+    /* a rebuilt compiler might generate different code, so the binary itself
+     * is part of the key */
+    if (stat("/proc/self/exe", &exe_stat) == 0) {
+        sprintf(buf, "%lu %lu %lu", (unsigned long)exe_stat.st_size,
+                (unsigned long)exe_stat.st_mtime,
+                (unsigned long)exe_stat.st_ino);
+        Sha256_update(&sha, buf, strlen(buf)+1);
+    }
+    Sha256_update(&sha, __DATE__ " " __TIME__, sizeof(__DATE__ " " __TIME__));
+
+    /* streaming puts the externs somewhere else in the output */
+    sprintf(buf, "O%d W%d P%d S%d", args->optimize != false,
+            args->w_error != false, args->pedantic != false,
+            args->stream_funcs != false);
+    Sha256_update(&sha, buf, strlen(buf)+1);
+
+    Sha256_update(&sha, src, src_len);
+    for (i = 0; i < includes->size; i++) {
+        const struct MacroInclude *include = &includes->elems[i];
+        sprintf(buf, "%lu", (unsigned long)include->src_len);
+        Sha256_update(&sha, include->path, strlen(include->path)+1);
+        Sha256_update(&sha, buf, strlen(buf)+1);
+        Sha256_update(&sha, include->src, include->src_len);
+    }
+    Sha256_final(&sha, digest);
+
+    for (i = 0; i < m_sha256_digest_size; i++)
+        sprintf(&key[i*2], "%02x", digest[i]);
+
+}
+
+static struct CacheStats read_stats(int fd) {
+
+    struct CacheStats stats;
+    char buf[128];
+    ssize_t len;
+
+    memset(&stats, 0, sizeof(stats));
+
+    lseek(fd, 0, SEEK_SET);
+    len = read(fd, buf, sizeof(buf)-1);
+    if (len <= 0)
+        return stats;
+    buf[len] = '\0';
+
+    if (sscanf(buf, "%lu %lu %lu", &stats.hits, &stats.misses,
+                &stats.size) != 3)
+        memset(&stats, 0, sizeof(stats));
+
+    return stats;
+
+}
+
+static void write_stats(int fd, const struct CacheStats *stats) {
+
+    char buf[128];
+    sprintf(buf, "%lu %lu %lu\n", stats->hits, stats->misses, stats->size);
+
+    lseek(fd, 0, SEEK_SET);
+    if (ftruncate(fd, 0) == 0)
+        write_all(fd, buf, strlen(buf));
+
+}
+
+static bool is_entry_name(const char *name) {
+
+    return strlen(name) == m_cache_key_len+2 &&
+        strcmp(&name[m_cache_key_len], ".s") == 0;
+
+}
+
+static int cmp_entries(const void *lhs, const void *rhs) {
+
+    time_t lhs_time = ((const struct CacheEntry *)lhs)->last_used;
+    time_t rhs_time = ((const struct CacheEntry *)rhs)->last_used;
+    return (lhs_time > rhs_time) - (lhs_time < rhs_time);
+
+}
+
+/* deletes the least recently used entries until the cache is back under
+ * m_cache_evict_percent of max_size. returns the new total size. */
+static unsigned long evict(const char *cache_dir, unsigned long max_size) {
+
+    DIR *dir = opendir(cache_dir);
+    struct dirent *dir_entry = NULL;
+    struct CacheEntry *entries = NULL;
+    u32 n_entries = 0;
+    u32 entries_capacity = 0;
+    unsigned long total_size = 0;
+    u32 i;
+
+    if (!dir)
+        return 0;
+
+    while ((dir_entry = readdir(dir))) {
+        struct stat entry_stat;
+        char *path = NULL;
+
+        if (!is_entry_name(dir_entry->d_name))
+            continue;
+
+        path = join_path(cache_dir, dir_entry->d_name);
+        if (stat(path, &entry_stat) == 0) {
+            if (n_entries == entries_capacity) {
+                entries_capacity = entries_capacity*2+16;
+                entries = safe_realloc(entries,
+                        entries_capacity*sizeof(*entries), MemTag_DRIVER);
+            }
+            strcpy(entries[n_entries].name, dir_entry->d_name);
+            entries[n_entries].last_used = entry_stat.st_mtime;
+            entries[n_entries].size = entry_stat.st_size;
+            total_size += entry_stat.st_size;
+            ++n_entries;
+        }
+        m_free(path);
+    }
+    closedir(dir);
+
+    if (n_entries > 0)
+        qsort(entries, n_entries, sizeof(*entries), cmp_entries);
+
+    for (i = 0; i < n_entries &&
+            total_size > max_size/100*m_cache_evict_percent; i++) {
+        char *path = join_path(cache_dir, entries[i].name);
+        if (unlink(path) == 0)
+            total_size -= entries[i].size;
+        m_free(path);
+    }
+
+    m_free(entries);
+    return total_size;
+
+}
+
+/* adds the changes to the stats file while holding a lock on it, and evicts
+ * entries if the cache got too big */
+static void update_stats(const struct CompArgs *args, unsigned long hits,
+        unsigned long misses, long size_change) {
+
+    char *path = join_path(args->cache_dir, "stats");
+    unsigned long max_size = args->cache_max_size*1024*1024;
+    struct CacheStats stats;
+    struct flock lock;
+    int fd;
+
+    pthread_mutex_lock(&stats_lock);
+
+    mkdir(args->cache_dir, 0777);
+    fd = open(path, O_RDWR | O_CREAT, 0666);
+    if (fd < 0) {
+        pthread_mutex_unlock(&stats_lock);
+        m_free(path);
+        return;
+    }
+
+    memset(&lock, 0, sizeof(lock));
+    lock.l_type = F_WRLCK;
+    lock.l_whence = SEEK_SET;
+    while (fcntl(fd, F_SETLKW, &lock) < 0 && errno == EINTR)
+        ;
+
+    stats = read_stats(fd);
+    stats.hits += hits;
+    stats.misses += misses;
+    if (size_change < 0 && (unsigned long)-size_change > stats.size)
+        stats.size = 0;
+    else
+        stats.size += size_change;
+
+    if (stats.size > max_size)
+        stats.size = evict(args->cache_dir, max_size);
+
+    write_stats(fd, &stats);
+
+    /* closing it releases the lock */
+    close(fd);
+    pthread_mutex_unlock(&stats_lock);
+    m_free(path);
+
+}
+
+bool Cache_fetch(const struct CompArgs *args, const char *key,
+        const char *asm_out_path) {
+
+    char name[m_cache_key_len+3];
+    char *path = NULL;
+    bool hit = false;
+
+    sprintf(name, "%s.s", key);
+    path = join_path(args->cache_dir, name);
+
+    hit = copy_file(path, asm_out_path);
+    /* the mtime is when the entry was last used, for the LRU eviction */
+    if (hit)
+        utime(path, NULL);
+
+    update_stats(args, hit, !hit, 0);
+
+    m_free(path);
+    return hit;
+
+}
+
+void Cache_store(const struct CompArgs *args, const char *key,
+        const char *asm_out_path) {
+
+    char name[m_cache_key_len+64];
+    char *path = NULL;
+    char *tmp_path = NULL;
+    struct stat entry_stat;
+    long size_change = 0;
+
+    mkdir(args->cache_dir, 0777);
+
+    pthread_mutex_lock(&stats_lock);
+    sprintf(name, "%s.s.tmp.%lu.%lu", key, (unsigned long)getpid(),
+            tmp_counter++);
+    pthread_mutex_unlock(&stats_lock);
+    tmp_path = join_path(args->cache_dir, name);
+
+    sprintf(name, "%s.s", key);
+    path = join_path(args->cache_dir, name);
+
+    if (!copy_file(asm_out_path, tmp_path) ||
+            stat(tmp_path, &entry_stat) != 0) {
+        unlink(tmp_path);
+        m_free(tmp_path);
+        m_free(path);
+        return;
+    }
+    size_change = entry_stat.st_size;
+
+    /* somebody else might've stored the same entry in the meantime */
+    if (stat(path, &entry_stat) == 0)
+        size_change -= entry_stat.st_size;
+
+    if (rename(tmp_path, path) == 0)
+        update_stats(args, 0, 0, size_change);
+    else
+        unlink(tmp_path);
+
+    m_free(tmp_path);
+    m_free(path);
+
+}
+
+void Cache_print_stats(const char *cache_dir, FILE *stream) {
+
+    char *path = join_path(cache_dir, "stats");
+    struct CacheStats stats;
+    int fd = open(path, O_RDONLY);
+
+    memset(&stats, 0, sizeof(stats));
+    if (fd >= 0) {
+        stats = read_stats(fd);
+        close(fd);
+    }
+
+    fprintf(stream, "cache '%s': %lu hits, %lu misses, %lu bytes\n",
+            cache_dir, stats.hits, stats.misses, stats.size);
+
+    m_free(path);
+
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+/* an on-disk cache of generated assembly, keyed by a hash of everything that
+ * affects it. entries are <cache dir>/<key>.s, and <cache dir>/stats keeps
+ * the hit/miss counts and the total size of the entries. */
+
+#include "comp_args.h"
+#include "pre_proc.h"
+#include "comp_dependent/ints.h"
+#include "bool.h"
+#include <stdio.h>
+
+/* the key is a hex SHA-256 */
+#define m_cache_key_len 64
+
+/* how big the cache can get if --cache-max-size isn't given, in MiB */
+#define m_cache_default_max_size 256
+
+/* hashes the source together with the args that change the output and the
+ * identity of the compiler binary. the files the source included, which
+ * includes has, get hashed too, by path and contents. the include dirs
+ * don't have to be, they only change which files those are. */
+void Cache_key(const struct CompArgs *args, const char *src, u32 src_len,
+        const struct MacroIncludeList *includes, char key[m_cache_key_len+1]);
+
+/* copies the cached assembly to asm_out_path and returns true on a hit.
+ * counts as a hit or a miss either way. */
+bool Cache_fetch(const struct CompArgs *args, const char *key,
+        const char *asm_out_path);
+
+/* copies asm_out_path into the cache. the entry gets written to a temporary
+ * file and renamed into place, so concurrent compilations never see half an
+ * entry. evicts the least recently used entries if the cache got too big. */
+void Cache_store(const struct CompArgs *args, const char *key,
+        const char *asm_out_path);
+
+void Cache_print_stats(const char *cache_dir, FILE *stream);
@@ -1,10 +1,39 @@
 #include "code_gen.h"
+#include "comp_ctx.h"
 
 /* The architecture to use */
 #include "x86/code_gen.h"
 
-void CodeGen_generate(FILE *output, const struct BlockNode *ast) {
+void CodeGen_generate(struct CompilerCtx *ctx, struct OutBuf *output,
+        const struct BlockNode *ast) {
 
-    CodeGenArch_generate(output, ast);
+    CodeGenArch_generate(ctx, output, ast);
+
+}
+
+void CodeGen_begin(struct OutBuf *output) {
+
+    CodeGenArch_begin(output);
+
+}
+
+void CodeGen_func(struct CompilerCtx *ctx, struct OutBuf *output,
+        const struct FuncDeclNode *func) {
+
+    CodeGenArch_func(ctx, output, func);
+
+}
+
+void CodeGen_nodes(struct CompilerCtx *ctx, struct OutBuf *output,
+        const struct BlockNode *ast, u32 first_node) {
+
+    CodeGenArch_nodes(ctx, output, ast, first_node);
+
+}
+
+void CodeGen_end(struct CompilerCtx *ctx, struct OutBuf *output,
+        const struct BlockNode *ast, u32 first_node) {
+
+    CodeGenArch_end(ctx, output, ast, first_node);
 
 }
@@ -1,6 +1,23 @@
 #pragma once
 
 #include "ast.h"
-#include <stdio.h>
+#include "out_buf.h"
 
-void CodeGen_generate(FILE *output, const struct BlockNode *ast);
+struct CompilerCtx;
+
+void CodeGen_generate(struct CompilerCtx *ctx, struct OutBuf *output,
+        const struct BlockNode *ast);
+
+/* the same thing as CodeGen_generate, a function at a time for
+ * -fstream-funcs. begin comes first, then func for every function definition
+ * that gets streamed. nodes generates the top level nodes of ast from
+ * first_node on, so whatever's between the functions, like the initializers
+ * of globals, stays in the same place. end is for whatever's left in the ast
+ * from first_node on. */
+void CodeGen_begin(struct OutBuf *output);
+void CodeGen_func(struct CompilerCtx *ctx, struct OutBuf *output,
+        const struct FuncDeclNode *func);
+void CodeGen_nodes(struct CompilerCtx *ctx, struct OutBuf *output,
+        const struct BlockNode *ast, u32 first_node);
+void CodeGen_end(struct CompilerCtx *ctx, struct OutBuf *output,
+        const struct BlockNode *ast, u32 first_node);
@@ -1,20 +1,32 @@
 #include "comp_args.h"
 #include "bool.h"
 #include "comp_args_help.h"
+#include "cache.h"
+#include "safe_mem.h"
 #include <stddef.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
-struct CompArgs CompArgs_args;
-
 struct CompArgs CompArgs_init(void) {
 
     struct CompArgs args;
     memset(&args, 0, sizeof(args));
+    args.n_jobs = 1;
+    args.cache_max_size = m_cache_default_max_size;
     return args;
 
 }
 
+void CompArgs_free(struct CompArgs *self) {
+
+    m_free(self->src_paths);
+    self->n_src_paths = 0;
+    m_free(self->include_dirs);
+    self->n_include_dirs = 0;
+
+}
+
 bool err_if_missing_operand(const char *arg, int operand_idx, int argc) {
 
     if (operand_idx < argc)
@@ -25,12 +37,49 @@ bool err_if_missing_operand(const char *arg, int operand_idx, int argc) {
 
 }
 
+/* returns 0 if job_str isn't a positive number */
+static unsigned read_n_jobs(const char *job_str) {
+
+    char *end = NULL;
+    long n_jobs = strtol(job_str, &end, 10);
+
+    if (*job_str == '\0' || *end != '\0' || n_jobs <= 0 || n_jobs > 1024) {
+        fprintf(stderr, "error: '%s' isn't a valid number of jobs.\n",
+                job_str);
+        return 0;
+    }
+
+    return n_jobs;
+
+}
+
+/* returns 0 if size_str isn't a positive number of MiB */
+static unsigned long read_cache_size(const char *size_str) {
+
+    char *end = NULL;
+    long size = strtol(size_str, &end, 10);
+
+    if (*size_str == '\0' || *end != '\0' || size <= 0 || size > 1048576) {
+        fprintf(stderr, "error: '%s' isn't a valid cache size.\n",
+                size_str);
+        return 0;
+    }
+
+    return size;
+
+}
+
 struct CompArgs CompArgs_get_args(int argc, char **argv) {
 
     struct CompArgs args = CompArgs_init();
 
     int i;
 
+    /* there can't be more source files or include dirs than arguments */
+    args.src_paths = safe_malloc(argc * sizeof(*args.src_paths), MemTag_DRIVER);
+    args.include_dirs = safe_malloc(argc * sizeof(*args.include_dirs),
+            MemTag_DRIVER);
+
     for (i = 1; i < argc; i++) {
 
         if (strcmp(argv[i], "-o") == 0) {
@@ -47,7 +96,9 @@ struct CompArgs CompArgs_get_args(int argc, char **argv) {
 
         else if (strcmp(argv[i], "-h") == 0 ||
                 strcmp(argv[i], "--help") == 0) {
-            printf("%s", CompArgs_help_str);
+            char **help_str = CompArgs_help_strs;
+            for (; *help_str; help_str++)
+                printf("%s", *help_str);
         }
 
         else if (strcmp(argv[i], "-Werror") == 0) {
@@ -56,6 +107,70 @@ struct CompArgs CompArgs_get_args(int argc, char **argv) {
         else if (strcmp(argv[i], "--pedantic") == 0) {
             args.pedantic = true;
         }
+        else if (strcmp(argv[i], "--echo-src") == 0) {
+            args.echo_src = true;
+        }
+
+        else if (strcmp(argv[i], "-ftime-report") == 0) {
+            args.time_report = true;
+        }
+        else if (strcmp(argv[i], "-ftime-report=json") == 0) {
+            args.time_report = true;
+            args.time_report_json = true;
+        }
+
+        else if (strcmp(argv[i], "-fmem-report") == 0) {
+            args.mem_report = true;
+        }
+
+        else if (strcmp(argv[i], "-fstream-funcs") == 0) {
+            args.stream_funcs = true;
+        }
+
+        else if (strncmp(argv[i], "-ftrace=", 8) == 0 && argv[i][8] != '\0') {
+            args.trace_path = &argv[i][8];
+        }
+
+        else if (strcmp(argv[i], "--cache-dir") == 0) {
+            if (err_if_missing_operand(argv[i], i+1, argc))
+                break;
+            args.cache_dir = argv[i+1];
+            ++i;
+        }
+        else if (strcmp(argv[i], "--cache-max-size") == 0) {
+            if (err_if_missing_operand(argv[i], i+1, argc))
+                break;
+            args.cache_max_size = read_cache_size(argv[i+1]);
+            ++i;
+        }
+        else if (strcmp(argv[i], "--cache-stats") == 0) {
+            args.cache_stats = true;
+        }
+
+        else if (strcmp(argv[i], "-I") == 0) {
+            if (err_if_missing_operand(argv[i], i+1, argc))
+                break;
+            args.include_dirs[args.n_include_dirs++] = argv[i+1];
+            ++i;
+        }
+        else if (strncmp(argv[i], "-I", 2) == 0) {
+            args.include_dirs[args.n_include_dirs++] = &argv[i][2];
+        }
+
+        else if (strcmp(argv[i], "-j") == 0) {
+            if (err_if_missing_operand(argv[i], i+1, argc))
+                break;
+            args.n_jobs = read_n_jobs(argv[i+1]);
+            ++i;
+        }
+        else if (strncmp(argv[i], "-j", 2) == 0) {
+            args.n_jobs = read_n_jobs(&argv[i][2]);
+        }
+
+        /* stdin */
+        else if (strcmp(argv[i], "-") == 0) {
+            args.src_paths[args.n_src_paths++] = argv[i];
+        }
 
         else if (argv[i][0] == '-') {
             fprintf(stderr,
@@ -64,11 +179,14 @@ struct CompArgs CompArgs_get_args(int argc, char **argv) {
         }
 
         else {
-            args.src_path = argv[i];
+            args.src_paths[args.n_src_paths++] = argv[i];
         }
 
     }
 
+    if (args.n_src_paths > 0)
+        args.src_path = args.src_paths[0];
+
     return args;
 
 }
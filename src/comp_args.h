@@ -2,20 +2,59 @@
 
 /* arguments that have been passed to the compiler */
 
+#include "comp_dependent/ints.h"
 #include "bool.h"
 
 struct CompArgs {
 
+    /* the file currently being compiled. it's the first of src_paths after
+     * the args have been parsed */
     const char *src_path;
     const char *asm_out_path;
 
+    /* every source file that was passed, in order */
+    const char **src_paths;
+    u32 n_src_paths;
+
+    /* the -I dirs #include looks in, in order */
+    const char **include_dirs;
+    u32 n_include_dirs;
+    /* makes #include an error, the library never touches the filesystem */
+    bool no_includes;
+
+    /* how many threads to compile the source files on */
+    unsigned n_jobs;
+
     bool optimize;
     bool w_error;
     bool pedantic;
 
-};
+    /* print the source file to stdout before compiling it */
+    bool echo_src;
+
+    /* -ftime-report and -ftime-report=json */
+    bool time_report;
+    bool time_report_json;
 
-extern struct CompArgs CompArgs_args;
+    /* -fmem-report */
+    bool mem_report;
+
+    /* -fstream-funcs, generate the code for each function as soon as it's
+     * been parsed instead of keeping the whole AST around */
+    bool stream_funcs;
+
+    /* where -ftrace=<file> writes the trace events to, NULL if it's off */
+    const char *trace_path;
+
+    /* --cache-dir <dir>, NULL if the cache is off */
+    const char *cache_dir;
+    /* --cache-max-size <MiB>. 0 if the given size wasn't valid */
+    unsigned long cache_max_size;
+    /* --cache-stats */
+    bool cache_stats;
+
+};
 
 struct CompArgs CompArgs_init(void);
 struct CompArgs CompArgs_get_args(int argc, char **argv);
+void CompArgs_free(struct CompArgs *self);
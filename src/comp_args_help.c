@@ -1,10 +1,32 @@
 #include "comp_args_help.h"
+#include <stddef.h>
 
-char *CompArgs_help_str =
-    "--help/-h                Show this menu.\n"
-    "<file>                   Select the C source file path.\n"
-    "-o <file>                Select the output file path.\n"
-    "-O/--optimize            Applies compiler optimizations.\n"
-    "-Werror                  Turns warnings into errors.\n"
-    "--pedantic               Warns about usage of non-standard extensions.\n"
-;
+char *CompArgs_help_strs[] = {
+    "--help/-h                Show this menu.\n",
+    "<file>...                Select the C source files. - reads stdin. With\n"
+    "                         several files, each one goes to <file>.s.\n",
+    "-o <file>                Select the output file path.\n",
+    "-O/--optimize            Applies compiler optimizations.\n",
+    "-I <dir>                 Adds dir to the dirs #include looks in.\n"
+    "                         \"file\" gets looked for next to the file\n"
+    "                         including it first.\n",
+    "-Werror                  Turns warnings into errors.\n",
+    "--pedantic               Warns about usage of non-standard extensions.\n",
+    "--echo-src               Prints the source file before compiling it.\n",
+    "-j <n>                   Compiles the source files on n threads.\n",
+    "-ftime-report[=json]     Prints how long each stage of the compiler took\n"
+    "                         to stderr, as a table or as a line of JSON.\n",
+    "-fmem-report             Prints how many allocations and bytes each part\n"
+    "                         of the compiler used to stderr when it's done.\n",
+    "-fstream-funcs           Generates the code for each function as soon as\n"
+    "                         it's parsed, so the AST only ever holds one\n"
+    "                         function body.\n",
+    "-ftrace=<file>           Writes a chrome trace of the compiler's stages\n"
+    "                         and of every function to file.\n",
+    "--cache-dir <dir>        Reuses the assembly of earlier compilations of\n"
+    "                         the same source and options from dir.\n",
+    "--cache-max-size <MiB>   Evicts the least recently used entries when the\n"
+    "                         cache gets bigger than this. 256 by default.\n",
+    "--cache-stats            Prints the hits, misses and size of the cache.\n",
+    NULL
+};
@@ -1,3 +1,5 @@
 #pragma once
 
-extern char *CompArgs_help_str;
+/* one string per option, NULL terminated. it's split up cuz C89 compilers
+ * only have to support string literals up to 509 chars */
+extern char *CompArgs_help_strs[];
@@ -0,0 +1,87 @@
+#include "comp_ctx.h"
+#include "comp_args.h"
+#include "identifier.h"
+#include "interner.h"
+#include "parser_var.h"
+#include "typedef.h"
+#include "x86/ir_state.h"
+#include "time_report.h"
+#include "arena.h"
+#include "ast.h"
+#include "out_buf.h"
+
+struct CompilerCtx CompilerCtx_init(void) {
+
+    struct CompilerCtx ctx;
+    ctx.args = CompArgs_init();
+    ctx.preproc_error_occurred = false;
+    ctx.lexer_error_occurred = false;
+    ctx.parser_error_occurred = false;
+    ctx.sy_error_occurred = false;
+    ctx.vars = ParVarList_init();
+    ctx.typedefs = TypedefList_init();
+    ctx.syms = Interner_init();
+    Ident_intern_builtins(&ctx.syms);
+    ctx.ast_arena = Arena_create(MemTag_AST);
+    ctx.exprs = ExprTable_init();
+    ctx.func_parsed = NULL;
+    ctx.body_arena = Arena_create(MemTag_AST);
+    ctx.stream_output = NULL;
+    ctx.n_streamed_nodes = 0;
+    ctx.defined_funcs = SymFlagList_init();
+    ctx.ir = IRState_init();
+    ctx.output = OutBuf_init();
+    ctx.time_report = TimeReport_init();
+    ctx.err_stream = stderr;
+    ctx.diagnostics_printed = false;
+    return ctx;
+
+}
+
+struct CompilerCtx CompilerCtx_create(struct CompArgs args) {
+
+    struct CompilerCtx ctx = CompilerCtx_init();
+    ctx.args = args;
+    ctx.time_report.enabled = args.time_report;
+    return ctx;
+
+}
+
+void CompilerCtx_reset(struct CompilerCtx *self) {
+
+    self->preproc_error_occurred = false;
+    self->lexer_error_occurred = false;
+    self->parser_error_occurred = false;
+    self->sy_error_occurred = false;
+    ParVarList_clear(&self->vars, NULL);
+    TypedefList_clear(&self->typedefs, NULL);
+    Interner_clear(&self->syms);
+    Ident_intern_builtins(&self->syms);
+    Arena_reset(&self->ast_arena);
+    ExprTable_clear(&self->exprs);
+    self->func_parsed = NULL;
+    Arena_reset(&self->body_arena);
+    self->stream_output = NULL;
+    self->n_streamed_nodes = 0;
+    SymFlagList_clear(&self->defined_funcs, NULL);
+    IRState_reset(&self->ir);
+    self->time_report = TimeReport_init();
+    self->time_report.enabled = self->args.time_report;
+    self->diagnostics_printed = false;
+
+}
+
+void CompilerCtx_free(struct CompilerCtx *self) {
+
+    ParVarList_free(&self->vars);
+    TypedefList_free(&self->typedefs);
+    Interner_free(&self->syms);
+
+    Arena_free(&self->ast_arena);
+    Arena_free(&self->body_arena);
+    SymFlagList_free(&self->defined_funcs);
+    IRState_free(&self->ir);
+    OutBuf_free(&self->output);
+    ExprTable_free(&self->exprs);
+
+}
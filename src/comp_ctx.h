@@ -0,0 +1,80 @@
+#pragma once
+
+/* everything a single compilation needs to keep track of. none of the stages
+ * keep state of their own, so several compilations can run at once as long as
+ * each one has its own context. */
+
+#include "comp_args.h"
+#include "interner.h"
+#include "parser_var.h"
+#include "typedef.h"
+#include "x86/ir_state.h"
+#include "time_report.h"
+#include "arena.h"
+#include "ast.h"
+#include "out_buf.h"
+#include "bool.h"
+
+#include <stdio.h>
+
+struct CompilerCtx {
+
+    struct CompArgs args;
+
+    bool preproc_error_occurred;
+    bool lexer_error_occurred;
+    bool parser_error_occurred;
+    bool sy_error_occurred;
+
+    /* the variables and typedefs the parser currently has in scope */
+    struct ParVarList vars;
+    struct TypedefList typedefs;
+    /* every identifier the lexer has come across, the parser and everything
+     * after it refer to identifiers by their id in here */
+    struct Interner syms;
+
+    /* the AST and everything hanging off of it. gets reset once the code for
+     * a translation unit has been generated */
+    struct Arena ast_arena;
+    /* the parts of the exprs that aren't kept in the nodes themselves */
+    struct ExprTable exprs;
+
+    /* -fstream-funcs. if set, the parser hands every function declaration
+     * at the top level to func_parsed as soon as it's done with it and throws
+     * the body away afterwards. top_level is what's been parsed of the top
+     * level before the function. the bodies get allocated from body_arena
+     * instead of ast_arena so they can go on their own. */
+    void (*func_parsed)(struct CompilerCtx *ctx,
+            struct BlockNode *top_level, struct FuncDeclNode *func);
+    struct Arena body_arena;
+    /* where func_parsed writes the code to, NULL if there's no output */
+    struct OutBuf *stream_output;
+    /* how many of the top level nodes func_parsed has generated the code for
+     * already */
+    u32 n_streamed_nodes;
+    /* indexed by the interned id of a func's name, whether it gets defined
+     * anywhere in the file. the parser fills it in before it starts, so the
+     * extern of a prototype can be written where the prototype is */
+    struct SymFlagList defined_funcs;
+
+    struct IRState ir;
+    /* what Compile_file writes the assembly through */
+    struct OutBuf output;
+
+    /* only gets filled in if args.time_report is set */
+    struct TimeReport time_report;
+
+    /* where errors and warnings get written to. stderr by default */
+    FILE *err_stream;
+    /* whether any error or warning got printed, the cache doesn't store
+     * output that came with diagnostics since they'd be lost on a hit */
+    bool diagnostics_printed;
+
+};
+
+struct CompilerCtx CompilerCtx_init(void);
+struct CompilerCtx CompilerCtx_create(struct CompArgs args);
+/* gets the context ready for another compilation with the same args. all the
+ * memory it's holding on to is kept for reuse */
+void CompilerCtx_reset(struct CompilerCtx *self);
+void CompilerCtx_free(struct CompilerCtx *self);
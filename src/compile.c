@@ -0,0 +1,286 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include "compile.h"
+#include "comp_ctx.h"
+#include "ast.h"
+#include "code_gen.h"
+#include "lexer.h"
+#include "parser.h"
+#include "pre_to_post_fix.h"
+#include "bin_to_unary.h"
+#include "merge_strings.h"
+#include "pre_proc.h"
+#include "const_fold.h"
+#include "time_report.h"
+#include "trace.h"
+#include "cache.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+/* the items the parse and const fold stages count, only worth walking the
+ * tree for when the time report is on */
+static u32 timed_n_nodes(struct CompilerCtx *ctx,
+        const struct BlockNode *block) {
+
+    /* prototypes don't have a block */
+    if (!ctx->time_report.enabled || !block)
+        return 0;
+    return BlockNode_n_nodes(block, &ctx->exprs);
+
+}
+
+/* -fstream-funcs. generates the code for a function as soon as the parser's
+ * done with it, the parser throws the body away afterwards. anything at the
+ * top level before it that's still waiting, like the initializer of a global,
+ * goes first so the code comes out in the same order as without streaming */
+static void stream_func(struct CompilerCtx *ctx,
+        struct BlockNode *top_level, struct FuncDeclNode *func) {
+
+    struct TimeReport *timer = &ctx->time_report;
+    u32 first_node = ctx->n_streamed_nodes;
+    u32 i;
+
+    /* this gets called in the middle of the parse stage */
+    TimeReport_stop(timer, TimeStage_PARSE,
+            timed_n_nodes(ctx, func->body));
+
+    ctx->n_streamed_nodes = top_level->nodes.size;
+
+    /* there's no point in generating any more code after an error */
+    if (!ctx->parser_error_occurred && ctx->stream_output) {
+        if (first_node < top_level->nodes.size) {
+            if (ctx->args.optimize) {
+                TimeReport_start(timer);
+                for (i = first_node; i < top_level->nodes.size; i++)
+                    ASTNode_const_fold(&top_level->nodes.elems[i]);
+                /* they get counted when the whole ast is folded at the end */
+                TimeReport_stop(timer, TimeStage_CONST_FOLD, 0);
+            }
+            CodeGen_nodes(ctx, ctx->stream_output, top_level, first_node);
+        }
+        if (ctx->args.optimize) {
+            TimeReport_start(timer);
+            FuncDeclNode_const_fold(func);
+            TimeReport_stop(timer, TimeStage_CONST_FOLD,
+                    timed_n_nodes(ctx, func->body));
+        }
+        CodeGen_func(ctx, ctx->stream_output, func);
+    }
+
+    TimeReport_start(timer);
+
+}
+
+/* what the pre-processor hands over to the lexer */
+struct PreProcessed {
+
+    struct PreProcMacroList macros;
+    struct TokenList macro_tokens;
+    struct MacroSegmentList macro_segments;
+    struct MacroInstList macro_insts;
+    struct MacroIncludeList includes;
+
+};
+
+static void preprocess(struct CompilerCtx *ctx, const struct SourceBuf *src,
+        struct PreProcessed *pre) {
+
+    struct TimeReport *timer = &ctx->time_report;
+
+    TimeReport_start(timer);
+    PreProc_process(ctx, src->src, src->len, &pre->macros, &pre->macro_tokens,
+            &pre->macro_segments, &pre->macro_insts, &pre->includes,
+            ctx->args.src_path);
+    TimeReport_stop(timer, TimeStage_PREPROC, src->len);
+
+}
+
+static void free_preprocessed(struct PreProcessed *pre) {
+
+    PreProcMacroList_free(&pre->macros);
+    TokenList_free(&pre->macro_tokens);
+    MacroSegmentList_free(&pre->macro_segments);
+    MacroInstList_free(&pre->macro_insts);
+    MacroIncludeList_clear(&pre->includes, MacroInclude_free);
+    MacroIncludeList_free(&pre->includes);
+
+}
+
+/* everything Compile_src does after the pre-processor. frees pre */
+static void compile_preprocessed(struct CompilerCtx *ctx,
+        const struct SourceBuf *src, struct PreProcessed *pre,
+        struct OutBuf *output, bool *error_occurred) {
+
+    struct TimeReport *timer = &ctx->time_report;
+
+    *error_occurred = false;
+
+    if (!ctx->preproc_error_occurred) {
+        struct Lexer lexer;
+
+        TimeReport_start(timer);
+        lexer = Lexer_lex(ctx, src->src, src->len, ctx->args.src_path,
+                &pre->macro_tokens, &pre->macro_segments, &pre->macro_insts,
+                &pre->includes);
+        TimeReport_stop(timer, TimeStage_LEX, lexer.token_tbl.size);
+
+        if (!ctx->lexer_error_occurred) {
+            struct BlockNode *ast;
+
+            TimeReport_start(timer);
+            MergeStrings_merge(&lexer.token_tbl);
+            TimeReport_stop(timer, TimeStage_MERGE_STRINGS,
+                    lexer.token_tbl.size);
+
+            TimeReport_start(timer);
+            BinToUnary_convert(&lexer.token_tbl);
+            TimeReport_stop(timer, TimeStage_BIN_TO_UNARY,
+                    lexer.token_tbl.size);
+
+            TimeReport_start(timer);
+            PreToPostFix_convert(&lexer.token_tbl);
+            TimeReport_stop(timer, TimeStage_PRE_TO_POST_FIX,
+                    lexer.token_tbl.size);
+
+            if (ctx->args.stream_funcs) {
+                ctx->func_parsed = stream_func;
+                ctx->stream_output = output;
+                if (output)
+                    CodeGen_begin(output);
+            }
+
+            TimeReport_start(timer);
+            ast = Parser_parse(ctx, &lexer);
+            TimeReport_stop(timer, TimeStage_PARSE,
+                    timed_n_nodes(ctx, ast));
+
+            if (!ctx->parser_error_occurred && output) {
+                if (ctx->args.optimize) {
+                    TimeReport_start(timer);
+                    BlockNode_const_fold(ast);
+                    TimeReport_stop(timer, TimeStage_CONST_FOLD,
+                            timed_n_nodes(ctx, ast));
+                }
+                if (ctx->args.stream_funcs)
+                    CodeGen_end(ctx, output, ast, ctx->n_streamed_nodes);
+                else
+                    CodeGen_generate(ctx, output, ast);
+            }
+            else
+                *error_occurred = true;
+
+            /* the whole AST goes in one go */
+            Arena_reset(&ctx->ast_arena);
+            ExprTable_clear(&ctx->exprs);
+        }
+        else
+            *error_occurred = true;
+
+        Lexer_free(&lexer);
+    }
+    else
+        *error_occurred = true;
+
+    free_preprocessed(pre);
+
+    if (ctx->args.time_report) {
+        TimeReport_print(timer, ctx->args.src_path,
+                ctx->args.time_report_json, ctx->err_stream);
+    }
+
+}
+
+void Compile_src(struct CompilerCtx *ctx, const struct SourceBuf *src,
+        struct OutBuf *output, bool *error_occurred) {
+
+    struct PreProcessed pre;
+
+    preprocess(ctx, src, &pre);
+    compile_preprocessed(ctx, src, &pre, output, error_occurred);
+
+}
+
+bool Compile_file(struct CompilerCtx *ctx, const char *src_path,
+        const char *asm_out_path, FILE *out_stream, FILE *err_stream) {
+
+    const struct CompArgs *args = &ctx->args;
+    struct SourceBuf src;
+    struct OutBuf *output = NULL;
+    bool error_occurred = false;
+    double trace_start = Trace_begin();
+    bool use_cache = args->cache_dir && asm_out_path;
+    char cache_key[m_cache_key_len+1];
+    struct PreProcessed pre;
+
+    CompilerCtx_reset(ctx);
+    ctx->args.src_path = src_path;
+    ctx->args.asm_out_path = asm_out_path;
+    ctx->err_stream = err_stream;
+
+    if (!SourceBuf_open(&src, src_path, err_stream))
+        return true;
+    if (args->echo_src) {
+        fwrite(src.src, sizeof(*src.src), src.len, out_stream);
+        fputc('\n', out_stream);
+    }
+
+    /* the included files are part of the key, so the pre-processor has to
+     * find them first */
+    preprocess(ctx, &src, &pre);
+
+    if (use_cache && !ctx->preproc_error_occurred) {
+        Cache_key(args, src.src, src.len, &pre.includes, cache_key);
+        if (Cache_fetch(args, cache_key, asm_out_path)) {
+            free_preprocessed(&pre);
+            SourceBuf_free(&src);
+            Trace_end("file", "cached ", src_path, trace_start);
+            return false;
+        }
+    }
+
+    if (asm_out_path) {
+        int fd = open(asm_out_path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        if (fd < 0) {
+            fprintf(err_stream, "can't open file '%s': %s\n",
+                    asm_out_path, strerror(errno));
+            free_preprocessed(&pre);
+            SourceBuf_free(&src);
+            return true;
+        }
+        /* the buffer is kept for the next file the context compiles */
+        output = &ctx->output;
+        OutBuf_reset(output, fd);
+    }
+
+    compile_preprocessed(ctx, &src, &pre, output, &error_occurred);
+
+    SourceBuf_free(&src);
+    if (output) {
+        /* -fstream-funcs might have written out some of the funcs already,
+         * a failed compile leaves the file empty either way */
+        if (error_occurred) {
+            OutBuf_reset(output, output->fd);
+            if (ftruncate(output->fd, 0) != 0) {
+                fprintf(err_stream, "can't truncate file '%s': %s\n",
+                        asm_out_path, strerror(errno));
+            }
+        }
+        else if (!OutBuf_flush(output)) {
+            fprintf(err_stream, "can't write to file '%s': %s\n",
+                    asm_out_path, strerror(errno));
+            error_occurred = true;
+        }
+        close(output->fd);
+        OutBuf_reset(output, -1);
+    }
+
+    if (use_cache && !error_occurred && !ctx->diagnostics_printed)
+        Cache_store(args, cache_key, asm_out_path);
+
+    Trace_end("file", "compile ", src_path, trace_start);
+
+    return error_occurred;
+
+}
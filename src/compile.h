@@ -0,0 +1,25 @@
+#pragma once
+
+/* runs a translation unit through every stage of the compiler */
+
+#include "comp_args.h"
+#include "source_buf.h"
+#include "out_buf.h"
+#include "bool.h"
+#include <stdio.h>
+
+struct CompilerCtx;
+
+/* output can be NULL if the assembly isn't needed. *error_occurred gets set
+ * to true if any of the stages failed. */
+void Compile_src(struct CompilerCtx *ctx, const struct SourceBuf *src,
+        struct OutBuf *output, bool *error_occurred);
+
+/* compiles the file at src_path with the options in ctx->args and writes the
+ * assembly to asm_out_path, which can be NULL. --echo-src goes to out_stream
+ * and all the diagnostics go to err_stream, so several files can be compiled
+ * at once without their messages getting mixed up. ctx gets reset first, so
+ * one context can compile file after file while reusing its memory.
+ * returns true if an error occurred. */
+bool Compile_file(struct CompilerCtx *ctx, const char *src_path,
+        const char *asm_out_path, FILE *out_stream, FILE *err_stream);
@@ -2,7 +2,6 @@
 #include "array_lit.h"
 #include "ast.h"
 #include "prim_type.h"
-#include "safe_mem.h"
 
 void Expr_const_fold(struct Expr **expr) {
 
@@ -11,15 +10,14 @@ void Expr_const_fold(struct Expr **expr) {
 
     if (Expr_statically_evaluatable(*expr)) {
         u32 value = Expr_evaluate(*expr);
-        struct Expr old_expr = **expr;
-
-        Expr_recur_free_w_self(*expr);
-        *expr = safe_malloc(sizeof(**expr));
-        **expr = Expr_create(old_expr.line_num, old_expr.column_num,
-                old_expr.src_start, old_expr.src_len, old_expr.file_path,
-                NULL, NULL, 0, 0, PrimType_INVALID, PrimType_INVALID,
-                ExprPtrList_init(), value, ArrayLit_init(), 0,
-                ExprType_INT_LIT, false, 0);
+        u32 id = (*expr)->id;
+
+        /* the old operands live in the AST arena, so the node can just be
+         * overwritten. it keeps its id so it keeps its place in the source */
+        **expr = Expr_init();
+        (*expr)->id = id;
+        (*expr)->int_value = value;
+        (*expr)->expr_type = ExprType_INT_LIT;
     }
     else {
         if ((*expr)->lhs)
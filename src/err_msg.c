@@ -1,13 +1,13 @@
 #include "err_msg.h"
-#include "comp_args.h"
+#include "comp_ctx.h"
 #include <stdarg.h>
 #include <stdio.h>
 
 bool ErrMsg_on = true;
 bool WarnMsg_on = true;
 
-void ErrMsg_print(bool print_err, bool *err_occurred, const char *file_path,
-        const char *fmt, ...) {
+void ErrMsg_print(struct CompilerCtx *ctx, bool print_err, bool *err_occurred,
+        const char *file_path, const char *fmt, ...) {
 
     va_list args;
     va_start(args, fmt);
@@ -15,29 +15,33 @@ void ErrMsg_print(bool print_err, bool *err_occurred, const char *file_path,
     if (print_err) {
         if (err_occurred)
             *err_occurred = true;
-        fprintf(stderr, "%s: error: ", file_path);
-        vfprintf(stderr, fmt, args);
+        ctx->diagnostics_printed = true;
+        fprintf(ctx->err_stream, "%s: error: ", file_path);
+        vfprintf(ctx->err_stream, fmt, args);
     }
 
     va_end(args);
 
 }
 
-void WarnMsg_print(bool print_warn, bool *err_occurred, const char *file_path,
+void WarnMsg_print(struct CompilerCtx *ctx, bool print_warn,
+        bool *err_occurred, const char *file_path,
         const char *fmt, ...) {
 
     va_list args;
     va_start(args, fmt);
 
-    if (CompArgs_args.w_error && print_warn) {
+    if (ctx->args.w_error && print_warn) {
         if (err_occurred)
             *err_occurred = true;
-        fprintf(stderr, "%s: error: ", file_path);
-        vfprintf(stderr, fmt, args);
+        ctx->diagnostics_printed = true;
+        fprintf(ctx->err_stream, "%s: error: ", file_path);
+        vfprintf(ctx->err_stream, fmt, args);
     }
     else if (print_warn) {
-        fprintf(stderr, "%s: warning: ", file_path);
-        vfprintf(stderr, fmt, args);
+        ctx->diagnostics_printed = true;
+        fprintf(ctx->err_stream, "%s: warning: ", file_path);
+        vfprintf(ctx->err_stream, fmt, args);
     }
 
     va_end(args);
@@ -3,17 +3,23 @@
 #include "bool.h"
 #include "attrib.h"
 
+struct CompilerCtx;
+
 /* do errors/warnings get emitted? both are true by default */
 extern bool ErrMsg_on;
 extern bool WarnMsg_on;
 
-/* print_err      - if false, this function does nothing.
+/* ctx            - the compilation the message belongs to. the message gets
+ *                  written to ctx->err_stream.
+ * print_err      - if false, this function does nothing.
  * err_occurred   - gets set to true if print_err is true. makes setting stuff
- *                  like Parser_error_occurred to true whenever an error
+ *                  like ctx->parser_error_occurred to true whenever an error
  *                  occurred less clunky. can be NULL if you don't need it. */
-void ErrMsg_print(bool print_err, bool *err_occurred, const char *file_path,
-        const char *fmt, ...) ATTRIBUTE((format (printf, 4, 5)));
+void ErrMsg_print(struct CompilerCtx *ctx, bool print_err, bool *err_occurred,
+        const char *file_path,
+        const char *fmt, ...) ATTRIBUTE((format (printf, 5, 6)));
 
 /* args do the same as with ErrMsg_print */
-void WarnMsg_print(bool print_warn, bool *err_occurred, const char *file_path,
-        const char *fmt, ...) ATTRIBUTE((format (printf, 4, 5)));
+void WarnMsg_print(struct CompilerCtx *ctx, bool print_warn,
+        bool *err_occurred, const char *file_path,
+        const char *fmt, ...) ATTRIBUTE((format (printf, 5, 6)));
@@ -1,62 +1,73 @@
 #include "ast.h"
+#include "comp_ctx.h"
 #include "bool.h"
 #include "comp_dependent/ints.h"
 #include "parser_var.h"
 #include "prim_type.h"
 #include "safe_mem.h"
 #include "err_msg.h"
+#include "interner.h"
 #include <assert.h>
 #include <stdio.h>
 
-static bool verify_func_call(const struct Expr *expr,
+static bool verify_func_call(struct CompilerCtx *ctx, const struct Expr *expr,
         const struct ParVarList *vars, bool is_root) {
 
     bool error = false;
-    char *func_name = Expr_src(expr);
-    u32 var_idx = ParVarList_find_var(vars, func_name);
+    const struct ExprPtrList *args = Expr_args(&ctx->exprs, expr);
+    u32 func_sym = Expr_sym(&ctx->exprs, expr);
+    const char *func_name = Interner_str(&ctx->syms, func_sym);
+    u32 var_idx = ParVarList_find_var(vars, func_sym);
     assert(var_idx != m_u32_max);
 
     if (!is_root && vars->elems[var_idx].type == PrimType_VOID &&
             vars->elems[var_idx].lvls_of_indir == 0) {
-        ErrMsg_print(ErrMsg_on, &error, expr->file_path,
+        struct TokenPos pos = Expr_pos(&ctx->exprs, expr);
+        ErrMsg_print(ctx, ErrMsg_on, &error, pos.file_path,
                 "cannot use the function '%s' in an expression, due to it"
                 " being of type 'void'. line %u, column %u.\n", func_name,
-                expr->line_num, expr->column_num);
+                pos.line_num, pos.column_num);
     }
 
-    if ((vars->elems[var_idx].void_args && expr->args.size > 0) ||
+    if ((vars->elems[var_idx].void_args && args->size > 0) ||
             (vars->elems[var_idx].args->size > 0 &&
             !VarDeclPtrList_equivalent_expr(vars->elems[var_idx].args,
-                &expr->args, vars, vars->elems[var_idx].variadic_args))) {
-        ErrMsg_print(ErrMsg_on, &error, expr->file_path,
+                args, &ctx->exprs, vars,
+                vars->elems[var_idx].variadic_args))) {
+        struct TokenPos pos = Expr_pos(&ctx->exprs, expr);
+        ErrMsg_print(ctx, ErrMsg_on, &error, pos.file_path,
                 "mismatching arguments for the call to '%s' on line %u,"
-                " column %u.\n", func_name, expr->line_num, expr->column_num);
+                " column %u.\n", func_name, pos.line_num, pos.column_num);
     }
 
-    m_free(func_name);
     return error;
 
 }
 
-static bool verify_unary_ptr_operation(const struct Expr *expr) {
+static bool verify_unary_ptr_operation(struct CompilerCtx *ctx,
+        const struct Expr *expr) {
+
+    struct TokenPos pos;
 
     if (!ExprType_is_valid_unary_ptr_operation(expr->expr_type)) {
-        char *expr_src = Expr_src(expr);
+        char *expr_src = Expr_src(&ctx->exprs, expr);
 
-        ErrMsg_print(ErrMsg_on, NULL, expr->file_path,
+        pos = Expr_pos(&ctx->exprs, expr);
+        ErrMsg_print(ctx, ErrMsg_on, NULL, pos.file_path,
                 "cannot perform unary operation '%s' on a pointer. line %u,"
-                " column %u.\n", expr_src, expr->line_num, expr->column_num);
+                " column %u.\n", expr_src, pos.line_num, pos.column_num);
 
         m_free(expr_src);
 
         return true;
     }
     else if (expr->lhs_lvls_of_indir == 1 && expr->lhs_type == PrimType_VOID) {
-        char *expr_src = Expr_src(expr);
+        char *expr_src = Expr_src(&ctx->exprs, expr);
 
-        ErrMsg_print(ErrMsg_on, NULL, expr->file_path,
+        pos = Expr_pos(&ctx->exprs, expr);
+        ErrMsg_print(ctx, ErrMsg_on, NULL, pos.file_path,
                 "cannot dereference a void pointer. line %u, column %u.\n",
-                expr->line_num, expr->column_num);
+                pos.line_num, pos.column_num);
 
         m_free(expr_src);
 
@@ -68,15 +79,19 @@ static bool verify_unary_ptr_operation(const struct Expr *expr) {
 }
 
 /* for when both operands are pointers */
-static bool verify_ptr_operation(const struct Expr *expr) {
+static bool verify_ptr_operation(struct CompilerCtx *ctx,
+        const struct Expr *expr) {
+
+    struct TokenPos pos;
 
     if (!ExprType_is_valid_ptr_operation(expr->expr_type)) {
-        char *expr_src = Expr_src(expr);
+        char *expr_src = Expr_src(&ctx->exprs, expr);
 
-        ErrMsg_print(ErrMsg_on, NULL, expr->file_path,
+        pos = Expr_pos(&ctx->exprs, expr);
+        ErrMsg_print(ctx, ErrMsg_on, NULL, pos.file_path,
                 "cannot perform operation '%s' on a pointer and a"
-                " pointer. line %u, column %u\n", expr_src, expr->line_num,
-                expr->column_num);
+                " pointer. line %u, column %u\n", expr_src, pos.line_num,
+                pos.column_num);
 
         m_free(expr_src);
 
@@ -88,15 +103,19 @@ static bool verify_ptr_operation(const struct Expr *expr) {
 }
 
 /* for when only the left operand is a pointer */
-static bool verify_single_ptr_operation(const struct Expr *expr) {
+static bool verify_single_ptr_operation(struct CompilerCtx *ctx,
+        const struct Expr *expr) {
+
+    struct TokenPos pos;
 
     if (!ExprType_is_valid_single_ptr_operation(expr->expr_type)) {
-        char *expr_src = Expr_src(expr);
+        char *expr_src = Expr_src(&ctx->exprs, expr);
 
-        ErrMsg_print(ErrMsg_on, NULL, expr->file_path,
+        pos = Expr_pos(&ctx->exprs, expr);
+        ErrMsg_print(ctx, ErrMsg_on, NULL, pos.file_path,
                 "cannot perform operation '%s' on a pointer and a"
-                " non-pointer. line %u, column %u\n", expr_src, expr->line_num,
-                expr->column_num);
+                " non-pointer. line %u, column %u\n", expr_src, pos.line_num,
+                pos.column_num);
 
         m_free(expr_src);
 
@@ -107,70 +126,86 @@ static bool verify_single_ptr_operation(const struct Expr *expr) {
 
 }
 
-static bool verify_expr(const struct Expr *expr, const struct ParVarList *vars,
+static bool verify_expr(struct CompilerCtx *ctx, const struct Expr *expr,
+        const struct ParVarList *vars,
         bool is_root, bool is_initializer) {
 
+    const struct ExprPtrList *args = Expr_args(&ctx->exprs, expr);
+    /* only looked up once there's an error to print */
+    struct TokenPos pos;
     bool error = false;
     u32 i;
 
     if (expr->lhs)
-        error |= verify_expr(expr->lhs, vars, false, is_initializer);
+        error |= verify_expr(ctx, expr->lhs, vars, false, is_initializer);
     if (expr->rhs)
-        error |= verify_expr(expr->rhs, vars, false, is_initializer);
+        error |= verify_expr(ctx, expr->rhs, vars, false, is_initializer);
 
     if (expr->expr_type == ExprType_FUNC_CALL) {
-        error |= verify_func_call(expr, vars, is_root);
+        error |= verify_func_call(ctx, expr, vars, is_root);
     }
     else if (expr->expr_type == ExprType_REFERENCE) {
         if (expr->lhs->expr_type != ExprType_IDENT &&
                 /* makes sure it's not a func call */
-                expr->lhs->args.size == 0 &&
+                Expr_args(&ctx->exprs, expr->lhs)->size == 0 &&
                 expr->lhs->expr_type != ExprType_DEREFERENCE) {
-            ErrMsg_print(ErrMsg_on, &error, expr->file_path,
+            pos = Expr_pos(&ctx->exprs, expr);
+            ErrMsg_print(ctx, ErrMsg_on, &error, pos.file_path,
                     "cannot reference an operand with no address. line %u,"
-                    " column %u.\n", expr->line_num, expr->column_num);
+                    " column %u.\n", pos.line_num, pos.column_num);
+            error = true;
+        }
+        else if (expr->lhs_lvls_of_indir == m_max_lvls_of_indir) {
+            pos = Expr_pos(&ctx->exprs, expr);
+            ErrMsg_print(ctx, ErrMsg_on, &error, pos.file_path,
+                    "referencing it would make more than %u levels of"
+                    " indirection. line %u, column %u.\n",
+                    m_max_lvls_of_indir, pos.line_num, pos.column_num);
             error = true;
         }
     }
     else if (expr->lhs_lvls_of_indir > 0 &&
             ExprType_is_unary_operator(expr->expr_type)) {
-        error |= verify_unary_ptr_operation(expr);
+        error |= verify_unary_ptr_operation(ctx, expr);
     }
     else if (expr->expr_type == ExprType_DEREFERENCE) {
-        ErrMsg_print(ErrMsg_on, &error, expr->file_path,
+        pos = Expr_pos(&ctx->exprs, expr);
+        ErrMsg_print(ctx, ErrMsg_on, &error, pos.file_path,
                 "can not dereference a non-pointer. line %u,"
-                " column %u.\n", expr->line_num, expr->column_num);
+                " column %u.\n", pos.line_num, pos.column_num);
         error = true;
     }
     else if (expr->lhs_lvls_of_indir > 0 && expr->rhs_lvls_of_indir > 0 &&
             ExprType_is_bin_operator(expr->expr_type)) {
-        error |= verify_ptr_operation(expr);
+        error |= verify_ptr_operation(ctx, expr);
     }
     else if (expr->lhs_lvls_of_indir > 0 &&
             ExprType_is_bin_operator(expr->expr_type)) {
-        error |= verify_single_ptr_operation(expr);
+        error |= verify_single_ptr_operation(ctx, expr);
     }
     else if (!is_initializer && expr->expr_type == ExprType_ARRAY_LIT &&
-            expr->array_value.elem_size == 0) {
+            Expr_array_lit(&ctx->exprs, expr)->elem_size == 0) {
         /* an elem size of 0 means the array isn't a string literal */
-        ErrMsg_print(ErrMsg_on, &error, expr->file_path,
+        pos = Expr_pos(&ctx->exprs, expr);
+        ErrMsg_print(ctx, ErrMsg_on, &error, pos.file_path,
                 "cannot use array literals outside of initializers."
-                " line num = %u, column num = %u.\n", expr->line_num,
-                expr->column_num);
+                " line num = %u, column num = %u.\n", pos.line_num,
+                pos.column_num);
         error = true;
     }
 
-    for (i = 0; i < expr->args.size; i++) {
-        verify_expr(expr->args.elems[i], vars, false, false);
+    for (i = 0; i < args->size; i++) {
+        verify_expr(ctx, args->elems[i], vars, false, false);
     }
 
     return error;
 
 }
 
-bool Expr_verify(const struct Expr *expr, const struct ParVarList *vars,
+bool Expr_verify(struct CompilerCtx *ctx, const struct Expr *expr,
+        const struct ParVarList *vars,
         bool is_initializer) {
 
-    return verify_expr(expr, vars, true, is_initializer);
+    return verify_expr(ctx, expr, vars, true, is_initializer);
 
 }
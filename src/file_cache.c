@@ -0,0 +1,274 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include "file_cache.h"
+#include "interner.h"
+#include "safe_mem.h"
+#include "vector_impl.h"
+#include "bool.h"
+#include <ctype.h>
+#include <pthread.h>
+#include <string.h>
+#include <sys/stat.h>
+
+/* indexed by the ids of the paths, NULL for a path with no file at it */
+struct CachedFileList {
+
+    struct CachedFile **elems;
+    u32 size;
+    u32 capacity;
+
+};
+
+m_declare_VectorImpl_funcs(CachedFileList, struct CachedFile *)
+m_define_VectorImpl_funcs(CachedFileList, struct CachedFile *, MemTag_SOURCE)
+
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static bool cache_init = false;
+static struct Interner paths;
+static struct CachedFileList files;
+
+/* skips whitespace and comments */
+static u32 skip_space(const char *src, u32 len, u32 i) {
+
+    for (;;) {
+        if (i < len && isspace(src[i]))
+            ++i;
+        else if (i+1 < len && src[i] == '/' && src[i+1] == '/') {
+            while (i < len && src[i] != '\n')
+                ++i;
+        }
+        else if (i+1 < len && src[i] == '/' && src[i+1] == '*') {
+            i += 2;
+            while (i+1 < len && (src[i] != '*' || src[i+1] != '/'))
+                ++i;
+            i = i+1 < len ? i+2 : len;
+        }
+        else
+            return i;
+    }
+
+}
+
+/* reads the identifier after the spaces at src[*i] and sets *i to after it.
+ * returns its length, 0 if there isn't one */
+static u32 read_ident(const char *src, u32 len, u32 *i, const char **ident) {
+
+    u32 start;
+
+    while (*i < len && (src[*i] == ' ' || src[*i] == '\t'))
+        ++*i;
+
+    start = *i;
+    *ident = &src[start];
+    if (*i < len && (isalpha(src[*i]) || src[*i] == '_')) {
+        while (*i < len && (isalnum(src[*i]) || src[*i] == '_'))
+            ++*i;
+    }
+
+    return *i-start;
+
+}
+
+static bool word_is(const char *word, u32 word_len, const char *str) {
+
+    return word_len == strlen(str) && strncmp(word, str, word_len) == 0;
+
+}
+
+/* reads the name of the directive starting with the '#' at src[*i] and sets
+ * *i to after it. returns 0 if src[*i] isn't a '#' */
+static u32 read_directive(const char *src, u32 len, u32 *i,
+        const char **name) {
+
+    if (*i >= len || src[*i] != '#')
+        return 0;
+
+    ++*i;
+    return read_ident(src, len, i, name);
+
+}
+
+/* looks for the classic include guard,
+ *     #ifndef X
+ *     #define X
+ *     ...
+ *     #endif
+ * with nothing but whitespace and comments outside of it. it only gets done
+ * once per file, after that including the file again while X is defined can
+ * be skipped without looking at the file at all. */
+static void find_guard(struct CachedFile *file) {
+
+    const char *src = file->buf.src;
+    u32 len = file->buf.len;
+    const char *guard = NULL;
+    u32 guard_len;
+    const char *name = NULL;
+    u32 name_len;
+    unsigned depth = 1;
+    bool line_start = false;
+    u32 i = skip_space(src, len, 0);
+
+    name_len = read_directive(src, len, &i, &name);
+    if (!word_is(name, name_len, "ifndef"))
+        return;
+    guard_len = read_ident(src, len, &i, &guard);
+    if (guard_len == 0)
+        return;
+
+    i = skip_space(src, len, i);
+    name_len = read_directive(src, len, &i, &name);
+    if (!word_is(name, name_len, "define") ||
+            read_ident(src, len, &i, &name) != guard_len ||
+            strncmp(name, guard, guard_len) != 0)
+        return;
+
+    /* the #endif closing the #ifndef has to be the last thing in the file */
+    for (; i < len; i++) {
+
+        if (src[i] == '\n')
+            line_start = true;
+
+        else if (src[i] == '/' && src[i+1] == '/') {
+            while (i+1 < len && src[i+1] != '\n')
+                ++i;
+        }
+        else if (src[i] == '/' && src[i+1] == '*') {
+            i += 2;
+            while (i+1 < len && (src[i] != '*' || src[i+1] != '/'))
+                ++i;
+            ++i;
+        }
+
+        else if (src[i] == '\"' || src[i] == '\'') {
+            char quote = src[i];
+            while (i+1 < len && src[i+1] != quote && src[i+1] != '\n') {
+                if (src[i+1] == '\\')
+                    ++i;
+                ++i;
+            }
+            ++i;
+            line_start = false;
+        }
+
+        else if (src[i] == '#' && line_start) {
+            name_len = read_directive(src, len, &i, &name);
+            if (word_is(name, name_len, "if") ||
+                    word_is(name, name_len, "ifdef") ||
+                    word_is(name, name_len, "ifndef"))
+                ++depth;
+            else if (word_is(name, name_len, "endif") && --depth == 0) {
+                while (i < len && src[i] != '\n')
+                    ++i;
+                if (skip_space(src, len, i) == len) {
+                    file->guard = guard;
+                    file->guard_len = guard_len;
+                }
+                return;
+            }
+            /* X being defined wouldn't skip the whole file anymore */
+            else if (depth == 1 && (word_is(name, name_len, "else") ||
+                        word_is(name, name_len, "elif")))
+                return;
+            while (i < len && src[i] != '\n')
+                ++i;
+            --i;
+            line_start = false;
+        }
+
+        else if (!isspace(src[i]))
+            line_start = false;
+
+    }
+
+}
+
+/* maps the file at path, returns NULL if there isn't one */
+static struct CachedFile* load(u32 id, const char *path, FILE *err_stream) {
+
+    struct CachedFile *file = NULL;
+    struct stat st;
+    const char *line_end = NULL;
+
+    /* not finding a file is normal when going through the include dirs, so
+     * it doesn't get an error */
+    if (stat(path, &st) != 0 || !S_ISREG(st.st_mode))
+        return NULL;
+
+    file = safe_malloc(sizeof(*file), MemTag_SOURCE);
+    file->id = id;
+    file->path = path;
+    file->line_starts = TokenOffsetList_init();
+    file->guard = NULL;
+    file->guard_len = 0;
+
+    if (!SourceBuf_open(&file->buf, path, err_stream)) {
+        m_free(file);
+        return NULL;
+    }
+
+    TokenOffsetList_push_back(&file->line_starts, 0);
+    line_end = file->buf.src;
+    while ((line_end = memchr(line_end, '\n',
+                    file->buf.src+file->buf.len-line_end))) {
+        ++line_end;
+        TokenOffsetList_push_back(&file->line_starts,
+                line_end-file->buf.src);
+    }
+
+    find_guard(file);
+
+    return file;
+
+}
+
+const struct CachedFile* FileCache_get(const char *path, FILE *err_stream) {
+
+    struct CachedFile *file = NULL;
+    u32 path_len = strlen(path);
+    u32 id;
+
+    pthread_mutex_lock(&cache_lock);
+
+    if (!cache_init) {
+        paths = Interner_init();
+        files = CachedFileList_init();
+        cache_init = true;
+    }
+
+    id = Interner_find(&paths, path, path_len);
+    if (id != m_interner_no_id)
+        file = files.elems[id];
+    else {
+        id = Interner_intern(&paths, path, path_len);
+        file = load(id, Interner_str(&paths, id), err_stream);
+        CachedFileList_push_back(&files, file);
+    }
+
+    pthread_mutex_unlock(&cache_lock);
+
+    return file;
+
+}
+
+void FileCache_free(void) {
+
+    u32 i;
+
+    pthread_mutex_lock(&cache_lock);
+
+    if (cache_init) {
+        for (i = 0; i < files.size; i++) {
+            if (!files.elems[i])
+                continue;
+            SourceBuf_free(&files.elems[i]->buf);
+            TokenOffsetList_free(&files.elems[i]->line_starts);
+            m_free(files.elems[i]);
+        }
+        CachedFileList_free(&files);
+        Interner_free(&paths);
+        cache_init = false;
+    }
+
+    pthread_mutex_unlock(&cache_lock);
+
+}
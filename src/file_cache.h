@@ -0,0 +1,37 @@
+#pragma once
+
+/* the files #include reads, shared by every compilation in the process. each
+ * one gets mapped the first time it's asked for and stays that way until
+ * FileCache_free, so a header that gets included hundreds of times is only
+ * ever read once. it's safe to use from several threads at once. */
+
+#include "source_buf.h"
+#include "token.h"
+#include "comp_dependent/ints.h"
+#include <stdio.h>
+
+struct CachedFile {
+
+    /* the cache gives every path it's asked for an id, counting up from 0 */
+    u32 id;
+    const char *path;
+    struct SourceBuf buf;
+
+    /* the offset each line in the file starts at */
+    struct TokenOffsetList line_starts;
+
+    /* the macro of the include guard around the whole file, guard_len chars
+     * at guard in the file's text. NULL if the file doesn't have one, see
+     * find_guard */
+    const char *guard;
+    u32 guard_len;
+
+};
+
+/* returns NULL if there isn't a file at path, which gets remembered too. if
+ * there is one but it can't be read, an error gets printed to err_stream.
+ * the file stays valid until FileCache_free. */
+const struct CachedFile* FileCache_get(const char *path, FILE *err_stream);
+
+/* unmaps every file. nothing can be using them anymore */
+void FileCache_free(void);
@@ -1,29 +1,51 @@
+#define _POSIX_C_SOURCE 200112L
+
 #include "file_io.h"
 #include "comp_dependent/ints.h"
 #include "safe_mem.h"
-#include <stdio.h>
+#include <errno.h>
+#include <unistd.h>
 
-void copy_file_contents(char *dest, FILE *file) {
+/* the size of the first read. doubles whenever the buffer fills up */
+#define m_read_chunk_size 65536
 
-    char c;
-    u32 i = 0;
+char *read_fd_into_str(int fd, u32 *len) {
 
-    while ((c=fgetc(file)) != EOF) dest[i++] = c;
-    dest[i] = '\0';
+    u32 str_len = 0;
+    u32 str_capacity = m_read_chunk_size;
+    char *str = safe_malloc(str_capacity*sizeof(*str), MemTag_SOURCE);
 
-}
+    for (;;) {
+
+        ssize_t n_read;
+
+        /* always leave room for the '\0' */
+        if (str_len+1 >= str_capacity) {
+            if (str_capacity > m_u32_max/2) {
+                m_free(str);
+                errno = EFBIG;
+                return NULL;
+            }
+            str_capacity *= 2;
+            str = safe_realloc(str, str_capacity*sizeof(*str), MemTag_SOURCE);
+        }
 
-char *copy_file_into_str(FILE *file) {
+        n_read = read(fd, &str[str_len], str_capacity-str_len-1);
+        if (n_read < 0 && errno == EINTR)
+            continue;
+        if (n_read < 0) {
+            m_free(str);
+            return NULL;
+        }
+        if (n_read == 0)
+            break;
 
-    u32 file_size;
-    char *str = NULL;
+        str_len += n_read;
 
-    fseek(file, 0L, SEEK_END);
-    file_size = ftell(file);
-    rewind(file);
+    }
 
-    str = safe_malloc((file_size+1)*sizeof(*str));
-    copy_file_contents(str, file);
+    str[str_len] = '\0';
+    *len = str_len;
 
     return str;
 
@@ -1,5 +1,9 @@
 #pragma once
 
-#include <stdio.h>
+#include "comp_dependent/ints.h"
 
-char *copy_file_into_str(FILE *file);
+/* reads everything left in the file descriptor into a '\0' terminated string.
+ * works with pipes too since it doesn't need to know the size up front.
+ * returns NULL if reading failed, errno is left as set by read().
+ * len        - gets set to the number of chars read, excluding the '\0'. */
+char *read_fd_into_str(int fd, u32 *len);
@@ -1,46 +1,70 @@
 #include "identifier.h"
+#include "interner.h"
 #include "prim_type.h"
 #include "token.h"
 #include "type_mods.h"
+#include <assert.h>
 #include <string.h>
 
-enum PrimitiveType Ident_type_spec(const char *ident,
+void Ident_intern_builtins(struct Interner *interner) {
+
+    static const char *names[IdentSym_COUNT] = {
+        "char", "short", "int", "long", "void", "return", "memcpy"
+    };
+    u32 i;
+
+    assert(interner->entries.size == 0);
+
+    for (i = 0; i < IdentSym_COUNT; i++) {
+        u32 id = Interner_intern(interner, names[i], strlen(names[i]));
+        assert(id == i);
+        (void)id;
+    }
+
+}
+
+enum PrimitiveType Ident_type_spec(u32 ident,
         const struct TypedefList *typedefs) {
 
     u32 i;
 
-    if (strcmp(ident, "char") == 0)
+    switch (ident) {
+
+    case IdentSym_CHAR:
         return PrimType_CHAR;
 
-    if (strcmp(ident, "short") == 0)
+    case IdentSym_SHORT:
         return PrimType_SHORT;
 
-    else if (strcmp(ident, "int") == 0)
+    case IdentSym_INT:
         return PrimType_INT;
 
-    else if (strcmp(ident, "long") == 0)
+    case IdentSym_LONG:
         return PrimType_LONG;
 
-    else if (strcmp(ident, "void") == 0)
+    case IdentSym_VOID:
         return PrimType_VOID;
 
+    default:
+        break;
+
+    }
+
     for (i = 0; i < typedefs->size; i++) {
-        if (strcmp(ident, typedefs->elems[i].type_name) == 0) {
+        if (ident == typedefs->elems[i].type_name)
             return typedefs->elems[i].conv_type;
-        }
     }
 
     return PrimType_INVALID;
 
 }
 
-u32 Ident_type_lvls_of_indir(const char *ident,
-        const struct TypedefList *typedefs) {
+u32 Ident_type_lvls_of_indir(u32 ident, const struct TypedefList *typedefs) {
 
     u32 i;
 
     for (i = 0; i < typedefs->size; i++) {
-        if (strcmp(ident, typedefs->elems[i].type_name) == 0)
+        if (ident == typedefs->elems[i].type_name)
             return typedefs->elems[i].conv_lvls_of_indir;
     }
 
@@ -48,29 +72,16 @@ u32 Ident_type_lvls_of_indir(const char *ident,
 
 }
 
-struct TypeModifiers Ident_type_modifiers(const char *ident,
+struct TypeModifiers Ident_type_modifiers(u32 ident,
         const struct TypedefList *typedefs) {
 
     u32 i;
 
     for (i = 0; i < typedefs->size; i++) {
-        if (strcmp(ident, typedefs->elems[i].type_name) == 0)
+        if (ident == typedefs->elems[i].type_name)
             return typedefs->elems[i].conv_mods;
     }
 
     return TypeModifiers_init();
 
 }
-
-enum TokenType Ident_modifier_str_to_tok(const char *ident) {
-
-    if (strcmp(ident, "unsigned") == 0)
-        return TokenType_UNSIGNED;
-    else if (strcmp(ident, "signed") == 0)
-        return TokenType_SIGNED;
-    else if (strcmp(ident, "static") == 0)
-        return TokenType_STATIC;
-    else
-        return TokenType_NONE;
-
-}
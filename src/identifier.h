@@ -1,22 +1,39 @@
 #pragma once
 
+#include "interner.h"
 #include "prim_type.h"
 #include "type_mods.h"
 #include "typedef.h"
 #include "token.h"
 
-/* returns what kind of type specifier ident is. if it isn't one, the function
- * returns PrimType_INVALID. */
-enum PrimitiveType Ident_type_spec(const char *ident,
+/* identifiers the compiler looks out for. Ident_intern_builtins interns them
+ * before anything else, so their ids are the same as the enum values. */
+enum IdentSym {
+
+    IdentSym_CHAR,
+    IdentSym_SHORT,
+    IdentSym_INT,
+    IdentSym_LONG,
+    IdentSym_VOID,
+    IdentSym_RETURN,
+    /* the code generated for array initializers calls it */
+    IdentSym_MEMCPY,
+
+    IdentSym_COUNT
+
+};
+
+/* must be called on an empty interner */
+void Ident_intern_builtins(struct Interner *interner);
+
+/* returns what kind of type specifier the identifier with the id ident is. if
+ * it isn't one, the function returns PrimType_INVALID. */
+enum PrimitiveType Ident_type_spec(u32 ident,
         const struct TypedefList *typedefs);
 
 /* goes through the typedefs and returns the lvls of indir the typedef has.
  * if the identifier is not in typedefs, returns 0. */
-u32 Ident_type_lvls_of_indir(const char *ident,
-        const struct TypedefList *typedefs);
+u32 Ident_type_lvls_of_indir(u32 ident, const struct TypedefList *typedefs);
 
-struct TypeModifiers Ident_type_modifiers(const char *ident,
+struct TypeModifiers Ident_type_modifiers(u32 ident,
         const struct TypedefList *typedefs);
-
-/* stuff like const and static. returns TokenType_NONE if it isn't a modifier */
-enum TokenType Ident_modifier_str_to_tok(const char *ident);
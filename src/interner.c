@@ -0,0 +1,140 @@
+#include "interner.h"
+#include "arena.h"
+#include "safe_mem.h"
+#include "vector_impl.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+m_define_VectorImpl_funcs(InternEntryList, struct InternEntry, MemTag_SYMBOLS)
+
+struct Interner Interner_init(void) {
+
+    struct Interner interner;
+    interner.entries = InternEntryList_init();
+    interner.slots = NULL;
+    interner.n_slots = 0;
+    interner.strings = Arena_create(MemTag_STRINGS);
+    return interner;
+
+}
+
+void Interner_free(struct Interner *self) {
+
+    InternEntryList_free(&self->entries);
+    m_free(self->slots);
+    self->n_slots = 0;
+    Arena_free(&self->strings);
+
+}
+
+void Interner_clear(struct Interner *self) {
+
+    u32 i;
+
+    InternEntryList_clear(&self->entries, NULL);
+    for (i = 0; i < self->n_slots; i++)
+        self->slots[i] = m_interner_no_id;
+    Arena_reset(&self->strings);
+
+}
+
+/* FNV-1a */
+static u32 hash_str(const char *str, u32 len) {
+
+    u32 hash = 2166136261U;
+    u32 i;
+
+    for (i = 0; i < len; i++) {
+        hash ^= (unsigned char)str[i];
+        hash *= 16777619U;
+    }
+
+    return hash;
+
+}
+
+/* the slot holding str's id, or the empty slot it would go in */
+static u32* find_slot(const struct Interner *self, const char *str, u32 len,
+        u32 hash) {
+
+    u32 mask = self->n_slots-1;
+    u32 i = hash & mask;
+
+    while (self->slots[i] != m_interner_no_id) {
+        const struct InternEntry *entry = &self->entries.elems[self->slots[i]];
+        if (entry->hash == hash && entry->len == len &&
+                memcmp(entry->str, str, len) == 0)
+            break;
+        i = (i+1) & mask;
+    }
+
+    return &self->slots[i];
+
+}
+
+/* keeps the table at most half full */
+static void grow_slots(struct Interner *self) {
+
+    u32 new_n_slots = self->n_slots == 0 ? 64 : self->n_slots*2;
+    u32 i;
+
+    if (new_n_slots == 0 || new_n_slots > m_u32_max/sizeof(*self->slots))
+        SafeMem_fatal("too many identifiers");
+
+    m_free(self->slots);
+    self->slots = safe_malloc(new_n_slots*sizeof(*self->slots),
+            MemTag_SYMBOLS);
+    self->n_slots = new_n_slots;
+    for (i = 0; i < self->n_slots; i++)
+        self->slots[i] = m_interner_no_id;
+
+    for (i = 0; i < self->entries.size; i++) {
+        const struct InternEntry *entry = &self->entries.elems[i];
+        *find_slot(self, entry->str, entry->len, entry->hash) = i;
+    }
+
+}
+
+u32 Interner_intern(struct Interner *self, const char *str, u32 len) {
+
+    u32 hash = hash_str(str, len);
+    u32 *slot;
+    struct InternEntry entry;
+    char *copy;
+
+    if (self->entries.size+1 > self->n_slots/2)
+        grow_slots(self);
+
+    slot = find_slot(self, str, len, hash);
+    if (*slot != m_interner_no_id)
+        return *slot;
+
+    copy = Arena_alloc(&self->strings, len+1);
+    memcpy(copy, str, len);
+    copy[len] = '\0';
+
+    entry.str = copy;
+    entry.len = len;
+    entry.hash = hash;
+    *slot = self->entries.size;
+    InternEntryList_push_back(&self->entries, entry);
+
+    return *slot;
+
+}
+
+u32 Interner_find(const struct Interner *self, const char *str, u32 len) {
+
+    if (self->n_slots == 0)
+        return m_interner_no_id;
+
+    return *find_slot(self, str, len, hash_str(str, len));
+
+}
+
+const char* Interner_str(const struct Interner *self, u32 id) {
+
+    return self->entries.elems[id].str;
+
+}
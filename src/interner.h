@@ -0,0 +1,60 @@
+#pragma once
+
+/* gives every distinct string it's handed a small integer id, so identifiers
+ * can be compared and looked up by id instead of with strcmp. the strings are
+ * kept around until Interner_free and their pointers never move. */
+
+#include "arena.h"
+#include "comp_dependent/ints.h"
+#include "vector_impl.h"
+
+/* the id of no string at all */
+#define m_interner_no_id m_u32_max
+
+struct InternEntry {
+
+    const char *str;
+    u32 len;
+    u32 hash;
+
+};
+
+struct InternEntryList {
+
+    struct InternEntry *elems;
+    u32 size;
+    u32 capacity;
+
+};
+
+m_declare_VectorImpl_funcs(InternEntryList, struct InternEntry)
+
+struct Interner {
+
+    /* indexed by id */
+    struct InternEntryList entries;
+
+    /* an open addressing hash table of ids, m_interner_no_id marking an empty
+     * slot. n_slots is always 0 or a power of 2. */
+    u32 *slots;
+    u32 n_slots;
+
+    /* the copies of the strings */
+    struct Arena strings;
+
+};
+
+struct Interner Interner_init(void);
+void Interner_free(struct Interner *self);
+/* forgets every string, the ids start from 0 again. keeps the memory */
+void Interner_clear(struct Interner *self);
+
+/* str doesn't have to be '\0' terminated. the same string always gets the
+ * same id, the first one interned gets 0, the next new one 1, and so on. */
+u32 Interner_intern(struct Interner *self, const char *str, u32 len);
+/* like Interner_intern, but a string that hasn't been interned yet gets
+ * m_interner_no_id instead of being added */
+u32 Interner_find(const struct Interner *self, const char *str, u32 len);
+
+/* the '\0' terminated string with that id */
+const char* Interner_str(const struct Interner *self, u32 id);
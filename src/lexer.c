@@ -1,6 +1,8 @@
 #include "lexer.h"
+#include "comp_ctx.h"
 #include "comp_dependent/ints.h"
 #include "err_msg.h"
+#include "interner.h"
 #include "safe_mem.h"
 #include "token.h"
 #include <assert.h>
@@ -9,8 +11,6 @@
 #include <stdio.h>
 #include <string.h>
 
-bool Lexer_error_occurred = false;
-
 struct Lexer Lexer_init(void) {
 
     struct Lexer lexer;
@@ -29,13 +29,20 @@ struct Lexer Lexer_create(struct TokenList token_tbl) {
 
 void Lexer_free(struct Lexer *lexer) {
 
-    while (lexer->token_tbl.size > 0) {
-        TokenList_pop_back(&lexer->token_tbl, Token_free);
-    }
     TokenList_free(&lexer->token_tbl);
 
 }
 
+/* for tokens without a value */
+static void add_token(struct TokenList *token_tbl, enum TokenType type,
+        u32 src_offset, u32 src_len, u16 file_id) {
+
+    union TokenValue value;
+    memset(&value, 0, sizeof(value));
+    TokenList_push_back(token_tbl, type, src_offset, src_len, file_id, value);
+
+}
+
 static bool valid_ident_start_char(char c) {
 
     return isalpha(c) || c == '_';
@@ -67,29 +74,30 @@ static unsigned get_identifier_len(const char *ident_start) {
 static enum TokenType identifier_keyword(const char *ident_start,
         u32 ident_len) {
 
-    if (strncmp(ident_start, "if", ident_len) == 0 && ident_len == 2)
+    if (ident_len == 2 && strncmp(ident_start, "if", ident_len) == 0)
         return TokenType_IF_STMT;
-    if (strncmp(ident_start, "else", ident_len) == 0 && ident_len == 4)
+    if (ident_len == 4 && strncmp(ident_start, "else", ident_len) == 0)
         return TokenType_ELSE;
-    else if (strncmp(ident_start, "while", ident_len) == 0 && ident_len == 5)
+    else if (ident_len == 5 && strncmp(ident_start, "while", ident_len) == 0)
         return TokenType_WHILE_STMT;
-    else if (strncmp(ident_start, "for", ident_len) == 0 && ident_len == 3)
+    else if (ident_len == 3 && strncmp(ident_start, "for", ident_len) == 0)
         return TokenType_FOR_STMT;
-    else if (strncmp(ident_start, "typedef", ident_len) == 0 && ident_len == 7)
+    else if (ident_len == 7 && strncmp(ident_start, "typedef", ident_len) == 0)
         return TokenType_TYPEDEF;
-    else if (strncmp(ident_start, "static", ident_len) == 0 && ident_len == 6)
+    else if (ident_len == 6 && strncmp(ident_start, "static", ident_len) == 0)
         return TokenType_STATIC;
-    else if (strncmp(ident_start, "signed", ident_len) == 0 && ident_len == 6)
+    else if (ident_len == 6 && strncmp(ident_start, "signed", ident_len) == 0)
         return TokenType_SIGNED;
-    else if (strncmp(ident_start, "unsigned", ident_len) == 0 &&
-            ident_len == 8)
+    else if (ident_len == 8 &&
+            strncmp(ident_start, "unsigned", ident_len) == 0)
         return TokenType_UNSIGNED;
     else
         return TokenType_NONE;
 
 }
 
-static int escape_code_to_int(char code, unsigned line_num,
+static int escape_code_to_int(struct CompilerCtx *ctx, char code,
+        unsigned line_num,
         unsigned column_num, const char *file_path) {
 
     switch (code) {
@@ -131,7 +139,7 @@ static int escape_code_to_int(char code, unsigned line_num,
         return '\0';
 
     default:
-        ErrMsg_print(ErrMsg_on, &Lexer_error_occurred, file_path,
+        ErrMsg_print(ctx, ErrMsg_on, &ctx->lexer_error_occurred, file_path,
                 "invalid escape sequence on line %u, column %u.\n",
                 line_num, column_num);
         return 0;
@@ -141,7 +149,8 @@ static int escape_code_to_int(char code, unsigned line_num,
 }
 
 /* end_idx points to the closing single quote */
-static int read_single_quote_str(const char *src, u32 single_qt_idx,
+static int read_single_quote_str(struct CompilerCtx *ctx, const char *src,
+        u32 single_qt_idx,
         u32 *end_idx, unsigned line_num, unsigned column_num,
         const char *file_path) {
 
@@ -150,12 +159,13 @@ static int read_single_quote_str(const char *src, u32 single_qt_idx,
     assert(src[single_qt_idx] == '\'');
 
     if (src[single_qt_idx+1] == '\\') {
-        value = escape_code_to_int(src[single_qt_idx+2], line_num, column_num,
+        value = escape_code_to_int(ctx, src[single_qt_idx+2], line_num,
+                column_num,
                 file_path);
         *end_idx = single_qt_idx+3;
     }
     else if (src[single_qt_idx+1] == '\n') {
-        ErrMsg_print(ErrMsg_on, &Lexer_error_occurred, file_path,
+        ErrMsg_print(ctx, ErrMsg_on, &ctx->lexer_error_occurred, file_path,
                 "missing terminating single quote for the one on line"
                 " %u, column %u.\n", line_num, column_num);
         *end_idx = single_qt_idx;
@@ -171,9 +181,10 @@ static int read_single_quote_str(const char *src, u32 single_qt_idx,
 }
 
 /* returns the index of the closing double quote */
-static int read_string(const char *src, u32 str_start, unsigned line_num,
+static int read_string(struct CompilerCtx *ctx, const char *src,
+        u32 src_offset, u32 str_start, unsigned line_num,
         unsigned column_num, struct TokenList *token_tbl,
-        const char *file_path) {
+        const char *file_path, u16 file_id) {
 
     union TokenValue value;
 
@@ -186,17 +197,19 @@ static int read_string(const char *src, u32 str_start, unsigned line_num,
 
     assert(src[str_start] == '\"');
 
-    string = safe_malloc(string_capacity*sizeof(*string));
+    string = safe_malloc(string_capacity*sizeof(*string), MemTag_STRINGS);
 
     while (src[src_i] != '\0' && src[src_i] != '\"' && src[src_i] != '\n') {
 
         if (string_len >= string_capacity) {
             string_capacity *= string_capacity;
-            string = safe_realloc(string, string_capacity*sizeof(*string));
+            string = safe_realloc(string, string_capacity*sizeof(*string),
+                    MemTag_STRINGS);
         }
 
         if (src[src_i-1] == '\\') {
-            string[string_len-1] = escape_code_to_int(src[src_i], line_num,
+            string[string_len-1] = escape_code_to_int(ctx, src[src_i],
+                    line_num,
                     cur_column_num, file_path);
             ++src_i;
         }
@@ -206,19 +219,19 @@ static int read_string(const char *src, u32 str_start, unsigned line_num,
 
     }
 
-    string = safe_realloc(string, (string_len+1)*sizeof(*string));
+    string = safe_realloc(string, (string_len+1)*sizeof(*string),
+            MemTag_STRINGS);
     string[string_len++] = '\0';
 
     value.string = string;
-    TokenList_push_back(token_tbl, Token_create_w_val(line_num, column_num,
-                &src[str_start+1], src_i-str_start, file_path,
-                TokenType_STR_LIT, value));
+    TokenList_push_back(token_tbl, TokenType_STR_LIT, src_offset+str_start,
+            src_i-str_start+1, file_id, value);
 
     if (src[src_i] == '\0' || src[src_i] == '\n') {
-        ErrMsg_print(ErrMsg_on, &Lexer_error_occurred, file_path,
+        ErrMsg_print(ctx, ErrMsg_on, &ctx->lexer_error_occurred, file_path,
                 "expected a closing '\"' for the string on line %u,"
                 " column %u.\n", line_num, column_num);
-        Lexer_error_occurred = true;
+        ctx->lexer_error_occurred = true;
         --src_i;
     }
 
@@ -226,46 +239,114 @@ static int read_string(const char *src, u32 str_start, unsigned line_num,
 
 }
 
-/* returns m_u32_max if the instance couldn't be found */
+/* returns m_u32_max if no instance starts at inst_start_idx. the
+ * preprocessor makes the instances in the order they show up in the source,
+ * so the cursor *next_inst only ever has to move forward */
 static u32 find_macro_instance(const struct MacroInstList *macro_insts,
-        u32 inst_start_idx) {
+        u32 *next_inst, u32 inst_start_idx) {
 
-    u32 i;
+    while (*next_inst < macro_insts->size &&
+            macro_insts->elems[*next_inst].start_idx < inst_start_idx)
+        ++*next_inst;
 
-    for (i = 0; i < macro_insts->size; i++) {
-        if (macro_insts->elems[i].start_idx == inst_start_idx)
-            return i;
-    }
+    if (*next_inst < macro_insts->size &&
+            macro_insts->elems[*next_inst].start_idx == inst_start_idx)
+        return *next_inst;
 
     return m_u32_max;
 
 }
 
-static void lex_str(const char *src, const char *file_path,
-        const struct MacroInstList *macro_insts, unsigned start_line_num,
-        unsigned start_column_num, u32 start_i, struct Lexer *lexer) {
+static char* copy_string(const char *str) {
 
-    struct TokenList *token_tbl = &lexer->token_tbl;
-    u32 src_len = strlen(src);
-    u32 src_i;
-    unsigned line_num = start_line_num;
-    unsigned column_num = start_column_num;
+    char *copy = safe_malloc((strlen(str)+1)*sizeof(*copy), MemTag_STRINGS);
+    strcpy(copy, str);
+    return copy;
 
-    Lexer_error_occurred = false;
+}
 
-    for (src_i = start_i; src[src_i] != '\0'; src_i++,column_num++) {
+/* copies what the instance expands to into the table */
+static void expand_macro(struct TokenList *token_tbl,
+        const struct TokenList *macro_tokens,
+        const struct MacroSegmentList *macro_segments,
+        const struct MacroInstance *inst, u16 file_id) {
 
-        if (valid_ident_start_char(src[src_i]) &&
-                find_macro_instance(macro_insts, src_i) != m_u32_max) {
+    u32 seg_idx;
+    u32 i;
 
-            u32 inst_idx = find_macro_instance(macro_insts, src_i);
-            u32 ident_len = get_identifier_len(&src[src_i]);
+    for (seg_idx = inst->first_segment;
+            seg_idx < inst->first_segment+inst->n_segments; seg_idx++) {
 
-            lex_str(macro_insts->elems[inst_idx].expansion, file_path,
-                    macro_insts, line_num, column_num, 0, lexer);
+        const struct MacroSegment *seg = &macro_segments->elems[seg_idx];
 
-            column_num += ident_len-1;
-            src_i += ident_len-1;
+        for (i = seg->first_token; i < seg->first_token+seg->n_tokens; i++) {
+            union TokenValue value = macro_tokens->values[i];
+            /* every string literal owns its string, and several instances
+             * can share their tokens */
+            if (macro_tokens->types[i] == TokenType_STR_LIT)
+                value.string = copy_string(value.string);
+            TokenList_push_back(token_tbl, macro_tokens->types[i],
+                    seg->offset+macro_tokens->src_offsets[i],
+                    macro_tokens->src_lens[i], file_id, value);
+        }
+
+    }
+
+}
+
+/* src_offset is where src sits in the token table's text. only src_len chars
+ * of src get lexed. macro_insts is NULL when lexing text from a macro, '#' and
+ * '##' are tokens there instead of starting a directive. */
+static void lex_str(struct CompilerCtx *ctx, const char *src, u32 src_len,
+        u32 src_offset, const char *file_path, u16 file_id,
+        const struct TokenList *macro_tokens,
+        const struct MacroSegmentList *macro_segments,
+        const struct MacroInstList *macro_insts,
+        const struct MacroIncludeList *includes, unsigned start_line_num,
+        unsigned start_column_num, u32 start_i, struct Lexer *lexer) {
+
+    struct TokenList *token_tbl = &lexer->token_tbl;
+    u32 src_i;
+    unsigned line_num = start_line_num;
+    unsigned column_num = start_column_num;
+    u32 next_inst = 0;
+    u32 inst_idx = m_u32_max;
+
+    for (src_i = start_i; src_i < src_len && src[src_i] != '\0';
+            src_i++,column_num++) {
+
+        /* #includes and the groups an #ifdef leaves out are instances too,
+         * starting at the directive's '#' */
+        if (macro_insts && (valid_ident_start_char(src[src_i]) ||
+                    src[src_i] == '#') &&
+                (inst_idx = find_macro_instance(macro_insts, &next_inst,
+                    src_i)) != m_u32_max) {
+
+            const struct MacroInstance *inst = &macro_insts->elems[inst_idx];
+
+            if (inst->include_idx != m_u32_max) {
+                const struct MacroInclude *include =
+                    &includes->elems[inst->include_idx];
+                lex_str(ctx, include->src, include->src_len, include->offset,
+                        include->path, TokenList_add_file(token_tbl,
+                            include->path), macro_tokens, macro_segments,
+                        &include->insts, includes, 1, 1, 0, lexer);
+            }
+            else {
+                expand_macro(token_tbl, macro_tokens, macro_segments, inst,
+                        file_id);
+            }
+
+            /* a function-like macro's arguments can go over several lines,
+             * and a left out group usually does */
+            while (src_i+1 < inst->end_idx) {
+                ++src_i;
+                ++column_num;
+                if (src[src_i] == '\n') {
+                    ++line_num;
+                    column_num = 0;
+                }
+            }
 
         }
 
@@ -275,11 +356,23 @@ static void lex_str(const char *src, const char *file_path,
                 column_num = 0;
             }
         }
+        else if (!macro_insts && src[src_i] == '#') {
+            if (src[src_i+1] == '#') {
+                add_token(token_tbl, TokenType_TOKEN_PASTE, src_offset+src_i,
+                        2, file_id);
+                ++src_i;
+                ++column_num;
+            }
+            else {
+                add_token(token_tbl, TokenType_STRINGIZE, src_offset+src_i, 1,
+                        file_id);
+            }
+        }
         else if ((src[src_i] == '/' && src[src_i+1] == '/') ||
                 src[src_i] == '#') {
             ++line_num;
             column_num = 0;
-            while (src[++src_i] != '\n');
+            while (src_i+1 < src_len && src[++src_i] != '\n');
         }
         else if (src[src_i] == '/' && src[src_i+1] == '*') {
             while (src[src_i] != '*' || src[src_i+1] != '/') {
@@ -296,121 +389,115 @@ static void lex_str(const char *src, const char *file_path,
 
         else if (src_i+2 < src_len && src[src_i] == '.' &&
                 src[src_i+1] == '.' && src[src_i+2] == '.') {
-            TokenList_push_back(token_tbl, Token_create(line_num, column_num,
-                        &src[src_i], 2, file_path, TokenType_VARIADIC));
+            add_token(token_tbl, TokenType_VARIADIC, src_offset+src_i, 2,
+                    file_id);
             src_i += 2;
             column_num += 2;
         }
 
         else if (src[src_i] == '|' && src[src_i+1] == '|') {
-            TokenList_push_back(token_tbl, Token_create(line_num, column_num,
-                        &src[src_i], 2, file_path, TokenType_BOOLEAN_OR));
+            add_token(token_tbl, TokenType_BOOLEAN_OR, src_offset+src_i, 2,
+                    file_id);
             ++src_i;
             ++column_num;
         }
         else if (src[src_i] == '&' && src[src_i+1] == '&') {
-            TokenList_push_back(token_tbl, Token_create(line_num, column_num,
-                        &src[src_i], 2, file_path, TokenType_BOOLEAN_AND));
+            add_token(token_tbl, TokenType_BOOLEAN_AND, src_offset+src_i, 2,
+                    file_id);
             ++src_i;
             ++column_num;
         }
         else if (src[src_i] == '=' && src[src_i+1] == '=') {
-            TokenList_push_back(token_tbl, Token_create(line_num, column_num,
-                        &src[src_i], 2, file_path, TokenType_EQUAL_TO));
+            add_token(token_tbl, TokenType_EQUAL_TO, src_offset+src_i, 2,
+                    file_id);
             ++src_i;
             ++column_num;
         }
         else if (src[src_i] == '!' && src[src_i+1] == '=') {
-            TokenList_push_back(token_tbl, Token_create(line_num, column_num,
-                        &src[src_i], 2, file_path, TokenType_NOT_EQUAL_TO));
+            add_token(token_tbl, TokenType_NOT_EQUAL_TO, src_offset+src_i, 2,
+                    file_id);
             ++src_i;
             ++column_num;
         }
         else if (src[src_i] == '<' && src[src_i+1] == '=') {
-            TokenList_push_back(token_tbl, Token_create(line_num, column_num,
-                        &src[src_i], 2, file_path, TokenType_L_THAN_OR_E));
+            add_token(token_tbl, TokenType_L_THAN_OR_E, src_offset+src_i, 2,
+                    file_id);
             ++src_i;
             ++column_num;
         }
         else if (src[src_i] == '>' && src[src_i+1] == '=') {
-            TokenList_push_back(token_tbl, Token_create(line_num, column_num,
-                        &src[src_i], 2, file_path, TokenType_G_THAN_OR_E));
+            add_token(token_tbl, TokenType_G_THAN_OR_E, src_offset+src_i, 2,
+                    file_id);
             ++src_i;
             ++column_num;
         }
         else if (src[src_i] == '+' && src[src_i+1] == '+') {
-            TokenList_push_back(token_tbl, Token_create(line_num, column_num,
-                        &src[src_i], 2, file_path, TokenType_PREFIX_INC));
+            add_token(token_tbl, TokenType_PREFIX_INC, src_offset+src_i, 2,
+                    file_id);
             ++src_i;
             ++column_num;
         }
         else if (src[src_i] == '-' && src[src_i+1] == '-') {
-            TokenList_push_back(token_tbl, Token_create(line_num, column_num,
-                        &src[src_i], 2, file_path, TokenType_PREFIX_DEC));
+            add_token(token_tbl, TokenType_PREFIX_DEC, src_offset+src_i, 2,
+                    file_id);
             ++src_i;
             ++column_num;
         }
 
         else if (src[src_i] == ';')
-            TokenList_push_back(token_tbl, Token_create(line_num, column_num,
-                        &src[src_i], 1, file_path, TokenType_SEMICOLON));
+            add_token(token_tbl, TokenType_SEMICOLON, src_offset+src_i, 1,
+                    file_id);
 
         else if (src[src_i] == '+')
-            TokenList_push_back(token_tbl, Token_create(line_num, column_num,
-                        &src[src_i], 1, file_path, TokenType_PLUS));
+            add_token(token_tbl, TokenType_PLUS, src_offset+src_i, 1, file_id);
         else if (src[src_i] == '-')
-            TokenList_push_back(token_tbl, Token_create(line_num, column_num,
-                        &src[src_i], 1, file_path, TokenType_MINUS));
+            add_token(token_tbl, TokenType_MINUS, src_offset+src_i, 1, file_id);
         else if (src[src_i] == '*')
-            TokenList_push_back(token_tbl, Token_create(line_num, column_num,
-                        &src[src_i], 1, file_path, TokenType_MUL));
+            add_token(token_tbl, TokenType_MUL, src_offset+src_i, 1, file_id);
         else if (src[src_i] == '/')
-            TokenList_push_back(token_tbl, Token_create(line_num, column_num,
-                        &src[src_i], 1, file_path, TokenType_DIV));
+            add_token(token_tbl, TokenType_DIV, src_offset+src_i, 1, file_id);
         else if (src[src_i] == '%')
-            TokenList_push_back(token_tbl, Token_create(line_num, column_num,
-                        &src[src_i], 1, file_path, TokenType_MODULUS));
+            add_token(token_tbl, TokenType_MODULUS, src_offset+src_i, 1,
+                    file_id);
         else if (src[src_i] == '=')
-            TokenList_push_back(token_tbl, Token_create(line_num, column_num,
-                        &src[src_i], 1, file_path, TokenType_EQUAL));
+            add_token(token_tbl, TokenType_EQUAL, src_offset+src_i, 1, file_id);
         else if (src[src_i] == ',')
-            TokenList_push_back(token_tbl, Token_create(line_num, column_num,
-                        &src[src_i], 1, file_path, TokenType_COMMA));
+            add_token(token_tbl, TokenType_COMMA, src_offset+src_i, 1, file_id);
         else if (src[src_i] == '[')
-            TokenList_push_back(token_tbl, Token_create(line_num, column_num,
-                        &src[src_i], 1, file_path, TokenType_L_ARR_SUBSCR));
+            add_token(token_tbl, TokenType_L_ARR_SUBSCR, src_offset+src_i, 1,
+                    file_id);
         else if (src[src_i] == '&')
-            TokenList_push_back(token_tbl, Token_create(line_num, column_num,
-                        &src[src_i], 1, file_path, TokenType_BITWISE_AND));
+            add_token(token_tbl, TokenType_BITWISE_AND, src_offset+src_i, 1,
+                    file_id);
         else if (src[src_i] == '<')
-            TokenList_push_back(token_tbl, Token_create(line_num, column_num,
-                        &src[src_i], 1, file_path, TokenType_L_THAN));
+            add_token(token_tbl, TokenType_L_THAN, src_offset+src_i, 1,
+                    file_id);
         else if (src[src_i] == '>')
-            TokenList_push_back(token_tbl, Token_create(line_num, column_num,
-                        &src[src_i], 1, file_path, TokenType_G_THAN));
+            add_token(token_tbl, TokenType_G_THAN, src_offset+src_i, 1,
+                    file_id);
 
         else if (src[src_i] == '~')
-            TokenList_push_back(token_tbl, Token_create(line_num, column_num,
-                        &src[src_i], 1, file_path, TokenType_BITWISE_NOT));
+            add_token(token_tbl, TokenType_BITWISE_NOT, src_offset+src_i, 1,
+                    file_id);
         else if (src[src_i] == '!')
-            TokenList_push_back(token_tbl, Token_create(line_num, column_num,
-                        &src[src_i], 1, file_path, TokenType_BOOLEAN_NOT));
+            add_token(token_tbl, TokenType_BOOLEAN_NOT, src_offset+src_i, 1,
+                    file_id);
 
         else if (src[src_i] == '(')
-            TokenList_push_back(token_tbl, Token_create(line_num, column_num,
-                        &src[src_i], 1, file_path, TokenType_L_PAREN));
+            add_token(token_tbl, TokenType_L_PAREN, src_offset+src_i, 1,
+                    file_id);
         else if (src[src_i] == ')')
-            TokenList_push_back(token_tbl, Token_create(line_num, column_num,
-                        &src[src_i], 1, file_path, TokenType_R_PAREN));
+            add_token(token_tbl, TokenType_R_PAREN, src_offset+src_i, 1,
+                    file_id);
         else if (src[src_i] == '{')
-            TokenList_push_back(token_tbl, Token_create(line_num, column_num,
-                        &src[src_i], 1, file_path, TokenType_L_CURLY));
+            add_token(token_tbl, TokenType_L_CURLY, src_offset+src_i, 1,
+                    file_id);
         else if (src[src_i] == '}')
-            TokenList_push_back(token_tbl, Token_create(line_num, column_num,
-                        &src[src_i], 1, file_path, TokenType_R_CURLY));
+            add_token(token_tbl, TokenType_R_CURLY, src_offset+src_i, 1,
+                    file_id);
         else if (src[src_i] == ']')
-            TokenList_push_back(token_tbl, Token_create(line_num, column_num,
-                        &src[src_i], 1, file_path, TokenType_R_ARR_SUBSCR));
+            add_token(token_tbl, TokenType_R_ARR_SUBSCR, src_offset+src_i, 1,
+                    file_id);
 
         else if (isdigit(src[src_i])) {
             /* An integer literal */
@@ -419,9 +506,8 @@ static void lex_str(const char *src, const char *file_path,
             union TokenValue value;
             value.int_value = strtoul(&src[src_i], &end_ptr, 0);
             chars_moved = end_ptr-&src[src_i];
-            TokenList_push_back(token_tbl, Token_create_w_val(line_num,
-                        column_num, &src[src_i], chars_moved, file_path,
-                        TokenType_INT_LIT, value));
+            TokenList_push_back(token_tbl, TokenType_INT_LIT,
+                    src_offset+src_i, chars_moved, file_id, value);
             src_i += chars_moved-1;
             column_num += chars_moved-1;
         }
@@ -429,17 +515,16 @@ static void lex_str(const char *src, const char *file_path,
         else if (src[src_i] == '\'') {
             u32 end_idx;
             union TokenValue value;
-            value.int_value = read_single_quote_str(src, src_i, &end_idx,
+            value.int_value = read_single_quote_str(ctx, src, src_i, &end_idx,
                     line_num, column_num, file_path);
-            TokenList_push_back(token_tbl, Token_create_w_val(line_num,
-                        column_num, &src[src_i], end_idx-src_i+1, file_path,
-                        TokenType_INT_LIT, value));
+            TokenList_push_back(token_tbl, TokenType_INT_LIT,
+                    src_offset+src_i, end_idx-src_i+1, file_id, value);
             column_num += end_idx-src_i;
             src_i = end_idx;
         }
         else if (src[src_i] == '\"') {
-            u32 end_idx = read_string(src, src_i, line_num, column_num,
-                    token_tbl, file_path);
+            u32 end_idx = read_string(ctx, src, src_offset, src_i, line_num,
+                    column_num, token_tbl, file_path, file_id);
             column_num += end_idx-src_i;
             src_i = end_idx;
         }
@@ -450,31 +535,25 @@ static void lex_str(const char *src, const char *file_path,
             enum TokenType keyword_type = identifier_keyword(&src[src_i], len);
 
             if (keyword_type != TokenType_NONE) {
-                TokenList_push_back(token_tbl,
-                        Token_create(
-                            line_num, column_num, &src[src_i], len, file_path,
-                            keyword_type
-                            )
-                        );
+                add_token(token_tbl, keyword_type, src_offset+src_i, len,
+                        file_id);
             }
             else {
-                TokenList_push_back(token_tbl,
-                        Token_create(
-                            line_num, column_num, &src[src_i], len, file_path,
-                            TokenType_IDENT
-                            )
-                        );
+                union TokenValue value;
+                value.sym_id = Interner_intern(&ctx->syms, &src[src_i], len);
+                TokenList_push_back(token_tbl, TokenType_IDENT,
+                        src_offset+src_i, len, file_id, value);
             }
             src_i += len-1;
             column_num += len-1;
         }
 
         else if (src[src_i] == ':')
-            TokenList_push_back(token_tbl, Token_create(line_num, column_num,
-                        &src[src_i], 1, file_path, TokenType_DEBUG_PRINT_RAX));
+            add_token(token_tbl, TokenType_DEBUG_PRINT_RAX, src_offset+src_i, 1,
+                    file_id);
 
         else {
-            ErrMsg_print(ErrMsg_on, &Lexer_error_occurred, file_path,
+            ErrMsg_print(ctx, ErrMsg_on, &ctx->lexer_error_occurred, file_path,
                     "unknown token '%c'. line %u, column %u.\n",
                     src[src_i], line_num, column_num);
         }
@@ -483,13 +562,38 @@ static void lex_str(const char *src, const char *file_path,
 
 }
 
-struct Lexer Lexer_lex(const char *src, const char *file_path,
-        const struct MacroInstList *macro_insts) {
+struct Lexer Lexer_lex(struct CompilerCtx *ctx, const char *src, u32 src_len,
+        const char *file_path, struct TokenList *macro_tokens,
+        const struct MacroSegmentList *macro_segments,
+        const struct MacroInstList *macro_insts,
+        const struct MacroIncludeList *includes) {
 
     struct Lexer lexer = Lexer_init();
 
-    lex_str(src, file_path, macro_insts, 1, 1, 0, &lexer);
+    ctx->lexer_error_occurred = false;
+    /* most code has a token every few chars, so this rarely has to grow more
+     * than once or twice */
+    TokenList_reserve(&lexer.token_tbl, src_len/4 + 16);
+    TokenList_set_src(&lexer.token_tbl, src, src_len);
+    TokenList_take_expansions(&lexer.token_tbl, macro_tokens);
+
+    lex_str(ctx, src, src_len, 0, file_path,
+            TokenList_add_file(&lexer.token_tbl, file_path), macro_tokens,
+            macro_segments, macro_insts, includes, 1, 1, 0, &lexer);
 
     return lexer;
 
 }
+
+void Lexer_lex_macro(struct CompilerCtx *ctx, struct TokenList *tokens,
+        const char *text, u32 text_len, u32 text_offset,
+        const char *file_path, unsigned line_num, unsigned column_num) {
+
+    struct Lexer lexer = Lexer_create(*tokens);
+
+    lex_str(ctx, text, text_len, text_offset, file_path, 0, NULL, NULL,
+            NULL, NULL, line_num, column_num, 0, &lexer);
+
+    *tokens = lexer.token_tbl;
+
+}
@@ -4,18 +4,35 @@
 #include "token.h"
 #include "pre_proc.h"
 
+struct CompilerCtx;
+
 struct Lexer {
 
     struct TokenList token_tbl;
 
 };
 
-extern bool Lexer_error_occurred;
-
 struct Lexer Lexer_init(void);
 
 void Lexer_free(struct Lexer *lexer);
 
-/* Converts a string into a list of tokens */
-struct Lexer Lexer_lex(const char *src, const char *file_path,
-        const struct MacroInstList *macro_insts);
+/* Converts a string into a list of tokens. src must be '\0' terminated, and
+ * the tokens' offsets point straight into it, so it has to outlive the
+ * lexer. macro_tokens, macro_segments, macro_insts and includes come from
+ * PreProc_process, the text of the expansions and the files get taken out of
+ * macro_tokens. the included files get lexed where they're included, so
+ * they have to outlive the lexer too. */
+struct Lexer Lexer_lex(struct CompilerCtx *ctx, const char *src, u32 src_len,
+        const char *file_path, struct TokenList *macro_tokens,
+        const struct MacroSegmentList *macro_segments,
+        const struct MacroInstList *macro_insts,
+        const struct MacroIncludeList *includes);
+
+/* lexes text_len chars of text from a macro, like its expansion or the
+ * arguments it's given, and appends the tokens to tokens. '#' and '##' are
+ * tokens here. the tokens' offsets get text_offset added and their file ids
+ * are left at 0. line_num and column_num are where text starts, for the
+ * errors. */
+void Lexer_lex_macro(struct CompilerCtx *ctx, struct TokenList *tokens,
+        const char *text, u32 text_len, u32 text_offset,
+        const char *file_path, unsigned line_num, unsigned column_num);
@@ -1,92 +1,22 @@
-#include <errno.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
-#include "ast.h"
-#include "code_gen.h"
 #include "comp_args.h"
-#include "file_io.h"
+#include "compile.h"
+#include "comp_ctx.h"
+#include "batch.h"
 #include "comp_dependent/ints.h"
 #include "safe_mem.h"
-#include "lexer.h"
-#include "parser.h"
-#include "pre_to_post_fix.h"
-#include "bin_to_unary.h"
-#include "merge_strings.h"
-#include "pre_proc.h"
-#include "const_fold.h"
+#include "trace.h"
+#include "file_cache.h"
+#include "cache.h"
 
 #define m_build_bug_on(condition) \
     ((void)sizeof(char[1 - 2*!!(condition)]))
 
-static char *read_file(const char *file_path) {
-
-    char *contents = NULL;
-    FILE *file = fopen(file_path, "r");
-    if (!file) {
-        fprintf(stderr, "Cannot open file \'%s\': %s\n", file_path,
-                strerror(errno));
-        return NULL;
-    }
-    contents = copy_file_into_str(file);
-    fclose(file);
-    return contents;
-
-}
-
-void compile(char *src, FILE *output,
-        bool *error_occurred) {
-
-    struct PreProcMacroList macros;
-    struct MacroInstList macro_insts;
-    PreProc_process(src, &macros, &macro_insts, CompArgs_args.src_path);
-    *error_occurred = false;
-
-    if (!PreProc_error_occurred) {
-        struct Lexer lexer = Lexer_lex(src, CompArgs_args.src_path, &macro_insts);
-
-        if (!Lexer_error_occurred) {
-            struct BlockNode *ast;
-
-            MergeStrings_merge(&lexer.token_tbl);
-            BinToUnary_convert(&lexer.token_tbl);
-            PreToPostFix_convert(&lexer.token_tbl);
-
-            ast = Parser_parse(&lexer);
-
-            if (!Parser_error_occurred && output) {
-                if (CompArgs_args.optimize) {
-                    BlockNode_const_fold(ast);
-                }
-                CodeGen_generate(output, ast);
-            }
-            else
-                *error_occurred = true;
-
-            BlockNode_free_w_self(ast);
-        }
-        else
-            *error_occurred = true;
-
-        Lexer_free(&lexer);
-    }
-    else
-        *error_occurred = true;
-
-    while (macros.size > 0)
-        PreProcMacroList_pop_back(&macros, PreProcMacro_free);
-    PreProcMacroList_free(&macros);
-
-    while (macro_insts.size > 0)
-        MacroInstList_pop_back(&macro_insts, MacroInstance_free);
-    MacroInstList_free(&macro_insts);
-
-}
-
 int main(int argc, char *argv[]) {
 
-    char *src = NULL;
-    FILE *output = NULL;
+    struct CompArgs args;
     bool error_occurred = false;
 
     m_build_bug_on(sizeof(i32) != 4);
@@ -96,29 +26,67 @@ int main(int argc, char *argv[]) {
     m_build_bug_on(sizeof(i8) != 1);
     m_build_bug_on(sizeof(u8) != 1);
 
-    CompArgs_args = CompArgs_get_args(argc, argv);
-    if (!CompArgs_args.src_path)
-        return 0;
+    args = CompArgs_get_args(argc, argv);
+    if (args.mem_report)
+        SafeMem_enable_accounting();
+    if (args.trace_path)
+        Trace_enable();
 
-    src = read_file(CompArgs_args.src_path);
-    if (!src)
+    if (args.n_jobs == 0 || args.cache_max_size == 0) {
+        CompArgs_free(&args);
+        return 1;
+    }
+    if (args.cache_stats && !args.cache_dir) {
+        fprintf(stderr, "error: '--cache-stats' needs '--cache-dir'.\n");
+        CompArgs_free(&args);
         return 1;
-    puts(src);
+    }
+    /* without any sources it's just asking how the cache is doing */
+    if (!args.src_path) {
+        if (args.cache_stats)
+            Cache_print_stats(args.cache_dir, stdout);
+        CompArgs_free(&args);
+        return 0;
+    }
 
-    if (CompArgs_args.asm_out_path) {
-        output = fopen(CompArgs_args.asm_out_path, "w");
-        if (!output) {
-            fprintf(stderr, "can't open file '%s': %s\n",
-                    CompArgs_args.asm_out_path, strerror(errno));
+    if (args.n_src_paths > 1) {
+        u32 i;
+        for (i = 0; i < args.n_src_paths; i++) {
+            if (strcmp(args.src_paths[i], "-") == 0) {
+                fprintf(stderr, "error: can't read stdin when compiling more"
+                        " than one file.\n");
+                CompArgs_free(&args);
+                return 1;
+            }
+        }
+        if (args.asm_out_path) {
+            fprintf(stderr, "error: '-o' can't be used when compiling more"
+                    " than one file.\n");
+            CompArgs_free(&args);
             return 1;
         }
+        error_occurred = Batch_compile(&args);
+    }
+    else {
+        struct CompilerCtx ctx = CompilerCtx_create(args);
+        error_occurred = Compile_file(&ctx, args.src_path,
+                args.asm_out_path, stdout, stderr);
+        CompilerCtx_free(&ctx);
     }
 
-    compile(src, output, &error_occurred);
+    /* after compiling, so the stats count this run too */
+    if (args.cache_stats)
+        Cache_print_stats(args.cache_dir, stdout);
+
+    if (args.trace_path && !Trace_write(args.trace_path)) {
+        fprintf(stderr, "can't write to file '%s'\n", args.trace_path);
+        error_occurred = true;
+    }
 
-    m_free(src);
-    if (output)
-        fclose(output);
+    FileCache_free();
+    CompArgs_free(&args);
+    if (args.mem_report)
+        SafeMem_print_report(stderr);
 
     return error_occurred != false;
 
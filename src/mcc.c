@@ -0,0 +1,136 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "mcc.h"
+#include "compile.h"
+#include "comp_args.h"
+#include "comp_ctx.h"
+#include "source_buf.h"
+#include "out_buf.h"
+#include "safe_mem.h"
+#include "bool.h"
+#include "comp_dependent/ints.h"
+#include <stdio.h>
+#include <string.h>
+
+struct MccOptions MccOptions_init(void) {
+
+    struct MccOptions options;
+    options.optimize = false;
+    options.w_error = false;
+    options.pedantic = false;
+    return options;
+
+}
+
+void MccResult_free(struct MccResult *self) {
+
+    m_free(self->asm_text);
+    /* comes from open_memstream, not safe_malloc */
+    free(self->diagnostics);
+    self->diagnostics = NULL;
+    self->asm_len = 0;
+    self->diagnostics_len = 0;
+    self->error_occurred = false;
+
+}
+
+/* for when the diagnostics can't go through an open_memstream. allocated
+ * with malloc so MccResult_free can treat it the same */
+static void set_diagnostic(struct MccResult *result, const char *msg) {
+
+    result->diagnostics_len = strlen(msg);
+    result->diagnostics = malloc(result->diagnostics_len+1);
+    if (result->diagnostics)
+        strcpy(result->diagnostics, msg);
+    else
+        result->diagnostics_len = 0;
+
+}
+
+int Mcc_compile(const char *src, size_t src_len, const char *file_name,
+        const struct MccOptions *options, struct MccResult *result) {
+
+    struct MccOptions default_options = MccOptions_init();
+    struct CompilerCtx ctx = CompilerCtx_init();
+    struct SourceBuf src_buf = SourceBuf_init();
+    struct OutBuf output = OutBuf_init();
+    char *src_copy = NULL;
+    FILE *err_stream = NULL;
+    bool error_occurred = false;
+    struct SafeMemTrap trap;
+    struct SafeMemTrap *old_trap = NULL;
+
+    if (!options)
+        options = &default_options;
+
+    result->asm_text = NULL;
+    result->asm_len = 0;
+    result->diagnostics = NULL;
+    result->diagnostics_len = 0;
+
+    err_stream = open_memstream(&result->diagnostics,
+            &result->diagnostics_len);
+    if (!err_stream) {
+        set_diagnostic(result, "error: couldn't open the diagnostics "
+                "stream.\n");
+        CompilerCtx_free(&ctx);
+        result->error_occurred = true;
+        return true;
+    }
+
+    if (src_len >= m_u32_max) {
+        fprintf(err_stream, "%s: error: the source is too large.\n",
+                file_name);
+        fclose(err_stream);
+        CompilerCtx_free(&ctx);
+        result->error_occurred = true;
+        return true;
+    }
+
+    /* running out of memory or a table getting too big ends up here instead
+     * of exiting the caller's process. whatever the compile had allocated by
+     * then is lost, the locals holding it can't be trusted after the jump */
+    old_trap = SafeMem_set_trap(&trap);
+    if (setjmp(trap.jmp)) {
+        SafeMem_set_trap(old_trap);
+        fprintf(err_stream, "%s: error: %s.\n", file_name, trap.msg);
+        fclose(err_stream);
+        result->error_occurred = true;
+        return true;
+    }
+
+    /* the pre-processor and the lexer need the '\0' at the end */
+    src_copy = safe_malloc(src_len+1, MemTag_SOURCE);
+    memcpy(src_copy, src, src_len);
+    src_copy[src_len] = '\0';
+    src_buf.src = src_copy;
+    src_buf.len = src_len;
+
+    ctx.args.src_path = file_name;
+    ctx.args.optimize = options->optimize;
+    ctx.args.w_error = options->w_error;
+    ctx.args.pedantic = options->pedantic;
+    ctx.args.no_includes = true;
+    ctx.err_stream = err_stream;
+
+    output = OutBuf_create(-1);
+    Compile_src(&ctx, &src_buf, &output, &error_occurred);
+
+    CompilerCtx_free(&ctx);
+    SourceBuf_free(&src_buf);
+
+    fclose(err_stream);
+
+    if (!error_occurred) {
+        result->asm_len = output.size;
+        OutBuf_append_char(&output, '\0');
+        result->asm_text = output.buf;
+    }
+    else
+        OutBuf_free(&output);
+
+    SafeMem_set_trap(old_trap);
+    result->error_occurred = error_occurred;
+    return error_occurred;
+
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+/* the library interface of the compiler. everything happens in memory, so
+ * nothing gets read from or written to the filesystem, stdout or stderr.
+ * this header doesn't pull in any of the compiler's own headers, so it can
+ * be included next to stdbool.h and friends. */
+
+#include <stddef.h>
+
+struct MccOptions {
+
+    /* these do the same thing as -O, -Werror and --pedantic. they're ints
+     * instead of bools so the header doesn't depend on bool.h */
+    int optimize;
+    int w_error;
+    int pedantic;
+
+};
+
+struct MccResult {
+
+    /* the generated assembly, '\0' terminated. NULL if compilation failed */
+    char *asm_text;
+    size_t asm_len;
+
+    /* every error and warning, '\0' terminated. it's just empty if there
+     * weren't any, and only NULL if there wasn't even memory for them */
+    char *diagnostics;
+    size_t diagnostics_len;
+
+    int error_occurred;
+
+};
+
+/* every option off */
+struct MccOptions MccOptions_init(void);
+
+/* compiles src_len chars of src. src doesn't have to be '\0' terminated.
+ * file_name is what the diagnostics refer to the source as, it doesn't have
+ * to exist, and #include is an error since there's no filesystem to look
+ * in. options can be NULL for the defaults.
+ * running out of memory, or a source too big for the compiler's tables,
+ * comes back as an error in result too, it doesn't exit.
+ * returns result->error_occurred. the buffers in result belong to the caller
+ * and have to be freed with MccResult_free. */
+int Mcc_compile(const char *src, size_t src_len, const char *file_name,
+        const struct MccOptions *options, struct MccResult *result);
+
+void MccResult_free(struct MccResult *self);
@@ -3,28 +3,61 @@
 #include "token.h"
 #include <string.h>
 
+/* concatenates the strings of the STR_LIT tokens from run_start up to run_end
+ * into one string, with a single allocation. the old strings get freed. */
+static char* merge_run(struct TokenList *token_tbl, u32 run_start,
+        u32 run_end) {
+
+    u32 total_len = 0;
+    u32 offset = 0;
+    char *merged = NULL;
+    u32 i;
+
+    for (i = run_start; i < run_end; i++)
+        total_len += strlen(token_tbl->values[i].string);
+
+    merged = safe_malloc((total_len+1)*sizeof(*merged), MemTag_STRINGS);
+
+    for (i = run_start; i < run_end; i++) {
+        u32 len = strlen(token_tbl->values[i].string);
+        memcpy(&merged[offset], token_tbl->values[i].string, len);
+        offset += len;
+        m_free(token_tbl->values[i].string);
+    }
+    merged[offset] = '\0';
+
+    return merged;
+
+}
+
 void MergeStrings_merge(struct TokenList *token_tbl) {
 
-    u32 i;
+    u32 i = 0;
+    /* where the next token that's kept goes. the list gets compacted in one
+     * go instead of erasing every merged string separately */
+    u32 n_kept = 0;
 
-    for (i = 0; token_tbl->size >= 2 && i < token_tbl->size-1; i++) {
+    while (i < token_tbl->size) {
 
-        if (token_tbl->elems[i].type != TokenType_STR_LIT ||
-                token_tbl->elems[i+1].type != TokenType_STR_LIT)
-            continue;
+        u32 run_end = i+1;
 
-        token_tbl->elems[i].value.string = safe_realloc(
-                token_tbl->elems[i].value.string,
-                (strlen(token_tbl->elems[i].value.string)+
-                     strlen(token_tbl->elems[i+1].value.string)+1) *
-                sizeof(*token_tbl->elems[i].value.string));
-        strcat(token_tbl->elems[i].value.string,
-                token_tbl->elems[i+1].value.string);
+        if (token_tbl->types[i] == TokenType_STR_LIT) {
+            while (run_end < token_tbl->size &&
+                    token_tbl->types[run_end] == TokenType_STR_LIT)
+                ++run_end;
+        }
 
-        TokenList_erase(token_tbl, i+1, Token_free);
+        if (run_end-i > 1)
+            token_tbl->values[i].string = merge_run(token_tbl, i, run_end);
 
-        --i;
+        /* the merged token keeps the position of the first string */
+        if (n_kept != i)
+            TokenList_move(token_tbl, n_kept, i);
+        ++n_kept;
+        i = run_end;
 
     }
 
+    token_tbl->size = n_kept;
+
 }
@@ -0,0 +1,144 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include "out_buf.h"
+#include "comp_dependent/ints.h"
+#include "safe_mem.h"
+#include "bool.h"
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+struct OutBuf OutBuf_init(void) {
+
+    struct OutBuf out;
+    out.buf = NULL;
+    out.size = 0;
+    out.capacity = 0;
+    out.fd = -1;
+    out.write_failed = false;
+    return out;
+
+}
+
+struct OutBuf OutBuf_create(int fd) {
+
+    struct OutBuf out = OutBuf_init();
+    out.fd = fd;
+    out.capacity = m_out_buf_block_size;
+    out.buf = safe_malloc(out.capacity*sizeof(*out.buf), MemTag_OUTPUT);
+    return out;
+
+}
+
+void OutBuf_free(struct OutBuf *self) {
+
+    m_free(self->buf);
+    *self = OutBuf_init();
+
+}
+
+void OutBuf_reset(struct OutBuf *self, int fd) {
+
+    self->size = 0;
+    self->fd = fd;
+    self->write_failed = false;
+
+}
+
+static void write_all(struct OutBuf *self) {
+
+    u32 written = 0;
+
+    while (!self->write_failed && written < self->size) {
+        ssize_t n = write(self->fd, &self->buf[written], self->size-written);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            self->write_failed = true;
+        else
+            written += n;
+    }
+
+    self->size = 0;
+
+}
+
+bool OutBuf_flush(struct OutBuf *self) {
+
+    if (self->fd >= 0)
+        write_all(self);
+
+    return !self->write_failed;
+
+}
+
+/* makes sure there's room for len more chars */
+static void reserve(struct OutBuf *self, u32 len) {
+
+    if (self->size+len <= self->capacity)
+        return;
+
+    if (self->fd >= 0) {
+        write_all(self);
+        if (len <= self->capacity)
+            return;
+    }
+
+    while (self->size+len > self->capacity) {
+        self->capacity = self->capacity > 0 ? self->capacity*2 :
+            m_out_buf_block_size;
+    }
+    self->buf = safe_realloc(self->buf, self->capacity*sizeof(*self->buf),
+            MemTag_OUTPUT);
+
+}
+
+void OutBuf_append_strn(struct OutBuf *self, const char *str, u32 len) {
+
+    reserve(self, len);
+    memcpy(&self->buf[self->size], str, len);
+    self->size += len;
+
+}
+
+void OutBuf_append_str(struct OutBuf *self, const char *str) {
+
+    OutBuf_append_strn(self, str, strlen(str));
+
+}
+
+void OutBuf_append_char(struct OutBuf *self, char c) {
+
+    reserve(self, 1);
+    self->buf[self->size++] = c;
+
+}
+
+void OutBuf_append_u32(struct OutBuf *self, u32 value) {
+
+    /* u32 max has 10 digits */
+    char digits[10];
+    u32 n_digits = 0;
+
+    do {
+        digits[n_digits++] = '0' + value % 10;
+        value /= 10;
+    } while (value > 0);
+
+    reserve(self, n_digits);
+    while (n_digits > 0)
+        self->buf[self->size++] = digits[--n_digits];
+
+}
+
+void OutBuf_append_i32(struct OutBuf *self, i32 value) {
+
+    if (value < 0) {
+        OutBuf_append_char(self, '-');
+        /* negating in unsigned so i32 min doesn't overflow */
+        OutBuf_append_u32(self, -(u32)value);
+    }
+    else
+        OutBuf_append_u32(self, value);
+
+}
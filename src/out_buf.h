@@ -0,0 +1,44 @@
+#pragma once
+
+/* a buffered output stream that doesn't go through stdio. everything gets
+ * collected in buf and written out with write() once it fills up. */
+
+#include "comp_dependent/ints.h"
+#include "bool.h"
+
+/* how much gets buffered before flushing to the file descriptor */
+#define m_out_buf_block_size 65536
+
+struct OutBuf {
+
+    char *buf;
+    u32 size;
+    u32 capacity;
+
+    /* where the buffer gets flushed to. if it's negative the buffer just keeps
+     * growing instead, which is useful for getting the output in memory. */
+    int fd;
+
+    /* set if a write() failed. everything after that gets dropped */
+    bool write_failed;
+
+};
+
+struct OutBuf OutBuf_init(void);
+struct OutBuf OutBuf_create(int fd);
+/* doesn't flush */
+void OutBuf_free(struct OutBuf *self);
+/* empties the buffer without flushing it and points it at fd, keeping the
+ * memory around for the next output */
+void OutBuf_reset(struct OutBuf *self, int fd);
+
+/* returns false if a write() has failed since the buffer was created */
+bool OutBuf_flush(struct OutBuf *self);
+
+void OutBuf_append_strn(struct OutBuf *self, const char *str, u32 len);
+void OutBuf_append_str(struct OutBuf *self, const char *str);
+void OutBuf_append_char(struct OutBuf *self, char c);
+
+/* these print the same thing as printf's %u and %d */
+void OutBuf_append_u32(struct OutBuf *self, u32 value);
+void OutBuf_append_i32(struct OutBuf *self, i32 value);
@@ -1,12 +1,15 @@
 #include "parser.h"
+#include "comp_ctx.h"
 #include "ast.h"
 #include "comp_dependent/ints.h"
 #include "err_msg.h"
 #include "lexer.h"
 #include "prim_type.h"
 #include "safe_mem.h"
+#include "arena.h"
 #include "shunting_yard.h"
 #include "identifier.h"
+#include "interner.h"
 #include "token.h"
 #include "backend_dependent/type_sizes.h"
 #include "macros.h"
@@ -14,16 +17,14 @@
 #include "type_mods.h"
 #include "typedef.h"
 #include "type_spec.h"
+#include "trace.h"
 #include <assert.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <string.h>
 
-bool Parser_error_occurred = false;
-struct ParVarList vars;
-struct TypedefList typedefs;
-
-static struct BlockNode* parse(const struct Lexer *lexer,
+static struct BlockNode* parse(struct CompilerCtx *ctx,
+        const struct Lexer *lexer,
         struct FuncDeclNode *parent_func, u32 bp, u32 sp, u32 block_start_idx,
         u32 *end_idx, unsigned n_blocks_deep, bool *missing_r_curly,
         bool detect_missing_curly, u32 n_instr_to_parse);
@@ -49,37 +50,46 @@ static u32 round_up(u32 num, u32 multiple) {
 
 }
 
+/* an ASTNode at the token at tok_idx */
+static struct ASTNode create_node(const struct Lexer *lexer, u32 tok_idx,
+        enum ASTNodeType type, void *node_struct) {
+
+    struct TokenPos pos = TokenList_pos(&lexer->token_tbl, tok_idx);
+    return ASTNode_create(pos.line_num, pos.column_num, type, node_struct);
+
+}
+
 /* returns m_u32_max if a token of stop_type type couldn't be found */
-static u32 skip_to_token_type(u32 start_idx, struct TokenList tokens,
+static u32 skip_to_token_type(u32 start_idx, const struct TokenList *tokens,
         enum TokenType stop_type) {
 
     u32 i;
-    for (i = start_idx; i < tokens.size; i++) {
-        if (tokens.elems[i].type == stop_type)
+    for (i = start_idx; i < tokens->size; i++) {
+        if (tokens->types[i] == stop_type)
             return i;
     }
     return m_u32_max;
 
 }
 
-/* same as skip_to_token_type but if the token couldn't be found tokens.size-1
- * -- the index of the last token -- is returned instead */
-static u32 skip_to_token_type_alt(u32 start_idx, struct TokenList tokens,
+/* same as skip_to_token_type but if the token couldn't be found
+ * tokens->size-1 -- the index of the last token -- is returned instead */
+static u32 skip_to_token_type_alt(u32 start_idx, const struct TokenList *tokens,
         enum TokenType stop_type) {
 
     return m_min(skip_to_token_type(start_idx, tokens, stop_type),
-            tokens.size-1);
+            tokens->size-1);
 
 }
 
-static u32 skip_to_token_type_arr(u32 start_idx, struct TokenList tokens,
+static u32 skip_to_token_type_arr(u32 start_idx, const struct TokenList *tokens,
         enum TokenType *stop_types, u32 n_stop_types) {
 
     u32 i;
-    for (i = start_idx; i < tokens.size; i++) {
+    for (i = start_idx; i < tokens->size; i++) {
         u32 j;
         for (j = 0; j < n_stop_types; j++) {
-            if (tokens.elems[i].type == stop_types[j])
+            if (tokens->types[i] == stop_types[j])
                 return i;
         }
     }
@@ -87,77 +97,82 @@ static u32 skip_to_token_type_arr(u32 start_idx, struct TokenList tokens,
 
 }
 
-static u32 skip_to_token_type_alt_arr(u32 start_idx, struct TokenList tokens,
-        enum TokenType *stop_types, u32 n_stop_types) {
+static u32 skip_to_token_type_alt_arr(u32 start_idx,
+        const struct TokenList *tokens, enum TokenType *stop_types,
+        u32 n_stop_types) {
 
     return m_min(skip_to_token_type_arr(start_idx, tokens, stop_types,
-                n_stop_types), tokens.size-1);
+                n_stop_types), tokens->size-1);
 
 }
 
-static void check_if_missing_r_curly(const struct Lexer *lexer,
+static void check_if_missing_r_curly(struct CompilerCtx *ctx,
+        const struct Lexer *lexer,
         u32 block_start_idx, u32 block_end_idx, bool check_if_reached_end,
         bool *missing_r_curly) {
 
-    if (lexer->token_tbl.elems[block_end_idx].type != TokenType_R_CURLY ||
+    if (lexer->token_tbl.types[block_end_idx] != TokenType_R_CURLY ||
             (check_if_reached_end &&
              block_end_idx+1 == lexer->token_tbl.size)) {
         if (missing_r_curly)
             *missing_r_curly = true;
-        ErrMsg_print(ErrMsg_on, &Parser_error_occurred,
-                lexer->token_tbl.elems[block_end_idx].file_path,
+        ErrMsg_print(ctx, ErrMsg_on, &ctx->parser_error_occurred,
+                TokenList_pos(&lexer->token_tbl, block_end_idx).file_path,
                 "missing a '}' to go with the '{' on line %u, column %u.\n",
-                lexer->token_tbl.elems[block_start_idx-1].line_num,
-                lexer->token_tbl.elems[block_start_idx-1].column_num);
+                TokenList_pos(&lexer->token_tbl, block_start_idx-1).line_num,
+                TokenList_pos(&lexer->token_tbl, block_start_idx-1).column_num);
     }
     else if (missing_r_curly)
         *missing_r_curly = false;
 
 }
 
-static struct Expr* parse_expr(const struct Lexer *lexer, u32 start_idx,
+static struct Expr* parse_expr(struct CompilerCtx *ctx,
+        const struct Lexer *lexer, u32 start_idx,
         u32 *sy_end_idx, u32 bp) {
 
-    struct Expr *expr = SY_shunting_yard(&lexer->token_tbl, start_idx, NULL, 0,
-            sy_end_idx, &vars, bp, false, &typedefs, true);
+    struct Expr *expr = SY_shunting_yard(ctx, &lexer->token_tbl, start_idx,
+            NULL, 0,
+            sy_end_idx, bp, false, true);
 
     if (*sy_end_idx == lexer->token_tbl.size) {
-        ErrMsg_print(ErrMsg_on, &Parser_error_occurred,
-                lexer->token_tbl.elems[start_idx].file_path,
+        ErrMsg_print(ctx, ErrMsg_on, &ctx->parser_error_occurred,
+                TokenList_pos(&lexer->token_tbl, start_idx).file_path,
                 "missing semicolon. line %u.\n",
-                lexer->token_tbl.elems[start_idx].line_num);
+                TokenList_pos(&lexer->token_tbl, start_idx).line_num);
     }
 
     return expr;
 
 }
 
-static struct Expr* var_decl_value(const struct Lexer *lexer, u32 ident_idx,
+static struct Expr* var_decl_value(struct CompilerCtx *ctx,
+        const struct Lexer *lexer, u32 ident_idx,
         u32 equal_sign_idx, u32 *semicolon_idx, u32 bp) {
 
     struct Expr *expr = NULL;
 
     if (equal_sign_idx+1 >= lexer->token_tbl.size ||
-            lexer->token_tbl.elems[equal_sign_idx].type ==
+            lexer->token_tbl.types[equal_sign_idx] ==
             TokenType_SEMICOLON) {
         *semicolon_idx = equal_sign_idx;
         return NULL;
     }
 
-    if (lexer->token_tbl.elems[equal_sign_idx].type != TokenType_EQUAL) {
-        ErrMsg_print(ErrMsg_on, &Parser_error_occurred,
-                lexer->token_tbl.elems[ident_idx].file_path,
+    if (lexer->token_tbl.types[equal_sign_idx] != TokenType_EQUAL) {
+        ErrMsg_print(ctx, ErrMsg_on, &ctx->parser_error_occurred,
+                TokenList_pos(&lexer->token_tbl, ident_idx).file_path,
                 "missing an equals sign. line %u.\n",
-                lexer->token_tbl.elems[ident_idx].line_num);
+                TokenList_pos(&lexer->token_tbl, ident_idx).line_num);
         *semicolon_idx = ident_idx;
-        while (lexer->token_tbl.elems[*semicolon_idx].type !=
+        while (lexer->token_tbl.types[*semicolon_idx] !=
                 TokenType_SEMICOLON)
             ++*semicolon_idx;
         return NULL;
     }
 
-    expr = SY_shunting_yard(&lexer->token_tbl, equal_sign_idx+1, NULL, 0,
-            semicolon_idx, &vars, bp, true, &typedefs, true);
+    expr = SY_shunting_yard(ctx, &lexer->token_tbl, equal_sign_idx+1, NULL, 0,
+            semicolon_idx, bp, true, true);
 
     return expr;
 
@@ -168,7 +183,8 @@ static struct Expr* var_decl_value(const struct Lexer *lexer, u32 ident_idx,
  *                        have thus far? can be NULL if is_func_param is false.
  * sp                   - can be NULL if is_func_param is true.
  */
-static struct VarDeclNode* parse_var_decl(const struct Lexer *lexer,
+static struct VarDeclNode* parse_var_decl(struct CompilerCtx *ctx,
+        const struct Lexer *lexer,
         u32 v_decl_idx, u32 *end_idx, u32 bp, u32 *sp, bool is_func_param,
         unsigned *n_func_param_bytes, void *par_var_parent) {
 
@@ -177,6 +193,9 @@ static struct VarDeclNode* parse_var_decl(const struct Lexer *lexer,
     struct VarDeclNode *var_decl = NULL;
     struct Expr *expr = NULL;
     struct Declarator decl;
+    /* there's only ever the one declarator for now. 2 slots since one always
+     * stays free */
+    struct Declarator decl_buf[2];
 
     bool is_array = false;
     u32 array_len = 0;
@@ -185,56 +204,60 @@ static struct VarDeclNode* parse_var_decl(const struct Lexer *lexer,
     enum PrimitiveType var_type;
     u32 n_lvls_of_indir;
     struct TypeModifiers mods;
-    u32 ident_idx = TypeSpec_read(&lexer->token_tbl, v_decl_idx, &var_type,
-            &n_lvls_of_indir, &mods, &typedefs, &Parser_error_occurred);
+    const char *var_name = NULL;
+    u32 ident_idx = TypeSpec_read(ctx, &lexer->token_tbl, v_decl_idx,
+            &var_type,
+            &n_lvls_of_indir, &mods, &ctx->typedefs,
+            &ctx->parser_error_occurred);
 
     if (ident_idx >= lexer->token_tbl.size ||
-            lexer->token_tbl.elems[ident_idx].type != TokenType_IDENT) {
+            lexer->token_tbl.types[ident_idx] != TokenType_IDENT) {
         enum TokenType stop_types[] =
             {TokenType_SEMICOLON, TokenType_COMMA, TokenType_R_PAREN};
-        ErrMsg_print(ErrMsg_on, &Parser_error_occurred,
-                lexer->token_tbl.elems[v_decl_idx].file_path,
+        ErrMsg_print(ctx, ErrMsg_on, &ctx->parser_error_occurred,
+                TokenList_pos(&lexer->token_tbl, v_decl_idx).file_path,
                 "unnamed variables are not supported. line %u,"
-                " column %u\n", lexer->token_tbl.elems[v_decl_idx].line_num,
-                lexer->token_tbl.elems[v_decl_idx].column_num);
+                " column %u\n",
+                TokenList_pos(&lexer->token_tbl, v_decl_idx).line_num,
+                TokenList_pos(&lexer->token_tbl, v_decl_idx).column_num);
 
-        *end_idx = skip_to_token_type_alt_arr(v_decl_idx, lexer->token_tbl,
+        *end_idx = skip_to_token_type_alt_arr(v_decl_idx, &lexer->token_tbl,
                 stop_types, sizeof(stop_types)/sizeof(stop_types[0]));
         return NULL;
     }
-    else if (var_type == PrimType_VOID && n_lvls_of_indir == 0) {
-        char *var_name = Token_src(&lexer->token_tbl.elems[ident_idx]);
-        ErrMsg_print(ErrMsg_on, &Parser_error_occurred,
-                lexer->token_tbl.elems[v_decl_idx].file_path,
+
+    var_name = Interner_str(&ctx->syms,
+            TokenList_sym(&lexer->token_tbl, ident_idx));
+
+    if (var_type == PrimType_VOID && n_lvls_of_indir == 0) {
+        ErrMsg_print(ctx, ErrMsg_on, &ctx->parser_error_occurred,
+                TokenList_pos(&lexer->token_tbl, v_decl_idx).file_path,
                 "variable '%s' of type 'void' on line %u,"
                 " column %u.\n", var_name,
-                lexer->token_tbl.elems[v_decl_idx].line_num,
-                lexer->token_tbl.elems[v_decl_idx].column_num);
+                TokenList_pos(&lexer->token_tbl, v_decl_idx).line_num,
+                TokenList_pos(&lexer->token_tbl, v_decl_idx).column_num);
 
-        m_free(var_name);
-        *end_idx = skip_to_token_type_alt(v_decl_idx, lexer->token_tbl,
+        *end_idx = skip_to_token_type_alt(v_decl_idx, &lexer->token_tbl,
                 TokenType_SEMICOLON);
         return NULL;
     }
 
     is_array = ident_idx+1 < lexer->token_tbl.size &&
-        lexer->token_tbl.elems[ident_idx+1].type == TokenType_L_ARR_SUBSCR;
+        lexer->token_tbl.types[ident_idx+1] == TokenType_L_ARR_SUBSCR;
     if (is_array) {
         enum TokenType stop_types[] = {TokenType_R_ARR_SUBSCR};
-        struct Expr *len_expr = SY_shunting_yard(&lexer->token_tbl,
+        struct Expr *len_expr = SY_shunting_yard(ctx, &lexer->token_tbl,
                 ident_idx+2, stop_types,
-                sizeof(stop_types)/sizeof(stop_types[0]), end_idx, &vars, bp,
-                false, &typedefs, true);
+                sizeof(stop_types)/sizeof(stop_types[0]), end_idx, bp,
+                false, true);
         ++*end_idx;
 
         if (len_expr && !Expr_statically_evaluatable(len_expr)) {
-            char *var_name = Token_src(&lexer->token_tbl.elems[ident_idx]);
-            ErrMsg_print(ErrMsg_on, &Parser_error_occurred,
-                    lexer->token_tbl.elems[ident_idx].file_path,
+                ErrMsg_print(ctx, ErrMsg_on, &ctx->parser_error_occurred,
+                    TokenList_pos(&lexer->token_tbl, ident_idx).file_path,
                     "array '%s' must have a statically evaluatable"
                     " length. line %u\n", var_name,
-                    lexer->token_tbl.elems[ident_idx].line_num);
-            m_free(var_name);
+                    TokenList_pos(&lexer->token_tbl, ident_idx).line_num);
             array_len = 1;
         }
         else if (!len_expr) {
@@ -243,20 +266,26 @@ static struct VarDeclNode* parse_var_decl(const struct Lexer *lexer,
         }
         else
             array_len = Expr_evaluate(len_expr);
-        Expr_recur_free_w_self(len_expr);
-        ++n_lvls_of_indir;  /* arrays act a lot like a level of pointers */
+
+        if (n_lvls_of_indir == m_max_lvls_of_indir) {
+            ErrMsg_print(ctx, ErrMsg_on, &ctx->parser_error_occurred,
+                    TokenList_pos(&lexer->token_tbl, ident_idx).file_path,
+                    "array '%s' has more than %u levels of indirection."
+                    " line %u\n", var_name, m_max_lvls_of_indir,
+                    TokenList_pos(&lexer->token_tbl, ident_idx).line_num);
+        }
+        else
+            ++n_lvls_of_indir;  /* arrays act a lot like a level of pointers */
     }
     else {
         *end_idx = ident_idx+1;
     }
 
     if (is_array && array_len == 0) {
-        char *var_name = Token_src(&lexer->token_tbl.elems[ident_idx]);
-        ErrMsg_print(ErrMsg_on, &Parser_error_occurred,
-                lexer->token_tbl.elems[ident_idx].file_path,
+        ErrMsg_print(ctx, ErrMsg_on, &ctx->parser_error_occurred,
+                TokenList_pos(&lexer->token_tbl, ident_idx).file_path,
                 "array '%s' cannot have a length of 0. line %u\n",
-                var_name, lexer->token_tbl.elems[ident_idx].line_num);
-        m_free(var_name);
+                var_name, TokenList_pos(&lexer->token_tbl, ident_idx).line_num);
         array_len = 1;
     }
 
@@ -270,42 +299,38 @@ static struct VarDeclNode* parse_var_decl(const struct Lexer *lexer,
      * given a length */
 
     expr = is_func_param ? NULL :
-        var_decl_value(lexer, ident_idx, *end_idx, end_idx, bp);
-    decl = Declarator_create(expr,
-            Token_src(&lexer->token_tbl.elems[ident_idx]), n_lvls_of_indir,
-            is_array, array_len, 0);
+        var_decl_value(ctx, lexer, ident_idx, *end_idx, end_idx, bp);
+    decl = Declarator_create(expr, var_name, n_lvls_of_indir, is_array,
+            array_len, 0);
 
     if (decl.is_array && decl.value &&
             decl.value->expr_type != ExprType_ARRAY_LIT) {
-        char *var_name = Token_src(&lexer->token_tbl.elems[ident_idx]);
-        ErrMsg_print(ErrMsg_on, &Parser_error_occurred,
-                lexer->token_tbl.elems[ident_idx].file_path,
+        ErrMsg_print(ctx, ErrMsg_on, &ctx->parser_error_occurred,
+                TokenList_pos(&lexer->token_tbl, ident_idx).file_path,
                 "'%s' can only be initialized by an array initializer."
                 " line %u, column %u\n", var_name,
-                lexer->token_tbl.elems[ident_idx].line_num,
-                lexer->token_tbl.elems[ident_idx].column_num);
-        Parser_error_occurred = true;
-        m_free(var_name);
+                TokenList_pos(&lexer->token_tbl, ident_idx).line_num,
+                TokenList_pos(&lexer->token_tbl, ident_idx).column_num);
+        ctx->parser_error_occurred = true;
     }
     else if (decl.is_array && decl.value) {
+        struct ArrayLit *array_value = Expr_array_lit(&ctx->exprs, decl.value);
         if (!len_defined) {
-            array_len = decl.value->array_value.n_values;
+            array_len = array_value->n_values;
             var_size =
                 PrimitiveType_size(var_type, n_lvls_of_indir-1)*array_len;
             decl.array_len = array_len;
         }
-        decl.value->array_value.elem_size = var_size/array_len;
+        array_value->elem_size = var_size/array_len;
     }
     else if (decl.is_array && !len_defined) {
-        char *var_name = Token_src(&lexer->token_tbl.elems[ident_idx]);
-        ErrMsg_print(ErrMsg_on, &Parser_error_occurred,
-                lexer->token_tbl.elems[ident_idx].file_path,
+        ErrMsg_print(ctx, ErrMsg_on, &ctx->parser_error_occurred,
+                TokenList_pos(&lexer->token_tbl, ident_idx).file_path,
                 "array '%s' hasn't been given a length. line %u,"
                 " column %u.\n", var_name,
-                lexer->token_tbl.elems[ident_idx].line_num,
-                lexer->token_tbl.elems[ident_idx].column_num);
-        Parser_error_occurred = true;
-        m_free(var_name);
+                TokenList_pos(&lexer->token_tbl, ident_idx).line_num,
+                TokenList_pos(&lexer->token_tbl, ident_idx).column_num);
+        ctx->parser_error_occurred = true;
     }
 
     /* align the variable to its size */
@@ -321,29 +346,31 @@ static struct VarDeclNode* parse_var_decl(const struct Lexer *lexer,
         *end_idx = ident_idx+1;
     }
 
-    var_decl = safe_malloc(sizeof(*var_decl));
+    var_decl = Arena_alloc(&ctx->ast_arena, sizeof(*var_decl));
     *var_decl = VarDeclNode_init();
     var_decl->type = var_type;
+    var_decl->decls = DeclList_init_inline(decl_buf,
+            sizeof(decl_buf)/sizeof(decl_buf[0]));
     DeclList_push_back(&var_decl->decls, decl);
+    m_arena_take_small_vec(&ctx->ast_arena, var_decl->decls);
 
     {
-        char *var_name = Token_src(&lexer->token_tbl.elems[ident_idx]);
-        u32 prev_decl_idx = ParVarList_find_var(&vars, var_name);
+        u32 prev_decl_idx = ParVarList_find_var(&ctx->vars,
+                TokenList_sym(&lexer->token_tbl, ident_idx));
         if (prev_decl_idx != m_u32_max &&
-                vars.elems[prev_decl_idx].parent == par_var_parent) {
-            ErrMsg_print(ErrMsg_on, &Parser_error_occurred,
-                    lexer->token_tbl.elems[v_decl_idx].file_path,
+                ctx->vars.elems[prev_decl_idx].parent == par_var_parent) {
+            ErrMsg_print(ctx, ErrMsg_on, &ctx->parser_error_occurred,
+                    TokenList_pos(&lexer->token_tbl, v_decl_idx).file_path,
                     "variable '%s' redeclared on line %u.\n", var_name,
-                    lexer->token_tbl.elems[v_decl_idx].line_num);
-            Parser_error_occurred = true;
+                    TokenList_pos(&lexer->token_tbl, v_decl_idx).line_num);
+            ctx->parser_error_occurred = true;
         }
-        m_free(var_name);
     }
 
-    ParVarList_push_back(&vars, ParserVar_create(
-                lexer->token_tbl.elems[v_decl_idx].line_num,
-                lexer->token_tbl.elems[v_decl_idx].column_num,
-                Token_src(&lexer->token_tbl.elems[ident_idx]), n_lvls_of_indir,
+    ParVarList_push_back(&ctx->vars, ParserVar_create(
+                TokenList_pos(&lexer->token_tbl, v_decl_idx).line_num,
+                TokenList_pos(&lexer->token_tbl, v_decl_idx).column_num,
+                TokenList_sym(&lexer->token_tbl, ident_idx), n_lvls_of_indir,
                 mods, var_type, is_array, array_len, decl.bp_offset+bp, NULL,
                 false, false, false, is_func_param, par_var_parent));
     if (!is_func_param)
@@ -351,75 +378,69 @@ static struct VarDeclNode* parse_var_decl(const struct Lexer *lexer,
     else
         *n_func_param_bytes += var_size;
 
-    if (!(lexer->token_tbl.elems[*end_idx].type == TokenType_SEMICOLON ||
+    if (!(lexer->token_tbl.types[*end_idx] == TokenType_SEMICOLON ||
             (is_func_param &&
-             (lexer->token_tbl.elems[*end_idx].type == TokenType_COMMA ||
-              lexer->token_tbl.elems[*end_idx].type == TokenType_R_PAREN)))) {
-        ErrMsg_print(ErrMsg_on, &Parser_error_occurred,
-                lexer->token_tbl.elems[v_decl_idx].file_path,
+             (lexer->token_tbl.types[*end_idx] == TokenType_COMMA ||
+              lexer->token_tbl.types[*end_idx] == TokenType_R_PAREN)))) {
+        ErrMsg_print(ctx, ErrMsg_on, &ctx->parser_error_occurred,
+                TokenList_pos(&lexer->token_tbl, v_decl_idx).file_path,
                 "missing '%c'. line %u.\n",
                 is_func_param ? ')' : ';',
-                lexer->token_tbl.elems[v_decl_idx].line_num);
-        Parser_error_occurred = true;
+                TokenList_pos(&lexer->token_tbl, v_decl_idx).line_num);
+        ctx->parser_error_occurred = true;
     }
 
     return var_decl;
 
 }
 
-static bool func_prototypes_match(const struct Lexer *lexer,
-        u32 prev_func_decl_var_idx, struct FuncDeclNode *func,
-        u32 f_ident_tok_idx) {
+static bool func_prototypes_match(struct CompilerCtx *ctx,
+        u32 prev_func_decl_var_idx, struct FuncDeclNode *func) {
 
-    char *func_name = Token_src(&lexer->token_tbl.elems[f_ident_tok_idx]);
+    const struct ParserVar *prev_decl =
+        &ctx->vars.elems[prev_func_decl_var_idx];
     u32 i;
     bool not_matching = false;
-    not_matching |= vars.elems[prev_func_decl_var_idx].lvls_of_indir == 0 &&
+    not_matching |= prev_decl->lvls_of_indir == 0 &&
         func->ret_lvls_of_indir > 0;
-    not_matching |= vars.elems[prev_func_decl_var_idx].lvls_of_indir > 0 &&
+    not_matching |= prev_decl->lvls_of_indir > 0 &&
         func->ret_lvls_of_indir == 0;
-    not_matching |= vars.elems[prev_func_decl_var_idx].type != func->ret_type;
-    not_matching |= !TypeModifiers_equal(
-            &vars.elems[prev_func_decl_var_idx].mods,
-            &func->ret_type_mods
-            );
-    not_matching |= vars.elems[prev_func_decl_var_idx].args->size !=
+    not_matching |= prev_decl->type != func->ret_type;
+    not_matching |= !TypeModifiers_equal(&prev_decl->mods,
+            &func->ret_type_mods);
+    not_matching |= prev_decl->args->size !=
         func->args.size;
-    not_matching |= vars.elems[prev_func_decl_var_idx].variadic_args !=
+    not_matching |= prev_decl->variadic_args !=
         func->variadic_args;
-    not_matching |= vars.elems[prev_func_decl_var_idx].void_args !=
+    not_matching |= prev_decl->void_args !=
         func->void_args;
     for (i = 0; !not_matching && i < func->args.size; i++) {
-        if (func->args.elems[i]->type !=
-                vars.elems[prev_func_decl_var_idx].args->elems[i]->type) {
+        if (func->args.elems[i]->type != prev_decl->args->elems[i]->type) {
             not_matching = true;
             break;
         }
     }
 
-    m_free(func_name);
     return !not_matching;
 
 }
 
-static bool is_unnamed_void_var(const struct Lexer *lexer, u32 type_spec_idx) {
-
-    char *type_spec_src = Token_src(&lexer->token_tbl.elems[type_spec_idx]);
+static bool is_unnamed_void_var(struct CompilerCtx *ctx,
+        const struct Lexer *lexer, u32 type_spec_idx) {
 
-    bool is_true = (Ident_type_spec(type_spec_src, &typedefs) == PrimType_VOID
+    return Ident_type_spec(TokenList_sym(&lexer->token_tbl, type_spec_idx),
+            &ctx->typedefs) == PrimType_VOID
             && (type_spec_idx+1 >= lexer->token_tbl.size ||
-                (lexer->token_tbl.elems[type_spec_idx+1].type !=
+                (lexer->token_tbl.types[type_spec_idx+1] !=
                  TokenType_IDENT &&
-                 lexer->token_tbl.elems[type_spec_idx+1].type !=
-                 TokenType_MUL)));
-
-    m_free(type_spec_src);
-    return is_true;
+                 lexer->token_tbl.types[type_spec_idx+1] !=
+                 TokenType_MUL));
 
 }
 
 /* returns the right parenthesis of after the function arguments */
-static u32 parse_func_args(const struct Lexer *lexer, u32 arg_decl_start_idx,
+static u32 parse_func_args(struct CompilerCtx *ctx, const struct Lexer *lexer,
+        u32 arg_decl_start_idx,
         struct VarDeclPtrList *args, bool *void_args, u32 bp,
         struct FuncDeclNode *func_node, bool *variadic_args) {
 
@@ -431,11 +452,11 @@ static u32 parse_func_args(const struct Lexer *lexer, u32 arg_decl_start_idx,
 
     /* if the function arguments start with an unnamed void variable, that
      * means the function takes no arguments */
-    if (is_unnamed_void_var(lexer, arg_decl_idx)) {
+    if (is_unnamed_void_var(ctx, lexer, arg_decl_idx)) {
         *void_args = true;
         arg_decl_end_idx = arg_decl_idx+1;
         if (arg_decl_end_idx >= lexer->token_tbl.size ||
-                lexer->token_tbl.elems[arg_decl_end_idx].type !=
+                lexer->token_tbl.types[arg_decl_end_idx] !=
                 TokenType_R_PAREN) {
             return m_u32_max;
         }
@@ -448,67 +469,64 @@ static u32 parse_func_args(const struct Lexer *lexer, u32 arg_decl_start_idx,
     }
 
     while (arg_decl_end_idx < lexer->token_tbl.size &&
-            lexer->token_tbl.elems[arg_decl_end_idx].type !=
+            lexer->token_tbl.types[arg_decl_end_idx] !=
             TokenType_R_PAREN) {
 
-        char *type_spec_src = NULL;
         struct VarDeclNode *arg;
 
-        if (lexer->token_tbl.elems[arg_decl_idx].type == TokenType_VARIADIC) {
+        if (lexer->token_tbl.types[arg_decl_idx] == TokenType_VARIADIC) {
             *variadic_args = true;
             arg_decl_end_idx = arg_decl_idx+1;
             break;
         }
 
-        type_spec_src = Token_src(&lexer->token_tbl.elems[arg_decl_idx]);
-
-        if (Ident_type_spec(type_spec_src, &typedefs) == PrimType_INVALID) {
+        if (Ident_type_spec(TokenList_sym(&lexer->token_tbl, arg_decl_idx),
+                &ctx->typedefs) == PrimType_INVALID) {
             enum TokenType stop_types[] =
                 {TokenType_R_PAREN, TokenType_L_CURLY};
+            char *type_spec_src =
+                TokenList_src(&lexer->token_tbl, arg_decl_idx);
 
-            ErrMsg_print(ErrMsg_on, &Parser_error_occurred,
-                    lexer->token_tbl.elems[arg_decl_idx].file_path,
+            ErrMsg_print(ctx, ErrMsg_on, &ctx->parser_error_occurred,
+                    TokenList_pos(&lexer->token_tbl, arg_decl_idx).file_path,
                     "missing type specifier for '%s'. line %u, column %u\n",
                     type_spec_src,
-                    lexer->token_tbl.elems[arg_decl_idx].line_num,
-                    lexer->token_tbl.elems[arg_decl_idx].column_num);
+                    TokenList_pos(&lexer->token_tbl, arg_decl_idx).line_num,
+                    TokenList_pos(&lexer->token_tbl, arg_decl_idx).column_num);
             m_free(type_spec_src);
             arg_decl_end_idx = skip_to_token_type_alt_arr(arg_decl_idx,
-                    lexer->token_tbl, stop_types,
+                    &lexer->token_tbl, stop_types,
                     sizeof(stop_types)/sizeof(stop_types[0])) - 1;
         }
 
-        arg = parse_var_decl(lexer, arg_decl_idx, &arg_decl_end_idx, bp, NULL,
+        arg = parse_var_decl(ctx, lexer, arg_decl_idx, &arg_decl_end_idx, bp,
+                NULL,
                 true, &n_func_param_bytes, func_node);
 
         if (arg) {
             VarDeclPtrList_push_back(args, arg);
         }
 
-        if (lexer->token_tbl.elems[arg_decl_end_idx].type == TokenType_R_PAREN) {
-            m_free(type_spec_src);
+        if (lexer->token_tbl.types[arg_decl_end_idx] == TokenType_R_PAREN)
             break;
-        }
 
-        if (lexer->token_tbl.elems[arg_decl_end_idx].type != TokenType_COMMA) {
+        if (lexer->token_tbl.types[arg_decl_end_idx] != TokenType_COMMA) {
             char *var_name =
-                Token_src(&lexer->token_tbl.elems[arg_decl_idx+1]);
-            ErrMsg_print(ErrMsg_on, &Parser_error_occurred,
-                    lexer->token_tbl.elems[arg_decl_idx+1].file_path,
+                TokenList_src(&lexer->token_tbl, arg_decl_idx+1);
+            ErrMsg_print(ctx, ErrMsg_on, &ctx->parser_error_occurred,
+                    TokenList_pos(&lexer->token_tbl, arg_decl_idx+1).file_path,
                     "expected a comma after '%s' argument declaration."
                     " line %u.\n", var_name,
-                    lexer->token_tbl.elems[arg_decl_idx+1].line_num);
+                    TokenList_pos(&lexer->token_tbl, arg_decl_idx+1).line_num);
             m_free(var_name);
-            m_free(type_spec_src);
 
             arg_decl_end_idx = skip_to_token_type_alt(arg_decl_end_idx-1,
-                    lexer->token_tbl, TokenType_L_CURLY);
+                    &lexer->token_tbl, TokenType_L_CURLY);
             --arg_decl_end_idx;
 
             break;
         }
 
-        m_free(type_spec_src);
         arg_decl_idx = arg_decl_end_idx+1;
 
     }
@@ -517,99 +535,132 @@ static u32 parse_func_args(const struct Lexer *lexer, u32 arg_decl_start_idx,
 
 }
 
-static void parse_func_decl(const struct Lexer *lexer, struct BlockNode *block,
-        u32 f_decl_idx, u32 *end_idx, u32 bp) {
+/* top_level is whether the func is declared outside of any other block, only
+ * those get streamed with -fstream-funcs */
+static void parse_func_decl(struct CompilerCtx *ctx,
+        const struct Lexer *lexer, struct BlockNode *block,
+        u32 f_decl_idx, u32 *end_idx, u32 bp, bool top_level) {
 
-    struct FuncDeclNode *func = safe_malloc(sizeof(*func));
+    double trace_start = Trace_begin();
+    struct FuncDeclNode *func = Arena_alloc(&ctx->ast_arena, sizeof(*func));
     struct VarDeclPtrList args = VarDeclPtrList_init();
     bool variadic_args = false;
     bool void_args = false;
-    u32 old_vars_size = vars.size;
+    u32 old_vars_size = ctx->vars.size;
     u32 args_end_idx;
-    char *func_name = NULL;
+    u32 func_sym;
+    const char *func_name = NULL;
     u32 prev_func_decl_var_idx;
+    bool stream_body = false;
+    bool stream_prototype = false;
+    /* how many exprs there were before the body, if it gets streamed */
+    u32 n_exprs = 0;
 
     enum PrimitiveType func_type;
     u32 func_lvls_of_indir;
     struct TypeModifiers func_type_mods;
-    u32 f_ident_idx = TypeSpec_read(&lexer->token_tbl, f_decl_idx, &func_type,
-            &func_lvls_of_indir, &func_type_mods, &typedefs,
-            &Parser_error_occurred);
+    u32 f_ident_idx = TypeSpec_read(ctx, &lexer->token_tbl, f_decl_idx,
+            &func_type,
+            &func_lvls_of_indir, &func_type_mods, &ctx->typedefs,
+            &ctx->parser_error_occurred);
 
-    func_name = Token_src(&lexer->token_tbl.elems[f_ident_idx]);
+    /* interned here instead of using TokenList_sym since on bad input the
+     * name might not be an IDENT token */
+    func_sym = Interner_intern(&ctx->syms,
+            TokenList_src_start(&lexer->token_tbl, f_ident_idx),
+            lexer->token_tbl.src_lens[f_ident_idx]);
+    func_name = Interner_str(&ctx->syms, func_sym);
 
-    prev_func_decl_var_idx = ParVarList_find_var(&vars, func_name);
+    prev_func_decl_var_idx = ParVarList_find_var(&ctx->vars, func_sym);
 
     if (prev_func_decl_var_idx == m_u32_max) { 
         /* has no earlier declaration */
-        ParVarList_push_back(&vars, ParserVar_create(
-                    lexer->token_tbl.elems[f_decl_idx].line_num,
-                    lexer->token_tbl.elems[f_decl_idx].column_num,
-                    Token_src(&lexer->token_tbl.elems[f_ident_idx]),
-                    func_lvls_of_indir, func_type_mods, func_type, false, 0, 0,
-                    &func->args, false, false, false, false, block));
+        ParVarList_push_back(&ctx->vars, ParserVar_create(
+                    TokenList_pos(&lexer->token_tbl, f_decl_idx).line_num,
+                    TokenList_pos(&lexer->token_tbl, f_decl_idx).column_num,
+                    func_sym, func_lvls_of_indir, func_type_mods, func_type,
+                    false, 0, 0, &func->args, false, false, false, false,
+                    block));
         ++old_vars_size;
     }
 
-    args_end_idx = parse_func_args(lexer, f_ident_idx+2, &args, &void_args,
+    args_end_idx = parse_func_args(ctx, lexer, f_ident_idx+2, &args,
+            &void_args,
             bp, func, &variadic_args);
     if (prev_func_decl_var_idx == m_u32_max) {
-        vars.elems[old_vars_size-1].variadic_args = variadic_args;
-        vars.elems[old_vars_size-1].void_args = void_args;
+        ctx->vars.elems[old_vars_size-1].variadic_args = variadic_args;
+        ctx->vars.elems[old_vars_size-1].void_args = void_args;
     }
 
     if (args_end_idx == m_u32_max) {
-        ErrMsg_print(ErrMsg_on, &Parser_error_occurred,
-                lexer->token_tbl.elems[f_decl_idx].file_path,
+        ErrMsg_print(ctx, ErrMsg_on, &ctx->parser_error_occurred,
+                TokenList_pos(&lexer->token_tbl, f_decl_idx).file_path,
                 "expected ')' to finish the list of arguments for '%s'."
                 " line %u\n", func_name,
-                lexer->token_tbl.elems[f_decl_idx].line_num);
-        m_free(func_name);
-        m_free(func);
-        *end_idx = skip_to_token_type_alt(f_decl_idx, lexer->token_tbl,
+                TokenList_pos(&lexer->token_tbl, f_decl_idx).line_num);
+        Trace_end("func", "parse ", func_name, trace_start);
+        VarDeclPtrList_free(&args);
+        *end_idx = skip_to_token_type_alt(f_decl_idx, &lexer->token_tbl,
                 TokenType_SEMICOLON);
         return;
     }
 
+    m_arena_take_vec(&ctx->ast_arena, args);
     *func = FuncDeclNode_create(args, variadic_args, void_args,
-            func_lvls_of_indir, func_type_mods, func_type, NULL,
-            Token_src(&lexer->token_tbl.elems[f_ident_idx]));
+            func_lvls_of_indir, func_type_mods, func_type, NULL, func_sym);
 
-    if (prev_func_decl_var_idx != m_u32_max && !func_prototypes_match(lexer,
-                prev_func_decl_var_idx, func, f_ident_idx)) {
-        ErrMsg_print(ErrMsg_on, &Parser_error_occurred,
-                lexer->token_tbl.elems[f_decl_idx].file_path,
+    if (prev_func_decl_var_idx != m_u32_max && !func_prototypes_match(ctx,
+                prev_func_decl_var_idx, func)) {
+        ErrMsg_print(ctx, ErrMsg_on, &ctx->parser_error_occurred,
+                TokenList_pos(&lexer->token_tbl, f_decl_idx).file_path,
                 "function '%s' declaration on line %u, column %u,"
                 " does not match previous declaration on line %u,"
                 " column %u.\n", func_name,
-                lexer->token_tbl.elems[f_decl_idx].line_num,
-                lexer->token_tbl.elems[f_decl_idx].column_num,
-                vars.elems[prev_func_decl_var_idx].line_num,
-                vars.elems[prev_func_decl_var_idx].column_num);
+                TokenList_pos(&lexer->token_tbl, f_decl_idx).line_num,
+                TokenList_pos(&lexer->token_tbl, f_decl_idx).column_num,
+                ctx->vars.elems[prev_func_decl_var_idx].line_num,
+                ctx->vars.elems[prev_func_decl_var_idx].column_num);
     }
 
     if (args_end_idx+1 < lexer->token_tbl.size &&
-            lexer->token_tbl.elems[args_end_idx+1].type == TokenType_L_CURLY) {
+            lexer->token_tbl.types[args_end_idx+1] == TokenType_L_CURLY) {
 
         u32 func_end_idx;
         bool missing_r_curly;
+        struct Arena decl_arena;
 
         if (prev_func_decl_var_idx == m_u32_max) {
-            vars.elems[old_vars_size-1].has_been_defined = true;
+            ctx->vars.elems[old_vars_size-1].has_been_defined = true;
         }
-        else if (vars.elems[prev_func_decl_var_idx].has_been_defined) {
-            ErrMsg_print(ErrMsg_on, &Parser_error_occurred,
-                    lexer->token_tbl.elems[f_decl_idx].file_path,
+        else if (ctx->vars.elems[prev_func_decl_var_idx].has_been_defined) {
+            ErrMsg_print(ctx, ErrMsg_on, &ctx->parser_error_occurred,
+                    TokenList_pos(&lexer->token_tbl, f_decl_idx).file_path,
                     "function '%s' has multiple definitions. first on line %u,"
                     " then later on line %u.\n",
-                    func_name, vars.elems[prev_func_decl_var_idx].line_num,
-                    lexer->token_tbl.elems[f_decl_idx].line_num);
+                    func_name,
+                    ctx->vars.elems[prev_func_decl_var_idx].line_num,
+                    TokenList_pos(&lexer->token_tbl, f_decl_idx).line_num);
+        }
+
+        stream_body = top_level && ctx->func_parsed;
+        if (stream_body) {
+            /* the body goes in an arena of its own, so it can be thrown away
+             * while the declaration is kept */
+            decl_arena = ctx->ast_arena;
+            ctx->ast_arena = ctx->body_arena;
+            n_exprs = ctx->exprs.tok_idxs.size;
         }
 
-        func->body = parse(lexer, func, bp, bp, args_end_idx+2, &func_end_idx,
+        func->body = parse(ctx, lexer, func, bp, bp, args_end_idx+2,
+                &func_end_idx,
                 1, &missing_r_curly, true, 0);
+
+        if (stream_body) {
+            ctx->body_arena = ctx->ast_arena;
+            ctx->ast_arena = decl_arena;
+        }
         if (!missing_r_curly)
-            check_if_missing_r_curly(lexer, args_end_idx+2, func_end_idx,
+            check_if_missing_r_curly(ctx, lexer, args_end_idx+2, func_end_idx,
                     false, NULL);
 
         *end_idx = func_end_idx;
@@ -618,33 +669,49 @@ static void parse_func_decl(const struct Lexer *lexer, struct BlockNode *block,
         *end_idx = args_end_idx+1;
     }
 
-    ASTNodeList_push_back(&block->nodes, ASTNode_create(
-                lexer->token_tbl.elems[f_decl_idx].line_num,
-                lexer->token_tbl.elems[f_decl_idx].column_num, ASTType_FUNC,
-                func));
-
-    while (vars.size > old_vars_size) {
-        ParVarList_pop_back(&vars, ParserVar_free);
+    /* with -fstream-funcs the extern a prototype might need gets written
+     * right away, so there's nothing left for it to do in the AST */
+    stream_prototype = top_level && ctx->func_parsed && !func->body;
+
+    while (ctx->vars.size > old_vars_size)
+        ParVarList_pop_back(&ctx->vars, NULL);
+    assert(ctx->vars.size == old_vars_size);
+
+    Trace_end("func", "parse ", func_name, trace_start);
+
+    /* before the func's node gets added, so block is only what came before
+     * it */
+    if (stream_body || stream_prototype)
+        ctx->func_parsed(ctx, block, func);
+    if (stream_body) {
+        func->body = NULL;
+        func->body_streamed = true;
+        Arena_reset(&ctx->body_arena);
+        ExprTable_truncate(&ctx->exprs, n_exprs);
     }
-    assert(vars.size == old_vars_size);
 
-    m_free(func_name);
+    if (!stream_prototype) {
+        ASTNodeList_push_back(&block->nodes, create_node(lexer, f_decl_idx,
+                    ASTType_FUNC, func));
+    }
 
 }
 
-static u32 parse_ret_stmt(const struct Lexer *lexer, struct BlockNode *block,
+static u32 parse_ret_stmt(struct CompilerCtx *ctx, const struct Lexer *lexer,
+        struct BlockNode *block,
         u32 bp, u32 ret_idx, struct FuncDeclNode *parent_func,
         u32 n_stack_frames_deep) {
 
-    struct RetNode *ret_node = safe_malloc(sizeof(*ret_node));
+    struct RetNode *ret_node = Arena_alloc(&ctx->ast_arena,
+            sizeof(*ret_node));
     u32 end_idx;
 
     if (!parent_func) {
-        ErrMsg_print(ErrMsg_on, &Parser_error_occurred,
-                lexer->token_tbl.elems[ret_idx].file_path,
+        ErrMsg_print(ctx, ErrMsg_on, &ctx->parser_error_occurred,
+                TokenList_pos(&lexer->token_tbl, ret_idx).file_path,
                 "return statement outside of a function on line %u\n",
-                lexer->token_tbl.elems[ret_idx].line_num);
-        return skip_to_token_type_alt(ret_idx, lexer->token_tbl,
+                TokenList_pos(&lexer->token_tbl, ret_idx).line_num);
+        return skip_to_token_type_alt(ret_idx, &lexer->token_tbl,
                 TokenType_SEMICOLON);
     }
 
@@ -654,51 +721,54 @@ static u32 parse_ret_stmt(const struct Lexer *lexer, struct BlockNode *block,
     ret_node->n_stack_frames_deep = n_stack_frames_deep;
 
     if (ret_idx+1 < lexer->token_tbl.size &&
-            lexer->token_tbl.elems[ret_idx+1].type == TokenType_SEMICOLON) {
+            lexer->token_tbl.types[ret_idx+1] == TokenType_SEMICOLON) {
         end_idx = ret_idx+1;
     }
     else if (parent_func->ret_type == PrimType_VOID &&
             parent_func->ret_lvls_of_indir == 0) {
-        ErrMsg_print(ErrMsg_on, &Parser_error_occurred,
-                lexer->token_tbl.elems[ret_idx].file_path,
+        ErrMsg_print(ctx, ErrMsg_on, &ctx->parser_error_occurred,
+                TokenList_pos(&lexer->token_tbl, ret_idx).file_path,
                 "cannot return a value in void function '%s'."
-                " line %u.\n", parent_func->name,
-                lexer->token_tbl.elems[ret_idx].line_num);
-        end_idx = skip_to_token_type_alt(ret_idx, lexer->token_tbl,
+                " line %u.\n", Interner_str(&ctx->syms, parent_func->name),
+                TokenList_pos(&lexer->token_tbl, ret_idx).line_num);
+        end_idx = skip_to_token_type_alt(ret_idx, &lexer->token_tbl,
                 TokenType_SEMICOLON);
     }
     else {
         enum TokenType stop_types[] = {TokenType_SEMICOLON};
-        ret_node->value = SY_shunting_yard(&lexer->token_tbl, ret_idx+1,
-                stop_types, sizeof(stop_types)/sizeof(stop_types[0]), &end_idx,
-                &vars, bp, false, &typedefs, true);
-        ret_node->lvls_of_indir = ret_node->value->lvls_of_indir;
-        ret_node->type = Expr_type(ret_node->value, &vars);
+        ret_node->value = SY_shunting_yard(ctx, &lexer->token_tbl, ret_idx+1,
+                stop_types, sizeof(stop_types)/sizeof(stop_types[0]),
+                &end_idx, bp, false, true);
+        /* the error's already been printed if the value's missing */
+        if (ret_node->value) {
+            ret_node->lvls_of_indir = ret_node->value->lvls_of_indir;
+            ret_node->type = Expr_type(ret_node->value, &ctx->exprs,
+                    &ctx->vars);
+        }
     }
 
     if (parent_func->ret_lvls_of_indir >= 1 &&
             parent_func->ret_type != ret_node->type) {
-        ErrMsg_print(ErrMsg_on, &Parser_error_occurred,
-                lexer->token_tbl.elems[ret_idx].file_path,
+        ErrMsg_print(ctx, ErrMsg_on, &ctx->parser_error_occurred,
+                TokenList_pos(&lexer->token_tbl, ret_idx).file_path,
                 "'%s' return type and returned type do not match."
-                " line %u.\n", parent_func->name,
-                lexer->token_tbl.elems[ret_idx].line_num);
-        Parser_error_occurred = true;
-        end_idx = skip_to_token_type_alt(ret_idx, lexer->token_tbl,
+                " line %u.\n", Interner_str(&ctx->syms, parent_func->name),
+                TokenList_pos(&lexer->token_tbl, ret_idx).line_num);
+        ctx->parser_error_occurred = true;
+        end_idx = skip_to_token_type_alt(ret_idx, &lexer->token_tbl,
                 TokenType_SEMICOLON);
     }
 
-    ASTNodeList_push_back(&block->nodes, ASTNode_create(
-                lexer->token_tbl.elems[ret_idx].line_num,
-                lexer->token_tbl.elems[ret_idx].column_num, ASTType_RETURN,
-                ret_node
+    ASTNodeList_push_back(&block->nodes, create_node(lexer, ret_idx,
+                ASTType_RETURN, ret_node
                 ));
 
     return end_idx;
 
 }
 
-u32 parse_if_stmt(const struct Lexer *lexer, struct BlockNode *block,
+u32 parse_if_stmt(struct CompilerCtx *ctx, const struct Lexer *lexer,
+        struct BlockNode *block,
         u32 n_blocks_deep, u32 if_idx, u32 bp, u32 sp,
         struct FuncDeclNode *parent_func) {
 
@@ -708,63 +778,60 @@ u32 parse_if_stmt(const struct Lexer *lexer, struct BlockNode *block,
     u32 end_idx;
 
     if (if_idx+1 >= lexer->token_tbl.size ||
-            lexer->token_tbl.elems[if_idx+1].type != TokenType_L_PAREN) {
-        ErrMsg_print(ErrMsg_on, &Parser_error_occurred,
-                lexer->token_tbl.elems[if_idx].file_path,
+            lexer->token_tbl.types[if_idx+1] != TokenType_L_PAREN) {
+        ErrMsg_print(ctx, ErrMsg_on, &ctx->parser_error_occurred,
+                TokenList_pos(&lexer->token_tbl, if_idx).file_path,
                 "expected parentheses after the if statement on line %u\n.",
-                lexer->token_tbl.elems[if_idx].line_num);
-        return skip_to_token_type_alt(if_idx, lexer->token_tbl,
+                TokenList_pos(&lexer->token_tbl, if_idx).line_num);
+        return skip_to_token_type_alt(if_idx, &lexer->token_tbl,
                 TokenType_SEMICOLON);
     }
 
-    if_node = safe_malloc(sizeof(*if_node));
+    if_node = Arena_alloc(&ctx->ast_arena, sizeof(*if_node));
     *if_node = IfNode_init();
 
     {
         enum TokenType sy_stop_types[] = {TokenType_R_PAREN};
-        if_node->expr = SY_shunting_yard(&lexer->token_tbl, if_idx+2,
+        if_node->expr = SY_shunting_yard(ctx, &lexer->token_tbl, if_idx+2,
                 sy_stop_types, sizeof(sy_stop_types)/sizeof(sy_stop_types[0]),
-                &r_paren_idx, &vars, bp, false, &typedefs, true);
+                &r_paren_idx, bp, false, true);
     }
 
     if (r_paren_idx >= lexer->token_tbl.size) {
-        ErrMsg_print(ErrMsg_on, &Parser_error_occurred,
-                lexer->token_tbl.elems[if_idx+1].file_path,
+        ErrMsg_print(ctx, ErrMsg_on, &ctx->parser_error_occurred,
+                TokenList_pos(&lexer->token_tbl, if_idx+1).file_path,
                 "expected a ')' after the condition expression on line %u,"
-                " column %u\n", lexer->token_tbl.elems[if_idx+1].line_num,
-                lexer->token_tbl.elems[if_idx+1].column_num);
-        IfNode_free_w_self(if_node);
-        return skip_to_token_type_alt(if_idx, lexer->token_tbl,
+                " column %u\n",
+                TokenList_pos(&lexer->token_tbl, if_idx+1).line_num,
+                TokenList_pos(&lexer->token_tbl, if_idx+1).column_num);
+        return skip_to_token_type_alt(if_idx, &lexer->token_tbl,
                 TokenType_SEMICOLON);
     }
     else if (r_paren_idx+1 < lexer->token_tbl.size &&
-            lexer->token_tbl.elems[r_paren_idx+1].type ==
+            lexer->token_tbl.types[r_paren_idx+1] ==
             TokenType_SEMICOLON) {
         /* idk why tf anyone would make an if statement without a body but here
          * ya go ig */
-        ASTNodeList_push_back(&block->nodes, ASTNode_create(
-                    lexer->token_tbl.elems[if_idx].line_num,
-                    lexer->token_tbl.elems[if_idx].column_num,
+        ASTNodeList_push_back(&block->nodes, create_node(lexer, if_idx,
                     ASTType_IF_STMT, if_node
                     ));
         return r_paren_idx;
     }
     else if (r_paren_idx+2 >= lexer->token_tbl.size) {
-        ErrMsg_print(ErrMsg_on, &Parser_error_occurred,
-                lexer->token_tbl.elems[if_idx].file_path,
+        ErrMsg_print(ctx, ErrMsg_on, &ctx->parser_error_occurred,
+                TokenList_pos(&lexer->token_tbl, if_idx).file_path,
                 "expected a block after the if statement on line %u.\n",
-                lexer->token_tbl.elems[if_idx].line_num);
-        IfNode_free_w_self(if_node);
-        return skip_to_token_type_alt(if_idx, lexer->token_tbl,
+                TokenList_pos(&lexer->token_tbl, if_idx).line_num);
+        return skip_to_token_type_alt(if_idx, &lexer->token_tbl,
                 TokenType_SEMICOLON);
     }
 
-    if_node->body_in_block = lexer->token_tbl.elems[r_paren_idx+1].type ==
+    if_node->body_in_block = lexer->token_tbl.types[r_paren_idx+1] ==
         TokenType_L_CURLY;
     {
         u32 body_start_idx = r_paren_idx+1+if_node->body_in_block;
         bool missing_r_curly;
-        if_node->body = parse(lexer, parent_func,
+        if_node->body = parse(ctx, lexer, parent_func,
                 if_node->body_in_block ? sp-m_TypeSize_stack_frame_size :
                 bp,
                 if_node->body_in_block ? sp-m_TypeSize_stack_frame_size :
@@ -774,19 +841,20 @@ u32 parse_if_stmt(const struct Lexer *lexer, struct BlockNode *block,
                 !if_node->body_in_block);
 
         if (!missing_r_curly && if_node->body_in_block)
-            check_if_missing_r_curly(lexer, body_start_idx, end_idx, false,
+            check_if_missing_r_curly(ctx, lexer, body_start_idx, end_idx,
+                    false,
                     NULL);
     }
 
     if (end_idx+1 < lexer->token_tbl.size &&
-            lexer->token_tbl.elems[end_idx+1].type == TokenType_ELSE) {
+            lexer->token_tbl.types[end_idx+1] == TokenType_ELSE) {
 
         u32 else_body_start_idx;
         bool missing_r_curly;
         if_node->else_body_in_block =
-            lexer->token_tbl.elems[end_idx+2].type == TokenType_ELSE;
+            lexer->token_tbl.types[end_idx+2] == TokenType_ELSE;
         else_body_start_idx = end_idx+2+if_node->else_body_in_block;
-        if_node->else_body = parse(lexer, parent_func,
+        if_node->else_body = parse(ctx, lexer, parent_func,
                 if_node->else_body_in_block ? sp-m_TypeSize_stack_frame_size :
                 bp,
                 if_node->else_body_in_block ? sp-m_TypeSize_stack_frame_size :
@@ -797,14 +865,12 @@ u32 parse_if_stmt(const struct Lexer *lexer, struct BlockNode *block,
                 !if_node->else_body_in_block);
 
         if (!missing_r_curly && if_node->else_body_in_block)
-            check_if_missing_r_curly(lexer, else_body_start_idx, end_idx,
+            check_if_missing_r_curly(ctx, lexer, else_body_start_idx, end_idx,
                     false, NULL);
 
     }
 
-    ASTNodeList_push_back(&block->nodes, ASTNode_create(
-                lexer->token_tbl.elems[if_idx].line_num,
-                lexer->token_tbl.elems[if_idx].column_num,
+    ASTNodeList_push_back(&block->nodes, create_node(lexer, if_idx,
                 ASTType_IF_STMT, if_node
                 ));
 
@@ -812,7 +878,8 @@ u32 parse_if_stmt(const struct Lexer *lexer, struct BlockNode *block,
 
 }
 
-u32 parse_while_stmt(const struct Lexer *lexer, struct BlockNode *block,
+u32 parse_while_stmt(struct CompilerCtx *ctx, const struct Lexer *lexer,
+        struct BlockNode *block,
         u32 n_blocks_deep, u32 while_idx, u32 bp, u32 sp,
         struct FuncDeclNode *parent_func) {
 
@@ -822,61 +889,59 @@ u32 parse_while_stmt(const struct Lexer *lexer, struct BlockNode *block,
     u32 end_idx;
 
     if (while_idx+1 >= lexer->token_tbl.size ||
-            lexer->token_tbl.elems[while_idx+1].type != TokenType_L_PAREN) {
-        ErrMsg_print(ErrMsg_on, &Parser_error_occurred,
-                lexer->token_tbl.elems[while_idx].file_path,
+            lexer->token_tbl.types[while_idx+1] != TokenType_L_PAREN) {
+        ErrMsg_print(ctx, ErrMsg_on, &ctx->parser_error_occurred,
+                TokenList_pos(&lexer->token_tbl, while_idx).file_path,
                 "expected parentheses after the while statement on line %u\n.",
-                lexer->token_tbl.elems[while_idx].line_num);
-        return skip_to_token_type_alt(while_idx, lexer->token_tbl,
+                TokenList_pos(&lexer->token_tbl, while_idx).line_num);
+        return skip_to_token_type_alt(while_idx, &lexer->token_tbl,
                 TokenType_SEMICOLON);
     }
 
-    while_node = safe_malloc(sizeof(*while_node));
+    while_node = Arena_alloc(&ctx->ast_arena, sizeof(*while_node));
     *while_node = WhileNode_init();
 
     {
         enum TokenType sy_stop_types[] = {TokenType_R_PAREN};
-        while_node->expr = SY_shunting_yard(&lexer->token_tbl, while_idx+2,
+        while_node->expr = SY_shunting_yard(ctx, &lexer->token_tbl,
+                while_idx+2,
                 sy_stop_types, sizeof(sy_stop_types)/sizeof(sy_stop_types[0]),
-                &r_paren_idx, &vars, bp, false, &typedefs, true);
+                &r_paren_idx, bp, false, true);
     }
 
     if (r_paren_idx >= lexer->token_tbl.size) {
-        ErrMsg_print(ErrMsg_on, &Parser_error_occurred,
-                lexer->token_tbl.elems[while_idx+1].file_path,
+        ErrMsg_print(ctx, ErrMsg_on, &ctx->parser_error_occurred,
+                TokenList_pos(&lexer->token_tbl, while_idx+1).file_path,
                 "expected a ')' after the condition expression on line %u,"
-                " column %u\n", lexer->token_tbl.elems[while_idx+1].line_num,
-                lexer->token_tbl.elems[while_idx+1].column_num);
-        WhileNode_free_w_self(while_node);
-        return skip_to_token_type_alt(while_idx, lexer->token_tbl,
+                " column %u\n",
+                TokenList_pos(&lexer->token_tbl, while_idx+1).line_num,
+                TokenList_pos(&lexer->token_tbl, while_idx+1).column_num);
+        return skip_to_token_type_alt(while_idx, &lexer->token_tbl,
                 TokenType_SEMICOLON);
     }
     else if (r_paren_idx+1 < lexer->token_tbl.size &&
-            lexer->token_tbl.elems[r_paren_idx+1].type ==
+            lexer->token_tbl.types[r_paren_idx+1] ==
             TokenType_SEMICOLON) {
-        ASTNodeList_push_back(&block->nodes, ASTNode_create(
-                    lexer->token_tbl.elems[while_idx].line_num,
-                    lexer->token_tbl.elems[while_idx].column_num,
+        ASTNodeList_push_back(&block->nodes, create_node(lexer, while_idx,
                     ASTType_WHILE_STMT, while_node
                     ));
         return r_paren_idx+1;
     }
     else if (r_paren_idx+2 >= lexer->token_tbl.size) {
-        ErrMsg_print(ErrMsg_on, &Parser_error_occurred,
-                lexer->token_tbl.elems[while_idx].file_path,
+        ErrMsg_print(ctx, ErrMsg_on, &ctx->parser_error_occurred,
+                TokenList_pos(&lexer->token_tbl, while_idx).file_path,
                 "expected a block after the while statement on line %u.\n",
-                lexer->token_tbl.elems[while_idx].line_num);
-        WhileNode_free_w_self(while_node);
-        return skip_to_token_type_alt(while_idx, lexer->token_tbl,
+                TokenList_pos(&lexer->token_tbl, while_idx).line_num);
+        return skip_to_token_type_alt(while_idx, &lexer->token_tbl,
                 TokenType_SEMICOLON);
     }
 
-    while_node->body_in_block = lexer->token_tbl.elems[r_paren_idx+1].type ==
+    while_node->body_in_block = lexer->token_tbl.types[r_paren_idx+1] ==
         TokenType_L_CURLY;
     {
         u32 body_start_idx = r_paren_idx+1+while_node->body_in_block;
         bool missing_r_curly;
-        while_node->body = parse(lexer, parent_func,
+        while_node->body = parse(ctx, lexer, parent_func,
                 while_node->body_in_block ? sp-m_TypeSize_stack_frame_size :
                 bp,
                 while_node->body_in_block ? sp-m_TypeSize_stack_frame_size :
@@ -887,13 +952,12 @@ u32 parse_while_stmt(const struct Lexer *lexer, struct BlockNode *block,
                 !while_node->body_in_block);
 
         if (!missing_r_curly && while_node->body_in_block)
-            check_if_missing_r_curly(lexer, body_start_idx, end_idx, false,
+            check_if_missing_r_curly(ctx, lexer, body_start_idx, end_idx,
+                    false,
                     NULL);
     }
 
-    ASTNodeList_push_back(&block->nodes, ASTNode_create(
-                lexer->token_tbl.elems[while_idx].line_num,
-                lexer->token_tbl.elems[while_idx].column_num,
+    ASTNodeList_push_back(&block->nodes, create_node(lexer, while_idx,
                 ASTType_WHILE_STMT, while_node
                 ));
 
@@ -901,7 +965,8 @@ u32 parse_while_stmt(const struct Lexer *lexer, struct BlockNode *block,
 
 }
 
-u32 parse_for_stmt(const struct Lexer *lexer, struct BlockNode *block,
+u32 parse_for_stmt(struct CompilerCtx *ctx, const struct Lexer *lexer,
+        struct BlockNode *block,
         u32 n_blocks_deep, u32 for_idx, u32 bp, u32 sp,
         struct FuncDeclNode *parent_func) {
 
@@ -913,86 +978,83 @@ u32 parse_for_stmt(const struct Lexer *lexer, struct BlockNode *block,
     u32 end_idx;
 
     if (for_idx+1 >= lexer->token_tbl.size ||
-            lexer->token_tbl.elems[for_idx+1].type != TokenType_L_PAREN) {
-        ErrMsg_print(ErrMsg_on, &Parser_error_occurred,
-                lexer->token_tbl.elems[for_idx].file_path,
+            lexer->token_tbl.types[for_idx+1] != TokenType_L_PAREN) {
+        ErrMsg_print(ctx, ErrMsg_on, &ctx->parser_error_occurred,
+                TokenList_pos(&lexer->token_tbl, for_idx).file_path,
                 "expected parentheses after the for statement on line %u\n.",
-                lexer->token_tbl.elems[for_idx].line_num);
-        return skip_to_token_type_alt(for_idx, lexer->token_tbl,
+                TokenList_pos(&lexer->token_tbl, for_idx).line_num);
+        return skip_to_token_type_alt(for_idx, &lexer->token_tbl,
                 TokenType_SEMICOLON);
     }
 
-    for_node = safe_malloc(sizeof(*for_node));
+    for_node = Arena_alloc(&ctx->ast_arena, sizeof(*for_node));
     *for_node = ForNode_init();
 
     /* get the for loop expressions */
 
-    for_node->init = SY_shunting_yard(&lexer->token_tbl, for_idx+2, NULL, 0,
-            &init_end_idx, &vars, bp, false, &typedefs, true);
+    for_node->init = SY_shunting_yard(ctx, &lexer->token_tbl, for_idx+2, NULL,
+            0,
+            &init_end_idx, bp, false, true);
     if (init_end_idx >= lexer->token_tbl.size) {
-        ErrMsg_print(ErrMsg_on, &Parser_error_occurred,
-                lexer->token_tbl.elems[for_idx].file_path,
+        ErrMsg_print(ctx, ErrMsg_on, &ctx->parser_error_occurred,
+                TokenList_pos(&lexer->token_tbl, for_idx).file_path,
                 "expected 3 expressions after the for keyword on line %u.\n",
-                lexer->token_tbl.elems[for_idx].line_num);
-        ForNode_free_w_self(for_node);
-        return skip_to_token_type_alt(for_idx, lexer->token_tbl,
+                TokenList_pos(&lexer->token_tbl, for_idx).line_num);
+        return skip_to_token_type_alt(for_idx, &lexer->token_tbl,
                 TokenType_SEMICOLON);
     }
 
-    for_node->condition = SY_shunting_yard(&lexer->token_tbl, init_end_idx+1,
-            NULL, 0, &cond_end_idx, &vars, bp, false, &typedefs, true);
+    for_node->condition = SY_shunting_yard(ctx, &lexer->token_tbl,
+            init_end_idx+1,
+            NULL, 0, &cond_end_idx, bp, false, true);
     if (cond_end_idx >= lexer->token_tbl.size) {
-        ErrMsg_print(ErrMsg_on, &Parser_error_occurred,
-                lexer->token_tbl.elems[for_idx].file_path,
+        ErrMsg_print(ctx, ErrMsg_on, &ctx->parser_error_occurred,
+                TokenList_pos(&lexer->token_tbl, for_idx).file_path,
                 "expected 3 expressions after the for keyword on line %u.\n",
-                lexer->token_tbl.elems[for_idx].line_num);
-        ForNode_free_w_self(for_node);
-        return skip_to_token_type_alt(for_idx, lexer->token_tbl,
+                TokenList_pos(&lexer->token_tbl, for_idx).line_num);
+        return skip_to_token_type_alt(for_idx, &lexer->token_tbl,
                 TokenType_SEMICOLON);
     }
 
     {
         enum TokenType stop_types[] = {TokenType_R_PAREN};
-        for_node->inc = SY_shunting_yard(&lexer->token_tbl, cond_end_idx+1,
+        for_node->inc = SY_shunting_yard(ctx, &lexer->token_tbl,
+                cond_end_idx+1,
                 stop_types, sizeof(stop_types)/sizeof(stop_types[0]),
-                &r_paren_idx, &vars, bp, false, &typedefs, true);
+                &r_paren_idx, bp, false, true);
     }
     if (r_paren_idx >= lexer->token_tbl.size) {
-        ErrMsg_print(ErrMsg_on, &Parser_error_occurred,
-                lexer->token_tbl.elems[for_idx].file_path,
+        ErrMsg_print(ctx, ErrMsg_on, &ctx->parser_error_occurred,
+                TokenList_pos(&lexer->token_tbl, for_idx).file_path,
                 "expected a ')' after the 3rd for statement expression on line"
-                " %u\n", lexer->token_tbl.elems[for_idx].line_num);
-        ForNode_free_w_self(for_node);
-        return skip_to_token_type_alt(for_idx, lexer->token_tbl,
+                " %u\n", TokenList_pos(&lexer->token_tbl, for_idx).line_num);
+        return skip_to_token_type_alt(for_idx, &lexer->token_tbl,
                 TokenType_SEMICOLON);
     }
 
     if (r_paren_idx+1 < lexer->token_tbl.size &&
-            lexer->token_tbl.elems[r_paren_idx+1].type ==
+            lexer->token_tbl.types[r_paren_idx+1] ==
             TokenType_SEMICOLON) {
-        ASTNodeList_push_back(&block->nodes, ASTNode_create(
-                    lexer->token_tbl.elems[for_idx].line_num,
-                    lexer->token_tbl.elems[for_idx].column_num,
+        ASTNodeList_push_back(&block->nodes, create_node(lexer, for_idx,
                     ASTType_FOR_STMT, for_node
                     ));
         return r_paren_idx+1;
     }
     else if (r_paren_idx+2 >= lexer->token_tbl.size) {
-        ErrMsg_print(ErrMsg_on, &Parser_error_occurred,
-                lexer->token_tbl.elems[for_idx].file_path,
+        ErrMsg_print(ctx, ErrMsg_on, &ctx->parser_error_occurred,
+                TokenList_pos(&lexer->token_tbl, for_idx).file_path,
                 "expected a block after the for statement on line %u.\n",
-                lexer->token_tbl.elems[for_idx].line_num);
-        ForNode_free_w_self(for_node);
-        return skip_to_token_type_alt(for_idx, lexer->token_tbl,
+                TokenList_pos(&lexer->token_tbl, for_idx).line_num);
+        return skip_to_token_type_alt(for_idx, &lexer->token_tbl,
                 TokenType_SEMICOLON);
     }
 
-    for_node->body_in_block = lexer->token_tbl.elems[r_paren_idx+1].type ==
+    for_node->body_in_block = lexer->token_tbl.types[r_paren_idx+1] ==
         TokenType_L_CURLY;
     {
         u32 body_start_idx = r_paren_idx+1+for_node->body_in_block;
         bool missing_r_curly;
-        for_node->body = parse(lexer, parent_func,
+        for_node->body = parse(ctx, lexer, parent_func,
                 for_node->body_in_block ? sp-m_TypeSize_stack_frame_size : bp,
                 for_node->body_in_block ? sp-m_TypeSize_stack_frame_size : sp,
                 body_start_idx, &end_idx,
@@ -1001,13 +1063,12 @@ u32 parse_for_stmt(const struct Lexer *lexer, struct BlockNode *block,
                 !for_node->body_in_block);
 
         if (!missing_r_curly && for_node->body_in_block)
-            check_if_missing_r_curly(lexer, body_start_idx, end_idx, false,
+            check_if_missing_r_curly(ctx, lexer, body_start_idx, end_idx,
+                    false,
                     NULL);
     }
 
-    ASTNodeList_push_back(&block->nodes, ASTNode_create(
-                lexer->token_tbl.elems[for_idx].line_num,
-                lexer->token_tbl.elems[for_idx].column_num,
+    ASTNodeList_push_back(&block->nodes, create_node(lexer, for_idx,
                 ASTType_FOR_STMT, for_node
                 ));
 
@@ -1015,54 +1076,56 @@ u32 parse_for_stmt(const struct Lexer *lexer, struct BlockNode *block,
 
 }
 
-u32 parse_typedef(const struct Lexer *lexer, u32 typedef_idx) {
+u32 parse_typedef(struct CompilerCtx *ctx, const struct Lexer *lexer,
+        u32 typedef_idx) {
 
     u32 conv_type_idx = typedef_idx+1;
 
-    char *type_name = NULL;
+    u32 type_name;
 
     enum PrimitiveType conv_type;
     unsigned conv_lvls_of_indir;
     struct TypeModifiers conv_mods;
-    unsigned type_name_idx = TypeSpec_read(&lexer->token_tbl, conv_type_idx,
-            &conv_type, &conv_lvls_of_indir, &conv_mods, &typedefs,
-            &Parser_error_occurred); 
-
-    if (lexer->token_tbl.elems[type_name_idx].type != TokenType_IDENT) {
-        ErrMsg_print(ErrMsg_on, &Parser_error_occurred,
-                lexer->token_tbl.elems[typedef_idx].file_path,
+    unsigned type_name_idx = TypeSpec_read(ctx, &lexer->token_tbl,
+            conv_type_idx,
+            &conv_type, &conv_lvls_of_indir, &conv_mods, &ctx->typedefs,
+            &ctx->parser_error_occurred); 
+
+    if (lexer->token_tbl.types[type_name_idx] != TokenType_IDENT) {
+        ErrMsg_print(ctx, ErrMsg_on, &ctx->parser_error_occurred,
+                TokenList_pos(&lexer->token_tbl, typedef_idx).file_path,
                 "expected an identifier at the end of the typedef on"
-                " line %u.\n", lexer->token_tbl.elems[typedef_idx].line_num);
-        return skip_to_token_type_alt(typedef_idx, lexer->token_tbl,
+                " line %u.\n",
+                TokenList_pos(&lexer->token_tbl, typedef_idx).line_num);
+        return skip_to_token_type_alt(typedef_idx, &lexer->token_tbl,
                 TokenType_SEMICOLON);
     }
 
-    type_name = Token_src(&lexer->token_tbl.elems[type_name_idx]);
+    type_name = TokenList_sym(&lexer->token_tbl, type_name_idx);
 
-    if (Ident_type_spec(type_name, &typedefs) != PrimType_INVALID &&
-            (Ident_type_spec(type_name, &typedefs) != conv_type ||
-             Ident_type_lvls_of_indir(type_name, &typedefs) !=
+    if (Ident_type_spec(type_name, &ctx->typedefs) != PrimType_INVALID &&
+            (Ident_type_spec(type_name, &ctx->typedefs) != conv_type ||
+             Ident_type_lvls_of_indir(type_name, &ctx->typedefs) !=
              conv_lvls_of_indir)) {
         /* the type already exists and doesn't match the typedef */
-        ErrMsg_print(ErrMsg_on, &Parser_error_occurred,
-                lexer->token_tbl.elems[type_name_idx].file_path,
+        ErrMsg_print(ctx, ErrMsg_on, &ctx->parser_error_occurred,
+                TokenList_pos(&lexer->token_tbl, type_name_idx).file_path,
                 "type '%s' redefined to a different type on line %u,"
-                " column %u.\n", type_name,
-                lexer->token_tbl.elems[type_name_idx].line_num,
-                lexer->token_tbl.elems[type_name_idx].column_num);
-        m_free(type_name);
+                " column %u.\n", Interner_str(&ctx->syms, type_name),
+                TokenList_pos(&lexer->token_tbl, type_name_idx).line_num,
+                TokenList_pos(&lexer->token_tbl, type_name_idx).column_num);
     }
     else {
-        TypedefList_push_back(&typedefs, Typedef_create(type_name, conv_type,
+        TypedefList_push_back(&ctx->typedefs, Typedef_create(type_name,
+                conv_type,
                     conv_lvls_of_indir, conv_mods));
-        type_name = NULL;
     }
 
-    if (lexer->token_tbl.elems[type_name_idx+1].type != TokenType_SEMICOLON) {
-        ErrMsg_print(ErrMsg_on, &Parser_error_occurred,
-                lexer->token_tbl.elems[type_name_idx].file_path,
+    if (lexer->token_tbl.types[type_name_idx+1] != TokenType_SEMICOLON) {
+        ErrMsg_print(ctx, ErrMsg_on, &ctx->parser_error_occurred,
+                TokenList_pos(&lexer->token_tbl, type_name_idx).file_path,
                 "missing semicolon on line %u.\n",
-                lexer->token_tbl.elems[type_name_idx].line_num);
+                TokenList_pos(&lexer->token_tbl, type_name_idx).line_num);
     }
 
     return type_name_idx+1;
@@ -1072,21 +1135,22 @@ u32 parse_typedef(const struct Lexer *lexer, u32 typedef_idx) {
 /*
  * n_instr_to_parse   - if set to 0, parses any nr of instructions.
  */
-static struct BlockNode* parse(const struct Lexer *lexer,
+static struct BlockNode* parse(struct CompilerCtx *ctx,
+        const struct Lexer *lexer,
         struct FuncDeclNode *parent_func, u32 bp, u32 sp, u32 block_start_idx,
         u32 *end_idx, unsigned n_blocks_deep, bool *missing_r_curly,
         bool detect_missing_curly, u32 n_instr_to_parse) {
 
     u32 n_instrs_parsed = m_u32_max;  /* wraps around to 0 later */
 
-    u32 old_vars_size = vars.size;
-    u32 old_typedefs_size = typedefs.size;
+    u32 old_vars_size = ctx->vars.size;
+    u32 old_typedefs_size = ctx->typedefs.size;
 
     /* var declarations are only allowed at the top of the scope */
     bool can_decl_vars = true;
 
     u32 prev_end_idx = block_start_idx-1;
-    struct BlockNode *block = safe_malloc(sizeof(*block));
+    struct BlockNode *block = Arena_alloc(&ctx->ast_arena, sizeof(*block));
     *block = BlockNode_init();
 
     if (missing_r_curly)
@@ -1095,7 +1159,7 @@ static struct BlockNode* parse(const struct Lexer *lexer,
     while (prev_end_idx+1 < lexer->token_tbl.size) {
 
         u32 start_idx = prev_end_idx+1;
-        char *token_src = NULL;
+        u32 start_sym;
         bool declared_var = false;
 
         ++n_instrs_parsed;
@@ -1103,123 +1167,121 @@ static struct BlockNode* parse(const struct Lexer *lexer,
             break;
         }
 
-        token_src = Token_src(&lexer->token_tbl.elems[start_idx]);
+        start_sym = TokenList_sym(&lexer->token_tbl, start_idx);
 
-        if (lexer->token_tbl.elems[start_idx].type == TokenType_L_CURLY) {
-            struct BlockNode *new_block = parse(lexer, parent_func,
+        if (lexer->token_tbl.types[start_idx] == TokenType_L_CURLY) {
+            struct BlockNode *new_block = parse(ctx, lexer, parent_func,
                     sp-m_TypeSize_stack_frame_size,
                     sp-m_TypeSize_stack_frame_size, start_idx+1,
                     &prev_end_idx, n_blocks_deep+1, NULL, true, 0);
-            ASTNodeList_push_back(&block->nodes, ASTNode_create(
-                        lexer->token_tbl.elems[start_idx].line_num,
-                        lexer->token_tbl.elems[start_idx].column_num,
-                        ASTType_BLOCK, new_block));
-            check_if_missing_r_curly(lexer, block_start_idx, prev_end_idx,
+            ASTNodeList_push_back(&block->nodes,
+                    create_node(lexer, start_idx, ASTType_BLOCK, new_block));
+            check_if_missing_r_curly(ctx, lexer, block_start_idx, prev_end_idx,
                     true, missing_r_curly);
         }
-        else if (lexer->token_tbl.elems[start_idx].type == TokenType_R_CURLY) {
-            m_free(token_src);
+        else if (lexer->token_tbl.types[start_idx] == TokenType_R_CURLY) {
             prev_end_idx = start_idx;
             break;
         }
-        else if (strcmp(token_src, "return") == 0) {
+        else if (start_sym == IdentSym_RETURN) {
             prev_end_idx =
-                parse_ret_stmt(lexer, block, bp, start_idx, parent_func,
+                parse_ret_stmt(ctx, lexer, block, bp, start_idx, parent_func,
                         n_blocks_deep);
         }
-        else if (Ident_type_spec(token_src, &typedefs) != PrimType_INVALID ||
-                Ident_modifier_str_to_tok(token_src) != TokenType_NONE) {
-            unsigned ident_idx = TypeSpec_read(&lexer->token_tbl, start_idx,
-                    NULL, NULL, NULL, &typedefs, &Parser_error_occurred);
+        else if (Ident_type_spec(start_sym,
+                &ctx->typedefs) != PrimType_INVALID ||
+                Token_is_type_modifier(lexer->token_tbl.types[start_idx])) {
+            unsigned ident_idx = TypeSpec_read(ctx, &lexer->token_tbl,
+                    start_idx,
+                    NULL, NULL, NULL, &ctx->typedefs,
+                    &ctx->parser_error_occurred);
 
             /* should probably move this into it's own function at some
              * point */
             if (ident_idx+1 >= lexer->token_tbl.size ||
-                    lexer->token_tbl.elems[ident_idx+1].type !=
+                    lexer->token_tbl.types[ident_idx+1] !=
                     TokenType_L_PAREN) {
                 u32 old_sp = sp;
                 struct VarDeclNode *var_decl = NULL;
 
                 if (!can_decl_vars) {
-                    ErrMsg_print(ErrMsg_on, &Parser_error_occurred,
-                            lexer->token_tbl.elems[start_idx].file_path,
+                    struct TokenPos pos = TokenList_pos(&lexer->token_tbl,
+                            start_idx);
+                    ErrMsg_print(ctx, ErrMsg_on, &ctx->parser_error_occurred,
+                            pos.file_path,
                             "mixing declarations and code is a C99"
-                            " extension. line %u.\n",
-                            lexer->token_tbl.elems[start_idx].line_num);
+                            " extension. line %u.\n", pos.line_num);
                 }
 
-                var_decl = parse_var_decl(lexer,
+                var_decl = parse_var_decl(ctx, lexer,
                         start_idx, &prev_end_idx, bp, &sp, false, NULL, block);
                 ASTNodeList_push_back(&block->nodes,
-                        ASTNode_create(
-                            lexer->token_tbl.elems[start_idx].line_num,
-                            lexer->token_tbl.elems[start_idx].column_num,
-                            ASTType_VAR_DECL, var_decl));
+                        create_node(lexer, start_idx, ASTType_VAR_DECL,
+                            var_decl));
                 block->var_bytes = block->var_bytes + old_sp-sp;
                 declared_var = true;
             }
-            else if (lexer->token_tbl.elems[ident_idx+1].type ==
+            else if (lexer->token_tbl.types[ident_idx+1] ==
                     TokenType_L_PAREN) {
-                parse_func_decl(lexer, block,
-                        start_idx, &prev_end_idx, bp);
+                parse_func_decl(ctx, lexer, block,
+                        start_idx, &prev_end_idx, bp, n_blocks_deep == 0);
             }
             else {
-                ErrMsg_print(ErrMsg_on, &Parser_error_occurred,
-                        lexer->token_tbl.elems[ident_idx+1].file_path,
+                struct TokenPos pos = TokenList_pos(&lexer->token_tbl,
+                        ident_idx+1);
+                char *token_src = TokenList_src(&lexer->token_tbl, start_idx);
+                ErrMsg_print(ctx, ErrMsg_on, &ctx->parser_error_occurred,
+                        pos.file_path,
                         "invalid token '%s' after variable declaration."
-                        " line %u, column %u.", token_src,
-                        lexer->token_tbl.elems[ident_idx+1].line_num,
-                        lexer->token_tbl.elems[ident_idx+1].column_num);
+                        " line %u, column %u.", token_src, pos.line_num,
+                        pos.column_num);
+                m_free(token_src);
             }
         }
 
-        else if (lexer->token_tbl.elems[start_idx].type == TokenType_IF_STMT) {
-            prev_end_idx = parse_if_stmt(lexer, block, n_blocks_deep,
+        else if (lexer->token_tbl.types[start_idx] == TokenType_IF_STMT) {
+            prev_end_idx = parse_if_stmt(ctx, lexer, block, n_blocks_deep,
                     start_idx, bp, sp, parent_func);
         }
 
-        else if (lexer->token_tbl.elems[start_idx].type ==
+        else if (lexer->token_tbl.types[start_idx] ==
                 TokenType_WHILE_STMT) {
-            prev_end_idx = parse_while_stmt(lexer, block, n_blocks_deep,
+            prev_end_idx = parse_while_stmt(ctx, lexer, block, n_blocks_deep,
                     start_idx, bp, sp, parent_func);
         }
 
-        else if (lexer->token_tbl.elems[start_idx].type ==
+        else if (lexer->token_tbl.types[start_idx] ==
                 TokenType_FOR_STMT) {
-            prev_end_idx = parse_for_stmt(lexer, block, n_blocks_deep,
+            prev_end_idx = parse_for_stmt(ctx, lexer, block, n_blocks_deep,
                     start_idx, bp, sp, parent_func);
         }
 
-        else if (lexer->token_tbl.elems[start_idx].type ==
+        else if (lexer->token_tbl.types[start_idx] ==
                 TokenType_TYPEDEF) {
-            prev_end_idx = parse_typedef(lexer, start_idx);
+            prev_end_idx = parse_typedef(ctx, lexer, start_idx);
         }
 
-        else if (lexer->token_tbl.elems[start_idx].type ==
+        else if (lexer->token_tbl.types[start_idx] ==
                 TokenType_DEBUG_PRINT_RAX) {
             struct DebugPrintRAX *debug_node =
-                safe_malloc(sizeof(*debug_node));
+                Arena_alloc(&ctx->ast_arena, sizeof(*debug_node));
             ASTNodeList_push_back(&block->nodes,
-                    ASTNode_create(lexer->token_tbl.elems[start_idx].line_num,
-                        lexer->token_tbl.elems[start_idx].column_num,
-                        ASTType_DEBUG_RAX, debug_node));
+                    create_node(lexer, start_idx, ASTType_DEBUG_RAX,
+                        debug_node));
             prev_end_idx = start_idx+1;
         }
 
         else {
-            struct Expr *expr = parse_expr(
+            struct Expr *expr = parse_expr(ctx, 
                     lexer, start_idx, &prev_end_idx, bp);
-            struct ExprNode *node = safe_malloc(sizeof(*node));
+            struct ExprNode *node = Arena_alloc(&ctx->ast_arena,
+                    sizeof(*node));
             node->expr = expr;
 
             ASTNodeList_push_back(&block->nodes,
-                    ASTNode_create(lexer->token_tbl.elems[start_idx].line_num,
-                        lexer->token_tbl.elems[start_idx].column_num,
-                        ASTType_EXPR, node));
+                    create_node(lexer, start_idx, ASTType_EXPR, node));
         }
 
-        free(token_src);
-
         /* check if there is a parent function cuz global variables can be
          * declared anywhere */
         if (!declared_var && parent_func) {
@@ -1233,45 +1295,95 @@ static struct BlockNode* parse(const struct Lexer *lexer,
 
     block->var_bytes = round_up(block->var_bytes,
             m_TypeSize_stack_min_alignment);
+    m_arena_take_vec(&ctx->ast_arena, block->nodes);
 
     if (n_blocks_deep == 1 && detect_missing_curly &&
-            lexer->token_tbl.elems[prev_end_idx].type != TokenType_R_CURLY) {
+            lexer->token_tbl.types[prev_end_idx] != TokenType_R_CURLY) {
         if (missing_r_curly)
             *missing_r_curly = true;
-        ErrMsg_print(ErrMsg_on, &Parser_error_occurred,
-                lexer->token_tbl.elems[prev_end_idx].file_path,
+        ErrMsg_print(ctx, ErrMsg_on, &ctx->parser_error_occurred,
+                TokenList_pos(&lexer->token_tbl, prev_end_idx).file_path,
                 "missing a '{' to go with the '}' on line %u, column %u\n",
-                lexer->token_tbl.elems[prev_end_idx].line_num,
-                lexer->token_tbl.elems[prev_end_idx].column_num);
+                TokenList_pos(&lexer->token_tbl, prev_end_idx).line_num,
+                TokenList_pos(&lexer->token_tbl, prev_end_idx).column_num);
     }
 
-    while (vars.size > old_vars_size)
-        ParVarList_pop_back(&vars, ParserVar_free);
-    assert(vars.size == old_vars_size);
+    while (ctx->vars.size > old_vars_size)
+        ParVarList_pop_back(&ctx->vars, NULL);
+    assert(ctx->vars.size == old_vars_size);
 
-    while (typedefs.size > old_typedefs_size)
-        TypedefList_pop_back(&typedefs, Typedef_free);
-    assert(typedefs.size == old_typedefs_size);
+    while (ctx->typedefs.size > old_typedefs_size)
+        TypedefList_pop_back(&ctx->typedefs, NULL);
+    assert(ctx->typedefs.size == old_typedefs_size);
 
     return block;
 
 }
 
-struct BlockNode* Parser_parse(const struct Lexer *lexer) {
+/* fills in ctx->defined_funcs for -fstream-funcs. a func definition at the
+ * top level is a name followed by its args and a '{', which the tokens alone
+ * are enough to go by */
+static void find_defined_funcs(struct CompilerCtx *ctx,
+        const struct TokenList *tokens) {
+
+    struct SymFlagList *defined = &ctx->defined_funcs;
+    u32 n_curlies_deep = 0;
+    u32 i;
+
+    SymFlagList_clear(defined, NULL);
+    SymFlagList_reserve(defined, ctx->syms.entries.size);
+    memset(defined->elems, false, ctx->syms.entries.size*sizeof(bool));
+    defined->size = ctx->syms.entries.size;
+
+    for (i = 0; i+1 < tokens->size; i++) {
+        u32 n_parens_deep = 0;
+        u32 sym = m_interner_no_id;
+
+        if (tokens->types[i] == TokenType_L_CURLY)
+            ++n_curlies_deep;
+        else if (tokens->types[i] == TokenType_R_CURLY && n_curlies_deep > 0)
+            --n_curlies_deep;
+
+        if (n_curlies_deep > 0 || tokens->types[i+1] != TokenType_L_PAREN)
+            continue;
+
+        sym = TokenList_sym(tokens, i);
+        if (sym == m_interner_no_id)
+            continue;
+
+        /* to the ')' closing the args */
+        for (++i; i < tokens->size; i++) {
+            if (tokens->types[i] == TokenType_L_PAREN)
+                ++n_parens_deep;
+            else if (tokens->types[i] == TokenType_R_PAREN &&
+                    --n_parens_deep == 0)
+                break;
+        }
+
+        if (i+1 < tokens->size && tokens->types[i+1] == TokenType_L_CURLY &&
+                sym < defined->size)
+            defined->elems[sym] = true;
+    }
+
+}
+
+struct BlockNode* Parser_parse(struct CompilerCtx *ctx,
+        const struct Lexer *lexer) {
 
     u32 bp = 0;
     struct BlockNode *root = NULL;
 
-    vars = ParVarList_init();
-    typedefs = TypedefList_init();
-    Parser_error_occurred = false;
+    ctx->parser_error_occurred = false;
+    ctx->exprs.tokens = &lexer->token_tbl;
+    if (ctx->func_parsed)
+        find_defined_funcs(ctx, &lexer->token_tbl);
 
-    root = parse(lexer, NULL, bp, bp, 0, NULL, 0, NULL, true, 0);
+    root = parse(ctx, lexer, NULL, bp, bp, 0, NULL, 0, NULL, true, 0);
 
-    assert(vars.size == 0);
-    ParVarList_free(&vars);
-    assert(typedefs.size == 0);
-    TypedefList_free(&typedefs);
+    assert(ctx->vars.size == 0);
+    ParVarList_free(&ctx->vars);
+    assert(ctx->typedefs.size == 0);
+    TypedefList_free(&ctx->typedefs);
     return root;
 
 }
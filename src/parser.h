@@ -3,6 +3,7 @@
 #include "ast.h"
 #include "lexer.h"
 
-extern bool Parser_error_occurred;
+struct CompilerCtx;
 
-struct BlockNode* Parser_parse(const struct Lexer *lexer);
+struct BlockNode* Parser_parse(struct CompilerCtx *ctx,
+        const struct Lexer *lexer);
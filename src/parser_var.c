@@ -1,13 +1,13 @@
 #include "parser_var.h"
+#include "interner.h"
 #include "type_mods.h"
-#include <string.h>
 
 struct ParserVar ParserVar_init(void) {
 
     struct ParserVar var;
     var.line_num = 0;
     var.column_num = 0;
-    var.name = NULL;
+    var.name = m_interner_no_id;
     var.lvls_of_indir = 0;
     var.mods = TypeModifiers_init();
     var.type = PrimType_INVALID;
@@ -25,7 +25,7 @@ struct ParserVar ParserVar_init(void) {
 }
 
 struct ParserVar ParserVar_create(unsigned line_num, unsigned column_num,
-        char *name, unsigned lvls_of_indir, struct TypeModifiers mods,
+        u32 name, unsigned lvls_of_indir, struct TypeModifiers mods,
         enum PrimitiveType type,
         bool is_array, u32 array_len, u32 stack_pos,
         struct VarDeclPtrList *args, bool variadic_args, bool void_args,
@@ -52,20 +52,14 @@ struct ParserVar ParserVar_create(unsigned line_num, unsigned column_num,
 
 }
 
-void ParserVar_free(struct ParserVar var) {
-
-    m_free(var.name);
-
-}
-
-u32 ParVarList_find_var(const struct ParVarList *self, char *name) {
+u32 ParVarList_find_var(const struct ParVarList *self, u32 name) {
 
     u32 i;
 
     /* counting down to start from the current scope. makes variable shadowing
      * work */
     for (i = self->size-1; i < self->size; i--) {
-        if (strcmp(self->elems[i].name, name) == 0)
+        if (self->elems[i].name == name)
             return i;
     }
 
@@ -73,4 +67,4 @@ u32 ParVarList_find_var(const struct ParVarList *self, char *name) {
 
 }
 
-m_define_VectorImpl_funcs(ParVarList, struct ParserVar)
+m_define_VectorImpl_funcs(ParVarList, struct ParserVar, MemTag_SYMBOLS)
@@ -9,7 +9,8 @@
 struct ParserVar {
 
     unsigned line_num, column_num;
-    char *name;
+    /* the interned id of the name */
+    u32 name;
     unsigned lvls_of_indir;
     struct TypeModifiers mods;
     enum PrimitiveType type;
@@ -32,12 +33,11 @@ struct ParserVar {
 
 struct ParserVar ParserVar_init(void);
 struct ParserVar ParserVar_create(unsigned line_num, unsigned column_num,
-        char *name, unsigned lvls_of_indir, struct TypeModifiers mods,
+        u32 name, unsigned lvls_of_indir, struct TypeModifiers mods,
         enum PrimitiveType type,
         bool is_array, u32 array_len, u32 stack_pos,
         struct VarDeclPtrList *args, bool variadic_args, bool void_args,
         bool has_been_defined, bool is_func_arg, void *parent);
-void ParserVar_free(struct ParserVar var);
 
 struct ParVarList {
 
@@ -50,4 +50,4 @@ struct ParVarList {
 m_declare_VectorImpl_funcs(ParVarList, struct ParserVar)
 
 /* returns m_u32_max if there is no var in the current scope by that name */
-u32 ParVarList_find_var(const struct ParVarList *self, char *name);
+u32 ParVarList_find_var(const struct ParVarList *self, u32 name);
@@ -1,73 +1,258 @@
 #include "pre_proc.h"
+#include "comp_ctx.h"
+#include "interner.h"
 #include "comp_dependent/ints.h"
 #include "safe_mem.h"
 #include "vector_impl.h"
 #include "bool.h"
 #include "err_msg.h"
+#include "lexer.h"
+#include "file_cache.h"
 #include <ctype.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
 
-bool PreProc_error_occurred = false;
-
 struct PreProcMacro PreProcMacro_init(void) {
 
     struct PreProcMacro macro;
-    macro.name = NULL;
-    macro.expansion = NULL;
+    macro.name = m_interner_no_id;
+    macro.text = 0;
+    macro.text_len = 0;
+    macro.first_token = 0;
+    macro.n_tokens = 0;
+    macro.lexed = false;
+    macro.src = NULL;
+    macro.file_path = NULL;
+    macro.line_num = 0;
+    macro.column_num = 0;
+    macro.func_like = false;
+    macro.first_param = 0;
+    macro.n_params = 0;
+    macro.first_use = 0;
+    macro.n_uses = 0;
+    macro.expanding = false;
+    macro.n_macros_clean = 0;
     return macro;
 
 }
 
-struct PreProcMacro PreProcMacro_create(char *name, char *expansion) {
+struct PreProcMacro PreProcMacro_create(u32 name, u32 text, u32 text_len,
+        u32 first_token, u32 n_tokens) {
 
-    struct PreProcMacro macro;
+    struct PreProcMacro macro = PreProcMacro_init();
     macro.name = name;
-    macro.expansion = expansion;
+    macro.text = text;
+    macro.text_len = text_len;
+    macro.first_token = first_token;
+    macro.n_tokens = n_tokens;
     return macro;
 
 }
 
-void PreProcMacro_free(struct PreProcMacro macro) {
-
-    m_free(macro.name);
-    m_free(macro.expansion);
-
-}
-
 struct MacroInstance MacroInstance_init(void) {
 
     struct MacroInstance macro;
-    macro.expansion = NULL;
     macro.start_idx = 0;
+    macro.end_idx = 0;
     macro.file_path = NULL;
-    macro.macro = NULL;
+    macro.macro_idx = m_u32_max;
+    macro.include_idx = m_u32_max;
+    macro.first_segment = 0;
+    macro.n_segments = 0;
     return macro;
 
 }
 
-struct MacroInstance MacroInstance_create(char *expansion, u32 start_idx,
-        const char *file_path, const struct PreProcMacro *macro) {
+struct MacroInstance MacroInstance_create(u32 start_idx, u32 end_idx,
+        const char *file_path, u32 macro_idx, u32 first_segment,
+        u32 n_segments) {
 
     struct MacroInstance macro_inst;
-    macro_inst.expansion = expansion;
     macro_inst.start_idx = start_idx;
+    macro_inst.end_idx = end_idx;
     macro_inst.file_path = file_path;
-    macro_inst.macro = macro;
+    macro_inst.macro_idx = macro_idx;
+    macro_inst.include_idx = m_u32_max;
+    macro_inst.first_segment = first_segment;
+    macro_inst.n_segments = n_segments;
     return macro_inst;
 
 }
 
-void MacroInstance_free(struct MacroInstance macro) {
+void MacroInclude_free(struct MacroInclude include) {
 
-    m_free(macro.expansion);
+    MacroInstList_free(&include.insts);
 
 }
 
-m_define_VectorImpl_funcs(PreProcMacroList, struct PreProcMacro)
-m_define_VectorImpl_funcs(MacroInstList, struct MacroInstance)
+/* the index of the macro every identifier names, by its interned id. macro
+ * names get interned when they're defined, so looking an identifier up is a
+ * probe of the interner's hash table straight from the source, with no copy
+ * of the identifier and no string compares against every macro. */
+struct MacroIdxList {
+
+    u32 *elems;
+    u32 size;
+    u32 capacity;
+
+};
+
+/* the interned ids of the parameters of every function-like macro */
+struct MacroParamList {
+
+    u32 *elems;
+    u32 size;
+    u32 capacity;
+
+};
+
+/* a function-like macro's parameter in its tokens, the token at index token
+ * in the macro token list being parameter param of the macro */
+struct MacroParamUse {
+
+    u32 token;
+    u32 param;
+
+};
+
+struct MacroParamUseList {
+
+    struct MacroParamUse *elems;
+    u32 size;
+    u32 capacity;
+
+};
+
+/* an argument given to a function-like macro. the raw tokens go from start up
+ * to end in the list the macro was used in, the fully expanded ones from
+ * exp_start up to exp_end in the preprocessor's args. */
+struct MacroArg {
+
+    u32 start;
+    u32 end;
+    u32 exp_start;
+    u32 exp_end;
+
+};
+
+struct MacroArgList {
+
+    struct MacroArg *elems;
+    u32 size;
+    u32 capacity;
+
+};
+
+/* an #ifdef or #ifndef that hasn't been closed yet */
+struct MacroCond {
+
+    /* whether the group being read now gets kept */
+    bool keep;
+    /* whether a group has been kept already, or none of them can be since
+     * the whole conditional is in a group that's left out */
+    bool done;
+    bool had_else;
+    unsigned line_num;
+
+};
+
+struct MacroCondList {
+
+    struct MacroCond *elems;
+    u32 size;
+    u32 capacity;
+
+};
+
+/* per file in the file cache, by its id */
+struct MacroFileFlagList {
+
+    bool *elems;
+    u32 size;
+    u32 capacity;
+
+};
+
+m_declare_VectorImpl_funcs(MacroIdxList, u32)
+m_declare_VectorImpl_funcs(MacroParamList, u32)
+m_declare_VectorImpl_funcs(MacroParamUseList, struct MacroParamUse)
+m_declare_VectorImpl_funcs(MacroArgList, struct MacroArg)
+m_declare_VectorImpl_funcs(MacroCondList, struct MacroCond)
+m_declare_VectorImpl_funcs(MacroFileFlagList, bool)
+
+m_define_VectorImpl_funcs(PreProcMacroList, struct PreProcMacro, MemTag_PREPROC)
+m_define_VectorImpl_funcs(MacroSegmentList, struct MacroSegment,
+        MemTag_PREPROC)
+m_define_VectorImpl_funcs(MacroInstList, struct MacroInstance, MemTag_PREPROC)
+m_define_VectorImpl_funcs(MacroIdxList, u32, MemTag_PREPROC)
+m_define_VectorImpl_funcs(MacroParamList, u32, MemTag_PREPROC)
+m_define_VectorImpl_funcs(MacroParamUseList, struct MacroParamUse,
+        MemTag_PREPROC)
+m_define_VectorImpl_funcs(MacroArgList, struct MacroArg, MemTag_PREPROC)
+m_define_VectorImpl_funcs(MacroIncludeList, struct MacroInclude,
+        MemTag_PREPROC)
+m_define_VectorImpl_funcs(MacroCondList, struct MacroCond, MemTag_PREPROC)
+m_define_VectorImpl_funcs(MacroFileFlagList, bool, MemTag_PREPROC)
+
+/* how deep #includes can go, a file including itself would go forever */
+#define m_max_include_depth 200
+
+/* everything a run of the preprocessor works with */
+struct PreProc {
+
+    struct CompilerCtx *ctx;
+    /* the file being read, which changes while an #include gets read. its
+     * text's offsets start at src_offset, that's 0 for the main file. file_id
+     * is its id in the file cache, m_u32_max for the main file */
+    const char *src;
+    u32 src_len;
+    const char *file_path;
+    u32 src_offset;
+    u32 file_id;
+    u32 include_depth;
+
+    struct PreProcMacroList *macros;
+    struct MacroIdxList macro_idxs;
+    struct MacroParamList params;
+    /* where the function-like macros' tokens use their parameters, so an
+     * instance getting spliced doesn't have to look at every token */
+    struct MacroParamUseList param_uses;
+    /* the macros' tokens, the arguments they got, what the instances that
+     * had to be expanded token by token expand to, and the text of it all.
+     * all the offsets past src_len are into its expansions. */
+    struct TokenList *macro_tokens;
+    struct MacroSegmentList *macro_segments;
+    /* the instances of the file being read */
+    struct MacroInstList *macro_insts;
+    struct MacroIncludeList *includes;
+
+    /* the conditionals that are open, innermost last. the ones from
+     * file_conds on are in the file being read. the group being left out,
+     * if there is one, starts at the directive at skip_start. */
+    struct MacroCondList conds;
+    u32 file_conds;
+    u32 skip_start;
+    /* the files that had a #pragma once */
+    struct MacroFileFlagList once;
+
+    /* scratch space for expanding an instance, emptied after each one. the
+     * macros get their arguments substituted in on top of work, which is
+     * used as a stack. args has the expanded arguments, arg_stack says where
+     * each one is, and text is where the text of a token made by # or ## gets
+     * put together. */
+    struct TokenList work;
+    struct TokenList args;
+    struct MacroArgList arg_stack;
+    struct TokenTextList text;
+
+    /* where the instance being expanded is */
+    u32 use_offset;
+    unsigned use_line_num;
+    unsigned use_column_num;
+
+};
 
 static bool valid_ident_start_char(char c) {
 
@@ -96,32 +281,134 @@ static unsigned get_identifier_len(const char *ident_start) {
 
 }
 
-static char *sub_str(const char *str, u32 start, u32 len) {
+/* the column src[idx] is on */
+static unsigned column_of(const char *src, u32 idx) {
+
+    u32 line_start = idx;
+
+    while (line_start > 0 && src[line_start-1] != '\n')
+        --line_start;
+
+    return idx-line_start+1;
+
+}
+
+/* the idx of the quote closing the string or char starting at src[quote_idx].
+ * stops at the end of the line if it isn't closed, the lexer complains about
+ * that. */
+static u32 skip_quoted(const char *src, u32 src_len, u32 quote_idx) {
+
+    u32 src_i = quote_idx+1;
 
-    char *new_str = safe_malloc((len+1)*sizeof(*new_str));
-    strncpy(new_str, &str[start], len);
-    new_str[len] = '\0';
+    while (src_i < src_len && src[src_i] != src[quote_idx] &&
+            src[src_i] != '\n') {
+        if (src[src_i] == '\\' && src_i+1 < src_len)
+            ++src_i;
+        ++src_i;
+    }
 
-    return new_str;
+    return src_i;
 
 }
 
-static char* make_str_copy(const char *str) {
+/* the idx of the '\n' ending the line src[idx] is on, src_len if it's the
+ * last line and there isn't one */
+static u32 line_end(const struct PreProc *pp, u32 idx) {
 
-    char *new_str = safe_malloc((strlen(str)+1)*sizeof(*new_str));
-    strcpy(new_str, str);
-    return new_str;
+    const char *end = memchr(&pp->src[idx], '\n', pp->src_len-idx);
+    return end ? (u32)(end-pp->src) : pp->src_len;
 
 }
 
-/* returns m_u32_max if the macro couldn't be found */
-static u32 find_macro(const struct PreProcMacroList *macros,
-        const char *name) {
+static char* copy_string(const char *str) {
+
+    char *copy = safe_malloc((strlen(str)+1)*sizeof(*copy), MemTag_STRINGS);
+    strcpy(copy, str);
+    return copy;
+
+}
+
+/* returns m_u32_max if sym isn't a macro */
+static u32 sym_macro(const struct MacroIdxList *macro_idxs, u32 sym) {
+
+    /* ids past the end of the list got interned after the last #define */
+    if (sym == m_interner_no_id || sym >= macro_idxs->size)
+        return m_u32_max;
+
+    return macro_idxs->elems[sym];
+
+}
+
+/* returns m_u32_max if the identifier of length len at ident isn't a macro */
+static u32 find_macro(const struct CompilerCtx *ctx,
+        const struct MacroIdxList *macro_idxs, const char *ident, u32 len) {
+
+    return sym_macro(macro_idxs, Interner_find(&ctx->syms, ident, len));
+
+}
+
+/* macro_idx can be m_u32_max to make sym not a macro anymore */
+static void set_macro(struct MacroIdxList *macro_idxs, u32 sym,
+        u32 macro_idx) {
+
+    while (macro_idxs->size <= sym)
+        MacroIdxList_push_back(macro_idxs, m_u32_max);
+    macro_idxs->elems[sym] = macro_idx;
+
+}
+
+/* whether any of the tokens from start up to end in list names a macro that
+ * could get expanded. if none do, there's nothing to rescan. */
+static bool names_macro(const struct PreProc *pp,
+        const struct TokenList *list, u32 start, u32 end) {
 
     u32 i;
 
-    for (i = 0; i < macros->size; i++) {
-        if (strcmp(name, macros->elems[i].name) == 0)
+    for (i = start; i < end; i++) {
+        u32 macro_idx;
+        if (list->types[i] != TokenType_IDENT)
+            continue;
+        macro_idx = sym_macro(&pp->macro_idxs, list->values[i].sym_id);
+        if (macro_idx != m_u32_max && !pp->macros->elems[macro_idx].expanding)
+            return true;
+    }
+
+    return false;
+
+}
+
+/* lexes text_len chars of text from a macro in the file at file_path onto
+ * the end of tokens. the lexer's errors count as the preprocessor's, it's
+ * the one lexing it */
+static void lex_text(struct PreProc *pp, struct TokenList *tokens,
+        const char *text, u32 text_len, u32 text_offset,
+        const char *file_path, unsigned line_num, unsigned column_num) {
+
+    struct CompilerCtx *ctx = pp->ctx;
+    bool lexer_error_occurred = ctx->lexer_error_occurred;
+
+    ctx->lexer_error_occurred = false;
+    Lexer_lex_macro(ctx, tokens, text, text_len, text_offset, file_path,
+            line_num, column_num);
+    if (ctx->lexer_error_occurred)
+        ctx->preproc_error_occurred = true;
+    ctx->lexer_error_occurred = lexer_error_occurred;
+
+}
+
+/* the index of the macro's parameter token idx in list is, or m_u32_max if it
+ * isn't one */
+static u32 token_param(const struct PreProc *pp,
+        const struct PreProcMacro *macro, const struct TokenList *list,
+        u32 idx) {
+
+    u32 i;
+
+    if (!macro->func_like || list->types[idx] != TokenType_IDENT)
+        return m_u32_max;
+
+    for (i = 0; i < macro->n_params; i++) {
+        if (pp->params.elems[macro->first_param+i] == list->values[idx].sym_id)
             return i;
     }
 
@@ -129,113 +416,1301 @@ static u32 find_macro(const struct PreProcMacroList *macros,
 
 }
 
+/* reads the name after a directive like #define. returns the length of the
+ * name, or 0 if there isn't one */
+static u32 read_macro_name(struct PreProc *pp, u32 dir_end,
+        unsigned line_num, u32 *name_start) {
+
+    struct CompilerCtx *ctx = pp->ctx;
+    const char *src = pp->src;
+
+    *name_start = dir_end;
+    while (isspace(src[*name_start]) && src[*name_start] != '\n')
+        ++*name_start;
+
+    if (!valid_ident_start_char(src[*name_start])) {
+        ErrMsg_print(ctx, ErrMsg_on, &ctx->preproc_error_occurred,
+                pp->file_path, "expected a macro name on line %u.\n",
+                line_num);
+        return 0;
+    }
+
+    return get_identifier_len(&src[*name_start]);
+
+}
+
+/* reads the parameters of a function-like macro, src[paren_idx] being the '('
+ * right after its name. returns the idx after the ')', or m_u32_max if the
+ * parameters are malformed. */
+static u32 read_macro_params(struct PreProc *pp, u32 paren_idx,
+        unsigned line_num, u32 *n_params) {
+
+    struct CompilerCtx *ctx = pp->ctx;
+    const char *src = pp->src;
+    u32 src_i = paren_idx+1;
+
+    *n_params = 0;
+
+    while (src[src_i] != '\n' && isspace(src[src_i]))
+        ++src_i;
+    if (src[src_i] == ')')
+        return src_i+1;
+
+    for (;;) {
+
+        u32 len;
+        u32 param;
+        u32 i;
+
+        while (src[src_i] != '\n' && isspace(src[src_i]))
+            ++src_i;
+
+        if (!valid_ident_start_char(src[src_i])) {
+            ErrMsg_print(ctx, ErrMsg_on, &ctx->preproc_error_occurred,
+                    pp->file_path,
+                    "expected a macro parameter on line %u.\n", line_num);
+            return m_u32_max;
+        }
+
+        len = get_identifier_len(&src[src_i]);
+        param = Interner_intern(&ctx->syms, &src[src_i], len);
+        /* a use of it couldn't tell which argument it is */
+        for (i = pp->params.size-*n_params; i < pp->params.size; i++) {
+            if (pp->params.elems[i] == param) {
+                ErrMsg_print(ctx, ErrMsg_on, &ctx->preproc_error_occurred,
+                        pp->file_path,
+                        "macro parameter '%s' is repeated on line %u.\n",
+                        Interner_str(&ctx->syms, param), line_num);
+                return m_u32_max;
+            }
+        }
+        MacroParamList_push_back(&pp->params, param);
+        ++*n_params;
+        src_i += len;
+
+        while (src[src_i] != '\n' && isspace(src[src_i]))
+            ++src_i;
+
+        if (src[src_i] == ')')
+            return src_i+1;
+        if (src[src_i] != ',') {
+            ErrMsg_print(ctx, ErrMsg_on, &ctx->preproc_error_occurred,
+                    pp->file_path,
+                    "expected a ',' or ')' after a macro parameter on line"
+                    " %u.\n", line_num);
+            return m_u32_max;
+        }
+        ++src_i;
+
+    }
+
+}
+
+/* a '#' has to be followed by a parameter, and a '##' needs something on
+ * both sides. returns false if the macro breaks that */
+static bool check_macro(struct PreProc *pp,
+        const struct PreProcMacro *macro) {
+
+    struct CompilerCtx *ctx = pp->ctx;
+    const struct TokenList *tokens = pp->macro_tokens;
+    u32 end = macro->first_token+macro->n_tokens;
+    u32 i;
+
+    for (i = macro->first_token; i < end; i++) {
+
+        if (tokens->types[i] == TokenType_STRINGIZE && (i+1 == end ||
+                    token_param(pp, macro, tokens, i+1) == m_u32_max)) {
+            ErrMsg_print(ctx, ErrMsg_on, &ctx->preproc_error_occurred,
+                    macro->file_path,
+                    "'#' has to be followed by a macro parameter on line"
+                    " %u.\n", macro->line_num);
+            return false;
+        }
+
+        if (tokens->types[i] == TokenType_TOKEN_PASTE &&
+                (i == macro->first_token || i+1 == end)) {
+            ErrMsg_print(ctx, ErrMsg_on, &ctx->preproc_error_occurred,
+                    macro->file_path,
+                    "'##' can't be at either end of a macro on line %u.\n",
+                    macro->line_num);
+            return false;
+        }
+
+    }
+
+    return true;
+
+}
+
+/* lexes the macro's text onto the end of the macro token list, if it hasn't
+ * been yet */
+static void lex_macro(struct PreProc *pp, struct PreProcMacro *macro) {
+
+    u32 i;
+
+    if (macro->lexed)
+        return;
+
+    macro->lexed = true;
+    macro->first_token = pp->macro_tokens->size;
+    lex_text(pp, pp->macro_tokens, macro->src, macro->text_len, 0,
+            macro->file_path, macro->line_num, macro->column_num);
+    macro->n_tokens = pp->macro_tokens->size-macro->first_token;
+    /* the error's been given, what it expands to doesn't matter anymore */
+    if (!check_macro(pp, macro))
+        macro->n_tokens = 0;
+
+    macro->first_use = pp->param_uses.size;
+    for (i = macro->first_token; i < macro->first_token+macro->n_tokens;
+            i++) {
+        struct MacroParamUse use;
+        use.token = i;
+        use.param = token_param(pp, macro, pp->macro_tokens, i);
+        if (use.param != m_u32_max)
+            MacroParamUseList_push_back(&pp->param_uses, use);
+    }
+    macro->n_uses = pp->param_uses.size-macro->first_use;
+
+}
+
 /* dir_end points to the first character after the define keyword */
-static void read_define_directive(const char *src, u32 dir_end,
-        unsigned line_num, u32 *end_idx, u32 *n_lines, const char *file_path,
-        struct PreProcMacroList *macros) {
+static void read_define_directive(struct PreProc *pp, u32 dir_end,
+        unsigned line_num, u32 *end_idx, u32 *n_lines) {
 
-    u32 name_start = dir_end;
+    const char *src = pp->src;
+    struct TokenList *macro_tokens = pp->macro_tokens;
+
+    u32 name_start;
     u32 name_len;
     u32 name_end; /* next idx after the name */
-    char *name = NULL;
+    u32 name;
 
+    u32 expansion_start;
     u32 expansion_end;
-    char *expansion = NULL;
+    struct PreProcMacro macro;
+    u32 first_param = pp->params.size;
+    u32 n_params = 0;
+    /* only a '(' right after the name makes a function-like macro */
+    bool func_like;
 
     *n_lines = 1;
 
-    while (isspace(src[name_start]) && src[name_start] != '\n')
+    name_len = read_macro_name(pp, dir_end, line_num, &name_start);
+    if (name_len == 0) {
+        *end_idx = line_end(pp, name_start);
+        return;
+    }
+
+    name_end = name_start+name_len;
+    name = Interner_intern(&pp->ctx->syms, &src[name_start], name_len);
+
+    func_like = src[name_end] == '(';
+    expansion_start = name_end;
+    if (func_like) {
+        expansion_start = read_macro_params(pp, name_end, line_num,
+                &n_params);
+        if (expansion_start == m_u32_max) {
+            pp->params.size = first_param;
+            return;
+        }
+    }
+
+    expansion_end = line_end(pp, expansion_start);
+
+    macro = PreProcMacro_create(name,
+            TokenList_add_expansion_text(macro_tokens, &src[expansion_start],
+                expansion_end-expansion_start),
+            expansion_end-expansion_start, 0, 0);
+    macro.src = &src[expansion_start];
+    macro.file_path = pp->file_path;
+    macro.line_num = line_num;
+    macro.column_num = column_of(src, expansion_start);
+    macro.func_like = func_like;
+    macro.first_param = first_param;
+    macro.n_params = n_params;
+
+    /* a redefinition replaces the old macro from here on */
+    PreProcMacroList_push_back(pp->macros, macro);
+    set_macro(&pp->macro_idxs, name, pp->macros->size-1);
+
+}
+
+static void read_undef_directive(struct PreProc *pp, u32 dir_end,
+        unsigned line_num) {
+
+    u32 name_start;
+    u32 name_len = read_macro_name(pp, dir_end, line_num, &name_start);
+    u32 name;
+
+    if (name_len == 0)
+        return;
+
+    name = Interner_find(&pp->ctx->syms, &pp->src[name_start], name_len);
+    if (name != m_interner_no_id && name < pp->macro_idxs.size)
+        pp->macro_idxs.elems[name] = m_u32_max;
+
+}
+
+/* whether the directive of length dir_len at src[dir_start] is dir */
+static bool directive_is(const char *src, u32 dir_start, u32 dir_len,
+        const char *dir) {
+
+    return dir_len == strlen(dir) &&
+        strncmp(&src[dir_start], dir, dir_len) == 0;
+
+}
+
+/* whether the group being read gets left out */
+static bool skipping(const struct PreProc *pp) {
+
+    return pp->conds.size > 0 && !pp->conds.elems[pp->conds.size-1].keep;
+
+}
+
+/* the group being left out ends at the directive at hashtag_idx. the lexer
+ * steps over all of it in one go, as an instance with nothing in it */
+static void end_skip(struct PreProc *pp, u32 hashtag_idx) {
+
+    MacroInstList_push_back(pp->macro_insts,
+            MacroInstance_create(pp->skip_start, hashtag_idx, pp->file_path,
+                m_u32_max, 0, 0));
+
+}
+
+static void push_cond(struct PreProc *pp, bool keep, bool done,
+        unsigned line_num) {
+
+    struct MacroCond cond;
+    cond.keep = keep;
+    cond.done = done;
+    cond.had_else = false;
+    cond.line_num = line_num;
+    MacroCondList_push_back(&pp->conds, cond);
+
+}
+
+/* #ifdef if defined is set, #ifndef otherwise */
+static void read_ifdef_directive(struct PreProc *pp, u32 hashtag_idx,
+        u32 dir_end, unsigned line_num, bool defined) {
+
+    u32 name_start;
+    u32 name_len;
+    bool keep;
+
+    /* in a group that's left out it only has to be matched up with its
+     * #endif */
+    if (skipping(pp)) {
+        push_cond(pp, false, true, line_num);
+        return;
+    }
+
+    name_len = read_macro_name(pp, dir_end, line_num, &name_start);
+    keep = name_len > 0 && (find_macro(pp->ctx, &pp->macro_idxs,
+                &pp->src[name_start], name_len) != m_u32_max) == defined;
+    if (!keep)
+        pp->skip_start = hashtag_idx;
+    push_cond(pp, keep, keep, line_num);
+
+}
+
+static void read_else_directive(struct PreProc *pp, u32 hashtag_idx,
+        unsigned line_num) {
+
+    struct CompilerCtx *ctx = pp->ctx;
+    struct MacroCond *cond;
+
+    if (pp->conds.size == pp->file_conds) {
+        ErrMsg_print(ctx, ErrMsg_on, &ctx->preproc_error_occurred,
+                pp->file_path,
+                "#else without an #ifdef or #ifndef on line %u.\n",
+                line_num);
+        return;
+    }
+
+    cond = &pp->conds.elems[pp->conds.size-1];
+    if (cond->had_else) {
+        ErrMsg_print(ctx, ErrMsg_on, &ctx->preproc_error_occurred,
+                pp->file_path,
+                "#else after an #else on line %u.\n", line_num);
+        return;
+    }
+    cond->had_else = true;
+
+    if (cond->keep) {
+        cond->keep = false;
+        pp->skip_start = hashtag_idx;
+    }
+    else if (!cond->done) {
+        cond->keep = true;
+        cond->done = true;
+        end_skip(pp, hashtag_idx);
+    }
+
+}
+
+static void read_endif_directive(struct PreProc *pp, u32 hashtag_idx,
+        unsigned line_num) {
+
+    struct CompilerCtx *ctx = pp->ctx;
+    bool kept;
+
+    if (pp->conds.size == pp->file_conds) {
+        ErrMsg_print(ctx, ErrMsg_on, &ctx->preproc_error_occurred,
+                pp->file_path,
+                "#endif without an #ifdef or #ifndef on line %u.\n",
+                line_num);
+        return;
+    }
+
+    kept = pp->conds.elems[--pp->conds.size].keep;
+    if (!kept && !skipping(pp))
+        end_skip(pp, hashtag_idx);
+
+}
+
+/* there's nothing to evaluate the expressions of #if and #elif with, so
+ * they're only allowed in groups that get left out */
+static void read_if_directive(struct PreProc *pp, unsigned line_num,
+        bool elif) {
+
+    struct CompilerCtx *ctx = pp->ctx;
+    /* the conditional the group an #elif starts is part of */
+    u32 depth = elif ? pp->conds.size-1 : pp->conds.size;
+    bool left_out;
+
+    if (elif && pp->conds.size == pp->file_conds) {
+        ErrMsg_print(ctx, ErrMsg_on, &ctx->preproc_error_occurred,
+                pp->file_path,
+                "#elif without an #ifdef or #ifndef on line %u.\n",
+                line_num);
+        return;
+    }
+
+    left_out = depth > 0 && !pp->conds.elems[depth-1].keep;
+    if (!left_out) {
+        ErrMsg_print(ctx, ErrMsg_on, &ctx->preproc_error_occurred,
+                pp->file_path,
+                "#if and #elif aren't supported, only #ifdef and #ifndef."
+                " line %u.\n", line_num);
+    }
+
+    if (!elif)
+        push_cond(pp, !left_out, true, line_num);
+
+}
+
+/* the conditionals opened in the file being read have to be closed by the
+ * end of it */
+static void close_conds(struct PreProc *pp) {
+
+    struct CompilerCtx *ctx = pp->ctx;
+
+    if (pp->conds.size == pp->file_conds)
+        return;
+
+    ErrMsg_print(ctx, ErrMsg_on, &ctx->preproc_error_occurred, pp->file_path,
+            "the #ifdef or #ifndef on line %u is never closed.\n",
+            pp->conds.elems[pp->file_conds].line_num);
+    pp->conds.size = pp->file_conds;
+
+}
+
+/* looks for the file name_len chars at name in dir, which is dir_len chars
+ * and can be empty */
+static const struct CachedFile* open_include(struct PreProc *pp,
+        const char *dir, u32 dir_len, const char *name, u32 name_len) {
+
+    TokenTextList_clear(&pp->text, NULL);
+    TokenTextList_append_n(&pp->text, dir, dir_len);
+    if (dir_len > 0 && dir[dir_len-1] != '/')
+        TokenTextList_push_back(&pp->text, '/');
+    TokenTextList_append_n(&pp->text, name, name_len);
+    TokenTextList_push_back(&pp->text, '\0');
+
+    return FileCache_get(pp->text.elems, pp->ctx->err_stream);
+
+}
+
+/* a "file" is looked for next to the file including it first, then in the
+ * -I dirs in order like a <file>. returns NULL if it isn't anywhere */
+static const struct CachedFile* find_include(struct PreProc *pp,
+        const char *name, u32 name_len, bool quoted) {
+
+    const struct CompArgs *args = &pp->ctx->args;
+    const struct CachedFile *file = NULL;
+    u32 i;
+
+    if (name[0] == '/')
+        return open_include(pp, "", 0, name, name_len);
+
+    if (quoted) {
+        const char *dir_end = strrchr(pp->file_path, '/');
+        file = open_include(pp, pp->file_path,
+                dir_end ? dir_end-pp->file_path+1 : 0, name, name_len);
+    }
+
+    for (i = 0; !file && i < args->n_include_dirs; i++) {
+        file = open_include(pp, args->include_dirs[i],
+                strlen(args->include_dirs[i]), name, name_len);
+    }
+
+    return file;
+
+}
+
+static void process(struct PreProc *pp, u32 start_idx, u32 end_idx);
+
+/* reads the file the #include at hashtag_idx names, end_idx being the end of
+ * the directive's line. the instance for it makes the lexer lex the file
+ * right there. */
+static void include_file(struct PreProc *pp, const struct CachedFile *file,
+        u32 hashtag_idx, u32 end_idx, unsigned line_num) {
+
+    struct CompilerCtx *ctx = pp->ctx;
+    /* what gets swapped out while the file is read */
+    const char *src = pp->src;
+    u32 src_len = pp->src_len;
+    const char *file_path = pp->file_path;
+    u32 src_offset = pp->src_offset;
+    u32 file_id = pp->file_id;
+    struct MacroInstList *macro_insts = pp->macro_insts;
+    u32 file_conds = pp->file_conds;
+
+    struct MacroInstList insts = MacroInstList_init();
+    struct MacroInstance inst;
+    struct MacroInclude include;
+    u32 include_idx = pp->includes->size;
+
+    /* a file that's been included already doesn't even get looked at again
+     * if it has a #pragma once or its include guard is defined */
+    if (file->id < pp->once.size && pp->once.elems[file->id])
+        return;
+    if (file->guard && find_macro(ctx, &pp->macro_idxs, file->guard,
+                file->guard_len) != m_u32_max)
+        return;
+
+    if (pp->include_depth == m_max_include_depth) {
+        ErrMsg_print(ctx, ErrMsg_on, &ctx->preproc_error_occurred,
+                pp->file_path,
+                "#include nested too deeply on line %u.\n", line_num);
+        return;
+    }
+
+    include.path = file->path;
+    include.src = file->buf.src;
+    include.src_len = file->buf.len;
+    include.offset = TokenList_add_include(pp->macro_tokens,
+            TokenList_add_included_file(pp->macro_tokens, file->path,
+                file->buf.src, &file->line_starts), file->buf.len);
+    include.insts = MacroInstList_init();
+    MacroIncludeList_push_back(pp->includes, include);
+
+    inst = MacroInstance_create(hashtag_idx, end_idx, pp->file_path,
+            m_u32_max, 0, 0);
+    inst.include_idx = include_idx;
+    MacroInstList_push_back(pp->macro_insts, inst);
+
+    pp->src = file->buf.src;
+    pp->src_len = file->buf.len;
+    pp->file_path = file->path;
+    pp->src_offset = include.offset;
+    pp->file_id = file->id;
+    pp->macro_insts = &insts;
+    pp->file_conds = pp->conds.size;
+    ++pp->include_depth;
+
+    process(pp, 0, file->buf.len);
+    close_conds(pp);
+
+    pp->src = src;
+    pp->src_len = src_len;
+    pp->file_path = file_path;
+    pp->src_offset = src_offset;
+    pp->file_id = file_id;
+    pp->macro_insts = macro_insts;
+    pp->file_conds = file_conds;
+    --pp->include_depth;
+
+    /* the list could've moved while the file was read */
+    pp->includes->elems[include_idx].insts = insts;
+
+}
+
+static void read_include_directive(struct PreProc *pp, u32 hashtag_idx,
+        u32 dir_end, unsigned line_num) {
+
+    struct CompilerCtx *ctx = pp->ctx;
+    const char *src = pp->src;
+    u32 name_start = dir_end;
+    u32 name_end;
+    char close;
+    const struct CachedFile *file = NULL;
+
+    while (src[name_start] != '\n' && isspace(src[name_start]))
         ++name_start;
 
-    if (!valid_ident_start_char(src[name_start])) {
-        ErrMsg_print(ErrMsg_on, &PreProc_error_occurred, file_path,
-                "expected a macro name on line %u.\n", line_num);
-        *end_idx = name_start;
-        while (src[*end_idx] != '\n') ++*end_idx;
+    close = src[name_start] == '<' ? '>' : '\"';
+    name_end = name_start+1;
+    while (name_end < pp->src_len && src[name_end] != '\n' &&
+            src[name_end] != close)
+        ++name_end;
+
+    if ((src[name_start] != '\"' && src[name_start] != '<') ||
+            src[name_end] != close || name_end == name_start+1) {
+        ErrMsg_print(ctx, ErrMsg_on, &ctx->preproc_error_occurred,
+                pp->file_path,
+                "expected a \"file\" or <file> after #include on line %u.\n",
+                line_num);
         return;
     }
 
-    name_len = get_identifier_len(&src[name_start]);
-    name_end = name_start+name_len;
-    name = sub_str(src, name_start, name_len);
+    /* the library doesn't touch the filesystem */
+    if (ctx->args.no_includes) {
+        ErrMsg_print(ctx, ErrMsg_on, &ctx->preproc_error_occurred,
+                pp->file_path,
+                "#include isn't supported here. line %u.\n", line_num);
+        return;
+    }
 
-    expansion_end = name_end;
-    while (src[expansion_end] != '\n')
-        ++expansion_end;
+    file = find_include(pp, &src[name_start+1], name_end-name_start-1,
+            close == '\"');
+    if (!file) {
+        ErrMsg_print(ctx, ErrMsg_on, &ctx->preproc_error_occurred,
+                pp->file_path,
+                "can't find the file '%.*s' included on line %u.\n",
+                (int)(name_end-name_start-1), &src[name_start+1], line_num);
+        return;
+    }
 
-    expansion = sub_str(src, name_end, expansion_end-name_end);
-    if (expansion[0] == '\0')
-        m_free(expansion);
+    include_file(pp, file, hashtag_idx, line_end(pp, name_end), line_num);
+
+}
+
+/* only #pragma once does anything, the others get ignored */
+static void read_pragma_directive(struct PreProc *pp, u32 dir_end) {
+
+    const char *src = pp->src;
+    u32 name_start = dir_end;
+
+    while (src[name_start] != '\n' && isspace(src[name_start]))
+        ++name_start;
+
+    /* the main file can't be included again anyway */
+    if (strncmp(&src[name_start], "once", 4) != 0 ||
+            valid_ident_char(src[name_start+4]) ||
+            pp->file_id == m_u32_max)
+        return;
 
-    PreProcMacroList_push_back(macros, PreProcMacro_create(name, expansion));
+    while (pp->once.size <= pp->file_id)
+        MacroFileFlagList_push_back(&pp->once, false);
+    pp->once.elems[pp->file_id] = true;
 
 }
 
 /*
  * end_idx          - *end_idx gets set to the index of the '\n' at the end of
- *                    the directive
+ *                    the directive, or to src_len if it's on the last line
  * n_lines          - the number of lines the directive takes up
  */
-static void read_preproc_directive(const char *src, u32 hashtag_idx,
-        unsigned line_num, struct PreProcMacroList *macros, u32 *end_idx,
-        unsigned *n_lines, const char *file_path) {
+static void read_preproc_directive(struct PreProc *pp, u32 hashtag_idx,
+        unsigned line_num, u32 *end_idx, unsigned *n_lines) {
 
+    struct CompilerCtx *ctx = pp->ctx;
+    const char *src = pp->src;
     u32 dir_start = hashtag_idx+1;
     u32 dir_len;
-    char *dir = NULL;
+    u32 dir_end;
+
+    *n_lines = 1;
 
     while (src[dir_start] != '\n' && isspace(src[dir_start])) {
         ++dir_start;
     }
 
     if (!valid_ident_start_char(src[dir_start])) {
-        ErrMsg_print(ErrMsg_on, &PreProc_error_occurred, file_path,
-                "expected a pre-processor directive on line %u.\n",
-                line_num);
-        while (src[dir_start] != '\n')
-            ++dir_start;
-        *n_lines = 1;
-        *end_idx = dir_start;
+        /* a group that's left out doesn't have to make any sense */
+        if (!skipping(pp)) {
+            ErrMsg_print(ctx, ErrMsg_on, &ctx->preproc_error_occurred,
+                    pp->file_path,
+                    "expected a pre-processor directive on line %u.\n",
+                    line_num);
+        }
+        *end_idx = line_end(pp, dir_start);
+        return;
     }
 
     dir_len = get_identifier_len(&src[dir_start]);
-    dir = sub_str(src, dir_start, dir_len);
+    dir_end = dir_start+dir_len;
+
+    /* the conditionals have to be followed even in a group that's left
+     * out */
+    if (directive_is(src, dir_start, dir_len, "ifdef"))
+        read_ifdef_directive(pp, hashtag_idx, dir_end, line_num, true);
+    else if (directive_is(src, dir_start, dir_len, "ifndef"))
+        read_ifdef_directive(pp, hashtag_idx, dir_end, line_num, false);
+    else if (directive_is(src, dir_start, dir_len, "else"))
+        read_else_directive(pp, hashtag_idx, line_num);
+    else if (directive_is(src, dir_start, dir_len, "endif"))
+        read_endif_directive(pp, hashtag_idx, line_num);
+    else if (directive_is(src, dir_start, dir_len, "if"))
+        read_if_directive(pp, line_num, false);
+    else if (directive_is(src, dir_start, dir_len, "elif"))
+        read_if_directive(pp, line_num, true);
+
+    else if (!skipping(pp)) {
+        if (directive_is(src, dir_start, dir_len, "define"))
+            read_define_directive(pp, dir_end, line_num, end_idx, n_lines);
+        else if (directive_is(src, dir_start, dir_len, "undef"))
+            read_undef_directive(pp, dir_end, line_num);
+        else if (directive_is(src, dir_start, dir_len, "include"))
+            read_include_directive(pp, hashtag_idx, dir_end, line_num);
+        else if (directive_is(src, dir_start, dir_len, "pragma"))
+            read_pragma_directive(pp, dir_end);
+    }
+
+    *end_idx = line_end(pp, dir_start);
 
-    if (strcmp(dir, "define") == 0) {
-        read_define_directive(src, dir_start+dir_len, line_num, end_idx,
-                n_lines, file_path, macros);
+}
+
+/* copies token idx of from onto the end of to, giving it offset. a string
+ * literal's string gets copied too, every token owns its own */
+static void copy_token(struct TokenList *to, const struct TokenList *from,
+        u32 idx, u32 offset) {
+
+    union TokenValue value = from->values[idx];
+
+    if (from->types[idx] == TokenType_STR_LIT)
+        value.string = copy_string(value.string);
+
+    TokenList_push_back(to, from->types[idx], offset, from->src_lens[idx], 0,
+            value);
+
+}
+
+static void copy_tokens(struct TokenList *to, const struct TokenList *from,
+        u32 start, u32 end) {
+
+    u32 i;
+
+    for (i = start; i < end; i++)
+        copy_token(to, from, i, from->src_offsets[i]);
+
+}
+
+/* appends the text of token idx in list to text */
+static void append_spelling(struct PreProc *pp, struct TokenTextList *text,
+        const struct TokenList *list, u32 idx) {
+
+    TokenTextList_append_n(text,
+            TokenList_text_at(pp->macro_tokens, list->src_offsets[idx]),
+            list->src_lens[idx]);
+
+}
+
+/* pushes a string literal of the text of the tokens from start up to end in
+ * list onto work. the '#' doing it is at hash_offset */
+static void stringize(struct PreProc *pp, const struct TokenList *list,
+        u32 start, u32 end, u32 hash_offset) {
+
+    union TokenValue value;
+    u32 i;
+
+    TokenTextList_clear(&pp->text, NULL);
+    for (i = start; i < end; i++) {
+        /* any whitespace between two tokens turns into a space */
+        if (i > start && list->src_offsets[i-1]+list->src_lens[i-1] !=
+                list->src_offsets[i])
+            TokenTextList_push_back(&pp->text, ' ');
+        append_spelling(pp, &pp->text, list, i);
     }
+    TokenTextList_push_back(&pp->text, '\0');
 
-    m_free(dir);
+    value.string = safe_malloc(pp->text.size*sizeof(*value.string),
+            MemTag_STRINGS);
+    memcpy(value.string, pp->text.elems, pp->text.size);
+    TokenList_push_back(&pp->work, TokenType_STR_LIT, hash_offset, 1, 0,
+            value);
 
-    while (src[dir_start] != '\n')
-        ++dir_start;
-    *end_idx = dir_start;
+}
+
+/* pastes work's tokens lhs and lhs+1 together into one token */
+static void paste(struct PreProc *pp, u32 lhs) {
+
+    struct CompilerCtx *ctx = pp->ctx;
+    struct TokenList *work = &pp->work;
+    u32 rhs = lhs+1;
+    u32 result = work->size;
+    u32 lhs_len = work->src_lens[lhs];
+    u32 text_len;
+    u32 offset;
+    u32 i;
+
+    TokenTextList_clear(&pp->text, NULL);
+    append_spelling(pp, &pp->text, work, lhs);
+    append_spelling(pp, &pp->text, work, rhs);
+    text_len = pp->text.size;
+    /* the lexer looks a char past the end */
+    TokenTextList_push_back(&pp->text, '\0');
+
+    offset = TokenList_add_expansion(pp->macro_tokens,
+            TokenList_add_expansion_text(pp->macro_tokens, pp->text.elems,
+                text_len),
+            text_len, pp->use_offset);
+    lex_text(pp, work, pp->text.elems, text_len, offset, pp->file_path,
+            pp->use_line_num, pp->use_column_num);
+
+    if (work->size-result != 1) {
+        ErrMsg_print(ctx, ErrMsg_on, &ctx->preproc_error_occurred,
+                pp->file_path,
+                "pasting \"%.*s\" and \"%.*s\" doesn't give a valid token on"
+                " line %u.\n", (int)lhs_len, pp->text.elems,
+                (int)(text_len-lhs_len), &pp->text.elems[lhs_len],
+                pp->use_line_num);
+        TokenList_truncate(work, result);
+        return;
+    }
+
+    for (i = lhs; i <= rhs; i++) {
+        if (work->types[i] == TokenType_STR_LIT)
+            m_free(work->values[i].string);
+    }
+
+    TokenList_move(work, lhs, result);
+    for (i = rhs; i+1 < result; i++)
+        TokenList_move(work, i, i+1);
+    work->size = result-1;
 
 }
 
-static void expand_macro(const struct PreProcMacroList *macros, u32 macro_idx,
-        struct MacroInstList *macro_insts, u32 macro_start_idx,
-        const char *file_path) {
+/* pushes what token i of the macro stands for onto work: an argument, an
+ * argument made into a string or the token itself. raw arguments aren't
+ * expanded first. base is where the macro's text sits for this use. returns
+ * the index of the token after. */
+static u32 push_operand(struct PreProc *pp, const struct PreProcMacro *macro,
+        const struct TokenList *arg_list, u32 first_arg, u32 base, u32 i,
+        bool raw) {
+
+    const struct TokenList *body = pp->macro_tokens;
+    u32 param;
+
+    if (body->types[i] == TokenType_STRINGIZE) {
+        const struct MacroArg *arg = &pp->arg_stack.elems[first_arg +
+            token_param(pp, macro, body, i+1)];
+        stringize(pp, arg_list, arg->start, arg->end,
+                base+body->src_offsets[i]);
+        return i+2;
+    }
 
-    char *expansion = NULL;
+    param = token_param(pp, macro, body, i);
+    if (param == m_u32_max)
+        copy_token(&pp->work, body, i, base+body->src_offsets[i]);
+    else {
+        const struct MacroArg *arg = &pp->arg_stack.elems[first_arg+param];
+        if (raw)
+            copy_tokens(&pp->work, arg_list, arg->start, arg->end);
+        else
+            copy_tokens(&pp->work, &pp->args, arg->exp_start, arg->exp_end);
+    }
 
-    assert(macro_idx != m_u32_max);
+    return i+1;
 
-    expansion = make_str_copy(macros->elems[macro_idx].expansion);
+}
+
+/* pushes the macro's tokens onto work, with the arguments on arg_stack from
+ * first_arg on substituted in and the ## done */
+static void substitute(struct PreProc *pp, const struct PreProcMacro *macro,
+        const struct TokenList *arg_list, u32 first_arg) {
+
+    const struct TokenList *body = pp->macro_tokens;
+    u32 end = macro->first_token+macro->n_tokens;
+    u32 i = macro->first_token;
+    u32 base;
+
+    if (macro->n_tokens == 0)
+        return;
+
+    /* the tokens from the macro's text sit where the macro got used, like
+     * the text had been copied there */
+    base = TokenList_add_expansion(pp->macro_tokens, macro->text,
+            macro->text_len, pp->use_offset);
+
+    while (i < end) {
 
-    MacroInstList_push_back(macro_insts,
-            MacroInstance_create(
-                expansion, macro_start_idx, file_path,
-                &macros->elems[macro_idx]
-                ));
+        u32 operand_end = body->types[i] == TokenType_STRINGIZE ? i+2 : i+1;
+        /* the arguments next to a ## don't get expanded */
+        bool raw = operand_end < end &&
+            body->types[operand_end] == TokenType_TOKEN_PASTE;
+        u32 lhs_start = pp->work.size;
+
+        i = push_operand(pp, macro, arg_list, first_arg, base, i, raw);
+
+        while (i < end && body->types[i] == TokenType_TOKEN_PASTE) {
+            u32 rhs_start = pp->work.size;
+            i = push_operand(pp, macro, arg_list, first_arg, base, i+1,
+                    true);
+            /* an empty argument on either side leaves the other as is */
+            if (rhs_start > lhs_start && pp->work.size > rhs_start)
+                paste(pp, rhs_start-1);
+        }
+
+    }
 
 }
 
-static void process(const char *src, struct PreProcMacroList *macros,
-        struct MacroInstList *macro_insts, u32 start_idx, u32 end_idx,
-        const char *file_path) {
+static void expand_tokens(struct PreProc *pp, const struct TokenList *list,
+        u32 start, u32 end, struct TokenList *out);
+
+/* pushes the arguments of a function-like macro onto arg_stack, the '(' after
+ * the macro's name being token paren_idx of list. returns the index of the
+ * ')' closing them, or m_u32_max if it doesn't come before end. */
+static u32 collect_args(struct PreProc *pp, const struct TokenList *list,
+        u32 paren_idx, u32 end) {
+
+    u32 depth = 0;
+    u32 arg_start = paren_idx+1;
+    u32 i;
+
+    for (i = paren_idx+1; i < end; i++) {
+
+        enum TokenType type = list->types[i];
+
+        if (type == TokenType_L_PAREN)
+            ++depth;
+        else if (type == TokenType_R_PAREN && depth > 0)
+            --depth;
+        else if (depth == 0 &&
+                (type == TokenType_R_PAREN || type == TokenType_COMMA)) {
+            struct MacroArg arg;
+            arg.start = arg_start;
+            arg.end = i;
+            arg.exp_start = 0;
+            arg.exp_end = 0;
+            MacroArgList_push_back(&pp->arg_stack, arg);
+            arg_start = i+1;
+            if (type == TokenType_R_PAREN)
+                return i;
+        }
+
+    }
+
+    return m_u32_max;
+
+}
+
+/* pushes the arguments of a function-like macro onto arg_stack, like
+ * collect_args, and checks there's the right number of them. returns the
+ * index after the ')', or m_u32_max if they aren't closed. if there's the
+ * wrong number, nothing gets pushed. */
+static u32 read_args(struct PreProc *pp, const struct PreProcMacro *macro,
+        const struct TokenList *list, u32 paren_idx, u32 end) {
+
+    struct CompilerCtx *ctx = pp->ctx;
+    u32 first_arg = pp->arg_stack.size;
+    u32 close_idx = collect_args(pp, list, paren_idx, end);
+    u32 n_args;
+
+    if (close_idx == m_u32_max) {
+        pp->arg_stack.size = first_arg;
+        return m_u32_max;
+    }
+
+    n_args = pp->arg_stack.size-first_arg;
+    /* F() gives F one empty argument, which is fine if F doesn't take any */
+    if (macro->n_params == 0 && n_args == 1 &&
+            pp->arg_stack.elems[first_arg].start == close_idx)
+        n_args = 0;
+
+    if (n_args != macro->n_params) {
+        ErrMsg_print(ctx, ErrMsg_on, &ctx->preproc_error_occurred,
+                pp->file_path,
+                "macro '%s' takes %u arguments, not %u. line %u.\n",
+                Interner_str(&ctx->syms, macro->name), macro->n_params,
+                n_args, pp->use_line_num);
+        pp->arg_stack.size = first_arg;
+    }
 
+    return close_idx+1;
+
+}
+
+/* expands the macro macro_idx onto the end of out. a function-like macro's
+ * arguments have been read from list onto arg_stack, starting at first_arg,
+ * and get popped off. */
+static void expand_read_macro(struct PreProc *pp, u32 macro_idx,
+        const struct TokenList *list, u32 first_arg, struct TokenList *out) {
+
+    struct PreProcMacro *macro = &pp->macros->elems[macro_idx];
+    u32 work_start = pp->work.size;
+    u32 args_start = pp->args.size;
+    u32 i;
+
+    lex_macro(pp, macro);
+
+    /* each argument gets expanded once, however many times it's used */
+    for (i = first_arg; i < pp->arg_stack.size; i++) {
+        u32 exp_start = pp->args.size;
+        expand_tokens(pp, list, pp->arg_stack.elems[i].start,
+                pp->arg_stack.elems[i].end, &pp->args);
+        pp->arg_stack.elems[i].exp_start = exp_start;
+        pp->arg_stack.elems[i].exp_end = pp->args.size;
+    }
+
+    substitute(pp, macro, list, first_arg);
+    pp->arg_stack.size = first_arg;
+    /* the expanded arguments got copied into work. out can be args too, so
+     * they can't be left in front of what goes there */
+    TokenList_truncate(&pp->args, args_start);
+
+    /* the result gets rescanned for more macros, just not this one */
+    macro->expanding = true;
+    if (names_macro(pp, &pp->work, work_start, pp->work.size)) {
+        expand_tokens(pp, &pp->work, work_start, pp->work.size, out);
+        TokenList_truncate(&pp->work, work_start);
+    }
+    else
+        TokenList_take(out, &pp->work, work_start);
+    macro->expanding = false;
+
+}
+
+/* expands the macro macro_idx onto the end of out. a function-like macro's
+ * arguments are in list, starting with the '(' at paren_idx and ending
+ * before end. returns the index after the arguments, paren_idx for an
+ * object-like macro, or m_u32_max if the arguments aren't closed. */
+static u32 expand_macro(struct PreProc *pp, u32 macro_idx,
+        const struct TokenList *list, u32 paren_idx, u32 end,
+        struct TokenList *out) {
+
+    const struct PreProcMacro *macro = &pp->macros->elems[macro_idx];
+    u32 first_arg = pp->arg_stack.size;
+    u32 after = paren_idx;
+
+    if (macro->func_like) {
+        after = read_args(pp, macro, list, paren_idx, end);
+        /* the wrong number of arguments leaves nothing on the stack */
+        if (after == m_u32_max || pp->arg_stack.size == first_arg)
+            return after;
+    }
+
+    expand_read_macro(pp, macro_idx, list, first_arg, out);
+    return after;
+
+}
+
+/* expands the macros in the tokens from start up to end in list, pushing the
+ * result onto out. a function-like macro's arguments have to be in the same
+ * range as its name. only at the end of an instance can they come from the
+ * source after it, see expand_trailing_macros. */
+static void expand_tokens(struct PreProc *pp, const struct TokenList *list,
+        u32 start, u32 end, struct TokenList *out) {
+
+    u32 i = start;
+
+    while (i < end) {
+
+        u32 macro_idx = m_u32_max;
+
+        if (list->types[i] == TokenType_IDENT)
+            macro_idx = sym_macro(&pp->macro_idxs, list->values[i].sym_id);
+
+        /* a function-like macro's name without a '(' after it is just an
+         * identifier */
+        if (macro_idx != m_u32_max &&
+                !pp->macros->elems[macro_idx].expanding &&
+                (!pp->macros->elems[macro_idx].func_like ||
+                 (i+1 < end && list->types[i+1] == TokenType_L_PAREN))) {
+            u32 after = expand_macro(pp, macro_idx, list, i+1, end, out);
+            if (after != m_u32_max) {
+                i = after;
+                continue;
+            }
+        }
+
+        copy_token(out, list, i, list->src_offsets[i]);
+        ++i;
+
+    }
+
+}
+
+/* the idx of the ')' matching the '(' at src[paren_idx], skipping over
+ * strings, chars and comments. m_u32_max if there isn't one */
+static u32 find_close_paren(const struct PreProc *pp, u32 paren_idx) {
+
+    const char *src = pp->src;
+    u32 depth = 0;
+    u32 src_i;
+
+    for (src_i = paren_idx; src_i < pp->src_len; src_i++) {
+
+        if (src[src_i] == '(')
+            ++depth;
+        else if (src[src_i] == ')') {
+            if (--depth == 0)
+                return src_i;
+        }
+        else if (src[src_i] == '\"' || src[src_i] == '\'')
+            src_i = skip_quoted(src, pp->src_len, src_i);
+        else if (src[src_i] == '/' && src[src_i+1] == '*') {
+            src_i += 2;
+            while (src_i+1 < pp->src_len &&
+                    (src[src_i] != '*' || src[src_i+1] != '/'))
+                ++src_i;
+            ++src_i;
+        }
+        else if (src[src_i] == '/' && src[src_i+1] == '/') {
+            while (src_i+1 < pp->src_len && src[src_i+1] != '\n')
+                ++src_i;
+        }
+
+    }
+
+    return m_u32_max;
+
+}
+
+/* whether the macro's own tokens have no # or ## and name no macros */
+static bool macro_is_clean(const struct PreProc *pp,
+        struct PreProcMacro *macro) {
+
+    const struct TokenList *body = pp->macro_tokens;
+    u32 i;
+
+    if (macro->n_macros_clean == pp->macros->size)
+        return true;
+
+    for (i = macro->first_token; i < macro->first_token+macro->n_tokens;
+            i++) {
+        if (body->types[i] == TokenType_STRINGIZE ||
+                body->types[i] == TokenType_TOKEN_PASTE)
+            return false;
+        if (token_param(pp, macro, body, i) == m_u32_max &&
+                names_macro(pp, body, i, i+1))
+            return false;
+    }
+
+    macro->n_macros_clean = pp->macros->size;
+    return true;
+
+}
+
+/* whether the macro's tokens and the arguments on arg_stack from first_arg
+ * on can go into an instance as they are, with no # or ## to do and nothing
+ * that would have to be rescanned */
+static bool can_splice(const struct PreProc *pp,
+        struct PreProcMacro *macro, const struct TokenList *list,
+        u32 first_arg) {
+
+    u32 i;
+
+    if (!macro_is_clean(pp, macro))
+        return false;
+
+    for (i = first_arg; i < pp->arg_stack.size; i++) {
+        if (names_macro(pp, list, pp->arg_stack.elems[i].start,
+                    pp->arg_stack.elems[i].end))
+            return false;
+    }
+
+    return true;
+
+}
+
+static void push_segment(struct PreProc *pp, u32 first_token, u32 n_tokens,
+        u32 offset) {
+
+    struct MacroSegment seg;
+
+    if (n_tokens == 0)
+        return;
+
+    seg.first_token = first_token;
+    seg.n_tokens = n_tokens;
+    seg.offset = offset;
+    MacroSegmentList_push_back(pp->macro_segments, seg);
+
+}
+
+/* adds the segments of an instance can_splice said yes to. the runs of the
+ * macro's own tokens go where it got used, with its arguments' tokens in
+ * between them */
+static void splice(struct PreProc *pp, const struct PreProcMacro *macro,
+        u32 first_arg) {
+
+    u32 end = macro->first_token+macro->n_tokens;
+    u32 run_start = macro->first_token;
+    u32 base;
+    u32 i;
+
+    if (macro->n_tokens == 0)
+        return;
+
+    base = TokenList_add_expansion(pp->macro_tokens, macro->text,
+            macro->text_len, pp->use_offset);
+
+    for (i = macro->first_use; i < macro->first_use+macro->n_uses; i++) {
+
+        const struct MacroParamUse *use = &pp->param_uses.elems[i];
+        const struct MacroArg *arg =
+            &pp->arg_stack.elems[first_arg+use->param];
+
+        push_segment(pp, run_start, use->token-run_start, base);
+        push_segment(pp, arg->start, arg->end-arg->start, 0);
+        run_start = use->token+1;
+
+    }
+
+    push_segment(pp, run_start, end-run_start, base);
+
+}
+
+/* reads the arguments of the function-like macro from the source, when
+ * they're what comes after src[end_idx]. line_num is the line end_idx is on,
+ * and gets moved along to the line the arguments end on. they get lexed onto
+ * the macro token list and pushed onto arg_stack, which has to be empty.
+ * returns the idx after the ')', or end_idx if there's no '(' there.
+ * *args_ok is false if there's an error, with nothing left on arg_stack. */
+static u32 read_src_args(struct PreProc *pp, const struct PreProcMacro *macro,
+        u32 end_idx, unsigned *line_num, bool *args_ok) {
+
+    struct CompilerCtx *ctx = pp->ctx;
+    const char *src = pp->src;
+    u32 paren_idx = end_idx;
+    u32 close_idx;
+    u32 args_start = pp->macro_tokens->size;
+    unsigned paren_line_num = *line_num;
+    u32 i;
+
+    *args_ok = false;
+
+    while (paren_idx < pp->src_len && isspace(src[paren_idx])) {
+        if (src[paren_idx] == '\n')
+            ++paren_line_num;
+        ++paren_idx;
+    }
+    if (src[paren_idx] != '(')
+        return end_idx;
+
+    close_idx = find_close_paren(pp, paren_idx);
+    if (close_idx == m_u32_max) {
+        ErrMsg_print(ctx, ErrMsg_on, &ctx->preproc_error_occurred,
+                pp->file_path,
+                "the arguments of macro '%s' on line %u are never"
+                " closed.\n", Interner_str(&ctx->syms, macro->name),
+                *line_num);
+        return end_idx;
+    }
+
+    /* the arguments stay in the macro token list, an instance can use
+     * their tokens as they are */
+    lex_text(pp, pp->macro_tokens, &src[paren_idx],
+            close_idx-paren_idx+1, pp->src_offset+paren_idx,
+            pp->file_path, paren_line_num, column_of(src, paren_idx));
+    if (read_args(pp, macro, pp->macro_tokens, args_start,
+                pp->macro_tokens->size) == m_u32_max ||
+            pp->arg_stack.size == 0)
+        pp->arg_stack.size = 0;
+    else
+        *args_ok = true;
+
+    *line_num = paren_line_num;
+    for (i = paren_idx; i < close_idx; i++) {
+        if (src[i] == '\n')
+            ++*line_num;
+    }
+
+    return close_idx+1;
+
+}
+
+/* when the expansion of an instance, in args from args_start on, ends with
+ * the name of a function-like macro, the macro takes its arguments from the
+ * source after the instance, the way #define H G then H(4) gives G(4). the
+ * instance ends at src[end_idx], on line line_num. returns where it ends
+ * after taking those arguments. */
+static u32 expand_trailing_macros(struct PreProc *pp, u32 args_start,
+        u32 end_idx, unsigned line_num) {
+
+    /* every round takes a '(' from the source, so it has to stop */
+    while (pp->args.size > args_start) {
+
+        u32 name = pp->args.size-1;
+        u32 macro_idx;
+        u32 after;
+        bool args_ok;
+
+        if (pp->args.types[name] != TokenType_IDENT)
+            break;
+        macro_idx = sym_macro(&pp->macro_idxs, pp->args.values[name].sym_id);
+        if (macro_idx == m_u32_max || !pp->macros->elems[macro_idx].func_like)
+            break;
+
+        after = read_src_args(pp, &pp->macros->elems[macro_idx], end_idx,
+                &line_num, &args_ok);
+        if (!args_ok)
+            break;
+
+        TokenList_truncate(&pp->args, name);
+        expand_read_macro(pp, macro_idx, pp->macro_tokens, 0, &pp->args);
+        end_idx = after;
+
+    }
+
+    return end_idx;
+
+}
+
+/* expands the macro whose name is at src[name_idx] and adds the instance.
+ * returns the idx after the use, which is right after the name if it's a
+ * function-like macro without any arguments. */
+static u32 expand_use(struct PreProc *pp, u32 macro_idx, u32 name_idx,
+        u32 name_len, unsigned line_num, unsigned column_num) {
+
+    struct PreProcMacro *macro = &pp->macros->elems[macro_idx];
+    u32 first_segment = pp->macro_segments->size;
+    u32 end_idx = name_idx+name_len;
+
+    pp->use_offset = pp->src_offset+name_idx;
+    pp->use_line_num = line_num;
+    pp->use_column_num = column_num;
+
+    lex_macro(pp, macro);
+
+    if (macro->func_like) {
+        bool args_ok;
+        u32 after = read_src_args(pp, macro, end_idx, &line_num, &args_ok);
+        if (!args_ok)
+            return after;
+        end_idx = after;
+    }
+
+    if (can_splice(pp, macro, pp->macro_tokens, 0)) {
+        splice(pp, macro, 0);
+        pp->arg_stack.size = 0;
+    }
+    else {
+        /* the macros it expands can still get lexed onto the macro token
+         * list, so the result goes there once it's done */
+        u32 args_start = pp->args.size;
+        u32 first_token;
+        expand_read_macro(pp, macro_idx, pp->macro_tokens, 0, &pp->args);
+        end_idx = expand_trailing_macros(pp, args_start, end_idx, line_num);
+        first_token = pp->macro_tokens->size;
+        TokenList_take(pp->macro_tokens, &pp->args, args_start);
+        push_segment(pp, first_token, pp->macro_tokens->size-first_token, 0);
+    }
+
+    MacroInstList_push_back(pp->macro_insts,
+            MacroInstance_create(name_idx, end_idx, pp->file_path, macro_idx,
+                first_segment, pp->macro_segments->size-first_segment));
+
+    return end_idx;
+
+}
+
+static void process(struct PreProc *pp, u32 start_idx, u32 end_idx) {
+
+    const char *src = pp->src;
     u32 src_i;
     unsigned line_num = 1;
     unsigned column_num = 1;
@@ -280,22 +1755,46 @@ static void process(const char *src, struct PreProcMacroList *macros,
 
         else if (only_whitespace && src[src_i] == '#') {
             unsigned n_lines;
-            read_preproc_directive(src, src_i, line_num, macros, &src_i,
-                    &n_lines, file_path);
+            read_preproc_directive(pp, src_i, line_num, &src_i, &n_lines);
+            /* src_i is on the '\n' now, which the loop steps over. stepping
+             * over it here too would skip the first char of the next line */
             line_num += n_lines;
             column_num = 0;
-            ++src_i;
+        }
+
+        /* a macro's name in a string isn't a use of it */
+        else if (src[src_i] == '\"' || src[src_i] == '\'') {
+            u32 quote_end = skip_quoted(src, end_idx, src_i);
+            /* an unclosed one stops at the '\n', which the loop has to see */
+            if (quote_end > end_idx || src[quote_end] == '\n')
+                --quote_end;
+            column_num += quote_end-src_i;
+            src_i = quote_end;
+            only_whitespace = false;
         }
 
         else if (valid_ident_start_char(src[src_i])) {
             u32 ident_len = get_identifier_len(&src[src_i]);
-            char *ident = sub_str(src, src_i, ident_len);
-            u32 macro_idx = find_macro(macros, ident);
+            /* nothing gets expanded in a group that's left out */
+            u32 macro_idx = skipping(pp) ? m_u32_max : find_macro(pp->ctx,
+                    &pp->macro_idxs, &src[src_i], ident_len);
+            u32 ident_end = src_i+ident_len;
+
+            if (macro_idx != m_u32_max) {
+                ident_end = expand_use(pp, macro_idx, src_i, ident_len,
+                        line_num, column_num);
+            }
 
-            if (macro_idx != m_u32_max)
-                expand_macro(macros, macro_idx, macro_insts, src_i, file_path);
+            /* a function-like macro's arguments can go over several lines */
+            while (src_i+1 < ident_end) {
+                ++src_i;
+                ++column_num;
+                if (src[src_i] == '\n') {
+                    ++line_num;
+                    column_num = 0;
+                }
+            }
 
-            m_free(ident);
             only_whitespace = false;
         }
 
@@ -307,14 +1806,65 @@ static void process(const char *src, struct PreProcMacroList *macros,
 
 }
 
-void PreProc_process(const char *src, struct PreProcMacroList *macros,
-        struct MacroInstList *macro_insts, const char *file_path) {
+void PreProc_process(struct CompilerCtx *ctx, const char *src, u32 src_len,
+        struct PreProcMacroList *macros, struct TokenList *macro_tokens,
+        struct MacroSegmentList *macro_segments,
+        struct MacroInstList *macro_insts, struct MacroIncludeList *includes,
+        const char *file_path) {
+
+    struct PreProc pp;
 
-    PreProc_error_occurred = false;
+    ctx->preproc_error_occurred = false;
 
     *macros = PreProcMacroList_init();
+    *macro_tokens = TokenList_init();
+    *macro_segments = MacroSegmentList_init();
     *macro_insts = MacroInstList_init();
-
-    process(src, macros, macro_insts, 0, strlen(src), file_path);
+    *includes = MacroIncludeList_init();
+    /* the offsets of the expansions and includes come after src's, same as
+     * in the lexer's token table. the files go there with them, the main one
+     * first */
+    TokenList_set_src(macro_tokens, src, src_len);
+    TokenList_add_file(macro_tokens, file_path);
+
+    pp.ctx = ctx;
+    pp.src = src;
+    pp.src_len = src_len;
+    pp.file_path = file_path;
+    pp.src_offset = 0;
+    pp.file_id = m_u32_max;
+    pp.include_depth = 0;
+    pp.macros = macros;
+    pp.macro_idxs = MacroIdxList_init();
+    pp.params = MacroParamList_init();
+    pp.param_uses = MacroParamUseList_init();
+    pp.macro_tokens = macro_tokens;
+    pp.macro_segments = macro_segments;
+    pp.macro_insts = macro_insts;
+    pp.includes = includes;
+    pp.conds = MacroCondList_init();
+    pp.file_conds = 0;
+    pp.skip_start = 0;
+    pp.once = MacroFileFlagList_init();
+    pp.work = TokenList_init();
+    pp.args = TokenList_init();
+    pp.arg_stack = MacroArgList_init();
+    pp.text = TokenTextList_init();
+    pp.use_offset = 0;
+    pp.use_line_num = 0;
+    pp.use_column_num = 0;
+
+    process(&pp, 0, src_len);
+    close_conds(&pp);
+
+    MacroIdxList_free(&pp.macro_idxs);
+    MacroCondList_free(&pp.conds);
+    MacroFileFlagList_free(&pp.once);
+    MacroParamList_free(&pp.params);
+    MacroParamUseList_free(&pp.param_uses);
+    TokenList_free(&pp.work);
+    TokenList_free(&pp.args);
+    MacroArgList_free(&pp.arg_stack);
+    TokenTextList_free(&pp.text);
 
 }
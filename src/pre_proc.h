@@ -2,20 +2,58 @@
 
 #include "comp_dependent/ints.h"
 #include "vector_impl.h"
+#include "token.h"
 #include "bool.h"
 
-extern bool PreProc_error_occurred;
+struct CompilerCtx;
 
 struct PreProcMacro {
 
-    char *name;
-    char *expansion;
+    /* the interned id of the name */
+    u32 name;
+    /* the macro's text is text_len chars at index text in the macro token
+     * list's expansion_text. it gets lexed once, the first time the macro
+     * gets expanded, into n_tokens tokens starting at first_token, with
+     * offsets into the text. a macro that never gets used can't fail the
+     * compile that way. */
+    u32 text;
+    u32 text_len;
+    u32 first_token;
+    u32 n_tokens;
+    bool lexed;
+    /* the text where it is in the file, which gets lexed instead of the copy
+     * since the lexer looks at the '\n' after it. the file outlives the
+     * preprocessor. the rest is where it is for the errors lexing it */
+    const char *src;
+    const char *file_path;
+    unsigned line_num;
+    unsigned column_num;
+
+    /* the interned ids of a function-like macro's parameters are n_params ids
+     * in the parameter list, starting at first_param */
+    bool func_like;
+    u32 first_param;
+    u32 n_params;
+    /* once it's lexed, the n_uses uses of the parameters in its tokens are
+     * in the preprocessor's list of them, starting at first_use */
+    u32 first_use;
+    u32 n_uses;
+
+    /* set while the macro's expansion gets rescanned, so it can't expand
+     * itself again */
+    bool expanding;
+    /* how many macros there were when the macro's tokens were last found to
+     * have no macros in them. that holds until there's more of them. the
+     * only way a name becomes a macro is a #define, which adds one even when
+     * it redefines a name. an #undef only takes names away, and tokens that
+     * named no macros still don't after that */
+    u32 n_macros_clean;
 
 };
 
 struct PreProcMacro PreProcMacro_init(void);
-struct PreProcMacro PreProcMacro_create(char *name, char *expansion);
-void PreProcMacro_free(struct PreProcMacro macro);
+struct PreProcMacro PreProcMacro_create(u32 name, u32 text, u32 text_len,
+        u32 first_token, u32 n_tokens);
 
 struct PreProcMacroList {
 
@@ -27,23 +65,56 @@ struct PreProcMacroList {
 
 m_declare_VectorImpl_funcs(PreProcMacroList, struct PreProcMacro)
 
-struct MacroInstance {
+/* n_tokens tokens in the macro token list, starting at first_token. offset
+ * gets added to their offsets, which lets an instance use the tokens of the
+ * macro or of its arguments instead of copies of them. */
+struct MacroSegment {
 
-    char *expansion;
+    u32 first_token;
+    u32 n_tokens;
+    u32 offset;
+
+};
+
+struct MacroSegmentList {
+
+    struct MacroSegment *elems;
+    u32 size;
+    u32 capacity;
+
+};
+
+m_declare_VectorImpl_funcs(MacroSegmentList, struct MacroSegment)
+
+struct MacroInstance {
 
     u32 start_idx;
+    /* the idx after the macro's name, or after the ')' closing the arguments
+     * of a function-like macro */
+    u32 end_idx;
 
-    /* used by #include */
+    /* the file the instance is in */
     const char *file_path;
 
-    const struct PreProcMacro *macro;
+    /* index into the macro list. not a pointer, the list can still grow
+     * after the macro gets used. m_u32_max for an #include, or for a group
+     * an #ifdef left out, which is the whole instance with no segments */
+    u32 macro_idx;
+    /* an #include's index in the include list, m_u32_max for anything
+     * else */
+    u32 include_idx;
+
+    /* what the macro expands to, the n_segments segments in the segment
+     * list starting at first_segment, one after the other */
+    u32 first_segment;
+    u32 n_segments;
 
 };
 
 struct MacroInstance MacroInstance_init(void);
-struct MacroInstance MacroInstance_create(char *expansion, u32 start_idx,
-        const char *file_dir, const struct PreProcMacro *macro);
-void MacroInstance_free(struct MacroInstance macro);
+struct MacroInstance MacroInstance_create(u32 start_idx, u32 end_idx,
+        const char *file_path, u32 macro_idx, u32 first_segment,
+        u32 n_segments);
 
 struct MacroInstList {
 
@@ -55,6 +126,38 @@ struct MacroInstList {
 
 m_declare_VectorImpl_funcs(MacroInstList, struct MacroInstance)
 
-/* automatically inits macros and macro_insts */
-void PreProc_process(const char *src, struct PreProcMacroList *macros,
-        struct MacroInstList *macro_insts, const char *file_path);
+/* a file that got #included. its tokens' offsets start at offset, and insts
+ * are the instances in it, same as the ones for the main file */
+struct MacroInclude {
+
+    const char *path;
+    const char *src;
+    u32 src_len;
+    u32 offset;
+    struct MacroInstList insts;
+
+};
+
+void MacroInclude_free(struct MacroInclude include);
+
+struct MacroIncludeList {
+
+    struct MacroInclude *elems;
+    u32 size;
+    u32 capacity;
+
+};
+
+m_declare_VectorImpl_funcs(MacroIncludeList, struct MacroInclude)
+
+/* automatically inits macros, macro_tokens, macro_segments, macro_insts and
+ * includes. src is read in place and must be '\0' terminated, src_len
+ * doesn't include the '\0'. macro_tokens gets the macros' tokens, their
+ * arguments, what the instances that had to be expanded token by token
+ * expand to, the text of all the expansions and the included files. every
+ * file that gets included is in includes, in the order they got included. */
+void PreProc_process(struct CompilerCtx *ctx, const char *src, u32 src_len,
+        struct PreProcMacroList *macros, struct TokenList *macro_tokens,
+        struct MacroSegmentList *macro_segments,
+        struct MacroInstList *macro_insts, struct MacroIncludeList *includes,
+        const char *file_path);
@@ -31,13 +31,13 @@ void PreToPostFix_convert(struct TokenList *token_tbl) {
 
     for (i = 0; i < token_tbl->size; i++) {
 
-        if (!convertable(token_tbl->elems[i].type))
+        if (!convertable(token_tbl->types[i]))
             continue;
 
-        if (i > 0 && (token_tbl->elems[i-1].type == TokenType_IDENT ||
-                    token_tbl->elems[i-1].type == TokenType_R_PAREN ||
-                    Token_is_literal(token_tbl->elems[i-1].type)))
-            token_tbl->elems[i].type = convert(token_tbl->elems[i].type);
+        if (i > 0 && (token_tbl->types[i-1] == TokenType_IDENT ||
+                    token_tbl->types[i-1] == TokenType_R_PAREN ||
+                    Token_is_literal(token_tbl->types[i-1])))
+            token_tbl->types[i] = convert(token_tbl->types[i]);
 
     }
 
@@ -1,37 +1,247 @@
+#define _POSIX_C_SOURCE 200112L
+
 #include "safe_mem.h"
+#include "bool.h"
+#include <pthread.h>
 #include <stdio.h>
 
-void* safe_malloc(size_t size) {
+/* every allocation is prefixed with one of these, so frees know how big the
+ * allocation was and what it was tagged with */
+struct AllocInfo {
+
+    size_t size;
+    enum MemTag tag;
+    /* allocations from before accounting was enabled don't get counted when
+     * they're freed either */
+    bool counted;
+
+};
+
+union AllocHeader {
+
+    struct AllocInfo info;
+
+    /* keeps the memory after the header as aligned as malloc's */
+    long double align_long_double;
+    void *align_ptr;
+    long align_long;
+
+};
+
+struct MemTagStats {
+
+    unsigned long n_allocs;
+    unsigned long n_frees;
+    unsigned long n_reallocs;
+
+    /* everything ever allocated, reallocs included */
+    unsigned long total_bytes;
+    /* how many bytes reallocs had to carry over */
+    unsigned long realloc_bytes;
+
+    unsigned long live_bytes;
+    unsigned long peak_bytes;
+
+};
+
+static const char *tag_names[MemTag_COUNT] = {
+    "misc",
+    "driver",
+    "source",
+    "preproc",
+    "tokens",
+    "strings",
+    "ast",
+    "symbols",
+    "ir",
+    "output",
+};
+
+/* every thread's SafeMemTrap */
+static pthread_once_t trap_once = PTHREAD_ONCE_INIT;
+static pthread_key_t trap_key;
+
+static bool accounting_on = false;
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct MemTagStats stats[MemTag_COUNT];
+static unsigned long total_live_bytes = 0;
+static unsigned long total_peak_bytes = 0;
+
+static void count_alloc(struct AllocInfo *info, size_t old_size,
+        bool is_realloc) {
+
+    struct MemTagStats *tag_stats = &stats[info->tag];
+
+    info->counted = accounting_on;
+    if (!accounting_on)
+        return;
 
-    void* ptr = malloc(size);
-    if (ptr == NULL) {
-        perror("Malloc failed");
-        exit(EXIT_FAILURE);
+    pthread_mutex_lock(&stats_lock);
+
+    if (is_realloc) {
+        ++tag_stats->n_reallocs;
+        tag_stats->realloc_bytes += old_size;
     }
-    return ptr;
+    else
+        ++tag_stats->n_allocs;
+
+    tag_stats->total_bytes += info->size;
+    tag_stats->live_bytes += info->size;
+    total_live_bytes += info->size;
+
+    if (tag_stats->live_bytes > tag_stats->peak_bytes)
+        tag_stats->peak_bytes = tag_stats->live_bytes;
+    if (total_live_bytes > total_peak_bytes)
+        total_peak_bytes = total_live_bytes;
+
+    pthread_mutex_unlock(&stats_lock);
+
+}
+
+static void count_free(const struct AllocInfo *info, bool is_realloc) {
+
+    if (!info->counted)
+        return;
+
+    pthread_mutex_lock(&stats_lock);
+
+    if (!is_realloc)
+        ++stats[info->tag].n_frees;
+    stats[info->tag].live_bytes -= info->size;
+    total_live_bytes -= info->size;
+
+    pthread_mutex_unlock(&stats_lock);
+
+}
+
+static void create_trap_key(void) {
+
+    pthread_key_create(&trap_key, NULL);
+
+}
+
+struct SafeMemTrap* SafeMem_set_trap(struct SafeMemTrap *trap) {
+
+    struct SafeMemTrap *old_trap = NULL;
+
+    pthread_once(&trap_once, create_trap_key);
+    old_trap = pthread_getspecific(trap_key);
+    pthread_setspecific(trap_key, trap);
+    return old_trap;
 
 }
 
+void SafeMem_fatal(const char *msg) {
 
-void* safe_calloc(size_t num, size_t size) {
+    struct SafeMemTrap *trap = SafeMem_set_trap(NULL);
 
-    void* ptr = calloc(num, size);
-    if (ptr == NULL) {
-        perror("Calloc failed");
-        exit(EXIT_FAILURE);
+    if (trap) {
+        trap->msg = msg;
+        longjmp(trap->jmp, 1);
     }
-    return ptr;
+
+    fprintf(stderr, "%s\n", msg);
+    exit(EXIT_FAILURE);
+
+}
+
+void* safe_malloc(size_t size, enum MemTag tag) {
+
+    union AllocHeader* header = malloc(sizeof(*header)+size);
+    if (header == NULL)
+        SafeMem_fatal("Malloc failed");
+    header->info.size = size;
+    header->info.tag = tag;
+    count_alloc(&header->info, 0, false);
+    return header+1;
+
+}
+
+
+void* safe_calloc(size_t num, size_t size, enum MemTag tag) {
+
+    union AllocHeader* header = NULL;
+    if (size != 0 && num > ((size_t)-1 - sizeof(*header))/size)
+        SafeMem_fatal("Calloc failed: too large");
+    header = calloc(1, sizeof(*header)+num*size);
+    if (header == NULL)
+        SafeMem_fatal("Calloc failed");
+    header->info.size = num*size;
+    header->info.tag = tag;
+    count_alloc(&header->info, 0, false);
+    return header+1;
 
 }
 
 
-void* safe_realloc(void* ptr, size_t size) {
+void* safe_realloc(void* ptr, size_t size, enum MemTag tag) {
+
+    union AllocHeader* header = NULL;
+    size_t old_size = 0;
 
-    void* new_ptr = realloc(ptr, size);
-    if (new_ptr == NULL && size != 0) {
-        perror("Realloc failed");
-        exit(EXIT_FAILURE);
+    if (ptr == NULL)
+        return safe_malloc(size, tag);
+
+    header = (union AllocHeader *)ptr - 1;
+    old_size = header->info.size;
+    count_free(&header->info, true);
+
+    header = realloc(header, sizeof(*header)+size);
+    if (header == NULL)
+        SafeMem_fatal("Realloc failed");
+    header->info.size = size;
+    header->info.tag = tag;
+    count_alloc(&header->info, old_size, true);
+    return header+1;
+
+}
+
+void safe_free(void *ptr) {
+
+    union AllocHeader* header = NULL;
+
+    if (ptr == NULL)
+        return;
+
+    header = (union AllocHeader *)ptr - 1;
+    count_free(&header->info, false);
+    free(header);
+
+}
+
+void SafeMem_enable_accounting(void) {
+
+    pthread_mutex_lock(&stats_lock);
+    accounting_on = true;
+    pthread_mutex_unlock(&stats_lock);
+
+}
+
+void SafeMem_print_report(FILE *stream) {
+
+    unsigned i;
+
+    pthread_mutex_lock(&stats_lock);
+
+    fprintf(stream, "memory report:\n");
+    fprintf(stream, "  %-8s %10s %10s %10s %12s %12s %12s %12s\n", "tag",
+            "allocs", "frees", "reallocs", "bytes", "realloc'd", "peak",
+            "live");
+
+    for (i = 0; i < MemTag_COUNT; i++) {
+        const struct MemTagStats *tag_stats = &stats[i];
+        if (tag_stats->n_allocs == 0 && tag_stats->n_reallocs == 0)
+            continue;
+        fprintf(stream, "  %-8s %10lu %10lu %10lu %12lu %12lu %12lu %12lu\n",
+                tag_names[i], tag_stats->n_allocs, tag_stats->n_frees,
+                tag_stats->n_reallocs, tag_stats->total_bytes,
+                tag_stats->realloc_bytes, tag_stats->peak_bytes,
+                tag_stats->live_bytes);
     }
-    return new_ptr;
+
+    fprintf(stream, "  peak live bytes: %lu, live at exit: %lu\n",
+            total_peak_bytes, total_live_bytes);
+
+    pthread_mutex_unlock(&stats_lock);
 
 }
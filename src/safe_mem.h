@@ -1,16 +1,71 @@
 #pragma once
 
+#include <setjmp.h>
+#include <stdio.h>
 #include <stdlib.h>
 
-/* Frees the pointer and sets it to NULL */
+/* Frees the pointer and sets it to NULL. only for memory that came from the
+ * safe_* functions, use free() for everything else */
 #define m_free(ptr) \
     do { \
-        free(ptr); \
+        safe_free(ptr); \
         ptr = NULL; \
     } while (0)
 
-void* safe_malloc(size_t size);
+/* what an allocation is used for, so -fmem-report can tell which part of the
+ * compiler the memory goes to */
+enum MemTag {
 
-void* safe_calloc(size_t num, size_t size);
+    MemTag_MISC,
+    /* the command line args and batch mode bookkeeping */
+    MemTag_DRIVER,
+    MemTag_SOURCE,
+    MemTag_PREPROC,
+    MemTag_TOKENS,
+    /* copies of identifiers, string literals, etc. */
+    MemTag_STRINGS,
+    MemTag_AST,
+    /* the vars and typedefs the parser keeps track of */
+    MemTag_SYMBOLS,
+    MemTag_IR,
+    MemTag_OUTPUT,
 
-void* safe_realloc(void* ptr, size_t size);
+    MemTag_COUNT
+
+};
+
+void* safe_malloc(size_t size, enum MemTag tag);
+
+void* safe_calloc(size_t num, size_t size, enum MemTag tag);
+
+/* the memory gets moved over to tag if it used to have a different one */
+void* safe_realloc(void* ptr, size_t size, enum MemTag tag);
+
+void safe_free(void *ptr);
+
+/* starts counting every allocation from here on. it's off by default cuz it
+ * has to take a lock for every allocation. */
+void SafeMem_enable_accounting(void);
+
+/* the counts, bytes, peak live bytes and reallocs of every tag */
+void SafeMem_print_report(FILE *stream);
+
+/* somewhere for SafeMem_fatal to jump back to instead of exiting */
+struct SafeMemTrap {
+
+    jmp_buf jmp;
+    /* what went wrong, set right before the jump */
+    const char *msg;
+
+};
+
+/* from here on, SafeMem_fatal on the calling thread longjmps to trap->jmp
+ * instead of exiting. NULL takes the trap away. returns the thread's trap
+ * from before, so it can be put back. the trap gets taken away by the jump
+ * too, its frame might not be around for the next one. */
+struct SafeMemTrap* SafeMem_set_trap(struct SafeMemTrap *trap);
+
+/* for when memory runs out or a table gets too big to index. jumps to the
+ * thread's trap if it has one, otherwise prints msg and exits. never
+ * returns */
+void SafeMem_fatal(const char *msg);
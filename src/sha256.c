@@ -0,0 +1,143 @@
+#include "sha256.h"
+#include "comp_dependent/ints.h"
+#include <string.h>
+
+#define m_rotr(x, n) (((x) >> (n)) | ((x) << (32-(n))))
+
+static const u32 round_consts[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+    0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+    0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+    0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+    0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+    0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+struct Sha256 Sha256_init(void) {
+
+    struct Sha256 sha;
+    sha.state[0] = 0x6a09e667;
+    sha.state[1] = 0xbb67ae85;
+    sha.state[2] = 0x3c6ef372;
+    sha.state[3] = 0xa54ff53a;
+    sha.state[4] = 0x510e527f;
+    sha.state[5] = 0x9b05688c;
+    sha.state[6] = 0x1f83d9ab;
+    sha.state[7] = 0x5be0cd19;
+    sha.block_len = 0;
+    sha.len_low = 0;
+    sha.len_high = 0;
+    return sha;
+
+}
+
+static void process_block(struct Sha256 *self) {
+
+    u32 w[64];
+    u32 a, b, c, d, e, f, g, h;
+    unsigned i;
+
+    for (i = 0; i < 16; i++) {
+        w[i] = (u32)self->block[i*4] << 24 | (u32)self->block[i*4+1] << 16 |
+            (u32)self->block[i*4+2] << 8 | (u32)self->block[i*4+3];
+    }
+    for (i = 16; i < 64; i++) {
+        u32 s0 = m_rotr(w[i-15], 7) ^ m_rotr(w[i-15], 18) ^ (w[i-15] >> 3);
+        u32 s1 = m_rotr(w[i-2], 17) ^ m_rotr(w[i-2], 19) ^ (w[i-2] >> 10);
+        w[i] = w[i-16] + s0 + w[i-7] + s1;
+    }
+
+    a = self->state[0];
+    b = self->state[1];
+    c = self->state[2];
+    d = self->state[3];
+    e = self->state[4];
+    f = self->state[5];
+    g = self->state[6];
+    h = self->state[7];
+
+    for (i = 0; i < 64; i++) {
+        u32 s1 = m_rotr(e, 6) ^ m_rotr(e, 11) ^ m_rotr(e, 25);
+        u32 ch = (e & f) ^ (~e & g);
+        u32 temp1 = h + s1 + ch + round_consts[i] + w[i];
+        u32 s0 = m_rotr(a, 2) ^ m_rotr(a, 13) ^ m_rotr(a, 22);
+        u32 maj = (a & b) ^ (a & c) ^ (b & c);
+        u32 temp2 = s0 + maj;
+
+        h = g;
+        g = f;
+        f = e;
+        e = d + temp1;
+        d = c;
+        c = b;
+        b = a;
+        a = temp1 + temp2;
+    }
+
+    self->state[0] += a;
+    self->state[1] += b;
+    self->state[2] += c;
+    self->state[3] += d;
+    self->state[4] += e;
+    self->state[5] += f;
+    self->state[6] += g;
+    self->state[7] += h;
+
+}
+
+void Sha256_update(struct Sha256 *self, const void *data, u32 len) {
+
+    const u8 *bytes = data;
+
+    if (self->len_low+len < self->len_low)
+        ++self->len_high;
+    self->len_low += len;
+
+    while (len > 0) {
+        u32 n_copied = 64-self->block_len;
+        if (n_copied > len)
+            n_copied = len;
+
+        memcpy(&self->block[self->block_len], bytes, n_copied);
+        self->block_len += n_copied;
+        bytes += n_copied;
+        len -= n_copied;
+
+        if (self->block_len == 64) {
+            process_block(self);
+            self->block_len = 0;
+        }
+    }
+
+}
+
+void Sha256_final(struct Sha256 *self, u8 digest[m_sha256_digest_size]) {
+
+    /* the length gets appended in bits */
+    u32 bits_high = self->len_high << 3 | self->len_low >> 29;
+    u32 bits_low = self->len_low << 3;
+    unsigned i;
+
+    self->block[self->block_len++] = 0x80;
+    if (self->block_len > 56) {
+        memset(&self->block[self->block_len], 0, 64-self->block_len);
+        process_block(self);
+        self->block_len = 0;
+    }
+    memset(&self->block[self->block_len], 0, 56-self->block_len);
+
+    for (i = 0; i < 4; i++) {
+        self->block[56+i] = bits_high >> (24-i*8);
+        self->block[60+i] = bits_low >> (24-i*8);
+    }
+    process_block(self);
+
+    for (i = 0; i < 32; i++)
+        digest[i] = self->state[i/4] >> (24-(i%4)*8);
+
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+/* SHA-256, for the compile cache keys */
+
+#include "comp_dependent/ints.h"
+
+#define m_sha256_digest_size 32
+
+struct Sha256 {
+
+    u32 state[8];
+    u8 block[64];
+    u32 block_len;
+    /* the message length in bytes, split up cuz C89 doesn't have a 64 bit
+     * int */
+    u32 len_low, len_high;
+
+};
+
+struct Sha256 Sha256_init(void);
+void Sha256_update(struct Sha256 *self, const void *data, u32 len);
+void Sha256_final(struct Sha256 *self, u8 digest[m_sha256_digest_size]);
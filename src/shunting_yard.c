@@ -1,10 +1,13 @@
 #include "shunting_yard.h"
+#include "comp_ctx.h"
+#include "arena.h"
 #include "array_lit.h"
 #include "ast.h"
 #include "comp_dependent/ints.h"
 #include "backend_dependent/type_sizes.h"
 #include "err_msg.h"
 #include "identifier.h"
+#include "interner.h"
 #include "parser.h"
 #include "prim_type.h"
 #include "safe_mem.h"
@@ -18,34 +21,33 @@
 #include <stdio.h>
 #include <string.h>
 
-bool SY_error_occurred = false;
-
 /* returns m_u32_max if a token of stop_type type couldn't be found */
-static u32 skip_to_token_type(u32 start_idx, struct TokenList tokens,
+static u32 skip_to_token_type(u32 start_idx, const struct TokenList *tokens,
         enum TokenType stop_type) {
 
     u32 i;
-    for (i = start_idx; i < tokens.size; i++) {
-        if (tokens.elems[i].type == stop_type)
+    for (i = start_idx; i < tokens->size; i++) {
+        if (tokens->types[i] == stop_type)
             return i;
     }
     return m_u32_max;
 
 }
 
-/* same as skip_to_token_type but if the token couldn't be found tokens.size-1,
- * or the index of the last token, is returned instead */
-static u32 skip_to_token_type_alt(u32 start_idx, struct TokenList tokens,
+/* same as skip_to_token_type but if the token couldn't be found
+ * tokens->size-1, or the index of the last token, is returned instead */
+static u32 skip_to_token_type_alt(u32 start_idx, const struct TokenList *tokens,
         enum TokenType stop_type) {
 
     return m_min(skip_to_token_type(start_idx, tokens, stop_type),
-            tokens.size-1);
+            tokens->size-1);
 
 }
 
 /* Moves the operator at the top of the operator queue over to the output
  * queue */
-static void move_operator_to_out_queue(struct ExprPtrList *output_queue,
+static void move_operator_to_out_queue(struct CompilerCtx *ctx,
+        struct ExprPtrList *output_queue,
         struct ExprPtrList *operator_stack, const struct ParVarList *vars) {
 
     struct Expr *operator =
@@ -54,8 +56,8 @@ static void move_operator_to_out_queue(struct ExprPtrList *output_queue,
     if (output_queue->size == 0) {
         /* an error should have already occurred by now, so no need to print
          * anything */
-        assert(SY_error_occurred);
-        ExprPtrList_pop_back(operator_stack, Expr_recur_free_w_self);
+        assert(ctx->sy_error_occurred);
+        ExprPtrList_pop_back(operator_stack, NULL);
         return;
     }
 
@@ -66,18 +68,22 @@ static void move_operator_to_out_queue(struct ExprPtrList *output_queue,
     operator->lhs =
         output_queue->elems[output_queue->size-1-(operator->rhs!=NULL)];
 
-    operator->lhs_lvls_of_indir = Expr_lvls_of_indir(operator->lhs, vars);
-    operator->lhs_type = Expr_type(operator->lhs, vars);
-    operator->lhs_og_type = Expr_type_no_prom(operator->lhs, vars);
+    operator->lhs_lvls_of_indir = Expr_lvls_of_indir(operator->lhs,
+            &ctx->exprs, vars);
+    operator->lhs_type = Expr_type(operator->lhs, &ctx->exprs, vars);
+    operator->lhs_og_type = Expr_type_no_prom(operator->lhs, &ctx->exprs,
+            vars);
     if (operator->rhs) {
-        operator->rhs_lvls_of_indir = Expr_lvls_of_indir(operator->rhs, vars);
-        operator->rhs_type = Expr_type(operator->rhs, vars);
-        operator->rhs_og_type = Expr_type_no_prom(operator->rhs, vars);
+        operator->rhs_lvls_of_indir = Expr_lvls_of_indir(operator->rhs,
+                &ctx->exprs, vars);
+        operator->rhs_type = Expr_type(operator->rhs, &ctx->exprs, vars);
+        operator->rhs_og_type = Expr_type_no_prom(operator->rhs, &ctx->exprs,
+                vars);
     }
 
-    Expr_lvls_of_indir(operator, vars);
-    Expr_type(operator, vars);
-    Expr_type_no_prom(operator, vars);
+    Expr_lvls_of_indir(operator, &ctx->exprs, vars);
+    Expr_type(operator, &ctx->exprs, vars);
+    Expr_type_no_prom(operator, &ctx->exprs, vars);
 
     /* Remove the lhs and rhs from the queue and replace them with the
      * operator. Later on the operator can then act as an operand for the next
@@ -94,14 +100,16 @@ static void move_operator_to_out_queue(struct ExprPtrList *output_queue,
  * check_below_operators  - Checks whether any previous operators in the
  *    operator stack should be popped first.
  */
-static void push_operator_to_stack(struct ExprPtrList *output_queue,
-        struct ExprPtrList *operator_stack, struct Token op_tok,
-        const struct ParVarList *vars) {
-
-    struct Expr *expr = safe_malloc(sizeof(*expr));
-    *expr = Expr_create_w_tok(op_tok, NULL, NULL, 0, 0, PrimType_INVALID,
-            PrimType_INVALID, ExprPtrList_init(), 0, ArrayLit_init(), 0,
-            tok_t_to_expr_t(op_tok.type), false, 0);
+static void push_operator_to_stack(struct CompilerCtx *ctx,
+        struct ExprPtrList *output_queue,
+        struct ExprPtrList *operator_stack, const struct TokenList *token_tbl,
+        u32 op_idx, const struct ParVarList *vars) {
+
+    enum TokenType op_type = token_tbl->types[op_idx];
+    struct Expr *expr = Arena_alloc(&ctx->ast_arena, sizeof(*expr));
+    *expr = Expr_create_w_tok(&ctx->exprs, op_idx, NULL, NULL, 0, 0,
+            PrimType_INVALID, PrimType_INVALID, ExprPtrList_init(), 0,
+            ArrayLit_init(), 0, tok_t_to_expr_t(op_type), false);
 
     /* If the operator o2 at the top of the stack has greater precedence than
      * the current operator o1, o2 must be moved to the output queue. Then if
@@ -112,19 +120,19 @@ static void push_operator_to_stack(struct ExprPtrList *output_queue,
         enum TokenType o2_tok_type = expr_t_to_tok_t(
                 ExprPtrList_back(operator_stack)->expr_type
             );
-        unsigned o1_prec = Token_precedence(op_tok.type);
+        unsigned o1_prec = Token_precedence(op_type);
         unsigned o2_prec = Token_precedence(o2_tok_type);
 
         /* Remember, precedence levels in c are reversed, so 1 is the highest
          * level and 15 is the lowest. */
-        if (!(o2_prec < o1_prec || (Token_l_to_right_asso(op_tok.type) &&
+        if (!(o2_prec < o1_prec || (Token_l_to_right_asso(op_type) &&
                  o2_prec == o1_prec)))
             break;
 
         assert(output_queue->size >=
                 (Token_is_bin_operator(o2_tok_type) ? 2 : 1));
 
-        move_operator_to_out_queue(output_queue, operator_stack, vars);
+        move_operator_to_out_queue(ctx, output_queue, operator_stack, vars);
     }
 
     ExprPtrList_push_back(operator_stack, expr);
@@ -134,23 +142,24 @@ static void push_operator_to_stack(struct ExprPtrList *output_queue,
 /* Reading a right parenthesis works by sending out all the operators that have
  * been inserted to the operator stack between the left parenthesis and the
  * right one in LIFO order */
-static void read_r_paren(struct ExprPtrList *output_queue,
-        struct ExprPtrList *operator_stack, const struct Token *r_paren_tok,
-        const struct ParVarList *vars) {
+static void read_r_paren(struct CompilerCtx *ctx,
+        struct ExprPtrList *output_queue,
+        struct ExprPtrList *operator_stack, const struct TokenList *token_tbl,
+        u32 r_paren_idx, const struct ParVarList *vars) {
 
     while (operator_stack->size > 0 &&
             ExprPtrList_back(operator_stack)->expr_type != ExprType_PAREN) {
-        move_operator_to_out_queue(output_queue, operator_stack, vars);
+        move_operator_to_out_queue(ctx, output_queue, operator_stack, vars);
     }
 
     if (operator_stack->size == 0) {
-        ErrMsg_print(ErrMsg_on, &SY_error_occurred,
-                r_paren_tok->file_path,
+        struct TokenPos pos = TokenList_pos(token_tbl, r_paren_idx);
+        ErrMsg_print(ctx, ErrMsg_on, &ctx->sy_error_occurred, pos.file_path,
                 "parenthesis mismatch. line %u, column %u\n",
-                r_paren_tok->line_num, r_paren_tok->column_num);
+                pos.line_num, pos.column_num);
     }
     else
-        ExprPtrList_pop_back(operator_stack, Expr_recur_free_w_self);
+        ExprPtrList_pop_back(operator_stack, NULL);
 
 }
 
@@ -158,57 +167,64 @@ static void read_r_paren(struct ExprPtrList *output_queue,
  * token_tbl->size if there was no right parenthesis.
  *  f_call_idx  - the index of the identifier of the function call.
  * */
-static u32 read_func_call(const struct TokenList *token_tbl, u32 f_call_idx,
+static u32 read_func_call(struct CompilerCtx *ctx,
+        const struct TokenList *token_tbl, u32 f_call_idx,
         u32 bp, struct ExprPtrList *output_queue,
-        const struct ParVarList *vars, const struct TypedefList *typedefs) {
+        const struct ParVarList *vars) {
 
     /* this'll be useful later */
     u32 arg_start_idx = f_call_idx+2;
 
     struct Expr *expr = NULL;
-    char *name = Token_src(&token_tbl->elems[f_call_idx]);
+    /* most calls only have a few args. holds 7, one slot stays free */
+    struct Expr *args_buf[8];
+    struct ExprPtrList args = ExprPtrList_init_inline(args_buf,
+            sizeof(args_buf)/sizeof(args_buf[0]));
+    u32 name = TokenList_sym(token_tbl, f_call_idx);
     u32 var_idx = ParVarList_find_var(vars, name);
     if (var_idx == m_u32_max) {
-        ErrMsg_print(ErrMsg_on, &SY_error_occurred,
-                token_tbl->elems[f_call_idx].file_path,
+        ErrMsg_print(ctx, ErrMsg_on, &ctx->sy_error_occurred,
+                TokenList_pos(token_tbl, f_call_idx).file_path,
                 "undeclared identifier '%s'. line %u, column %u\n",
-                name, token_tbl->elems[f_call_idx].line_num,
-                token_tbl->elems[f_call_idx].column_num);
-        m_free(name);
-        return skip_to_token_type_alt(f_call_idx, *token_tbl, TokenType_R_PAREN);
+                Interner_str(&ctx->syms, name),
+                TokenList_pos(token_tbl, f_call_idx).line_num,
+                TokenList_pos(token_tbl, f_call_idx).column_num);
+        return skip_to_token_type_alt(f_call_idx, token_tbl,
+                TokenType_R_PAREN);
     }
-    m_free(name);
 
 
-    expr = safe_malloc(sizeof(*expr));
-    *expr = Expr_create_w_tok(token_tbl->elems[f_call_idx], NULL, NULL, 0, 0,
+    expr = Arena_alloc(&ctx->ast_arena, sizeof(*expr));
+    *expr = Expr_create_w_tok(&ctx->exprs, f_call_idx, NULL, NULL, 0, 0,
             PrimType_INVALID, PrimType_INVALID, ExprPtrList_init(), 0,
-            ArrayLit_init(), 0, ExprType_FUNC_CALL, false, 0);
+            ArrayLit_init(), 0, ExprType_FUNC_CALL, false);
 
     /* now, we gotta parse every expression inside the parentheses */
     while (arg_start_idx < token_tbl->size &&
-            token_tbl->elems[arg_start_idx].type != TokenType_R_PAREN) {
+            token_tbl->types[arg_start_idx] != TokenType_R_PAREN) {
 
-        bool old_error_occurred = SY_error_occurred;
+        bool old_error_occurred = ctx->sy_error_occurred;
         bool on_a_comma =
-            token_tbl->elems[arg_start_idx].type == TokenType_COMMA;
+            token_tbl->types[arg_start_idx] == TokenType_COMMA;
         enum TokenType stop_types[] = {TokenType_R_PAREN, TokenType_COMMA};
-        struct Expr *arg = SY_shunting_yard(token_tbl,
+        struct Expr *arg = SY_shunting_yard(ctx, token_tbl,
                 arg_start_idx+on_a_comma, stop_types,
-                sizeof(stop_types)/sizeof(stop_types[0]), &arg_start_idx, vars,
-                bp, false, typedefs, false);
-        SY_error_occurred |= old_error_occurred;
+                sizeof(stop_types)/sizeof(stop_types[0]), &arg_start_idx,
+                bp, false, false);
+        ctx->sy_error_occurred |= old_error_occurred;
 
         if (!arg)
             continue;
 
-        ExprPtrList_push_back(&expr->args, arg);
+        ExprPtrList_push_back(&args, arg);
 
     }
+    m_arena_take_small_vec(&ctx->ast_arena, args);
+    Expr_set_args(&ctx->exprs, expr, args);
 
-    Expr_lvls_of_indir(expr, vars);
-    Expr_type(expr, vars);
-    Expr_type_no_prom(expr, vars);
+    Expr_lvls_of_indir(expr, &ctx->exprs, vars);
+    Expr_type(expr, &ctx->exprs, vars);
+    Expr_type_no_prom(expr, &ctx->exprs, vars);
 
     /* the function call is done being constructed */
     ExprPtrList_push_back(output_queue, expr);
@@ -229,104 +245,107 @@ static bool type_is_in_array(enum TokenType type, enum TokenType *arr,
 
 }
 
-static void push_array_subscr_to_stack(const struct TokenList *token_tbl,
+static void push_array_subscr_to_stack(struct CompilerCtx *ctx,
+        const struct TokenList *token_tbl,
         struct ExprPtrList *output_queue, struct ExprPtrList *operator_stack,
-        u32 l_arr_subscr, u32 *end_idx, const struct ParVarList *vars,
-        u32 bp, const struct TypedefList *typedefs) {
+        u32 l_arr_subscr, u32 *end_idx, u32 bp) {
 
     struct Expr *expr = NULL;
     struct Expr *value = NULL;
     enum TokenType stop_types[] = {TokenType_R_ARR_SUBSCR};
-    bool old_error_occurred = SY_error_occurred;
+    bool old_error_occurred = ctx->sy_error_occurred;
 
-    assert(token_tbl->elems[l_arr_subscr].type == TokenType_L_ARR_SUBSCR);
+    assert(token_tbl->types[l_arr_subscr] == TokenType_L_ARR_SUBSCR);
 
-    value = SY_shunting_yard(token_tbl, l_arr_subscr+1, stop_types,
-            sizeof(stop_types)/sizeof(stop_types[0]), end_idx, vars, bp, false,
-            typedefs, false);
-    SY_error_occurred |= old_error_occurred;
+    value = SY_shunting_yard(ctx, token_tbl, l_arr_subscr+1, stop_types,
+            sizeof(stop_types)/sizeof(stop_types[0]), end_idx, bp, false,
+            false);
+    ctx->sy_error_occurred |= old_error_occurred;
 
-    expr = safe_malloc(sizeof(*expr));
-    *expr = Expr_create_w_tok(token_tbl->elems[l_arr_subscr], NULL, NULL,
+    expr = Arena_alloc(&ctx->ast_arena, sizeof(*expr));
+    *expr = Expr_create_w_tok(&ctx->exprs, l_arr_subscr, NULL, NULL,
             0, 0, PrimType_INVALID, PrimType_INVALID, ExprPtrList_init(), 0,
             ArrayLit_init(), 0,
-            tok_t_to_expr_t(token_tbl->elems[l_arr_subscr].type), false, 0);
+            tok_t_to_expr_t(token_tbl->types[l_arr_subscr]), false);
 
     ExprPtrList_push_back(output_queue, value);
     ExprPtrList_push_back(operator_stack, expr);
 
 }
 
-static void read_array_initializer(const struct TokenList *token_tbl,
+static void read_array_initializer(struct CompilerCtx *ctx,
+        const struct TokenList *token_tbl,
         struct ExprPtrList *output_queue, u32 l_curly_idx, u32 *end_idx,
-        const struct ParVarList *vars, u32 bp,
-        const struct TypedefList *typedefs) {
+        const struct ParVarList *vars, u32 bp) {
 
     struct Expr *array_expr = NULL;
     struct ExprPtrList values = ExprPtrList_init();
     u32 value_idx = l_curly_idx+1;
 
-    assert(token_tbl->elems[l_curly_idx].type == TokenType_L_CURLY);
+    assert(token_tbl->types[l_curly_idx] == TokenType_L_CURLY);
 
     while (value_idx < token_tbl->size &&
-            token_tbl->elems[value_idx].type != TokenType_R_CURLY) {
+            token_tbl->types[value_idx] != TokenType_R_CURLY) {
 
         struct Expr *value = NULL;
-        bool old_error_occurred = SY_error_occurred;
+        bool old_error_occurred = ctx->sy_error_occurred;
         enum TokenType stop_types[] = {TokenType_COMMA, TokenType_R_CURLY};
 
-        if (token_tbl->elems[value_idx].type == TokenType_COMMA) {
+        if (token_tbl->types[value_idx] == TokenType_COMMA) {
             ++value_idx;
             continue;
         }
 
-        value = SY_shunting_yard(token_tbl, value_idx, stop_types,
-                sizeof(stop_types)/sizeof(stop_types[0]), &value_idx, vars,
-                bp, false, typedefs, false);
+        value = SY_shunting_yard(ctx, token_tbl, value_idx, stop_types,
+                sizeof(stop_types)/sizeof(stop_types[0]), &value_idx,
+                bp, false, false);
 
-        if (!SY_error_occurred && !Expr_statically_evaluatable(value)) {
-            ErrMsg_print(ErrMsg_on, &SY_error_occurred,
-                    value->file_path,
+        if (!ctx->sy_error_occurred && !Expr_statically_evaluatable(value)) {
+            struct TokenPos value_pos = Expr_pos(&ctx->exprs, value);
+            ErrMsg_print(ctx, ErrMsg_on, &ctx->sy_error_occurred,
+                    value_pos.file_path,
                     "array initializer elements must be statically"
                     " evaluatable. line %u, column %u\n",
-                    value->line_num, value->column_num
+                    value_pos.line_num, value_pos.column_num
                     );
         }
 
-        SY_error_occurred |= old_error_occurred;
+        ctx->sy_error_occurred |= old_error_occurred;
 
         ExprPtrList_push_back(&values, value);
 
     }
 
     if (value_idx >= token_tbl->size) {
-        ErrMsg_print(ErrMsg_on, &SY_error_occurred,
-                token_tbl->elems[l_curly_idx].file_path,
+        ErrMsg_print(ctx, ErrMsg_on, &ctx->sy_error_occurred,
+                TokenList_pos(token_tbl, l_curly_idx).file_path,
                 "missing '}' for the initializer on line %u,"
-                " column %u\n", token_tbl->elems[l_curly_idx].line_num,
-                token_tbl->elems[l_curly_idx].column_num);
+                " column %u\n", TokenList_pos(token_tbl, l_curly_idx).line_num,
+                TokenList_pos(token_tbl, l_curly_idx).column_num);
     }
 
-    array_expr = safe_malloc(sizeof(*array_expr));
-    *array_expr = Expr_create_w_tok(token_tbl->elems[l_curly_idx], NULL, NULL,
+    m_arena_take_vec(&ctx->ast_arena, values);
+    array_expr = Arena_alloc(&ctx->ast_arena, sizeof(*array_expr));
+    *array_expr = Expr_create_w_tok(&ctx->exprs, l_curly_idx, NULL, NULL,
             0, 0, PrimType_INVALID, PrimType_INVALID, ExprPtrList_init(), 0,
             ArrayLit_create(values.elems, values.size, 0), 0,
-            ExprType_ARRAY_LIT, false, 0);
+            ExprType_ARRAY_LIT, false);
 
-    Expr_lvls_of_indir(array_expr, vars);
-    Expr_type(array_expr, vars);
-    Expr_type_no_prom(array_expr, vars);
+    Expr_lvls_of_indir(array_expr, &ctx->exprs, vars);
+    Expr_type(array_expr, &ctx->exprs, vars);
+    Expr_type_no_prom(array_expr, &ctx->exprs, vars);
 
     ExprPtrList_push_back(output_queue, array_expr);
 
     *end_idx = value_idx;
 
-    /* values doesn't need to be freed cuz it's array has been passed to the
-     * array literal */
+    /* values doesn't need to be freed cuz it's array has been moved to the
+     * arena with the array literal */
 
 }
 
-static void read_string(const struct TokenList *token_tbl,
+static void read_string(struct CompilerCtx *ctx,
+        const struct TokenList *token_tbl,
         struct ExprPtrList *output_queue, u32 str_idx, u32 *end_idx,
         const struct ParVarList *vars) {
 
@@ -335,30 +354,31 @@ static void read_string(const struct TokenList *token_tbl,
 
     u32 i;
     /* account for the NULL terminator */
-    u32 str_len = strlen(token_tbl->elems[str_idx].value.string)+1;
+    u32 str_len = strlen(token_tbl->values[str_idx].string)+1;
 
     for (i = 0; i < str_len; i++) {
 
-        struct Expr *value = safe_malloc(sizeof(*value));
+        struct Expr *value = Arena_alloc(&ctx->ast_arena, sizeof(*value));
 
-        *value = Expr_create_w_tok(token_tbl->elems[i], NULL, NULL, 0, 0,
+        *value = Expr_create_w_tok(&ctx->exprs, i, NULL, NULL, 0, 0,
                 PrimType_INT, PrimType_INVALID, ExprPtrList_init(),
-                token_tbl->elems[str_idx].value.string[i], ArrayLit_init(), 0,
-                ExprType_INT_LIT, false, 0);
+                token_tbl->values[str_idx].string[i], ArrayLit_init(), 0,
+                ExprType_INT_LIT, false);
 
         ExprPtrList_push_back(&values, value);
 
     }
 
-    str_expr = safe_malloc(sizeof(*str_expr));
-    *str_expr = Expr_create_w_tok(token_tbl->elems[str_idx], NULL, NULL,
+    m_arena_take_vec(&ctx->ast_arena, values);
+    str_expr = Arena_alloc(&ctx->ast_arena, sizeof(*str_expr));
+    *str_expr = Expr_create_w_tok(&ctx->exprs, str_idx, NULL, NULL,
             0, 0, PrimType_INVALID, PrimType_INVALID, ExprPtrList_init(), 0,
             ArrayLit_create(values.elems, values.size, m_TypeSize_char), 0,
-            ExprType_ARRAY_LIT, false, 0);
+            ExprType_ARRAY_LIT, false);
 
-    Expr_lvls_of_indir(str_expr, vars);
-    Expr_type(str_expr, vars);
-    Expr_type_no_prom(str_expr, vars);
+    Expr_lvls_of_indir(str_expr, &ctx->exprs, vars);
+    Expr_type(str_expr, &ctx->exprs, vars);
+    Expr_type_no_prom(str_expr, &ctx->exprs, vars);
 
     ExprPtrList_push_back(output_queue, str_expr);
 
@@ -366,7 +386,8 @@ static void read_string(const struct TokenList *token_tbl,
 
 }
 
-static void read_type_cast(const struct TokenList *token_tbl,
+static void read_type_cast(struct CompilerCtx *ctx,
+        const struct TokenList *token_tbl,
         struct ExprPtrList *operator_stack, u32 l_paren_idx, u32 *end_idx,
         const struct TypedefList *typedefs) {
 
@@ -377,22 +398,22 @@ static void read_type_cast(const struct TokenList *token_tbl,
     enum PrimitiveType type;
     unsigned lvls_of_indir;
     struct TypeModifiers mods;
-    *end_idx = TypeSpec_read(token_tbl, type_idx,
+    *end_idx = TypeSpec_read(ctx, token_tbl, type_idx,
             &type, &lvls_of_indir, &mods,
-            typedefs, &SY_error_occurred);
+            typedefs, &ctx->sy_error_occurred);
 
     if (mods.is_static) {
-        ErrMsg_print(ErrMsg_on, &SY_error_occurred,
-                token_tbl->elems[type_idx].file_path,
+        ErrMsg_print(ctx, ErrMsg_on, &ctx->sy_error_occurred,
+                TokenList_pos(token_tbl, type_idx).file_path,
                 "storage specifier in type cast. line %u, column %u.",
-                token_tbl->elems[type_idx].line_num,
-                token_tbl->elems[type_idx].column_num);
+                TokenList_pos(token_tbl, type_idx).line_num,
+                TokenList_pos(token_tbl, type_idx).column_num);
     }
 
-    expr = safe_malloc(sizeof(*expr));
-    *expr = Expr_create_w_tok(token_tbl->elems[l_paren_idx], NULL, NULL, 0, 0,
+    expr = Arena_alloc(&ctx->ast_arena, sizeof(*expr));
+    *expr = Expr_create_w_tok(&ctx->exprs, l_paren_idx, NULL, NULL, 0, 0,
             PrimType_INVALID, PrimType_INVALID, ExprPtrList_init(), 0,
-            ArrayLit_init(), 0, ExprType_TYPECAST, false, 0);
+            ArrayLit_init(), 0, ExprType_TYPECAST, false);
     expr->prim_type = type;
     expr->non_prom_prim_type = type;
     expr->lvls_of_indir = lvls_of_indir;
@@ -400,137 +421,144 @@ static void read_type_cast(const struct TokenList *token_tbl,
     ExprPtrList_push_back(operator_stack, expr);
 
     if (*end_idx >= token_tbl->size ||
-            token_tbl->elems[*end_idx].type != TokenType_R_PAREN) {
-        ErrMsg_print(ErrMsg_on, &SY_error_occurred,
-                token_tbl->elems[l_paren_idx].file_path,
+            token_tbl->types[*end_idx] != TokenType_R_PAREN) {
+        ErrMsg_print(ctx, ErrMsg_on, &ctx->sy_error_occurred,
+                TokenList_pos(token_tbl, l_paren_idx).file_path,
                 "expected a ')' to finish the typecast on line %u,"
-                " column %u.\n", token_tbl->elems[l_paren_idx].line_num,
-                token_tbl->elems[l_paren_idx].column_num);
+                " column %u.\n", TokenList_pos(token_tbl, l_paren_idx).line_num,
+                TokenList_pos(token_tbl, l_paren_idx).column_num);
         return;
     }
 
 }
 
-struct Expr* SY_shunting_yard(const struct TokenList *token_tbl, u32 start_idx,
-        enum TokenType *stop_types, u32 n_stop_types, u32 *end_idx,
-        const struct ParVarList *vars, u32 bp, bool is_initializer,
-        const struct TypedefList *typedefs, bool set_parser_err_occurred) {
-
-    struct ExprPtrList output_queue = ExprPtrList_init();
-    struct ExprPtrList operator_stack = ExprPtrList_init();
+struct Expr* SY_shunting_yard(struct CompilerCtx *ctx,
+        const struct TokenList *token_tbl, u32 start_idx,
+        enum TokenType *stop_types, u32 n_stop_types, u32 *end_idx, u32 bp,
+        bool is_initializer, bool set_parser_err_occurred) {
+
+    const struct ParVarList *vars = &ctx->vars;
+    const struct TypedefList *typedefs = &ctx->typedefs;
+    /* the stacks start out on these, they only go to the heap for long
+     * expressions. each holds 15, one slot stays free */
+    struct Expr *output_buf[16];
+    struct Expr *operator_buf[16];
+    struct ExprPtrList output_queue = ExprPtrList_init_inline(output_buf,
+            sizeof(output_buf)/sizeof(output_buf[0]));
+    struct ExprPtrList operator_stack = ExprPtrList_init_inline(operator_buf,
+            sizeof(operator_buf)/sizeof(operator_buf[0]));
     unsigned n_parens_deep = 0;
     unsigned i;
 
-    SY_error_occurred = false;
+    ctx->sy_error_occurred = false;
+    /* the exprs only keep the index of their token */
+    assert(token_tbl == ctx->exprs.tokens);
 
     for (i = start_idx; i < token_tbl->size; i++) {
-        if (token_tbl->elems[i].type == TokenType_SEMICOLON)
+        if (token_tbl->types[i] == TokenType_SEMICOLON)
             break;
         else if (n_parens_deep == 0 &&
-                type_is_in_array(token_tbl->elems[i].type, stop_types,
+                type_is_in_array(token_tbl->types[i], stop_types,
                     n_stop_types))
             break;
 
-        if (token_tbl->elems[i].type == TokenType_L_ARR_SUBSCR) {
-            push_array_subscr_to_stack(token_tbl, &output_queue,
-                    &operator_stack, i, &i, vars, bp, typedefs);
+        if (token_tbl->types[i] == TokenType_L_ARR_SUBSCR) {
+            push_array_subscr_to_stack(ctx, token_tbl, &output_queue,
+                    &operator_stack, i, &i, bp);
         }
-        else if (Token_is_operator(token_tbl->elems[i].type)) {
-            push_operator_to_stack(&output_queue, &operator_stack,
-                    token_tbl->elems[i], vars);
+        else if (Token_is_operator(token_tbl->types[i])) {
+            push_operator_to_stack(ctx, &output_queue, &operator_stack,
+                    token_tbl, i, vars);
         }
-        else if (token_tbl->elems[i].type == TokenType_L_PAREN) {
+        else if (token_tbl->types[i] == TokenType_L_PAREN) {
             /* it could be a typecast */
-            char *next_src = i+1 < token_tbl->size ?
-                Token_src(&token_tbl->elems[i+1]) : NULL;
-            if (next_src && Ident_type_spec(next_src, typedefs) !=
+            if (i+1 < token_tbl->size &&
+                    Ident_type_spec(TokenList_sym(token_tbl, i+1), typedefs) !=
                     PrimType_INVALID) {
-                read_type_cast(token_tbl, &operator_stack, i, &i, typedefs);
+                read_type_cast(ctx, token_tbl, &operator_stack, i, &i,
+                        typedefs);
             }
             else {
-                struct Expr *expr = safe_malloc(sizeof(*expr));
-                *expr = Expr_create_w_tok(token_tbl->elems[i], NULL, NULL, 0, 0,
-                        PrimType_INVALID, PrimType_INVALID, ExprPtrList_init(), 0,
-                        ArrayLit_init(), 0, ExprType_PAREN, false, 0);
+                struct Expr *expr = Arena_alloc(&ctx->ast_arena, sizeof(*expr));
+                *expr = Expr_create_w_tok(&ctx->exprs, i, NULL, NULL, 0, 0,
+                        PrimType_INVALID, PrimType_INVALID,
+                                ExprPtrList_init(), 0,
+                        ArrayLit_init(), 0, ExprType_PAREN, false);
                 ExprPtrList_push_back(&operator_stack, expr);
                 ++n_parens_deep;
             }
-            m_free(next_src);
         }
-        else if (token_tbl->elems[i].type == TokenType_R_PAREN) {
-            read_r_paren(&output_queue, &operator_stack, &token_tbl->elems[i],
+        else if (token_tbl->types[i] == TokenType_R_PAREN) {
+            read_r_paren(ctx, &output_queue, &operator_stack, token_tbl, i,
                     vars);
             --n_parens_deep;
         }
-        else if (token_tbl->elems[i].type == TokenType_L_CURLY) {
-            read_array_initializer(token_tbl, &output_queue, i, &i, vars, bp,
-                    typedefs);
+        else if (token_tbl->types[i] == TokenType_L_CURLY) {
+            read_array_initializer(ctx, token_tbl, &output_queue, i, &i, vars,
+                    bp);
         }
-        else if (token_tbl->elems[i].type == TokenType_STR_LIT) {
-            read_string(token_tbl, &output_queue, i, &i, vars);
+        else if (token_tbl->types[i] == TokenType_STR_LIT) {
+            read_string(ctx, token_tbl, &output_queue, i, &i, vars);
         }
         else if (i+1 < token_tbl->size &&
-                token_tbl->elems[i].type == TokenType_IDENT &&
-                token_tbl->elems[i+1].type == TokenType_L_PAREN) {
+                token_tbl->types[i] == TokenType_IDENT &&
+                token_tbl->types[i+1] == TokenType_L_PAREN) {
             u32 old_i = i;
-            i = read_func_call(token_tbl, i, bp, &output_queue, vars,
-                    typedefs);
+            i = read_func_call(ctx, token_tbl, i, bp, &output_queue, vars);
             if (i == token_tbl->size) {
-                char *func_name = Token_src(&token_tbl->elems[old_i]);
-                ErrMsg_print(ErrMsg_on, &SY_error_occurred,
-                        token_tbl->elems[old_i].file_path,
+                ErrMsg_print(ctx, ErrMsg_on, &ctx->sy_error_occurred,
+                        TokenList_pos(token_tbl, old_i).file_path,
                         "missing ')' to finish the call to %s on line %u,"
-                        " column %u\n", func_name,
-                        token_tbl->elems[old_i].line_num,
-                        token_tbl->elems[old_i].column_num);
-                m_free(func_name);
+                        " column %u\n",
+                        Interner_str(&ctx->syms,
+                            TokenList_sym(token_tbl, old_i)),
+                        TokenList_pos(token_tbl, old_i).line_num,
+                        TokenList_pos(token_tbl, old_i).column_num);
             }
         }
-        else if (token_tbl->elems[i].type == TokenType_IDENT) {
+        else if (token_tbl->types[i] == TokenType_IDENT) {
             struct Expr *expr = NULL;
-            char *name = Token_src(&token_tbl->elems[i]);
+            u32 name = TokenList_sym(token_tbl, i);
             u32 var_idx = ParVarList_find_var(vars, name);
             if (var_idx == m_u32_max) {
-                ErrMsg_print(ErrMsg_on, &SY_error_occurred,
-                        token_tbl->elems[i].file_path,
+                ErrMsg_print(ctx, ErrMsg_on, &ctx->sy_error_occurred,
+                        TokenList_pos(token_tbl, i).file_path,
                         "undeclared identifier '%s'. line %u, column %u\n",
-                        name, token_tbl->elems[i].line_num,
-                        token_tbl->elems[i].column_num);
-                m_free(name);
+                        Interner_str(&ctx->syms, name),
+                        TokenList_pos(token_tbl, i).line_num,
+                        TokenList_pos(token_tbl, i).column_num);
                 continue;
             }
-            m_free(name);
 
-            expr = safe_malloc(sizeof(*expr));
-            *expr = Expr_create_w_tok(token_tbl->elems[i], NULL, NULL,
+            expr = Arena_alloc(&ctx->ast_arena, sizeof(*expr));
+            *expr = Expr_create_w_tok(&ctx->exprs, i, NULL, NULL,
                     vars->elems[var_idx].lvls_of_indir, 0,
                     vars->elems[var_idx].type, PrimType_INVALID,
                     ExprPtrList_init(), 0, ArrayLit_init(),
                     vars->elems[var_idx].stack_pos-bp,
-                    ExprType_IDENT, vars->elems[var_idx].is_array,
-                    vars->elems[var_idx].array_len);
-            Expr_lvls_of_indir(expr, vars);
-            Expr_type_no_prom(expr, vars);
-            Expr_type(expr, vars);
+                    ExprType_IDENT, vars->elems[var_idx].is_array);
+            Expr_lvls_of_indir(expr, &ctx->exprs, vars);
+            Expr_type_no_prom(expr, &ctx->exprs, vars);
+            Expr_type(expr, &ctx->exprs, vars);
             ExprPtrList_push_back(&output_queue, expr);
         }
-        else if (token_tbl->elems[i].type == TokenType_INT_LIT) {
-            struct Expr *expr = safe_malloc(sizeof(*expr));
-            *expr = Expr_create_w_tok(token_tbl->elems[i], NULL, NULL, 0, 0,
+        else if (token_tbl->types[i] == TokenType_INT_LIT) {
+            struct Expr *expr = Arena_alloc(&ctx->ast_arena, sizeof(*expr));
+            *expr = Expr_create_w_tok(&ctx->exprs, i, NULL, NULL, 0, 0,
                     PrimType_INT, PrimType_INVALID, ExprPtrList_init(),
-                    token_tbl->elems[i].value.int_value, ArrayLit_init(), 0,
-                    ExprType_INT_LIT, false, 0);
-            Expr_lvls_of_indir(expr, vars);
-            Expr_type_no_prom(expr, vars);
-            Expr_type(expr, vars);
+                    token_tbl->values[i].int_value, ArrayLit_init(), 0,
+                    ExprType_INT_LIT, false);
+            Expr_lvls_of_indir(expr, &ctx->exprs, vars);
+            Expr_type_no_prom(expr, &ctx->exprs, vars);
+            Expr_type(expr, &ctx->exprs, vars);
             ExprPtrList_push_back(&output_queue, expr);
         }
         else {
-            ErrMsg_print(true, &SY_error_occurred,
-                    token_tbl->elems[i].file_path,
+            ErrMsg_print(ctx, true, &ctx->sy_error_occurred,
+                    TokenList_pos(token_tbl, i).file_path,
                     "unknown token at %u,%u\n",
-                    token_tbl->elems[i].line_num,
-                    token_tbl->elems[i].column_num);
+                    TokenList_pos(token_tbl, i).line_num,
+                    TokenList_pos(token_tbl, i).column_num);
             assert(false);
         }
 
@@ -548,41 +576,42 @@ struct Expr* SY_shunting_yard(const struct TokenList *token_tbl, u32 start_idx,
         if (operator_stack.size > 0 && output_queue.size <
                 (ExprType_is_bin_operator(
                     ExprPtrList_back(&operator_stack)->expr_type) ? 2U : 1U)) {
-            ErrMsg_print(ErrMsg_on, &SY_error_occurred,
-                    ExprPtrList_back(&operator_stack)->file_path,
+            struct TokenPos op_pos = Expr_pos(&ctx->exprs,
+                    ExprPtrList_back(&operator_stack));
+            ErrMsg_print(ctx, ErrMsg_on, &ctx->sy_error_occurred,
+                    op_pos.file_path,
                     "missing an operand for the operator on line %u,"
                     " column %u.\n",
-                    ExprPtrList_back(&operator_stack)->line_num,
-                    ExprPtrList_back(&operator_stack)->column_num);
-            ExprPtrList_pop_back(&operator_stack, Expr_recur_free_w_self);
+                    op_pos.line_num, op_pos.column_num);
+            ExprPtrList_pop_back(&operator_stack, NULL);
         }
         else
-            move_operator_to_out_queue(&output_queue, &operator_stack, vars);
+            move_operator_to_out_queue(ctx, &output_queue, &operator_stack,
+            vars);
     }
     ExprPtrList_free(&operator_stack);
 
     if (output_queue.size == 1) {
         struct Expr *expr = output_queue.elems[0];
         ExprPtrList_free(&output_queue);
-        SY_error_occurred |= Expr_verify(expr, vars, is_initializer);
+        ctx->sy_error_occurred |= Expr_verify(ctx, expr, vars, is_initializer);
         if (set_parser_err_occurred)
-            Parser_error_occurred |= SY_error_occurred;
+            ctx->parser_error_occurred |= ctx->sy_error_occurred;
 
         return expr;
     }
     else {
-        ErrMsg_print(ErrMsg_on, &SY_error_occurred,
-                token_tbl->elems[start_idx].file_path,
+        ErrMsg_print(ctx, ErrMsg_on, &ctx->sy_error_occurred,
+                TokenList_pos(token_tbl, start_idx).file_path,
                 "missing %s in the expression starting at line %u,"
                 " column %u.\n",
                 output_queue.size == 0 ? "operands" : "operators",
-                token_tbl->elems[start_idx].line_num,
-                token_tbl->elems[start_idx].column_num);
+                TokenList_pos(token_tbl, start_idx).line_num,
+                TokenList_pos(token_tbl, start_idx).column_num);
         if (set_parser_err_occurred)
-            Parser_error_occurred |= SY_error_occurred;
+            ctx->parser_error_occurred |= ctx->sy_error_occurred;
 
-        while (output_queue.size > 0)
-            ExprPtrList_pop_back(&output_queue, Expr_recur_free_w_self);
+        /* the exprs in it live in the arena */
         ExprPtrList_free(&output_queue);
         return NULL;
     }
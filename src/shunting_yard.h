@@ -6,7 +6,7 @@
 #include "parser_var.h"
 #include "typedef.h"
 
-extern bool SY_error_occurred;
+struct CompilerCtx;
 
 /*
  * this function automatically stops at the first semicolon it finds,
@@ -14,14 +14,14 @@ extern bool SY_error_occurred;
  * stop_types   - Stop reading tokens after encountering a token with a type in
  *                stop_types. Doesn't stop if that token is inside another
  *                of parentheses.
- * set_parser_err_occurred - Set Parser_error_occurred to true if an error
+ * set_parser_err_occurred - Set ctx->parser_error_occurred to true if an error
  *                           occurs.
  * function automatically stops at if it reaches the end of the token table.
  * end_idx, if not NULL, is set to the index of the first token after the
  * expression, i.e. either the first token of type stop_type or
  * token_tbl->size.
  */
-struct Expr* SY_shunting_yard(const struct TokenList *token_tbl, u32 start_idx,
-        enum TokenType *stop_types, u32 n_stop_types, u32 *end_idx,
-        const struct ParVarList *vars, u32 bp, bool is_initializer,
-        const struct TypedefList *typedefs, bool set_parser_err_occurred);
+struct Expr* SY_shunting_yard(struct CompilerCtx *ctx,
+        const struct TokenList *token_tbl, u32 start_idx,
+        enum TokenType *stop_types, u32 n_stop_types, u32 *end_idx, u32 bp,
+        bool is_initializer, bool set_parser_err_occurred);
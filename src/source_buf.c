@@ -0,0 +1,95 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include "source_buf.h"
+#include "comp_dependent/ints.h"
+#include "file_io.h"
+#include "safe_mem.h"
+#include "bool.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+struct SourceBuf SourceBuf_init(void) {
+
+    struct SourceBuf buf;
+    buf.src = NULL;
+    buf.len = 0;
+    buf.map_len = 0;
+    return buf;
+
+}
+
+/* the bytes past the end of a file in its last page are guaranteed to be 0,
+ * so the sentinel comes for free unless the file fills the whole page. the
+ * caller falls back to reading the file if this returns false. */
+static bool map_file(struct SourceBuf *self, int fd, const struct stat *st) {
+
+    long page_size = sysconf(_SC_PAGESIZE);
+    void *map = NULL;
+
+    if (!S_ISREG(st->st_mode) || st->st_size <= 0 ||
+            (unsigned long)st->st_size >= m_u32_max || page_size <= 0 ||
+            st->st_size % page_size == 0)
+        return false;
+
+    map = mmap(NULL, st->st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED)
+        return false;
+
+    self->src = map;
+    self->len = st->st_size;
+    self->map_len = st->st_size;
+
+    return true;
+
+}
+
+bool SourceBuf_open(struct SourceBuf *self, const char *file_path,
+        FILE *err_stream) {
+
+    bool use_stdin = strcmp(file_path, "-") == 0;
+    int fd = use_stdin ? STDIN_FILENO : open(file_path, O_RDONLY);
+    struct stat st;
+    char *contents = NULL;
+
+    *self = SourceBuf_init();
+
+    if (fd < 0) {
+        fprintf(err_stream, "Cannot open file \'%s\': %s\n", file_path,
+                strerror(errno));
+        return false;
+    }
+
+    if (fstat(fd, &st) == 0 && map_file(self, fd, &st)) {
+        close(fd);
+        return true;
+    }
+
+    contents = read_fd_into_str(fd, &self->len);
+    if (!contents) {
+        fprintf(err_stream, "Cannot read file \'%s\': %s\n", file_path,
+                strerror(errno));
+    }
+    self->src = contents;
+
+    if (!use_stdin)
+        close(fd);
+
+    return contents != NULL;
+
+}
+
+void SourceBuf_free(struct SourceBuf *self) {
+
+    if (self->map_len > 0)
+        munmap((void *)self->src, self->map_len);
+    else
+        safe_free((void *)self->src);
+
+    *self = SourceBuf_init();
+
+}
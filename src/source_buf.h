@@ -0,0 +1,29 @@
+#pragma once
+
+/* a read-only view of a source file. the contents are always followed by a
+ * '\0', so the pre-processor and the lexer can read them in place. */
+
+#include "comp_dependent/ints.h"
+#include "bool.h"
+#include <stdio.h>
+
+struct SourceBuf {
+
+    const char *src;
+    u32 len;
+
+    /* the size of the mapping if src is mmap'd, 0 if it's on the heap */
+    u32 map_len;
+
+};
+
+struct SourceBuf SourceBuf_init(void);
+
+/* mmaps the file if possible, otherwise it gets streamed in, which is what
+ * happens with pipes. a file_path of "-" reads stdin.
+ * prints an error to err_stream and returns false if the file couldn't be
+ * read. */
+bool SourceBuf_open(struct SourceBuf *self, const char *file_path,
+        FILE *err_stream);
+
+void SourceBuf_free(struct SourceBuf *self);
@@ -0,0 +1,149 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include "time_report.h"
+#include "trace.h"
+#include <string.h>
+#include <time.h>
+
+static const char *stage_names[TimeStage_COUNT] = {
+    "preproc",
+    "lex",
+    "merge strings",
+    "bin to unary",
+    "pre to post fix",
+    "parse",
+    "const fold",
+    "ir",
+    "emit",
+};
+
+/* what the items of each stage are */
+static const char *stage_units[TimeStage_COUNT] = {
+    "bytes",
+    "tokens",
+    "tokens",
+    "tokens",
+    "tokens",
+    "nodes",
+    "nodes",
+    "instrs",
+    "instrs",
+};
+
+struct TimeReport TimeReport_init(void) {
+
+    struct TimeReport report;
+    memset(&report, 0, sizeof(report));
+    report.enabled = false;
+    return report;
+
+}
+
+const char* TimeStage_name(enum TimeStage stage) {
+
+    return stage_names[stage];
+
+}
+
+const char* TimeStage_unit(enum TimeStage stage) {
+
+    return stage_units[stage];
+
+}
+
+double TimeReport_now(void) {
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec/1e9;
+
+}
+
+void TimeReport_start(struct TimeReport *self) {
+
+    if (self->enabled || Trace_on)
+        self->start_time = TimeReport_now();
+
+}
+
+void TimeReport_stop(struct TimeReport *self, enum TimeStage stage,
+        u32 n_items) {
+
+    Trace_end("stage", stage_names[stage], NULL, self->start_time);
+
+    if (!self->enabled)
+        return;
+
+    self->seconds[stage] += TimeReport_now()-self->start_time;
+    self->n_items[stage] += n_items;
+    self->ran[stage] = true;
+
+}
+
+static void print_json_str(const char *str, FILE *stream) {
+
+    fputc('"', stream);
+    for (; *str != '\0'; str++) {
+        if (*str == '"' || *str == '\\')
+            fprintf(stream, "\\%c", *str);
+        else if ((unsigned char)*str < 0x20)
+            fprintf(stream, "\\u%04x", (unsigned char)*str);
+        else
+            fputc(*str, stream);
+    }
+    fputc('"', stream);
+
+}
+
+static void print_json(const struct TimeReport *self, const char *file_path,
+        double total, FILE *stream) {
+
+    unsigned i;
+
+    fprintf(stream, "{\"file\": ");
+    print_json_str(file_path, stream);
+    fprintf(stream, ", \"total_ms\": %.3f, \"stages\": [", total*1e3);
+
+    for (i = 0; i < TimeStage_COUNT; i++) {
+        fprintf(stream, "%s{\"name\": \"%s\", \"ran\": %s, \"wall_ms\": %.3f,"
+                " \"percent\": %.1f, \"items\": %u, \"unit\": \"%s\"}",
+                i == 0 ? "" : ", ", stage_names[i],
+                self->ran[i] ? "true" : "false", self->seconds[i]*1e3,
+                total > 0 ? self->seconds[i]/total*100 : 0.0,
+                self->n_items[i], stage_units[i]);
+    }
+
+    fprintf(stream, "]}\n");
+
+}
+
+void TimeReport_print(const struct TimeReport *self, const char *file_path,
+        bool json, FILE *stream) {
+
+    double total = 0;
+    unsigned i;
+
+    for (i = 0; i < TimeStage_COUNT; i++)
+        total += self->seconds[i];
+
+    if (json) {
+        print_json(self, file_path, total, stream);
+        return;
+    }
+
+    fprintf(stream, "time report for '%s':\n", file_path);
+    fprintf(stream, "  %-16s %12s %7s %12s\n", "stage", "wall (ms)", "%",
+            "items");
+
+    for (i = 0; i < TimeStage_COUNT; i++) {
+        if (!self->ran[i])
+            continue;
+        fprintf(stream, "  %-16s %12.3f %6.1f%% %12u %s\n", stage_names[i],
+                self->seconds[i]*1e3,
+                total > 0 ? self->seconds[i]/total*100 : 0.0,
+                self->n_items[i], stage_units[i]);
+    }
+
+    fprintf(stream, "  %-16s %12.3f %6.1f%%\n", "total", total*1e3, 100.0);
+
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+/* per-stage wall clock times for -ftime-report */
+
+#include "comp_dependent/ints.h"
+#include "bool.h"
+#include <stdio.h>
+
+/* in the order they run in */
+enum TimeStage {
+
+    TimeStage_PREPROC,
+    TimeStage_LEX,
+    TimeStage_MERGE_STRINGS,
+    TimeStage_BIN_TO_UNARY,
+    TimeStage_PRE_TO_POST_FIX,
+    TimeStage_PARSE,
+    TimeStage_CONST_FOLD,
+    TimeStage_IR,
+    TimeStage_EMIT,
+
+    TimeStage_COUNT
+
+};
+
+struct TimeReport {
+
+    /* if false, starting and stopping stages does nothing */
+    bool enabled;
+
+    /* when the stage that's currently running was started */
+    double start_time;
+
+    double seconds[TimeStage_COUNT];
+    /* how many tokens/nodes/instructions/etc. each stage went through */
+    u32 n_items[TimeStage_COUNT];
+    bool ran[TimeStage_COUNT];
+
+};
+
+struct TimeReport TimeReport_init(void);
+
+const char* TimeStage_name(enum TimeStage stage);
+/* what the items of the stage are, "tokens", "nodes", etc. */
+const char* TimeStage_unit(enum TimeStage stage);
+
+/* seconds since some arbitrary point, from a monotonic clock */
+double TimeReport_now(void);
+
+/* these also record a trace span for the stage if -ftrace is on */
+void TimeReport_start(struct TimeReport *self);
+/* adds the time since the last TimeReport_start to the stage */
+void TimeReport_stop(struct TimeReport *self, enum TimeStage stage,
+        u32 n_items);
+
+/* prints a table, or a single line of JSON if json is true */
+void TimeReport_print(const struct TimeReport *self, const char *file_path,
+        bool json, FILE *stream);
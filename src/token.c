@@ -1,44 +1,12 @@
 #include "token.h"
+#include "interner.h"
 #include "safe_mem.h"
 #include "vector_impl.h"
 #include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
-struct Token Token_create(unsigned line_num, unsigned column_num,
-        const char *src_start, unsigned src_len, const char *file_path,
-        enum TokenType type) {
-
-    struct Token token;
-    token.line_num = line_num;
-    token.column_num = column_num;
-    token.src_start = src_start;
-    token.src_len = src_len;
-    token.file_path = file_path;
-    token.type = type;
-    memset(&token.value, 0, sizeof(token.value));
-    return token;
-
-}
-
-struct Token Token_create_w_val(unsigned line_num, unsigned column_num,
-        const char *src_start, unsigned src_len, const char *file_path,
-        enum TokenType type, union TokenValue value) {
-
-    struct Token token = Token_create(line_num, column_num, src_start, src_len,
-            file_path, type);
-    token.value = value;
-    return token;
-
-}
-
-void Token_free(struct Token token) {
-
-    if (token.type == TokenType_STR_LIT) {
-        m_free(token.value.string);
-    }
-
-}
-
 bool Token_is_unary_operator(enum TokenType type) {
 
     return type > TokenType_UNARY_OPS_START &&
@@ -73,6 +41,13 @@ bool Token_is_literal(enum TokenType type) {
 
 }
 
+bool Token_is_type_modifier(enum TokenType type) {
+
+    return type == TokenType_UNSIGNED || type == TokenType_SIGNED ||
+        type == TokenType_STATIC;
+
+}
+
 bool Token_convert_to_unary(enum TokenType type) {
 
     switch (type) {
@@ -171,13 +146,426 @@ bool Token_l_to_right_asso(enum TokenType type) {
 
 }
 
-char* Token_src(const struct Token *self) {
+m_define_VectorImpl_funcs(TokenExpansionList, struct TokenExpansion,
+        MemTag_TOKENS)
+m_define_VectorImpl_funcs(TokenOffsetList, u32, MemTag_TOKENS)
+m_define_VectorImpl_funcs(TokenTextList, char, MemTag_TOKENS)
+m_define_VectorImpl_funcs(TokenFileList, struct TokenFile, MemTag_TOKENS)
+m_define_VectorImpl_funcs(TokenIncludeList, struct TokenInclude,
+        MemTag_TOKENS)
+
+struct TokenList TokenList_init(void) {
+
+    struct TokenList list;
+    list.types = NULL;
+    list.src_offsets = NULL;
+    list.src_lens = NULL;
+    list.file_ids = NULL;
+    list.values = NULL;
+    list.size = 0;
+    list.capacity = 0;
+    list.src = NULL;
+    list.src_len = 0;
+    list.line_starts = TokenOffsetList_init();
+    list.expansion_text = TokenTextList_init();
+    list.expansions = TokenExpansionList_init();
+    list.includes = TokenIncludeList_init();
+    list.expansions_len = 0;
+    list.files = TokenFileList_init();
+    return list;
+
+}
+
+void TokenList_free(struct TokenList *self) {
+
+    u32 i;
+
+    for (i = 0; i < self->size; i++) {
+        if (self->types[i] == TokenType_STR_LIT)
+            m_free(self->values[i].string);
+    }
+
+    m_free(self->types);
+    m_free(self->src_offsets);
+    m_free(self->src_lens);
+    m_free(self->file_ids);
+    m_free(self->values);
+    self->size = 0;
+    self->capacity = 0;
+
+    TokenOffsetList_free(&self->line_starts);
+    TokenTextList_free(&self->expansion_text);
+    TokenExpansionList_free(&self->expansions);
+    TokenIncludeList_free(&self->includes);
+    TokenFileList_free(&self->files);
+
+}
+
+static void set_capacity(struct TokenList *self, u32 capacity) {
+
+    self->types = safe_realloc(self->types, capacity*sizeof(*self->types),
+            MemTag_TOKENS);
+    self->src_offsets = safe_realloc(self->src_offsets,
+            capacity*sizeof(*self->src_offsets), MemTag_TOKENS);
+    self->src_lens = safe_realloc(self->src_lens,
+            capacity*sizeof(*self->src_lens), MemTag_TOKENS);
+    self->file_ids = safe_realloc(self->file_ids,
+            capacity*sizeof(*self->file_ids), MemTag_TOKENS);
+    self->values = safe_realloc(self->values,
+            capacity*sizeof(*self->values), MemTag_TOKENS);
+    self->capacity = capacity;
+
+}
+
+/* like the vectors, the capacity is always kept at least one bigger than the
+ * size */
+void TokenList_reserve(struct TokenList *self, u32 n_tokens) {
+
+    /* the union is the biggest of the arrays */
+    size_t max_capacity = (size_t)-1 / sizeof(*self->values);
+    if (max_capacity > m_u32_max)
+        max_capacity = m_u32_max;
+
+    if (n_tokens < self->capacity)
+        return;
+    if (n_tokens >= max_capacity)
+        SafeMem_fatal("TokenList is too large");
+
+    set_capacity(self, n_tokens+1);
+
+}
+
+void TokenList_set_src(struct TokenList *self, const char *src, u32 src_len) {
+
+    const char *line_end = src;
+
+    self->src = src;
+    self->src_len = src_len;
+
+    TokenOffsetList_clear(&self->line_starts, NULL);
+    TokenOffsetList_push_back(&self->line_starts, 0);
+    while ((line_end = memchr(line_end, '\n', src+src_len-line_end))) {
+        ++line_end;
+        TokenOffsetList_push_back(&self->line_starts, line_end-src);
+    }
+
+}
+
+u16 TokenList_add_file(struct TokenList *self, const char *file_path) {
+
+    return TokenList_add_included_file(self, file_path, NULL, NULL);
+
+}
+
+u16 TokenList_add_included_file(struct TokenList *self, const char *file_path,
+        const char *src, const struct TokenOffsetList *line_starts) {
+
+    struct TokenFile file;
+    u32 i;
+
+    for (i = 0; i < self->files.size; i++) {
+        if (self->files.elems[i].path == file_path)
+            return i;
+    }
+
+    if (self->files.size > m_u16_max)
+        SafeMem_fatal("too many files");
+
+    file.path = file_path;
+    file.src = src;
+    file.line_starts = line_starts;
+    TokenFileList_push_back(&self->files, file);
+    return self->files.size-1;
+
+}
+
+/* makes room for len more offsets past the end of src */
+static u32 reserve_offsets(struct TokenList *self, u32 len) {
+
+    u32 start = self->src_len + self->expansions_len;
+
+    if (len >= m_u32_max - start)
+        SafeMem_fatal("TokenList is too large");
+
+    self->expansions_len += len;
+    return start;
+
+}
+
+u32 TokenList_add_include(struct TokenList *self, u16 file_id, u32 src_len) {
+
+    struct TokenInclude include;
+    include.start = reserve_offsets(self, src_len);
+    include.file_id = file_id;
+    TokenIncludeList_push_back(&self->includes, include);
+    return include.start;
+
+}
+
+void TokenList_take_expansions(struct TokenList *self, struct TokenList *from) {
+
+    assert(self->expansions.size == 0 && self->files.size == 0 &&
+            self->src_len == from->src_len);
+
+    TokenTextList_free(&self->expansion_text);
+    TokenExpansionList_free(&self->expansions);
+    TokenIncludeList_free(&self->includes);
+    TokenFileList_free(&self->files);
+    self->expansion_text = from->expansion_text;
+    self->expansions = from->expansions;
+    self->includes = from->includes;
+    self->files = from->files;
+    self->expansions_len = from->expansions_len;
+
+    from->expansion_text = TokenTextList_init();
+    from->expansions = TokenExpansionList_init();
+    from->includes = TokenIncludeList_init();
+    from->files = TokenFileList_init();
+    from->expansions_len = 0;
+
+}
+
+u32 TokenList_add_expansion_text(struct TokenList *self, const char *text,
+        u32 text_len) {
+
+    u32 text_idx = self->expansion_text.size;
+    TokenTextList_append_n(&self->expansion_text, text, text_len);
+    return text_idx;
+
+}
+
+u32 TokenList_add_expansion(struct TokenList *self, u32 text, u32 text_len,
+        u32 use_offset) {
+
+    struct TokenExpansion expansion;
+    expansion.start = reserve_offsets(self, text_len);
+    expansion.use_offset = use_offset;
+    expansion.text = text;
+    TokenExpansionList_push_back(&self->expansions, expansion);
+    return expansion.start;
+
+}
+
+/* makes room for n more tokens, doubling the capacity like the vectors */
+static void grow(struct TokenList *self, u32 n) {
+
+    if (self->size+n >= self->capacity) {
+        u32 capacity = self->capacity < m_vector_impl_min_capacity ?
+            m_vector_impl_min_capacity : self->capacity;
+        while (capacity <= self->size+n)
+            capacity = capacity > m_u32_max/2 ? m_u32_max : capacity*2;
+        TokenList_reserve(self, capacity);
+    }
+
+}
+
+void TokenList_push_back(struct TokenList *self, enum TokenType type,
+        u32 src_offset, u32 src_len, u16 file_id, union TokenValue value) {
+
+    grow(self, 1);
+
+    self->types[self->size] = type;
+    self->src_offsets[self->size] = src_offset;
+    self->src_lens[self->size] = src_len;
+    self->file_ids[self->size] = file_id;
+    self->values[self->size] = value;
+    ++self->size;
+
+}
+
+void TokenList_move(struct TokenList *self, u32 dest_idx, u32 src_idx) {
+
+    self->types[dest_idx] = self->types[src_idx];
+    self->src_offsets[dest_idx] = self->src_offsets[src_idx];
+    self->src_lens[dest_idx] = self->src_lens[src_idx];
+    self->file_ids[dest_idx] = self->file_ids[src_idx];
+    self->values[dest_idx] = self->values[src_idx];
+
+}
+
+/* the expansion offset is in, offset has to be past the end of src. NULL if
+ * it's in an include */
+static const struct TokenExpansion* find_expansion(
+        const struct TokenList *self, u32 offset) {
+
+    u32 low = 0;
+    u32 high = self->expansions.size;
+
+    if (high == 0 || self->expansions.elems[0].start > offset)
+        return NULL;
+
+    while (high - low > 1) {
+        u32 mid = low + (high-low)/2;
+        if (self->expansions.elems[mid].start <= offset)
+            low = mid;
+        else
+            high = mid;
+    }
+
+    return &self->expansions.elems[low];
+
+}
+
+/* the include offset is in, offset has to be past the end of src. NULL if
+ * it's in an expansion */
+static const struct TokenInclude* find_include(const struct TokenList *self,
+        u32 offset) {
+
+    const struct TokenExpansion *expansion = find_expansion(self, offset);
+    u32 low = 0;
+    u32 high = self->includes.size;
+
+    if (high == 0 || self->includes.elems[0].start > offset)
+        return NULL;
+
+    while (high - low > 1) {
+        u32 mid = low + (high-low)/2;
+        if (self->includes.elems[mid].start <= offset)
+            low = mid;
+        else
+            high = mid;
+    }
+
+    if (expansion && expansion->start > self->includes.elems[low].start)
+        return NULL;
+
+    return &self->includes.elems[low];
+
+}
+
+void TokenList_truncate(struct TokenList *self, u32 size) {
+
+    u32 i;
+
+    for (i = size; i < self->size; i++) {
+        if (self->types[i] == TokenType_STR_LIT)
+            m_free(self->values[i].string);
+    }
+
+    if (size < self->size)
+        self->size = size;
+
+}
+
+void TokenList_take(struct TokenList *self, struct TokenList *from,
+        u32 start) {
 
-    char *str = safe_malloc((self->src_len+1)*sizeof(*str));
-    strncpy(str, self->src_start, self->src_len);
-    str[self->src_len] = '\0';
+    u32 n = from->size-start;
+
+    grow(self, n);
+
+    memcpy(&self->types[self->size], &from->types[start],
+            n*sizeof(*self->types));
+    memcpy(&self->src_offsets[self->size], &from->src_offsets[start],
+            n*sizeof(*self->src_offsets));
+    memcpy(&self->src_lens[self->size], &from->src_lens[start],
+            n*sizeof(*self->src_lens));
+    memcpy(&self->file_ids[self->size], &from->file_ids[start],
+            n*sizeof(*self->file_ids));
+    memcpy(&self->values[self->size], &from->values[start],
+            n*sizeof(*self->values));
+
+    self->size += n;
+    from->size = start;
+
+}
+
+const char* TokenList_text_at(const struct TokenList *self, u32 offset) {
+
+    const struct TokenExpansion *expansion = NULL;
+    const struct TokenInclude *include = NULL;
+
+    if (offset < self->src_len)
+        return &self->src[offset];
+
+    include = find_include(self, offset);
+    if (include) {
+        return &self->files.elems[include->file_id].src[
+            offset - include->start];
+    }
+
+    expansion = find_expansion(self, offset);
+    return &self->expansion_text.elems[expansion->text +
+        offset - expansion->start];
+
+}
+
+const char* TokenList_src_start(const struct TokenList *self, u32 idx) {
+
+    return TokenList_text_at(self, self->src_offsets[idx]);
+
+}
+
+char* TokenList_src(const struct TokenList *self, u32 idx) {
+
+    u32 len = self->src_lens[idx];
+    char *str = safe_malloc((len+1)*sizeof(*str), MemTag_STRINGS);
+    memcpy(str, TokenList_src_start(self, idx), len);
+    str[len] = '\0';
     return str;
 
 }
 
-m_define_VectorImpl_funcs(TokenList, struct Token)
+/* the line offset is on, as an index into line_starts */
+static u32 find_line(const struct TokenOffsetList *line_starts, u32 offset) {
+
+    u32 low = 0;
+    u32 high = line_starts->size;
+
+    while (high - low > 1) {
+        u32 mid = low + (high-low)/2;
+        if (line_starts->elems[mid] <= offset)
+            low = mid;
+        else
+            high = mid;
+    }
+
+    return low;
+
+}
+
+/* an expanded token sits where the macro was used, plus however far into the
+ * expansion it is, same as the lexer counts it. an included token is
+ * wherever it is in its own file */
+static void offset_pos(const struct TokenList *self, u32 offset,
+        unsigned *line_num, unsigned *column_num) {
+
+    const struct TokenOffsetList *line_starts = &self->line_starts;
+    u32 line;
+
+    if (offset >= self->src_len) {
+        const struct TokenInclude *include = find_include(self, offset);
+        if (!include) {
+            const struct TokenExpansion *expansion =
+                find_expansion(self, offset);
+            offset_pos(self, expansion->use_offset, line_num, column_num);
+            *column_num += offset - expansion->start;
+            return;
+        }
+        line_starts = self->files.elems[include->file_id].line_starts;
+        offset -= include->start;
+    }
+
+    line = find_line(line_starts, offset);
+    *line_num = line+1;
+    *column_num = offset - line_starts->elems[line] + 1;
+
+}
+
+struct TokenPos TokenList_pos(const struct TokenList *self, u32 idx) {
+
+    struct TokenPos pos;
+    pos.file_path = self->files.elems[self->file_ids[idx]].path;
+    offset_pos(self, self->src_offsets[idx], &pos.line_num, &pos.column_num);
+    return pos;
+
+}
+
+u32 TokenList_sym(const struct TokenList *self, u32 idx) {
+
+    if (self->types[idx] != TokenType_IDENT)
+        return m_interner_no_id;
+
+    return self->values[idx].sym_id;
+
+}
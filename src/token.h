@@ -79,6 +79,11 @@ enum TokenType {
 
     TokenType_VARIADIC,
 
+    /* '#' and '##' in a macro's expansion. the preprocessor gets rid of them
+     * before the parser could see them */
+    TokenType_STRINGIZE,
+    TokenType_TOKEN_PASTE,
+
     TokenType_DEBUG_PRINT_RAX
 
 };
@@ -86,47 +91,134 @@ enum TokenType {
 union TokenValue {
     u32 int_value;
     char *string;
+    /* IDENT tokens, the identifier's id in the context's interner */
+    u32 sym_id;
 };
 
-struct Token {
+/* where a token is, for diagnostics. worked out on demand by TokenList_pos */
+struct TokenPos {
 
+    const char *file_path;
     unsigned line_num;
     unsigned column_num;
 
-    /* Start of the part of the source file that represents this token */
-    const char *src_start;
-    unsigned src_len;
+};
 
-    /* the file the token is in */
-    const char *file_path;
+/* a macro expansion the lexer went through. its tokens' offsets start at
+ * start, and the macro's name was at use_offset. every use of a macro shares
+ * the same text, which is at index text in expansion_text. */
+struct TokenExpansion {
 
-    enum TokenType type;
-    union TokenValue value;
+    u32 start;
+    u32 use_offset;
+    u32 text;
 
 };
 
-struct TokenList {
+struct TokenExpansionList {
 
-    struct Token *elems;
+    struct TokenExpansion *elems;
     u32 size;
     u32 capacity;
 
 };
 
-/* Memsets value to all 0s */
-struct Token Token_create(unsigned line_num, unsigned column_num,
-        const char *src_start, unsigned src_len, const char *file_path,
-        enum TokenType type);
-struct Token Token_create_w_val(unsigned line_num, unsigned column_num,
-        const char *src_start, unsigned src_len, const char *file_path,
-        enum TokenType type, union TokenValue value);
-void Token_free(struct Token token);
+struct TokenOffsetList {
+
+    u32 *elems;
+    u32 size;
+    u32 capacity;
+
+};
+
+struct TokenTextList {
+
+    char *elems;
+    u32 size;
+    u32 capacity;
+
+};
+
+/* an entry in the file table. an #included file's text and the offsets its
+ * lines start at are kept here, both are NULL for the list's own src */
+struct TokenFile {
+
+    const char *path;
+    const char *src;
+    const struct TokenOffsetList *line_starts;
+
+};
+
+struct TokenFileList {
+
+    struct TokenFile *elems;
+    u32 size;
+    u32 capacity;
+
+};
+
+/* the text of an #included file, file_id in the file table. its tokens'
+ * offsets start at start */
+struct TokenInclude {
+
+    u32 start;
+    u16 file_id;
+
+};
+
+struct TokenIncludeList {
+
+    struct TokenInclude *elems;
+    u32 size;
+    u32 capacity;
+
+};
+
+/* the tokens are kept as a structure of arrays, token i being index i in each
+ * of the per token arrays. most passes only look at the types, so those get a
+ * dense array of their own. */
+struct TokenList {
+
+    /* enum TokenTypes */
+    u8 *types;
+    /* where each token's text starts. offsets below src_len are in src, the
+     * rest are in one of the expansions or includes. */
+    u32 *src_offsets;
+    u32 *src_lens;
+    /* indices into files */
+    u16 *file_ids;
+    union TokenValue *values;
+    u32 size;
+    u32 capacity;
+
+    /* the source file's text. not owned, it has to outlive the list */
+    const char *src;
+    u32 src_len;
+    /* the offset each line in src starts at */
+    struct TokenOffsetList line_starts;
+
+    /* a copy of the text of every macro that got expanded, one after the
+     * other */
+    struct TokenTextList expansion_text;
+    /* sorted by start */
+    struct TokenExpansionList expansions;
+    /* sorted by start too, the includes get their offsets from the same
+     * range as the expansions */
+    struct TokenIncludeList includes;
+    /* how many offsets past src_len the expansions and includes take up */
+    u32 expansions_len;
+
+    struct TokenFileList files;
+
+};
 
 bool Token_is_unary_operator(enum TokenType type);
 bool Token_is_bin_operator(enum TokenType type);
 bool Token_is_operator(enum TokenType type);
 bool Token_is_cmp_operator(enum TokenType type);
 bool Token_is_literal(enum TokenType type);
+/* unsigned, signed or static */
+bool Token_is_type_modifier(enum TokenType type);
 /* only works on token types that have a unary equivalent, such as
  * TokenType_MINUS->TokenType_NEGATIVE */
 bool Token_convert_to_unary(enum TokenType type);
@@ -136,8 +228,59 @@ unsigned Token_precedence(enum TokenType type);
 /* Does the token have left to right associativity? */
 bool Token_l_to_right_asso(enum TokenType type);
 
-/* uses src_start and src_len to return a null terminated string.
- * the string is dynamically allocated and must be freed */
-char* Token_src(const struct Token *self);
+m_declare_VectorImpl_funcs(TokenExpansionList, struct TokenExpansion)
+m_declare_VectorImpl_funcs(TokenOffsetList, u32)
+m_declare_VectorImpl_funcs(TokenTextList, char)
+m_declare_VectorImpl_funcs(TokenFileList, struct TokenFile)
+m_declare_VectorImpl_funcs(TokenIncludeList, struct TokenInclude)
+
+struct TokenList TokenList_init(void);
+/* frees the strings of the string literals too */
+void TokenList_free(struct TokenList *self);
+void TokenList_reserve(struct TokenList *self, u32 n_tokens);
+/* src has to be '\0' terminated and outlive the list */
+void TokenList_set_src(struct TokenList *self, const char *src, u32 src_len);
+/* returns the file id to give the file's tokens */
+u16 TokenList_add_file(struct TokenList *self, const char *file_path);
+/* same as TokenList_add_file, for a file that gets #included. src and
+ * line_starts have to outlive the list */
+u16 TokenList_add_included_file(struct TokenList *self, const char *file_path,
+        const char *src, const struct TokenOffsetList *line_starts);
+/* the file file_id, src_len chars long, got included. returns the offset its
+ * tokens start at. */
+u32 TokenList_add_include(struct TokenList *self, u16 file_id, u32 src_len);
+/* takes over the expansions of from, their text, its files and its includes.
+ * self can't have any expansions or files of its own yet, and both have to
+ * have the same src. */
+void TokenList_take_expansions(struct TokenList *self, struct TokenList *from);
+/* copies the text of a macro, to be shared by all its expansions. returns the
+ * index of the copy in expansion_text. */
+u32 TokenList_add_expansion_text(struct TokenList *self, const char *text,
+        u32 text_len);
+/* a macro whose text is at index text in expansion_text got expanded at
+ * use_offset. returns the offset its tokens start at. */
+u32 TokenList_add_expansion(struct TokenList *self, u32 text, u32 text_len,
+        u32 use_offset);
+void TokenList_push_back(struct TokenList *self, enum TokenType type,
+        u32 src_offset, u32 src_len, u16 file_id, union TokenValue value);
+/* copies token src_idx over token dest_idx, for compacting the list in place.
+ * dest_idx's old value isn't freed. */
+void TokenList_move(struct TokenList *self, u32 dest_idx, u32 src_idx);
+/* drops every token from size on, freeing their strings */
+void TokenList_truncate(struct TokenList *self, u32 size);
+/* moves the tokens of from starting at start onto the end of self. their
+ * strings belong to self after */
+void TokenList_take(struct TokenList *self, struct TokenList *from,
+        u32 start);
 
-m_declare_VectorImpl_funcs(TokenList, struct Token)
+/* the text at a token offset. points into src, expansion_text or an included
+ * file, so it isn't '\0' terminated */
+const char* TokenList_text_at(const struct TokenList *self, u32 offset);
+/* same as TokenList_text_at with the token's offset */
+const char* TokenList_src_start(const struct TokenList *self, u32 idx);
+/* returns the token's text as a null terminated string.
+ * the string is dynamically allocated and must be freed */
+char* TokenList_src(const struct TokenList *self, u32 idx);
+struct TokenPos TokenList_pos(const struct TokenList *self, u32 idx);
+/* the interned id of an IDENT token, m_interner_no_id for any other token */
+u32 TokenList_sym(const struct TokenList *self, u32 idx);
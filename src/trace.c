@@ -0,0 +1,151 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include "trace.h"
+#include "time_report.h"
+#include "safe_mem.h"
+#include "comp_dependent/ints.h"
+#include <pthread.h>
+#include <stdio.h>
+
+/* the same threads keep coming back, so there's no need for more */
+#define m_trace_max_threads 256
+
+struct TraceEvent {
+
+    char name[m_trace_name_capacity];
+    const char *category;
+    /* in microseconds since tracing was enabled */
+    double start;
+    double duration;
+    unsigned thread_id;
+
+};
+
+bool Trace_on = false;
+
+static pthread_mutex_t trace_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct TraceEvent *ring = NULL;
+/* how many events have been recorded in total, including overwritten ones */
+static unsigned long n_events = 0;
+static double enable_time = 0;
+
+static pthread_t threads[m_trace_max_threads];
+static unsigned n_threads = 0;
+
+void Trace_enable(void) {
+
+    ring = safe_malloc(m_trace_ring_capacity*sizeof(*ring), MemTag_MISC);
+    enable_time = TimeReport_now();
+    Trace_on = true;
+
+}
+
+double Trace_begin(void) {
+
+    return Trace_on ? TimeReport_now() : 0;
+
+}
+
+/* gives every thread a small id so they show up as separate tracks. has to
+ * be called with trace_lock held */
+static unsigned thread_id(void) {
+
+    pthread_t self = pthread_self();
+    unsigned i;
+
+    for (i = 0; i < n_threads; i++) {
+        if (pthread_equal(threads[i], self))
+            return i+1;
+    }
+
+    if (n_threads == m_trace_max_threads)
+        return 0;
+    threads[n_threads++] = self;
+    return n_threads;
+
+}
+
+/* copies src into the name without anything that'd need escaping in JSON */
+static u32 copy_name(char *name, u32 name_len, const char *src) {
+
+    for (; *src != '\0' && name_len < m_trace_name_capacity-1; src++) {
+        if (*src == '"' || *src == '\\' || (unsigned char)*src < 0x20)
+            name[name_len++] = '?';
+        else
+            name[name_len++] = *src;
+    }
+
+    return name_len;
+
+}
+
+void Trace_end(const char *category, const char *name,
+        const char *name_suffix, double start) {
+
+    double end;
+    struct TraceEvent *event = NULL;
+    u32 name_len = 0;
+
+    if (!Trace_on)
+        return;
+
+    end = TimeReport_now();
+
+    pthread_mutex_lock(&trace_lock);
+
+    event = &ring[n_events++ % m_trace_ring_capacity];
+    name_len = copy_name(event->name, name_len, name);
+    if (name_suffix)
+        name_len = copy_name(event->name, name_len, name_suffix);
+    event->name[name_len] = '\0';
+    event->category = category;
+    event->start = (start-enable_time)*1e6;
+    event->duration = (end-start)*1e6;
+    event->thread_id = thread_id();
+
+    pthread_mutex_unlock(&trace_lock);
+
+}
+
+bool Trace_write(const char *file_path) {
+
+    FILE *file = NULL;
+    unsigned long first_event = 0;
+    unsigned long i;
+    bool write_failed = false;
+
+    if (!Trace_on)
+        return true;
+
+    file = fopen(file_path, "w");
+    if (!file)
+        return false;
+
+    pthread_mutex_lock(&trace_lock);
+
+    if (n_events > m_trace_ring_capacity)
+        first_event = n_events-m_trace_ring_capacity;
+
+    fprintf(file, "{\"traceEvents\": [\n");
+    for (i = first_event; i < n_events; i++) {
+        const struct TraceEvent *event = &ring[i % m_trace_ring_capacity];
+        fprintf(file, "%s{\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"X\","
+                " \"ts\": %.3f, \"dur\": %.3f, \"pid\": 1, \"tid\": %u}",
+                i == first_event ? "" : ",\n", event->name, event->category,
+                event->start, event->duration, event->thread_id);
+    }
+    fprintf(file, "\n], \"displayTimeUnit\": \"ms\", \"otherData\": "
+            "{\"dropped_events\": %lu}}\n", first_event);
+
+    Trace_on = false;
+    m_free(ring);
+    n_events = 0;
+
+    pthread_mutex_unlock(&trace_lock);
+
+    write_failed = ferror(file) != 0;
+    write_failed |= fclose(file) != 0;
+
+    return !write_failed;
+
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+/* chrome/perfetto trace events for -ftrace. finished spans get copied into a
+ * ring that's allocated up front and written out as JSON at exit, so leaving
+ * it on doesn't cost much more than two clock reads per span. */
+
+#include "bool.h"
+
+/* how many spans the ring holds. the oldest ones get overwritten once it's
+ * full */
+#define m_trace_ring_capacity 32768
+/* longer span names get cut off */
+#define m_trace_name_capacity 64
+
+/* don't set this directly, use Trace_enable */
+extern bool Trace_on;
+
+/* has to be called before any other threads are started */
+void Trace_enable(void);
+
+/* returns the start time to give to Trace_end */
+double Trace_begin(void);
+
+/* records a span from start to now. the name is name followed by name_suffix,
+ * which can be NULL. category groups the spans, like "stage" or "func". */
+void Trace_end(const char *category, const char *name,
+        const char *name_suffix, double start);
+
+/* writes the spans to file_path as a chrome trace event JSON object and
+ * frees the ring. returns false if the file couldn't be written. */
+bool Trace_write(const char *file_path);
@@ -1,4 +1,5 @@
 #include "type_spec.h"
+#include "comp_ctx.h"
 #include "err_msg.h"
 #include "identifier.h"
 #include "prim_type.h"
@@ -10,7 +11,8 @@
 #include <string.h>
 
 /* returns the index of the token after the last type modifier */
-static u32 read_type_modifiers(const struct TokenList *token_tbl, u32 mod_idx,
+static u32 read_type_modifiers(struct CompilerCtx *ctx,
+        const struct TokenList *token_tbl, u32 mod_idx,
         struct TypeModifiers *mods, bool *is_signed, bool *has_signed_mod,
         bool *error_occurred) {
 
@@ -18,11 +20,9 @@ static u32 read_type_modifiers(const struct TokenList *token_tbl, u32 mod_idx,
     bool signed_mod = false;
     bool unsigned_mod = false;
 
-    char *cur_tok_src = Token_src(&token_tbl->elems[mod_idx]);
+    while (Token_is_type_modifier(token_tbl->types[mod_idx])) {
 
-    while (Ident_modifier_str_to_tok(cur_tok_src) != TokenType_NONE) {
-
-        enum TokenType type = Ident_modifier_str_to_tok(cur_tok_src);
+        enum TokenType type = token_tbl->types[mod_idx];
 
         if (type == TokenType_UNSIGNED)
             unsigned_mod = true;
@@ -33,19 +33,16 @@ static u32 read_type_modifiers(const struct TokenList *token_tbl, u32 mod_idx,
         else
             assert(false);
 
-        m_free(cur_tok_src);
-        cur_tok_src = Token_src(&token_tbl->elems[++mod_idx]);
+        ++mod_idx;
 
     }
 
-    m_free(cur_tok_src);
-
     if (signed_mod && unsigned_mod) {
-        ErrMsg_print(ErrMsg_on, error_occurred,
-                token_tbl->elems[mod_idx].file_path,
+        ErrMsg_print(ctx, ErrMsg_on, error_occurred,
+                TokenList_pos(token_tbl, mod_idx).file_path,
                 "cannot mix signed and unsigned modifiers. line %u,"
-                " column %u.\n", token_tbl->elems[mod_idx].line_num,
-                token_tbl->elems[mod_idx].column_num);
+                " column %u.\n", TokenList_pos(token_tbl, mod_idx).line_num,
+                TokenList_pos(token_tbl, mod_idx).column_num);
     }
 
     if (is_signed)
@@ -60,7 +57,8 @@ static u32 read_type_modifiers(const struct TokenList *token_tbl, u32 mod_idx,
 
 }
 
-u32 TypeSpec_read(const struct TokenList *token_tbl, u32 type_spec_idx,
+u32 TypeSpec_read(struct CompilerCtx *ctx, const struct TokenList *token_tbl,
+        u32 type_spec_idx,
         enum PrimitiveType *type, unsigned *lvls_of_indir,
         struct TypeModifiers *mods,
         const struct TypedefList *typedefs, bool *error_occurred) {
@@ -71,14 +69,14 @@ u32 TypeSpec_read(const struct TokenList *token_tbl, u32 type_spec_idx,
     bool is_signed;
     bool has_signed_mod;
     bool missing_type_spec = false;
-    char *type_name = NULL;
+    u32 type_name;
     unsigned n_asterisks = 0;
 
     type_spec_idx =
-        read_type_modifiers(token_tbl, type_spec_idx, mods, &is_signed,
+        read_type_modifiers(ctx, token_tbl, type_spec_idx, mods, &is_signed,
                 &has_signed_mod, error_occurred);
 
-    type_name = Token_src(&token_tbl->elems[type_spec_idx]);
+    type_name = TokenList_sym(token_tbl, type_spec_idx);
 
     spec_type = Ident_type_spec(type_name, typedefs);
     missing_type_spec = spec_type == PrimType_INVALID;
@@ -93,11 +91,11 @@ u32 TypeSpec_read(const struct TokenList *token_tbl, u32 type_spec_idx,
         spec_mods = TypeModifiers_init();
     }
     else {
-        ErrMsg_print(ErrMsg_on, error_occurred,
-                token_tbl->elems[type_spec_idx-1].file_path,
+        ErrMsg_print(ctx, ErrMsg_on, error_occurred,
+                TokenList_pos(token_tbl, type_spec_idx-1).file_path,
                 "missing a type specifier on line %u, column %u.\n",
-                token_tbl->elems[type_spec_idx-1].line_num,
-                token_tbl->elems[type_spec_idx-1].column_num);
+                TokenList_pos(token_tbl, type_spec_idx-1).line_num,
+                TokenList_pos(token_tbl, type_spec_idx-1).column_num);
         /* defaulting the type to int so everything doesn't crash */
         spec_type = PrimType_INT;
         spec_lvls_of_indir = 0;
@@ -106,29 +104,43 @@ u32 TypeSpec_read(const struct TokenList *token_tbl, u32 type_spec_idx,
 
     if (!is_signed) {
         if (spec_type == PrimType_VOID) {
-            ErrMsg_print(ErrMsg_on, error_occurred,
-                    token_tbl->elems[type_spec_idx].file_path,
+            ErrMsg_print(ctx, ErrMsg_on, error_occurred,
+                    TokenList_pos(token_tbl, type_spec_idx).file_path,
                     "'void' has no unsigned equivalent. line %u, column %u.\n",
-                    token_tbl->elems[type_spec_idx].line_num,
-                    token_tbl->elems[type_spec_idx].column_num);
+                    TokenList_pos(token_tbl, type_spec_idx).line_num,
+                    TokenList_pos(token_tbl, type_spec_idx).column_num);
         }
         else
             spec_type = PrimitiveType_make_unsigned(spec_type);
     }
 
-    while (token_tbl->elems[type_spec_idx+1+n_asterisks].type ==
+    while (token_tbl->types[type_spec_idx+1+n_asterisks] ==
             TokenType_DEREFERENCE ||
-            token_tbl->elems[type_spec_idx+1+n_asterisks].type ==
+            token_tbl->types[type_spec_idx+1+n_asterisks] ==
             TokenType_MUL) {
         ++n_asterisks;
     }
 
     if (spec_type == PrimType_INVALID) {
-        ErrMsg_print(ErrMsg_on, error_occurred,
-                token_tbl->elems[type_spec_idx].file_path,
+        char *type_src = TokenList_src(token_tbl, type_spec_idx);
+        ErrMsg_print(ctx, ErrMsg_on, error_occurred,
+                TokenList_pos(token_tbl, type_spec_idx).file_path,
                 "unknown type '%s' on line %u, column %u.\n",
-                type_name, token_tbl->elems[type_spec_idx].line_num,
-                token_tbl->elems[type_spec_idx].column_num);
+                type_src, TokenList_pos(token_tbl, type_spec_idx).line_num,
+                TokenList_pos(token_tbl, type_spec_idx).column_num);
+        m_free(type_src);
+    }
+    /* the parser looks ahead with lvls_of_indir NULL first, that doesn't get
+     * the error too */
+    else if (spec_lvls_of_indir+n_asterisks > m_max_lvls_of_indir) {
+        if (lvls_of_indir)
+            ErrMsg_print(ctx, ErrMsg_on, error_occurred,
+                    TokenList_pos(token_tbl, type_spec_idx).file_path,
+                    "more than %u levels of indirection on line %u,"
+                    " column %u.\n", m_max_lvls_of_indir,
+                    TokenList_pos(token_tbl, type_spec_idx).line_num,
+                    TokenList_pos(token_tbl, type_spec_idx).column_num);
+        spec_lvls_of_indir = m_max_lvls_of_indir;
     }
     else {
         spec_lvls_of_indir += n_asterisks;
@@ -141,8 +153,6 @@ u32 TypeSpec_read(const struct TokenList *token_tbl, u32 type_spec_idx,
     if (mods)
         *mods = TypeModifiers_combine(mods, &spec_mods, true, error_occurred);
 
-    m_free(type_name);
-
     return type_spec_idx-missing_type_spec+n_asterisks+1;
 
 }
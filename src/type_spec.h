@@ -6,10 +6,13 @@
 #include "typedef.h"
 #include "type_mods.h"
 
+struct CompilerCtx;
+
 /* returns the index of the next token after the type name and the asterisks.
  * if *error_occurred is already equal to true, it will stay true.
  * type_spec_idx can also point to a type modifier like const or static. */
-u32 TypeSpec_read(const struct TokenList *token_tbl, u32 type_spec_idx,
+u32 TypeSpec_read(struct CompilerCtx *ctx, const struct TokenList *token_tbl,
+        u32 type_spec_idx,
         enum PrimitiveType *type, unsigned *lvls_of_indir,
         struct TypeModifiers *mods,
         const struct TypedefList *typedefs, bool *error_occurred);
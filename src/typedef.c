@@ -1,6 +1,6 @@
 #include "typedef.h"
+#include "interner.h"
 #include "prim_type.h"
-#include "safe_mem.h"
 #include "type_mods.h"
 #include "vector_impl.h"
 #include <stddef.h>
@@ -8,7 +8,7 @@
 struct Typedef Typedef_init(void) {
 
     struct Typedef x;
-    x.type_name = NULL;
+    x.type_name = m_interner_no_id;
     x.conv_type = PrimType_INVALID;
     x.conv_lvls_of_indir = 0;
     x.conv_mods = TypeModifiers_init();
@@ -16,7 +16,7 @@ struct Typedef Typedef_init(void) {
 
 }
 
-struct Typedef Typedef_create(char *type_name, enum PrimitiveType conv_type,
+struct Typedef Typedef_create(u32 type_name, enum PrimitiveType conv_type,
         unsigned conv_lvls_of_indir, struct TypeModifiers conv_mods) {
 
     struct Typedef x;
@@ -28,10 +28,4 @@ struct Typedef Typedef_create(char *type_name, enum PrimitiveType conv_type,
 
 }
 
-void Typedef_free(struct Typedef x) {
-
-    m_free(x.type_name);
-
-}
-
-m_define_VectorImpl_funcs(TypedefList, struct Typedef)
+m_define_VectorImpl_funcs(TypedefList, struct Typedef, MemTag_SYMBOLS)
@@ -7,7 +7,8 @@
 
 struct Typedef {
 
-    char *type_name;
+    /* the interned id of the name */
+    u32 type_name;
     enum PrimitiveType conv_type;
     unsigned conv_lvls_of_indir;
     struct TypeModifiers conv_mods;
@@ -15,9 +16,8 @@ struct Typedef {
 };
 
 struct Typedef Typedef_init(void);
-struct Typedef Typedef_create(char *type_name, enum PrimitiveType conv_type,
+struct Typedef Typedef_create(u32 type_name, enum PrimitiveType conv_type,
         unsigned conv_lvls_of_indir, struct TypeModifiers conv_mods);
-void Typedef_free(struct Typedef x);
 
 struct TypedefList {
 
@@ -2,15 +2,43 @@
 
 /* Macros to quickly create vector types
  * Requires the vector struct contains elems, size and capacity.
+ * MemTag is the enum MemTag the elements get allocated with.
+ *
+ * The SmallVecImpl variant is for vectors that usually stay tiny. They can
+ * start out on storage the caller owns, like an array on the stack, and only
+ * move to the heap once that's full. The struct additionally needs an
+ * inline_elems member pointing to that storage, or NULL if there is none.
+ * The storage has to stay alive for as long as the vector might be using it.
+ * Like any vector it keeps one slot free, so storage for n elements holds
+ * n-1 of them before the vector moves to the heap.
+ *
+ * A vector whose elements got moved into an arena (m_arena_take_vec) has
+ * capacity == size, which a vector that can still grow never has. Anything
+ * that would reallocate it asserts instead.
  */
 
+#include <assert.h>
+
 #include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "safe_mem.h"
+#include "comp_dependent/ints.h"
+
+/* the smallest capacity a vector gets once something is pushed to it */
+#define m_vector_impl_min_capacity 8
 
-#define m_define_VectorImpl_funcs(VecStruct, ElemType) \
+#define m_define_VectorImpl_funcs(VecStruct, ElemType, MemTag) \
     m_define_VectorImpl_init(VecStruct) \
     m_define_VectorImpl_free(VecStruct) \
+    m_define_VectorImpl_set_capacity(VecStruct, MemTag) \
+    m_define_VectorImpl_grow(VecStruct) \
+    m_define_VectorImpl_reserve(VecStruct) \
+    m_define_VectorImpl_shrink_to_fit(VecStruct) \
     m_define_VectorImpl_push_back(VecStruct, ElemType) \
+    m_define_VectorImpl_append_n(VecStruct, ElemType) \
+    m_define_VectorImpl_clear(VecStruct, ElemType) \
     m_define_VectorImpl_pop_back(VecStruct, ElemType) \
     m_define_VectorImpl_back(VecStruct, ElemType) \
     m_define_VectorImpl_erase(VecStruct, ElemType) \
@@ -18,13 +46,41 @@
 #define m_declare_VectorImpl_funcs(VecStruct, ElemType) \
     struct VecStruct VecStruct##_init(void); \
     void VecStruct##_free(struct VecStruct *self); \
+    void VecStruct##_reserve(struct VecStruct *self, u32 n_elems); \
+    void VecStruct##_shrink_to_fit(struct VecStruct *self); \
     void VecStruct##_push_back(struct VecStruct *self, ElemType value); \
+    void VecStruct##_append_n(struct VecStruct *self, const ElemType *values, \
+            u32 n_values); \
+    void VecStruct##_clear(struct VecStruct *self, \
+            void free_func(ElemType)); \
     void VecStruct##_pop_back(struct VecStruct *self, \
             void free_func(ElemType)); \
     ElemType VecStruct##_back(struct VecStruct *self); \
     void VecStruct##_erase(struct VecStruct *self, u32 erase_idx, \
             void free_func(ElemType));
 
+#define m_define_SmallVecImpl_funcs(VecStruct, ElemType, MemTag) \
+    m_define_SmallVecImpl_init(VecStruct, ElemType) \
+    m_define_SmallVecImpl_free(VecStruct) \
+    m_define_SmallVecImpl_set_capacity(VecStruct, MemTag) \
+    m_define_VectorImpl_grow(VecStruct) \
+    m_define_VectorImpl_reserve(VecStruct) \
+    m_define_SmallVecImpl_shrink_to_fit(VecStruct) \
+    m_define_VectorImpl_push_back(VecStruct, ElemType) \
+    m_define_VectorImpl_append_n(VecStruct, ElemType) \
+    m_define_VectorImpl_clear(VecStruct, ElemType) \
+    m_define_VectorImpl_pop_back(VecStruct, ElemType) \
+    m_define_VectorImpl_back(VecStruct, ElemType) \
+    m_define_VectorImpl_erase(VecStruct, ElemType) \
+
+#define m_declare_SmallVecImpl_funcs(VecStruct, ElemType) \
+    m_declare_VectorImpl_funcs(VecStruct, ElemType) \
+    struct VecStruct VecStruct##_init_inline(ElemType *storage, u32 n_elems);
+
+/* whether a SmallVecImpl vector is still on the caller's storage */
+#define m_small_vec_is_inline(vec) \
+    ((vec)->inline_elems && (vec)->elems == (vec)->inline_elems)
+
 #define m_define_VectorImpl_init(VecStruct) \
     struct VecStruct VecStruct##_init(void) { \
         struct VecStruct var; \
@@ -41,17 +97,94 @@
         m_free(self->elems); \
     }
 
+/* moves the elements to a buffer with room for exactly capacity elements */
+#define m_define_VectorImpl_set_capacity(VecStruct, MemTag) \
+    static void VecStruct##_set_capacity(struct VecStruct *self, \
+            u32 capacity) { \
+        assert(self->capacity == 0 || self->size < self->capacity); \
+        self->elems = safe_realloc(self->elems, \
+                capacity*sizeof(*self->elems), MemTag); \
+        self->capacity = capacity; \
+    }
+
+/* makes room for n_more more elements. the capacity is always kept at least
+ * one bigger than the size. it doubles so pushing stays amortized O(1), but
+ * it stops at whatever a u32 size and a size_t byte count can hold. */
+#define m_define_VectorImpl_grow(VecStruct) \
+    static void VecStruct##_grow(struct VecStruct *self, u32 n_more) { \
+        size_t max_capacity = (size_t)-1 / sizeof(*self->elems); \
+        u32 new_capacity = self->capacity; \
+        if (max_capacity > m_u32_max) \
+            max_capacity = m_u32_max; \
+        if (n_more >= max_capacity - self->size) \
+            SafeMem_fatal(#VecStruct " is too large"); \
+        if (new_capacity < m_vector_impl_min_capacity) \
+            new_capacity = m_vector_impl_min_capacity; \
+        while (new_capacity <= self->size + n_more) { \
+            new_capacity = new_capacity > max_capacity/2 ? \
+                max_capacity : new_capacity*2; \
+        } \
+        VecStruct##_set_capacity(self, new_capacity); \
+    }
+
+/* makes room for n_elems elements in total, without growing any further than
+ * that. for when a producer knows up front about how much it'll push. */
+#define m_define_VectorImpl_reserve(VecStruct) \
+    void VecStruct##_reserve(struct VecStruct *self, u32 n_elems) { \
+        size_t max_capacity = (size_t)-1 / sizeof(*self->elems); \
+        if (n_elems < self->capacity) \
+            return; \
+        if (max_capacity > m_u32_max) \
+            max_capacity = m_u32_max; \
+        if (n_elems >= max_capacity) \
+            SafeMem_fatal(#VecStruct " is too large"); \
+        VecStruct##_set_capacity(self, n_elems+1); \
+    }
+
+/* gives back the memory that isn't used by any elements */
+#define m_define_VectorImpl_shrink_to_fit(VecStruct) \
+    void VecStruct##_shrink_to_fit(struct VecStruct *self) { \
+        if (self->size == 0) { \
+            self->capacity = 0; \
+            m_free(self->elems); \
+            return; \
+        } \
+        if (self->size+1 == self->capacity) \
+            return; \
+        VecStruct##_set_capacity(self, self->size+1); \
+    }
+
 #define m_define_VectorImpl_push_back(VecStruct, ElemType) \
     void VecStruct##_push_back(struct VecStruct *self, ElemType value) { \
-        while (self->size+1 >= self->capacity) { \
-            self->capacity = self->capacity >= 2 ? \
-                self->capacity*self->capacity : self->capacity+1; \
-            self->elems = safe_realloc(self->elems, \
-                    self->capacity*sizeof(*self->elems)); \
-        } \
+        if (self->size+1 >= self->capacity) \
+            VecStruct##_grow(self, 1); \
         self->elems[self->size++] = value; \
     }
 
+#define m_define_VectorImpl_append_n(VecStruct, ElemType) \
+    void VecStruct##_append_n(struct VecStruct *self, const ElemType *values, \
+            u32 n_values) { \
+        if (n_values == 0) \
+            return; \
+        if (n_values >= self->capacity - self->size) \
+            VecStruct##_grow(self, n_values); \
+        memcpy(&self->elems[self->size], values, \
+                n_values*sizeof(*self->elems)); \
+        self->size += n_values; \
+    }
+
+/* keeps the memory around. free_func can be NULL like with pop_back */
+#define m_define_VectorImpl_clear(VecStruct, ElemType) \
+    void VecStruct##_clear(struct VecStruct *self, \
+            void free_func(ElemType)) { \
+        u32 i; \
+        if (free_func) { \
+            for (i = 0; i < self->size; i++) \
+                free_func(self->elems[i]); \
+        } \
+        self->size = 0; \
+    }
+
 /* optionally, free_func can be NULL, in which case no freeing is done */
 #define m_define_VectorImpl_pop_back(VecStruct, ElemType) \
     void VecStruct##_pop_back(struct VecStruct *self, \
@@ -77,3 +210,65 @@
         } \
         --self->size; \
     }
+
+#define m_define_SmallVecImpl_init(VecStruct, ElemType) \
+    struct VecStruct VecStruct##_init(void) { \
+        struct VecStruct var; \
+        var.elems = NULL; \
+        var.size = 0; \
+        var.capacity = 0; \
+        var.inline_elems = NULL; \
+        return var; \
+    } \
+    struct VecStruct VecStruct##_init_inline(ElemType *storage, \
+            u32 n_elems) { \
+        struct VecStruct var; \
+        var.elems = storage; \
+        var.size = 0; \
+        var.capacity = n_elems; \
+        var.inline_elems = storage; \
+        return var; \
+    }
+
+/* DOESN'T FREE ALL THE INDIVIDUAL ELEMENTS! */
+#define m_define_SmallVecImpl_free(VecStruct) \
+    void VecStruct##_free(struct VecStruct *self) { \
+        if (!m_small_vec_is_inline(self)) \
+            m_free(self->elems); \
+        self->elems = NULL; \
+        self->capacity = 0; \
+    }
+
+/* the first time it outgrows the caller's storage the elements get copied
+ * over to the heap, the storage itself is left alone */
+#define m_define_SmallVecImpl_set_capacity(VecStruct, MemTag) \
+    static void VecStruct##_set_capacity(struct VecStruct *self, \
+            u32 capacity) { \
+        assert(self->capacity == 0 || self->size < self->capacity); \
+        if (m_small_vec_is_inline(self)) { \
+            void *heap_elems = safe_malloc(capacity*sizeof(*self->elems), \
+                    MemTag); \
+            memcpy(heap_elems, self->elems, self->size*sizeof(*self->elems)); \
+            self->elems = heap_elems; \
+        } \
+        else { \
+            self->elems = safe_realloc(self->elems, \
+                    capacity*sizeof(*self->elems), MemTag); \
+        } \
+        self->capacity = capacity; \
+    }
+
+/* the caller's storage is never given back, only heap memory */
+#define m_define_SmallVecImpl_shrink_to_fit(VecStruct) \
+    void VecStruct##_shrink_to_fit(struct VecStruct *self) { \
+        if (m_small_vec_is_inline(self)) \
+            return; \
+        if (self->size == 0) { \
+            self->capacity = 0; \
+            m_free(self->elems); \
+            return; \
+        } \
+        if (self->size+1 == self->capacity) \
+            return; \
+        VecStruct##_set_capacity(self, self->size+1); \
+    }
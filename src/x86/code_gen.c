@@ -1,5 +1,10 @@
 #include "code_gen.h"
+#include "../comp_ctx.h"
 #include "ir.h"
+#include "../interner.h"
+#include "../out_buf.h"
+#include "../time_report.h"
+#include "../trace.h"
 #include <assert.h>
 #include <stdio.h>
 
@@ -175,268 +180,358 @@ static bool shift_instr(enum InstrType type) {
 
 }
 
-static void write_instr(FILE *output, const struct Instruction *instr) {
+/* appends the name of a register operand */
+static void write_reg(struct OutBuf *output, enum InstrOperandType type,
+        enum InstrSize size) {
+
+    OutBuf_append_str(output, reg_names[type_to_reg(type)][size]);
+
+}
+
+/* appends prefix, id and a '$'. the '$' keeps compiler generated labels from
+ * clashing with user symbols. */
+static void write_label(struct OutBuf *output, const char *prefix, u32 id) {
+
+    OutBuf_append_str(output, prefix);
+    OutBuf_append_u32(output, id);
+    OutBuf_append_char(output, '$');
+
+}
+
+/* appends the label, array literal or symbol the instruction refers to */
+static void write_name(struct OutBuf *output, const struct Interner *syms,
+        const struct Instruction *instr) {
+
+    switch (instr->name_type) {
+
+    case InstrNameType_LABEL:
+        write_label(output, "_L", instr->name);
+        break;
+
+    case InstrNameType_ARRAY_LIT:
+        write_label(output, "array_lit_", instr->name);
+        break;
+
+    case InstrNameType_SYM:
+        OutBuf_append_str(output, Interner_str(syms, instr->name));
+        break;
+
+    default:
+        assert(false);
+
+    }
+
+}
+
+/* appends "[reg+offset]" */
+static void write_loc(struct OutBuf *output, enum InstrOperandType reg,
+        i32 offset) {
+
+    OutBuf_append_char(output, '[');
+    write_reg(output, reg, InstrSize_32);
+    OutBuf_append_char(output, '+');
+    OutBuf_append_i32(output, offset);
+    OutBuf_append_char(output, ']');
+
+}
+
+/* appends "instr reg\n" */
+static void write_instr_w_reg(struct OutBuf *output, const char *instr,
+        enum InstrOperandType reg, enum InstrSize size) {
+
+    OutBuf_append_str(output, instr);
+    OutBuf_append_char(output, ' ');
+    write_reg(output, reg, size);
+    OutBuf_append_char(output, '\n');
+
+}
+
+/* appends "instr string\n" */
+static void write_instr_w_str(struct OutBuf *output, const char *instr,
+        const char *string) {
+
+    OutBuf_append_str(output, instr);
+    OutBuf_append_char(output, ' ');
+    OutBuf_append_str(output, string);
+    OutBuf_append_char(output, '\n');
+
+}
+
+/* appends "instr name\n" */
+static void write_instr_w_name(struct OutBuf *output, const char *instr,
+        const struct Interner *syms, const struct Instruction *name_instr) {
+
+    OutBuf_append_str(output, instr);
+    OutBuf_append_char(output, ' ');
+    write_name(output, syms, name_instr);
+    OutBuf_append_char(output, '\n');
+
+}
+
+/* appends "xchg rax, reg\n" */
+static void write_xchg_rax(struct OutBuf *output, enum InstrOperandType reg) {
+
+    OutBuf_append_str(output, "xchg rax, ");
+    write_reg(output, reg, InstrSize_32);
+    OutBuf_append_char(output, '\n');
+
+}
+
+/* the rhs of div/idiv can't be an immediate, so it gets moved into tmp_names
+ * first */
+static void write_div_rhs(struct OutBuf *output,
+        const struct Instruction *instr, const char **tmp_names) {
+
+    if (type_is_reg(instr->rhs.type))
+        write_instr_w_reg(output, instr_type_to_asm[instr->type],
+                instr->rhs.type, instr->instr_size);
+    else {
+        OutBuf_append_str(output, "mov ");
+        OutBuf_append_str(output, tmp_names[instr->instr_size]);
+        OutBuf_append_str(output, ", ");
+        OutBuf_append_u32(output, instr->rhs.value.imm);
+        OutBuf_append_char(output, '\n');
+        write_instr_w_str(output, instr_type_to_asm[instr->type],
+                tmp_names[instr->instr_size]);
+    }
+
+}
+
+static void write_sign_extend(struct OutBuf *output,
+        const struct Instruction *instr) {
+
+    if (instr->type == InstrType_DIV)
+        OutBuf_append_str(output, "xor rdx, rdx\n");
+    else {
+        if (instr->instr_size == InstrSize_32)
+            OutBuf_append_str(output, "cdq\n");
+        else if (instr->instr_size == InstrSize_32)
+            OutBuf_append_str(output, "cqo\n");
+        else
+            assert(false);
+    }
+
+}
+
+static void write_instr(struct OutBuf *output, const struct Interner *syms,
+        const struct Instruction *instr) {
 
     if (instr->type == InstrType_MOV_F_LOC) {
         assert(type_is_reg(instr->lhs.type));
         assert(type_is_reg(instr->rhs.type));
 
-        fprintf(output, "mov %s",
-                reg_names[type_to_reg(instr->lhs.type)][instr->instr_size]
-                );
-
-        fprintf(output, ", [%s+%d]\n",
-                reg_names[type_to_reg(instr->rhs.type)][InstrSize_32],
-                instr->offset
-                );
+        OutBuf_append_str(output, "mov ");
+        write_reg(output, instr->lhs.type, instr->instr_size);
+        OutBuf_append_str(output, ", ");
+        write_loc(output, instr->rhs.type, instr->offset);
+        OutBuf_append_char(output, '\n');
     }
 
     else if (instr->type == InstrType_MOV_T_LOC) {
         assert(type_is_reg(instr->lhs.type));
 
         if (type_is_reg(instr->rhs.type)) {
-            fprintf(output, "mov [%s+%d]",
-                    reg_names[type_to_reg(instr->lhs.type)][InstrSize_32],
-                    instr->offset
-                    );
-
-            fprintf(output, ", %s\n",
-                    reg_names[type_to_reg(instr->rhs.type)][instr->instr_size]
-                    );
+            OutBuf_append_str(output, "mov ");
+            write_loc(output, instr->lhs.type, instr->offset);
+            OutBuf_append_str(output, ", ");
+            write_reg(output, instr->rhs.type, instr->instr_size);
+            OutBuf_append_char(output, '\n');
         }
         else {
-            fprintf(output, "mov %s [%s+%d]",
-                    size_specifier[instr->instr_size],
-                    reg_names[type_to_reg(instr->lhs.type)][InstrSize_32],
-                    instr->offset
-                    );
-
-            fprintf(output, ", %u\n", instr->rhs.value.imm);
+            OutBuf_append_str(output, "mov ");
+            OutBuf_append_str(output, size_specifier[instr->instr_size]);
+            OutBuf_append_char(output, ' ');
+            write_loc(output, instr->lhs.type, instr->offset);
+            OutBuf_append_str(output, ", ");
+            OutBuf_append_u32(output, instr->rhs.value.imm);
+            OutBuf_append_char(output, '\n');
         }
     }
 
     else if (instr->type == InstrType_LEA) {
         assert(type_is_reg(instr->lhs.type));
 
-        fprintf(output, "lea %s",
-                reg_names[type_to_reg(instr->lhs.type)][InstrSize_32]);
+        OutBuf_append_str(output, "lea ");
+        write_reg(output, instr->lhs.type, InstrSize_32);
+        OutBuf_append_str(output, ", ");
 
         if (type_is_reg(instr->rhs.type)) {
-            fprintf(output, ", [%s+%d]\n",
-                    reg_names[type_to_reg(instr->rhs.type)][InstrSize_32],
-                    instr->offset);
+            write_loc(output, instr->rhs.type, instr->offset);
         }
         else {
-            fprintf(output, ", [%d+%d]\n", instr->rhs.value.imm,
-                    instr->offset);
+            OutBuf_append_char(output, '[');
+            OutBuf_append_i32(output, instr->rhs.value.imm);
+            OutBuf_append_char(output, '+');
+            OutBuf_append_i32(output, instr->offset);
+            OutBuf_append_char(output, ']');
         }
+        OutBuf_append_char(output, '\n');
     }
 
     else if (instr->type == InstrType_XCHG) {
         assert(type_is_reg(instr->lhs.type));
         assert(type_is_reg(instr->rhs.type));
 
-        fprintf(output, "xchg %s, %s\n",
-                reg_names[type_to_reg(instr->lhs.type)][instr->instr_size],
-                reg_names[type_to_reg(instr->rhs.type)][instr->instr_size]);
+        OutBuf_append_str(output, "xchg ");
+        write_reg(output, instr->lhs.type, instr->instr_size);
+        OutBuf_append_str(output, ", ");
+        write_reg(output, instr->rhs.type, instr->instr_size);
+        OutBuf_append_char(output, '\n');
     }
 
     else if (instr->type == InstrType_INC_LOC ||
             instr->type == InstrType_DEC_LOC) {
+        OutBuf_append_str(output, instr_type_to_asm[instr->type]);
+        OutBuf_append_char(output, ' ');
+        OutBuf_append_str(output, size_specifier[instr->instr_size]);
+        OutBuf_append_str(output, " [");
         if (type_is_reg(instr->lhs.type))
-            fprintf(output, "%s %s [%s]\n", instr_type_to_asm[instr->type],
-                    size_specifier[instr->instr_size],
-                    reg_names[type_to_reg(instr->lhs.type)][InstrSize_32]
-                    );
-        else if (instr->string)
-            fprintf(output, "%s %s [%s]\n", instr_type_to_asm[instr->type],
-                    size_specifier[instr->instr_size], instr->string);
+            write_reg(output, instr->lhs.type, InstrSize_32);
+        else if (instr->name_type != InstrNameType_NONE)
+            write_name(output, syms, instr);
         else
-            fprintf(output, "%s %s [%u]\n", instr_type_to_asm[instr->type],
-                    size_specifier[instr->instr_size], instr->lhs.value.imm);
+            OutBuf_append_u32(output, instr->lhs.value.imm);
+        OutBuf_append_str(output, "]\n");
     }
 
     else if (unary_instr(instr->type)) {
         assert(type_is_reg(instr->lhs.type));
-        fprintf(output, "%s %s\n", instr_type_to_asm[instr->type],
-                reg_names[type_to_reg(instr->lhs.type)][instr->instr_size]);
+        write_instr_w_reg(output, instr_type_to_asm[instr->type],
+                instr->lhs.type, instr->instr_size);
     }
 
     else if (regular_2_oper_instr(instr->type)) {
         assert(type_is_reg(instr->lhs.type));
-        fprintf(output, "%s %s", instr_type_to_asm[instr->type],
-                reg_names[type_to_reg(instr->lhs.type)][instr->instr_size]
-                );
+        OutBuf_append_str(output, instr_type_to_asm[instr->type]);
+        OutBuf_append_char(output, ' ');
+        write_reg(output, instr->lhs.type, instr->instr_size);
+        OutBuf_append_str(output, ", ");
 
         if (type_is_reg(instr->rhs.type))
-            fprintf(output, ", %s\n",
-                    reg_names[type_to_reg(instr->rhs.type)][instr->instr_size]
-                    );
-        else if (instr->string) {
-            fprintf(output, ", %s\n", instr->string);
+            write_reg(output, instr->rhs.type, instr->instr_size);
+        else if (instr->name_type != InstrNameType_NONE) {
+            write_name(output, syms, instr);
         }
-        else
-            fprintf(output, ", %s %d\n", size_specifier[instr->instr_size],
-                    instr->rhs.value.imm);
+        else {
+            OutBuf_append_str(output, size_specifier[instr->instr_size]);
+            OutBuf_append_char(output, ' ');
+            OutBuf_append_i32(output, instr->rhs.value.imm);
+        }
+        OutBuf_append_char(output, '\n');
     }
 
     else if (instr->type == InstrType_MUL || instr->type == InstrType_IMUL) {
         /* why x86? just why? */
         if (instr->lhs.type != InstrOperandType_REG_AX)
-            fprintf(output, "xchg rax, %s\n",
-                    reg_names[type_to_reg(instr->lhs.type)][InstrSize_32]);
+            write_xchg_rax(output, instr->lhs.type);
 
-        if (type_is_reg(instr->rhs.type))
-            fprintf(output, "%s %s\n", instr_type_to_asm[instr->type],
-                    reg_names[type_to_reg(instr->rhs.type)][instr->instr_size]
-                    );
-        else {
-            fprintf(output, "mov %s, %u\n", dx_names[instr->instr_size],
-                    instr->rhs.value.imm);
-            fprintf(output, "%s %s\n", instr_type_to_asm[instr->type],
-                    dx_names[instr->instr_size]);
-        }
+        write_div_rhs(output, instr, dx_names);
 
         if (instr->lhs.type != InstrOperandType_REG_AX)
-            fprintf(output, "xchg rax, %s\n",
-                    reg_names[type_to_reg(instr->lhs.type)][InstrSize_32]);
+            write_xchg_rax(output, instr->lhs.type);
     }
 
     else if (instr->type == InstrType_DIV || instr->type == InstrType_IDIV) {
         /* day 7045205478 of questioning why div and mul always use AX */
         if (instr->lhs.type != InstrOperandType_REG_AX)
-            fprintf(output, "xchg rax, %s\n",
-                    reg_names[type_to_reg(instr->lhs.type)][InstrSize_32]);
+            write_xchg_rax(output, instr->lhs.type);
 
-        if (instr->type == InstrType_DIV)
-            fprintf(output, "xor rdx, rdx\n");
-        else {
-            if (instr->instr_size == InstrSize_32)
-                fprintf(output, "cdq\n");
-            else if (instr->instr_size == InstrSize_32)
-                fprintf(output, "cqo\n");
-            else
-                assert(false);
-        }
+        write_sign_extend(output, instr);
 
-        if (type_is_reg(instr->rhs.type))
-            fprintf(output, "%s %s\n", instr_type_to_asm[instr->type],
-                    reg_names[type_to_reg(instr->rhs.type)][instr->instr_size]
-                    );
-        else {
-            /* uses SI to temporarily hold the immediate value */
-            fprintf(output, "mov %s, %u\n", si_names[instr->instr_size],
-                    instr->rhs.value.imm);
-            fprintf(output, "%s %s\n", instr_type_to_asm[instr->type],
-                    si_names[instr->instr_size]);
-        }
+        /* uses SI to temporarily hold the immediate value */
+        write_div_rhs(output, instr, si_names);
 
         if (instr->lhs.type != InstrOperandType_REG_AX)
-            fprintf(output, "xchg rax, %s\n",
-                    reg_names[type_to_reg(instr->lhs.type)][InstrSize_32]);
+            write_xchg_rax(output, instr->lhs.type);
     }
 
     else if (instr->type == InstrType_MODULO ||
             instr->type == InstrType_IMODULO) {
         /* day 7045205478 of questioning why div and mul always use AX */
         if (instr->lhs.type != InstrOperandType_REG_AX)
-            fprintf(output, "xchg rax, %s\n",
-                    reg_names[type_to_reg(instr->lhs.type)][InstrSize_32]);
+            write_xchg_rax(output, instr->lhs.type);
 
-        if (instr->type == InstrType_DIV)
-            fprintf(output, "xor rdx, rdx\n");
-        else {
-            if (instr->instr_size == InstrSize_32)
-                fprintf(output, "cdq\n");
-            else if (instr->instr_size == InstrSize_32)
-                fprintf(output, "cqo\n");
-            else
-                assert(false);
-        }
+        write_sign_extend(output, instr);
 
-        if (type_is_reg(instr->rhs.type))
-            fprintf(output, "%s %s\n", instr_type_to_asm[instr->type],
-                    reg_names[type_to_reg(instr->rhs.type)][instr->instr_size]
-                    );
-        else {
-            /* uses SI to temporarily hold the immediate value */
-            fprintf(output, "mov %s, %u\n", si_names[instr->instr_size],
-                    instr->rhs.value.imm);
-            fprintf(output, "%s %s\n", instr_type_to_asm[instr->type],
-                    si_names[instr->instr_size]);
-        }
+        /* uses SI to temporarily hold the immediate value */
+        write_div_rhs(output, instr, si_names);
 
         if (instr->lhs.type != InstrOperandType_REG_AX)
-            fprintf(output, "xchg rax, %s\n",
-                    reg_names[type_to_reg(instr->lhs.type)][InstrSize_32]);
+            write_xchg_rax(output, instr->lhs.type);
 
         /* the remainder is in DX */
-        fprintf(output, "mov %s, %s\n",
-                reg_names[type_to_reg(instr->lhs.type)][instr->instr_size],
-                dx_names[instr->instr_size]);
+        OutBuf_append_str(output, "mov ");
+        write_reg(output, instr->lhs.type, instr->instr_size);
+        OutBuf_append_str(output, ", ");
+        OutBuf_append_str(output, dx_names[instr->instr_size]);
+        OutBuf_append_char(output, '\n');
     }
 
     else if (instr->type == InstrType_PUSH) {
         if (type_is_reg(instr->lhs.type))
-            fprintf(output, "push %s\n",
-                    reg_names[type_to_reg(instr->lhs.type)][instr->instr_size]
-                    );
-        else if (instr->string)
-            fprintf(output, "push %s\n", instr->string);
-        else
-            fprintf(output, "push %s %u\n", size_specifier[instr->instr_size],
-                    instr->lhs.value.imm);
+            write_instr_w_reg(output, "push", instr->lhs.type,
+                    instr->instr_size);
+        else if (instr->name_type != InstrNameType_NONE)
+            write_instr_w_name(output, "push", syms, instr);
+        else {
+            OutBuf_append_str(output, "push ");
+            OutBuf_append_str(output, size_specifier[instr->instr_size]);
+            OutBuf_append_char(output, ' ');
+            OutBuf_append_u32(output, instr->lhs.value.imm);
+            OutBuf_append_char(output, '\n');
+        }
     }
 
     else if (instr->type == InstrType_POP) {
         assert(type_is_reg(instr->lhs.type));
-        fprintf(output, "pop %s\n",
-                reg_names[type_to_reg(instr->lhs.type)][instr->instr_size]);
+        write_instr_w_reg(output, "pop", instr->lhs.type, instr->instr_size);
     }
 
     else if (instr->type == InstrType_CALL) {
-        assert(instr->string);
-        fprintf(output, "call %s\n", instr->string);
+        write_instr_w_name(output, "call", syms, instr);
     }
 
     else if (instr->type == InstrType_RET) {
-        fprintf(output, "ret\n");
+        OutBuf_append_str(output, "ret\n");
     }
 
     else if (branch_instr(instr->type)) {
-        fprintf(output, "%s %s\n", instr_type_to_asm[instr->type],
-            instr->string);
+        write_instr_w_name(output, instr_type_to_asm[instr->type], syms,
+                instr);
     }
 
     else if (instr->type == InstrType_LABEL) {
-        assert(instr->string);
-        fprintf(output, "%s:\n", instr->string);
+        write_name(output, syms, instr);
+        OutBuf_append_str(output, ":\n");
     }
 
     else if (instr->type == InstrType_EXTERN ||
             instr->type == InstrType_GLOBAL) {
-        assert(instr->string);
-        fprintf(output, "%s %s\n", instr_type_to_asm[instr->type],
-                instr->string);
+        write_instr_w_name(output, instr_type_to_asm[instr->type], syms,
+                instr);
     }
 
     else if (shift_instr(instr->type)) {
-        fprintf(output, "%s %s", instr_type_to_asm[instr->type],
-                reg_names[type_to_reg(instr->lhs.type)][instr->instr_size]);
+        OutBuf_append_str(output, instr_type_to_asm[instr->type]);
+        OutBuf_append_char(output, ' ');
+        write_reg(output, instr->lhs.type, instr->instr_size);
+        OutBuf_append_str(output, ", ");
         if (type_is_reg(instr->rhs.type))
-            fprintf(output, ", %s\n",
-                    reg_names[type_to_reg(instr->rhs.type)][InstrSize_8]);
+            write_reg(output, instr->rhs.type, InstrSize_8);
         else
-            fprintf(output, ", %u\n", instr->rhs.value.imm);
+            OutBuf_append_u32(output, instr->rhs.value.imm);
+        OutBuf_append_char(output, '\n');
     }
 
     else if (instr->type == InstrType_DEBUG_EAX) {
-        fprintf(output, "mov ebx, esp\n");
-        fprintf(output, "and esp, -16\n");
-        fprintf(output, "push eax\n");
-        fprintf(output, "push msg$\n");
-        fprintf(output, "call printf\n");
-        fprintf(output, "mov esp, ebx\n");
+        OutBuf_append_str(output,
+                "mov ebx, esp\n"
+                "and esp, -16\n"
+                "push eax\n"
+                "push msg$\n"
+                "call printf\n"
+                "mov esp, ebx\n"
+                );
     }
 
     else {
@@ -446,51 +541,171 @@ static void write_instr(FILE *output, const struct Instruction *instr) {
 
 }
 
-void CodeGenArch_generate(FILE *output, const struct BlockNode *ast) {
+/* the labels the compiler makes up itself aren't symbols, so any other label
+ * is the start of a function */
+static bool is_func_label(const struct Instruction *instr) {
 
-    struct ArrayLitList array_lits = ArrayLitList_init();
+    return instr->type == InstrType_LABEL &&
+        instr->name_type == InstrNameType_SYM;
 
-    struct InstrList instrs = IR_get_instructions(ast);
-    u32 i;
+}
 
-    BlockNode_get_array_lits(ast, &array_lits);
+/* writes the instructions, for -ftrace every function gets a span of its own */
+static void write_instrs(struct CompilerCtx *ctx, struct OutBuf *output,
+        const struct InstrList *instrs) {
 
-    fprintf(output, "[BITS 32]\n\n");
-    fprintf(output, "extern memcpy\n");
-    fprintf(output, "extern printf\n");
-    fprintf(output, "\nsection .text\n");
-    fprintf(output, "global main\n");
+    /* the function currently being emitted */
+    const char *func_name = NULL;
+    double func_trace_start = 0;
+    u32 i;
 
-    for (i = 0; i < instrs.size; i++) {
-        write_instr(output, &instrs.elems[i]);
-        fprintf(output, "\n");
+    for (i = 0; i < instrs->size; i++) {
+        if (Trace_on && is_func_label(&instrs->elems[i])) {
+            if (func_name)
+                Trace_end("func", "emit ", func_name, func_trace_start);
+            func_name = Interner_str(&ctx->syms, instrs->elems[i].name);
+            func_trace_start = Trace_begin();
+        }
+        write_instr(output, &ctx->syms, &instrs->elems[i]);
+        OutBuf_append_char(output, '\n');
     }
+    if (func_name)
+        Trace_end("func", "emit ", func_name, func_trace_start);
+
+}
+
+/* the first one gets the label array_lit_<first_id>$ */
+static void write_array_lits(struct OutBuf *output,
+        const struct ArrayLitList *array_lits, u32 first_id) {
 
-    fprintf(output, "\nsection .rodata\n");
-    fprintf(output, "msg$: db `result = %%d\\n\\0`\n");
+    u32 i;
 
-    for (i = 0; i < array_lits.size; i++) {
+    for (i = 0; i < array_lits->size; i++) {
         u32 j;
-        fprintf(output, "array_lit_%lu$: %s ", (unsigned long)i,
-                elem_size_specifier[
-                    bytes_log2(array_lits.elems[i].elem_size)
+        write_label(output, "array_lit_", first_id+i);
+        OutBuf_append_str(output, ": ");
+        OutBuf_append_str(output, elem_size_specifier[
+                    bytes_log2(array_lits->elems[i].elem_size)
                 ]);
-        for (j = 0; j < array_lits.elems[i].n_values; j++) {
+        OutBuf_append_char(output, ' ');
+        for (j = 0; j < array_lits->elems[i].n_values; j++) {
             if (j != 0)
-                fprintf(output, ", ");
-            fprintf(output, "%d",
-                    Expr_evaluate(array_lits.elems[i].values[j]));
+                OutBuf_append_str(output, ", ");
+            OutBuf_append_i32(output,
+                    Expr_evaluate(array_lits->elems[i].values[j]));
         }
-        fprintf(output, "\n");
+        OutBuf_append_char(output, '\n');
     }
 
-    while (instrs.size > 0) {
-        InstrList_pop_back(&instrs, Instruction_free);
-    }
-    InstrList_free(&instrs);
+}
+
+/* -fstream-funcs. the array literals in ctx->ir.array_lits have to wait for
+ * .rodata. they get evaluated now since a streamed function's exprs are about
+ * to be thrown away, and numbered after the ones streamed before them */
+static void stream_array_lits(struct CompilerCtx *ctx) {
+
+    struct ArrayLitList *array_lits = &ctx->ir.array_lits;
+
+    write_array_lits(&ctx->ir.rodata, array_lits,
+            ctx->ir.n_streamed_array_lits);
+    ctx->ir.n_streamed_array_lits += array_lits->size;
+
+}
+
+void CodeGenArch_generate(struct CompilerCtx *ctx, struct OutBuf *output,
+        const struct BlockNode *ast) {
+
+    CodeGenArch_begin(output);
+    CodeGenArch_end(ctx, output, ast, 0);
+
+}
+
+void CodeGenArch_begin(struct OutBuf *output) {
+
+    OutBuf_append_str(output,
+            "[BITS 32]\n\n"
+            "extern memcpy\n"
+            "extern printf\n"
+            "\nsection .text\n"
+            "global main\n"
+            );
+
+}
+
+void CodeGenArch_func(struct CompilerCtx *ctx, struct OutBuf *output,
+        const struct FuncDeclNode *func) {
+
+    struct ArrayLitList *array_lits = &ctx->ir.array_lits;
+    const struct InstrList *instrs;
+
+    TimeReport_start(&ctx->time_report);
+    instrs = IR_get_func_instructions(ctx, func);
+    TimeReport_stop(&ctx->time_report, TimeStage_IR, instrs->size);
+
+    TimeReport_start(&ctx->time_report);
+    write_instrs(ctx, output, instrs);
+
+    ArrayLitList_clear(array_lits, NULL);
+    FuncDeclNode_get_array_lits(func, &ctx->exprs, array_lits);
+    stream_array_lits(ctx);
+    TimeReport_stop(&ctx->time_report, TimeStage_EMIT, instrs->size);
+
+}
+
+void CodeGenArch_nodes(struct CompilerCtx *ctx, struct OutBuf *output,
+        const struct BlockNode *ast, u32 first_node) {
+
+    struct ArrayLitList *array_lits = &ctx->ir.array_lits;
+    const struct InstrList *instrs;
+    u32 i;
+
+    TimeReport_start(&ctx->time_report);
+    instrs = IR_get_instructions(ctx, ast, first_node);
+    TimeReport_stop(&ctx->time_report, TimeStage_IR, instrs->size);
+
+    TimeReport_start(&ctx->time_report);
+    write_instrs(ctx, output, instrs);
+
+    ArrayLitList_clear(array_lits, NULL);
+    for (i = first_node; i < ast->nodes.size; i++)
+        ASTNode_get_array_lits(&ast->nodes.elems[i], &ctx->exprs, array_lits);
+    stream_array_lits(ctx);
+    TimeReport_stop(&ctx->time_report, TimeStage_EMIT, instrs->size);
+
+}
+
+void CodeGenArch_end(struct CompilerCtx *ctx, struct OutBuf *output,
+        const struct BlockNode *ast, u32 first_node) {
 
     /* don't free the individual elements cuz they'll be freed when the ast is
      * freed. */
-    ArrayLitList_free(&array_lits);
+    struct ArrayLitList *array_lits = &ctx->ir.array_lits;
+    const struct InstrList *instrs;
+    u32 i;
+
+    TimeReport_start(&ctx->time_report);
+    instrs = IR_get_instructions(ctx, ast, first_node);
+    TimeReport_stop(&ctx->time_report, TimeStage_IR, instrs->size);
+
+    TimeReport_start(&ctx->time_report);
+    ArrayLitList_clear(array_lits, NULL);
+    for (i = first_node; i < ast->nodes.size; i++)
+        ASTNode_get_array_lits(&ast->nodes.elems[i], &ctx->exprs, array_lits);
+
+    write_instrs(ctx, output, instrs);
+
+    OutBuf_append_str(output,
+            "\nsection .rodata\n"
+            "msg$: db `result = %d\\n\\0`\n"
+            );
+
+    if (ctx->ir.rodata.size > 0) {
+        OutBuf_append_strn(output, ctx->ir.rodata.buf,
+                ctx->ir.rodata.size);
+    }
+    write_array_lits(output, array_lits, ctx->ir.n_streamed_array_lits);
+    OutBuf_reset(&ctx->ir.rodata, -1);
+
+    TimeReport_stop(&ctx->time_report, TimeStage_EMIT, instrs->size);
 
 }
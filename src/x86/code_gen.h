@@ -1,6 +1,21 @@
 #pragma once
 
 #include "../ast.h"
-#include <stdio.h>
+#include "../out_buf.h"
 
-void CodeGenArch_generate(FILE *output, const struct BlockNode *ast);
+struct CompilerCtx;
+
+void CodeGenArch_generate(struct CompilerCtx *ctx, struct OutBuf *output,
+        const struct BlockNode *ast);
+
+/* -fstream-funcs splits CodeGenArch_generate up. begin comes first, then func
+ * for every streamed function definition, with nodes before it for the top
+ * level nodes from first_node on that came before the function. end does the
+ * rest of the ast, from first_node on */
+void CodeGenArch_begin(struct OutBuf *output);
+void CodeGenArch_func(struct CompilerCtx *ctx, struct OutBuf *output,
+        const struct FuncDeclNode *func);
+void CodeGenArch_nodes(struct CompilerCtx *ctx, struct OutBuf *output,
+        const struct BlockNode *ast, u32 first_node);
+void CodeGenArch_end(struct CompilerCtx *ctx, struct OutBuf *output,
+        const struct BlockNode *ast, u32 first_node);
@@ -1,4 +1,9 @@
 #include "ir.h"
+#include "ir_state.h"
+#include "../comp_ctx.h"
+#include "../identifier.h"
+#include "../interner.h"
+#include "../trace.h"
 
 #include <assert.h>
 #include <limits.h>
@@ -6,25 +11,7 @@
 #include <string.h>
 #include <stdlib.h>
 
-/* the length of the labels the compiler generates for stuff like loops and
- * if statements, not the labels used for function names and stuff.
- * i don't think anyone's ever gonna have a TU so long that they're gonna need
- * label names long than this */
-#define m_comp_label_name_capacity 1024
-
-unsigned long label_counter = 0;
-unsigned long array_lit_counter = 0;
-
-unsigned next_reg_to_leak = 0;
-
-/* is the register currently holding a value? */
-bool gp_reg_used[] = {
-    false,  /* ax */
-    false,  /* bx */
-    false,  /* cx */
-};
-
-const unsigned n_gp_regs = sizeof(gp_reg_used)/sizeof(gp_reg_used[0]);
+const unsigned n_gp_regs = m_n_gp_regs;
 
 struct GPReg {
 
@@ -45,11 +32,11 @@ static struct GPReg GPReg_init(void) {
 }
 
 /* finds an unused register, returns UINT_MAX if one couldn't be found */
-static unsigned unused_reg(void) {
+static unsigned unused_reg(struct CompilerCtx *ctx) {
 
     unsigned i;
     for (i = 0; i < n_gp_regs; i++) {
-        if (!gp_reg_used[i])
+        if (!ctx->ir.gp_reg_used[i])
             return i;
     }
 
@@ -72,7 +59,8 @@ static u32 round_up(u32 num, u32 multiple) {
 
 }
 
-static void get_block_instructions(struct InstrList *instrs,
+static void get_block_instructions(struct CompilerCtx *ctx,
+        struct InstrList *instrs,
         const struct BlockNode *block);
 
 static void leak_reg_to_stack(struct InstrList *instrs, unsigned reg_idx) {
@@ -101,29 +89,31 @@ static void unleak_reg(struct InstrList *instrs, unsigned reg_idx) {
 
 /* finds a free register to use. if there are no free registers left, a used
  * one is leaked onto the stack so it can be used. */
-static struct GPReg alloc_reg(struct InstrList *instrs) {
+static struct GPReg alloc_reg(struct CompilerCtx *ctx,
+        struct InstrList *instrs) {
 
     struct GPReg reg = GPReg_init();
-    reg.reg_idx = unused_reg();
+    reg.reg_idx = unused_reg(ctx);
     if (reg.reg_idx == UINT_MAX) {
         /* IMPORTANT: verify that using rand isn't absolutely bonkers here */
-        reg.reg_idx = next_reg_to_leak++;
+        reg.reg_idx = ctx->ir.next_reg_to_leak++;
         leak_reg_to_stack(instrs, reg.reg_idx);
         reg.prev_val_was_leaked = true;
-        next_reg_to_leak %= n_gp_regs;
+        ctx->ir.next_reg_to_leak %= n_gp_regs;
     }
-    gp_reg_used[reg.reg_idx] = true;
+    ctx->ir.gp_reg_used[reg.reg_idx] = true;
     return reg;
 
 }
 
-static void free_reg(struct InstrList *instrs, struct GPReg reg) {
+static void free_reg(struct CompilerCtx *ctx, struct InstrList *instrs,
+        struct GPReg reg) {
 
     if (reg.prev_val_was_leaked) {
         unleak_reg(instrs, reg.reg_idx);
     }
     else {
-        gp_reg_used[reg.reg_idx] = false;
+        ctx->ir.gp_reg_used[reg.reg_idx] = false;
     }
 
     reg.reg_idx = UINT_MAX;
@@ -214,6 +204,46 @@ static enum InstrType expr_to_instr_t(const struct Expr *expr) {
 
 }
 
+struct IRState IRState_init(void) {
+
+    struct IRState state;
+    unsigned i;
+    state.label_counter = 0;
+    state.array_lit_counter = 0;
+    state.next_reg_to_leak = 0;
+    for (i = 0; i < m_n_gp_regs; i++)
+        state.gp_reg_used[i] = false;
+    state.rodata = OutBuf_init();
+    state.n_streamed_array_lits = 0;
+    state.instrs = InstrList_init();
+    state.array_lits = ArrayLitList_init();
+    return state;
+
+}
+
+void IRState_reset(struct IRState *self) {
+
+    unsigned i;
+    self->label_counter = 0;
+    self->array_lit_counter = 0;
+    self->next_reg_to_leak = 0;
+    for (i = 0; i < m_n_gp_regs; i++)
+        self->gp_reg_used[i] = false;
+    OutBuf_reset(&self->rodata, -1);
+    self->n_streamed_array_lits = 0;
+    InstrList_clear(&self->instrs, NULL);
+    ArrayLitList_clear(&self->array_lits, NULL);
+
+}
+
+void IRState_free(struct IRState *self) {
+
+    OutBuf_free(&self->rodata);
+    InstrList_free(&self->instrs);
+    ArrayLitList_free(&self->array_lits);
+
+}
+
 struct InstrOperand InstrOperand_init(void) {
 
     struct InstrOperand operand;
@@ -272,37 +302,33 @@ struct Instruction Instruction_init(void) {
     instr.offset = 0;
     instr.lhs = InstrOperand_init();
     instr.rhs = InstrOperand_init();
-    instr.string = NULL;
+    instr.name = 0;
+    instr.name_type = InstrNameType_NONE;
     return instr;
 
 }
 
-void Instruction_free(struct Instruction instr) {
-
-    m_free(instr.string);
-
-}
-
 static enum InstrOperandType reg_idx_to_operand_t(unsigned idx) {
 
     return InstrOperandType_REGISTERS_START+idx+1;
 
 }
 
-static void push_used_caller_saved_regs(struct InstrList *instrs) {
+static void push_used_caller_saved_regs(struct CompilerCtx *ctx,
+        struct InstrList *instrs) {
 
     struct Instruction push_instr = Instruction_init();
     push_instr.type = InstrType_PUSH;
     push_instr.instr_size = InstrSize_32;
 
-    if (gp_reg_used[operand_t_to_reg_idx(InstrOperandType_REG_CX)]) {
+    if (ctx->ir.gp_reg_used[operand_t_to_reg_idx(InstrOperandType_REG_CX)]) {
         push_instr.lhs =
             InstrOperand_create_imm(InstrOperandType_REG_CX, 0);
         InstrList_push_back(instrs, push_instr);
     }
 
     /*
-    if (gp_reg_used[operand_t_to_reg_idx(InstrOperandType_REG_DX)]) {
+    if (ctx->ir.gp_reg_used[operand_t_to_reg_idx(InstrOperandType_REG_DX)]) {
         push_instr.lhs =
             InstrOperand_create_imm(InstrOperandType_REG_DX, 0);
         InstrList_push_back(instrs, push_instr);
@@ -310,20 +336,21 @@ static void push_used_caller_saved_regs(struct InstrList *instrs) {
 
 }
 
-static void pop_used_caller_saved_regs(struct InstrList *instrs) {
+static void pop_used_caller_saved_regs(struct CompilerCtx *ctx,
+        struct InstrList *instrs) {
 
     struct Instruction pop_instr = Instruction_init();
     pop_instr.type = InstrType_POP;
     pop_instr.instr_size = InstrSize_32;
 
     /*
-    if (gp_reg_used[operand_t_to_reg_idx(InstrOperandType_REG_DX)]) {
+    if (ctx->ir.gp_reg_used[operand_t_to_reg_idx(InstrOperandType_REG_DX)]) {
         pop_instr.lhs =
             InstrOperand_create_imm(InstrOperandType_REG_DX, 0);
         InstrList_push_back(instrs, pop_instr);
     }*/
 
-    if (gp_reg_used[operand_t_to_reg_idx(InstrOperandType_REG_CX)]) {
+    if (ctx->ir.gp_reg_used[operand_t_to_reg_idx(InstrOperandType_REG_CX)]) {
         pop_instr.lhs =
             InstrOperand_create_imm(InstrOperandType_REG_CX, 0);
         InstrList_push_back(instrs, pop_instr);
@@ -362,16 +389,17 @@ static void instr_reg_and_imm32(struct InstrList *instrs, enum InstrType type,
 
 }
 
-static void instr_reg_and_string(struct InstrList *instrs, enum InstrType type,
-        enum InstrSize size, enum InstrOperandType reg, char *str,
-        i32 offset) {
+static void instr_reg_and_name(struct InstrList *instrs, enum InstrType type,
+        enum InstrSize size, enum InstrOperandType reg,
+        enum InstrNameType name_type, u32 name, i32 offset) {
 
     struct Instruction instr = Instruction_init();
 
     instr.type = type;
     instr.instr_size = size;
     instr.lhs = InstrOperand_create_imm(reg, 0);
-    instr.string = str;
+    instr.name_type = name_type;
+    instr.name = name;
     instr.offset = offset;
 
     InstrList_push_back(instrs, instr);
@@ -405,13 +433,14 @@ static void instr_imm32(struct InstrList *instrs, enum InstrType type,
 
 }
 
-static void instr_string(struct InstrList *instrs, enum InstrType type,
-        char *str) {
+static void instr_name(struct InstrList *instrs, enum InstrType type,
+        enum InstrNameType name_type, u32 name) {
 
     struct Instruction instr = Instruction_init();
 
     instr.type = type;
-    instr.string = str;
+    instr.name_type = name_type;
+    instr.name = name;
 
     InstrList_push_back(instrs, instr);
 
@@ -450,20 +479,23 @@ static unsigned bytes_log2(unsigned bytes) {
 
 }
 
-static struct GPReg get_expr_instructions(struct InstrList *instrs,
+static struct GPReg get_expr_instructions(struct CompilerCtx *ctx,
+        struct InstrList *instrs,
         const struct Expr *expr, bool load_reference);
 
-static struct GPReg get_func_call_expr_instructions(struct InstrList *instrs,
+static struct GPReg get_func_call_expr_instructions(struct CompilerCtx *ctx,
+        struct InstrList *instrs,
         const struct Expr *expr) {
 
+    const struct ExprPtrList *args = Expr_args(&ctx->exprs, expr);
     u32 i;
     u32 args_stack_space = 0;
     u32 next_arg_offset = 0;
 
-    struct GPReg ret_reg = alloc_reg(instrs);
+    struct GPReg ret_reg = alloc_reg(ctx, instrs);
     ret_reg.reg_size = InstrSize_32;
 
-    push_used_caller_saved_regs(instrs);
+    push_used_caller_saved_regs(ctx, instrs);
 
     /* the return value always goes in ax, so this is to keep the old value of
      * ax if it is not to be overwritten, and also to make sure the return
@@ -476,10 +508,10 @@ static struct GPReg get_func_call_expr_instructions(struct InstrList *instrs,
     /* make space for every argument on the stack. this method is slightly more
      * efficient and slightly easier to implement */
     {
-        for (i = 0; i < expr->args.size; i++) {
+        for (i = 0; i < args->size; i++) {
             unsigned arg_size = PrimitiveType_size(
-                    expr->args.elems[i]->prim_type,
-                    expr->args.elems[i]->lvls_of_indir);
+                    args->elems[i]->prim_type,
+                    args->elems[i]->lvls_of_indir);
             /* alignment */
             args_stack_space = round_up(args_stack_space, arg_size);
             args_stack_space += arg_size;
@@ -490,9 +522,9 @@ static struct GPReg get_func_call_expr_instructions(struct InstrList *instrs,
     }
 
     /* every argument gets loaded into the stack from bottom to top */
-    for (i = 0; i < expr->args.size; i++) {
-        struct GPReg arg_reg = get_expr_instructions(instrs,
-                expr->args.elems[i], false);
+    for (i = 0; i < args->size; i++) {
+        struct GPReg arg_reg = get_expr_instructions(ctx, instrs,
+                args->elems[i], false);
         unsigned reg_size_bytes = InstrSize_to_bytes(arg_reg.reg_size);
 
         next_arg_offset = round_up(next_arg_offset, reg_size_bytes);
@@ -503,16 +535,17 @@ static struct GPReg get_func_call_expr_instructions(struct InstrList *instrs,
 
         next_arg_offset += reg_size_bytes;
 
-        free_reg(instrs, arg_reg);
+        free_reg(ctx, instrs, arg_reg);
     }
 
     /* everything's prepared now */
-    instr_string(instrs, InstrType_CALL, Expr_src(expr));
+    instr_name(instrs, InstrType_CALL, InstrNameType_SYM,
+            Expr_sym(&ctx->exprs, expr));
 
     /* clean up the stack and bring back the caller saved regs */
     instr_reg_and_imm32(instrs, InstrType_ADD, InstrSize_32,
             InstrOperandType_REG_SP, args_stack_space, 0);
-    pop_used_caller_saved_regs(instrs);
+    pop_used_caller_saved_regs(ctx, instrs);
 
     if (reg_idx_to_operand_t(ret_reg.reg_idx) != InstrOperandType_REG_AX) {
         instr_reg_and_reg(instrs, InstrType_XCHG, InstrSize_32,
@@ -547,10 +580,7 @@ static void get_cmp_instructions(struct InstrList *instrs,
 
 static void get_boolean_and_instructions(struct InstrList *instrs,
         const struct Expr *expr, struct GPReg lhs_reg, struct GPReg rhs_reg,
-        unsigned long end_label_id) {
-
-    char *end_label =
-        safe_malloc(m_comp_label_name_capacity*sizeof(*end_label));
+        u32 end_label_id) {
 
     if (expr->rhs->expr_type != ExprType_INT_LIT)
         instr_reg_and_reg(instrs, InstrType_AND, InstrSize_32,
@@ -568,17 +598,13 @@ static void get_boolean_and_instructions(struct InstrList *instrs,
     instr_reg_and_imm32(instrs, InstrType_AND, InstrSize_32,
             reg_idx_to_operand_t(lhs_reg.reg_idx), 0xff, 0);
 
-    sprintf(end_label, "_L%lu$", end_label_id);
-    instr_string(instrs, InstrType_LABEL, end_label);
+    instr_name(instrs, InstrType_LABEL, InstrNameType_LABEL, end_label_id);
 
 }
 
 static void get_boolean_or_instructions(struct InstrList *instrs,
         const struct Expr *expr, struct GPReg lhs_reg, struct GPReg rhs_reg,
-        unsigned long end_label_id) {
-
-    char *end_label =
-        safe_malloc(m_comp_label_name_capacity*sizeof(*end_label));
+        u32 end_label_id) {
 
     if (expr->rhs->expr_type != ExprType_INT_LIT)
         instr_reg_and_reg(instrs, InstrType_OR, InstrSize_32,
@@ -594,8 +620,7 @@ static void get_boolean_or_instructions(struct InstrList *instrs,
     instr_reg(instrs, InstrType_SETNE, InstrSize_8,
             reg_idx_to_operand_t(lhs_reg.reg_idx), 0);
 
-    sprintf(end_label, "_L%lu$", end_label_id);
-    instr_string(instrs, InstrType_LABEL, end_label);
+    instr_name(instrs, InstrType_LABEL, InstrNameType_LABEL, end_label_id);
 
     /* this is placed after the label to ensure that if the lhs is already
      * not 0, the result becomes exactly 1 and not some non-zero value */
@@ -606,45 +631,43 @@ static void get_boolean_or_instructions(struct InstrList *instrs,
 
 /* load_reference is only used on identifier nodes and dereference nodes, else
  * it's ignored */
-static struct GPReg get_expr_instructions(struct InstrList *instrs,
+static struct GPReg get_expr_instructions(struct CompilerCtx *ctx,
+        struct InstrList *instrs,
         const struct Expr *expr, bool load_reference) {
 
     struct GPReg lhs_reg = GPReg_init(), rhs_reg = GPReg_init();
     enum InstrSize instr_size = InstrSize_32;
 
-    unsigned long old_label_count = label_counter;
+    u32 old_label_count = ctx->ir.label_counter;
 
     if (expr->expr_type == ExprType_BOOLEAN_OR ||
             expr->expr_type == ExprType_BOOLEAN_AND)
-        ++label_counter;
+        ++ctx->ir.label_counter;
 
     if (expr->expr_type == ExprType_FUNC_CALL) {
-        return get_func_call_expr_instructions(instrs, expr);
+        return get_func_call_expr_instructions(ctx, instrs, expr);
     }
 
     if (expr->lhs)
-        lhs_reg = get_expr_instructions(instrs, expr->lhs,
+        lhs_reg = get_expr_instructions(ctx, instrs, expr->lhs,
                 expr->expr_type == ExprType_EQUAL ||
                 expr->expr_type == ExprType_REFERENCE ||
                 ExprType_is_inc_or_dec_operator(expr->expr_type) ||
                 expr->lhs->is_array);
     else
-        lhs_reg = alloc_reg(instrs);
+        lhs_reg = alloc_reg(ctx, instrs);
 
     if (expr->expr_type == ExprType_BOOLEAN_OR ||
             expr->expr_type == ExprType_BOOLEAN_AND) {
         enum InstrType jmp_instr = expr->expr_type == ExprType_BOOLEAN_OR ?
             InstrType_JNE : InstrType_JE;
-        char *end_label =
-            safe_malloc(m_comp_label_name_capacity*sizeof(*end_label));
-        sprintf(end_label, "_L%lu$", old_label_count);
         instr_reg_and_imm32(instrs, InstrType_CMP, InstrSize_32,
                 reg_idx_to_operand_t(lhs_reg.reg_idx), 0, 0);
-        instr_string(instrs, jmp_instr, end_label);
+        instr_name(instrs, jmp_instr, InstrNameType_LABEL, old_label_count);
     }
 
     if (expr->rhs && expr->rhs->expr_type != ExprType_INT_LIT)
-        rhs_reg = get_expr_instructions(instrs, expr->rhs, false);
+        rhs_reg = get_expr_instructions(ctx, instrs, expr->rhs, false);
 
     if (expr->expr_type == ExprType_INT_LIT) {
         instr_reg_and_imm32(instrs, InstrType_MOV, instr_size,
@@ -733,10 +756,9 @@ static struct GPReg get_expr_instructions(struct InstrList *instrs,
         }
     }
     else if (expr->expr_type == ExprType_ARRAY_LIT) {
-        char *str = safe_malloc(m_comp_label_name_capacity*sizeof(*str));
-        sprintf(str, "array_lit_%lu$", array_lit_counter++);
-        instr_reg_and_string(instrs, InstrType_MOV, InstrSize_32,
-                reg_idx_to_operand_t(lhs_reg.reg_idx), str, 0);
+        instr_reg_and_name(instrs, InstrType_MOV, InstrSize_32,
+                reg_idx_to_operand_t(lhs_reg.reg_idx), InstrNameType_ARRAY_LIT,
+                ctx->ir.array_lit_counter++, 0);
     }
     else if (ExprType_is_cmp_operator(expr->expr_type)) {
         get_cmp_instructions(instrs, expr, lhs_reg, rhs_reg);
@@ -775,7 +797,7 @@ static struct GPReg get_expr_instructions(struct InstrList *instrs,
 
         if (is_postfix) {
             u32 i;
-            struct GPReg temp_reg = alloc_reg(instrs);
+            struct GPReg temp_reg = alloc_reg(ctx, instrs);
 
             instr_reg_and_reg(instrs, InstrType_MOV_F_LOC, size,
                     reg_idx_to_operand_t(temp_reg.reg_idx),
@@ -785,7 +807,7 @@ static struct GPReg get_expr_instructions(struct InstrList *instrs,
                 instr_reg(instrs, instr_type, size,
                         reg_idx_to_operand_t(lhs_reg.reg_idx), 0);
 
-            free_reg(instrs, lhs_reg);
+            free_reg(ctx, instrs, lhs_reg);
             lhs_reg = temp_reg;
         }
         else {
@@ -846,7 +868,7 @@ static struct GPReg get_expr_instructions(struct InstrList *instrs,
     }
 
     if (rhs_reg.reg_idx != UINT_MAX)
-        free_reg(instrs, rhs_reg);
+        free_reg(ctx, instrs, rhs_reg);
 
     {
         struct GPReg ret_reg = lhs_reg;
@@ -856,7 +878,8 @@ static struct GPReg get_expr_instructions(struct InstrList *instrs,
 
 }
 
-static void get_var_decl_instructions(struct InstrList *instrs,
+static void get_var_decl_instructions(struct CompilerCtx *ctx,
+        struct InstrList *instrs,
     const struct VarDeclNode *var_decl) {
 
     unsigned i;
@@ -864,16 +887,9 @@ static void get_var_decl_instructions(struct InstrList *instrs,
         if (var_decl->decls.elems[i].value &&
                 var_decl->decls.elems[i].is_array) {
 
-            struct GPReg reg = alloc_reg(instrs);
-
-            char *array_lit_name =
-                safe_malloc(m_comp_label_name_capacity*
-                        sizeof(*array_lit_name));
-            char *memcpy_name = safe_malloc(m_comp_label_name_capacity*
-                    sizeof(*memcpy_name));
-
-            sprintf(array_lit_name, "array_lit_%lu$", array_lit_counter++);
-            sprintf(memcpy_name, "memcpy");
+            struct GPReg reg = alloc_reg(ctx, instrs);
+            const struct ArrayLit *array_value = Expr_array_lit(&ctx->exprs,
+                    var_decl->decls.elems[i].value);
 
             instr_reg_and_reg(instrs, InstrType_LEA, InstrSize_32,
                     reg_idx_to_operand_t(reg.reg_idx), InstrOperandType_REG_BP,
@@ -881,17 +897,15 @@ static void get_var_decl_instructions(struct InstrList *instrs,
 
             /* memcpy the array literal into the array itself */
             instr_imm32(instrs, InstrType_PUSH, InstrSize_32,
-                    var_decl->decls.elems[i].value->array_value.n_values*
-                        var_decl->decls.elems[i].value->array_value.elem_size);
-            instr_string(instrs, InstrType_PUSH, array_lit_name);
+                    array_value->n_values*array_value->elem_size);
+            instr_name(instrs, InstrType_PUSH, InstrNameType_ARRAY_LIT,
+                    ctx->ir.array_lit_counter++);
             instr_reg(instrs, InstrType_PUSH, InstrSize_32,
                     reg_idx_to_operand_t(reg.reg_idx), 0);
-            instr_string(instrs, InstrType_CALL, memcpy_name);
+            instr_name(instrs, InstrType_CALL, InstrNameType_SYM,
+                    IdentSym_MEMCPY);
 
-            array_lit_name = NULL;
-            memcpy_name = NULL;
-
-            free_reg(instrs, reg);
+            free_reg(ctx, instrs, reg);
 
         }
         else if (var_decl->decls.elems[i].value) {
@@ -900,13 +914,14 @@ static void get_var_decl_instructions(struct InstrList *instrs,
                         ));
 
             struct GPReg reg =
-                get_expr_instructions(instrs, var_decl->decls.elems[i].value,
+                get_expr_instructions(ctx, instrs,
+                        var_decl->decls.elems[i].value,
                         false);
             instr_reg_and_reg(instrs, InstrType_MOV_T_LOC, instr_size,
                     InstrOperandType_REG_BP, reg_idx_to_operand_t(reg.reg_idx),
                     var_decl->decls.elems[i].bp_offset);
 
-            free_reg(instrs, reg);
+            free_reg(ctx, instrs, reg);
         }
     }
 
@@ -988,55 +1003,60 @@ static void destroy_stack_frame(struct InstrList *instrs) {
 
 }
 
-static void get_func_decl_instructions(struct InstrList *instrs,
+static void get_func_decl_instructions(struct CompilerCtx *ctx,
+        struct InstrList *instrs,
         const struct FuncDeclNode *func, const struct BlockNode *transl_unit) {
 
-    char *label = NULL;
+    double trace_start = Trace_begin();
 
     if (!func->body) {
-        if (!func->ret_type_mods.is_static &&
-                !FuncDeclNode_defined(func, transl_unit)) {
+        /* -fstream-funcs gets here before the rest of the file's been parsed,
+         * without a transl_unit */
+        bool defined = transl_unit ? FuncDeclNode_defined(func, transl_unit) :
+            func->name < ctx->defined_funcs.size &&
+            ctx->defined_funcs.elems[func->name];
+
+        if (!func->ret_type_mods.is_static && !defined) {
             /* only non-static funcs have external linking, and if they func's
              * never defined within this translation unit, it's defined
              * externally */
-            char *copy = safe_malloc((strlen(func->name)+1)*sizeof(*copy));
-            strcpy(copy, func->name);
-            instr_string(instrs, InstrType_EXTERN, copy);
+            instr_name(instrs, InstrType_EXTERN, InstrNameType_SYM,
+                    func->name);
         }
         return;
     }
     else if (!func->ret_type_mods.is_static) {
         /* only non-static funcs have external linking */
-        char *copy = safe_malloc((strlen(func->name)+1)*sizeof(*copy));
-        strcpy(copy, func->name);
-        instr_string(instrs, InstrType_GLOBAL, copy);
+        instr_name(instrs, InstrType_GLOBAL, InstrNameType_SYM, func->name);
     }
 
-    label = safe_malloc((strlen(func->name)+1)*sizeof(*label));
-    strcpy(label, func->name);
-    instr_string(instrs, InstrType_LABEL, label);
+    instr_name(instrs, InstrType_LABEL, InstrNameType_SYM, func->name);
 
     push_callee_saved_regs(instrs);
     create_stack_frame(instrs, func->body->var_bytes);
 
-    get_block_instructions(instrs, func->body);
+    get_block_instructions(ctx, instrs, func->body);
 
     destroy_stack_frame(instrs);
     pop_callee_saved_regs(instrs);
     instr_only_type(instrs, InstrType_RET);
 
+    Trace_end("func", "ir ", Interner_str(&ctx->syms, func->name),
+            trace_start);
+
 }
 
-static void get_ret_stmt_instructions(struct InstrList *instrs,
+static void get_ret_stmt_instructions(struct CompilerCtx *ctx,
+        struct InstrList *instrs,
         const struct RetNode *ret_node) {
 
     u32 i;
 
     if (ret_node->value) {
         struct GPReg reg =
-            get_expr_instructions(instrs, ret_node->value, false);
+            get_expr_instructions(ctx, instrs, ret_node->value, false);
         assert(reg.reg_idx == 0);
-        free_reg(instrs, reg);
+        free_reg(ctx, instrs, reg);
 
         if (PrimitiveType_size(ret_node->type, ret_node->lvls_of_indir) < 4) {
             unsigned type_size = PrimitiveType_size(ret_node->type,
@@ -1063,188 +1083,162 @@ static void get_ret_stmt_instructions(struct InstrList *instrs,
 
 }
 
-static void get_if_stmt_instructions(struct InstrList *instrs,
+static void get_if_stmt_instructions(struct CompilerCtx *ctx,
+        struct InstrList *instrs,
         struct IfNode *if_node) {
 
     struct GPReg expr_reg = GPReg_init();
-    /* each instruction assumes it can free it's associated string, meaning
-     * each instruction will need to be given a different one */
-    char *if_end_label[2] = {NULL, NULL};
-    char *else_end_label[2] = {NULL, NULL};
-    u32 i;
+    u32 if_end_label = ctx->ir.label_counter;
+    u32 else_end_label = ctx->ir.label_counter+1;
 
     if (!if_node->body)
         return;
 
-    for (i = 0; i < sizeof(if_end_label)/sizeof(if_end_label[0]); i++) {
-        if_end_label[i] =
-            safe_malloc(m_comp_label_name_capacity*sizeof(*if_end_label[i]));
-        sprintf(if_end_label[i], "_L%lu$", label_counter);
-        if (if_node->else_body) {
-            else_end_label[i] = safe_malloc(
-                    m_comp_label_name_capacity*sizeof(*else_end_label[i]));
-            sprintf(else_end_label[i], "_L%lu$", label_counter+1);
-        }
-    }
-    label_counter += 1+(if_node->else_body!=NULL);
+    ctx->ir.label_counter += 1+(if_node->else_body!=NULL);
 
-    expr_reg = get_expr_instructions(instrs, if_node->expr, false);
+    expr_reg = get_expr_instructions(ctx, instrs, if_node->expr, false);
 
     instr_reg_and_imm32(instrs, InstrType_CMP, expr_reg.reg_size,
             reg_idx_to_operand_t(expr_reg.reg_idx), 0, 0);
-    instr_string(instrs, InstrType_JE, if_end_label[0]);
+    instr_name(instrs, InstrType_JE, InstrNameType_LABEL, if_end_label);
 
-    free_reg(instrs, expr_reg);
+    free_reg(ctx, instrs, expr_reg);
 
     if (if_node->body_in_block)
         create_stack_frame(instrs, if_node->body->var_bytes);
-    get_block_instructions(instrs, if_node->body);
+    get_block_instructions(ctx, instrs, if_node->body);
     if (if_node->body_in_block)
         destroy_stack_frame(instrs);
 
     if (if_node->else_body)
-        instr_string(instrs, InstrType_JMP, else_end_label[0]);
+        instr_name(instrs, InstrType_JMP, InstrNameType_LABEL,
+                else_end_label);
 
-    instr_string(instrs, InstrType_LABEL, if_end_label[1]);
+    instr_name(instrs, InstrType_LABEL, InstrNameType_LABEL, if_end_label);
 
     if (if_node->else_body) {
         if (if_node->else_body_in_block)
             create_stack_frame(instrs, if_node->else_body->var_bytes);
-        get_block_instructions(instrs, if_node->else_body);
+        get_block_instructions(ctx, instrs, if_node->else_body);
         if (if_node->else_body_in_block)
             destroy_stack_frame(instrs);
 
-        instr_string(instrs, InstrType_LABEL, else_end_label[1]);
+        instr_name(instrs, InstrType_LABEL, InstrNameType_LABEL,
+                else_end_label);
     }
 
 }
 
-static void get_while_stmt_instructions(struct InstrList *instrs,
+static void get_while_stmt_instructions(struct CompilerCtx *ctx,
+        struct InstrList *instrs,
         struct WhileNode *while_node) {
 
     struct GPReg expr_reg = GPReg_init();
-    /* each instruction assumes it can free it's associated string, meaning
-     * each instruction will need to be given a different one */
-    char *while_start_label[2] = {NULL, NULL};
-    char *while_end_label[2] = {NULL, NULL};
-    u32 i;
+    u32 while_start_label = ctx->ir.label_counter;
+    u32 while_end_label = ctx->ir.label_counter+1;
 
-    for (i = 0; i < sizeof(while_end_label)/sizeof(while_end_label[0]); i++) {
-        while_start_label[i] = safe_malloc(m_comp_label_name_capacity*
-                sizeof(*while_start_label[i]));
-        while_end_label[i] = safe_malloc(m_comp_label_name_capacity*
-                sizeof(*while_end_label[i]));
-        sprintf(while_start_label[i], "_L%lu$", label_counter);
-        sprintf(while_end_label[i], "_L%lu$", label_counter+1);
-    }
-    label_counter += 2;
+    ctx->ir.label_counter += 2;
 
-    instr_string(instrs, InstrType_LABEL, while_start_label[0]);
+    instr_name(instrs, InstrType_LABEL, InstrNameType_LABEL, while_start_label);
 
-    expr_reg = get_expr_instructions(instrs, while_node->expr, false);
+    expr_reg = get_expr_instructions(ctx, instrs, while_node->expr, false);
 
     instr_reg_and_imm32(instrs, InstrType_CMP, expr_reg.reg_size,
             reg_idx_to_operand_t(expr_reg.reg_idx), 0, 0);
-    instr_string(instrs, InstrType_JE, while_end_label[0]);
+    instr_name(instrs, InstrType_JE, InstrNameType_LABEL, while_end_label);
 
-    free_reg(instrs, expr_reg);
+    free_reg(ctx, instrs, expr_reg);
 
     if (while_node->body_in_block)
         create_stack_frame(instrs, while_node->body->var_bytes);
-    get_block_instructions(instrs, while_node->body);
+    get_block_instructions(ctx, instrs, while_node->body);
     if (while_node->body_in_block)
         destroy_stack_frame(instrs);
 
-    instr_string(instrs, InstrType_JMP, while_start_label[1]);
+    instr_name(instrs, InstrType_JMP, InstrNameType_LABEL, while_start_label);
 
-    instr_string(instrs, InstrType_LABEL, while_end_label[1]);
+    instr_name(instrs, InstrType_LABEL, InstrNameType_LABEL, while_end_label);
 
 }
 
-static void get_for_stmt_instructions(struct InstrList *instrs,
+static void get_for_stmt_instructions(struct CompilerCtx *ctx,
+        struct InstrList *instrs,
         struct ForNode *for_node) {
 
     struct GPReg cond_reg = GPReg_init();
-    /* each instruction assumes it can free it's associated string, meaning
-     * each instruction will need to be given a different one */
-    char *for_start_label[2] = {NULL, NULL};
-    char *for_end_label[2] = {NULL, NULL};
-
-    u32 i;
+    u32 for_start_label = ctx->ir.label_counter;
+    u32 for_end_label = ctx->ir.label_counter+1;
 
-    for (i = 0; i < sizeof(for_end_label)/sizeof(for_end_label[0]); i++) {
-        for_start_label[i] = safe_malloc(m_comp_label_name_capacity*
-                sizeof(*for_start_label[i]));
-        for_end_label[i] = safe_malloc(m_comp_label_name_capacity*
-                sizeof(*for_end_label[i]));
-        sprintf(for_start_label[i], "_L%lu$", label_counter);
-        sprintf(for_end_label[i], "_L%lu$", label_counter+1);
-    }
-    label_counter += 2;
+    ctx->ir.label_counter += 2;
 
     /* the init expr goes before the label cuz it's technically done outside of
      * the loop */
     if (for_node->init)
-        free_reg(instrs, get_expr_instructions(instrs, for_node->init, false));
+        free_reg(ctx, instrs, get_expr_instructions(ctx, instrs,
+        for_node->init, false));
 
-    instr_string(instrs, InstrType_LABEL, for_start_label[0]);
+    instr_name(instrs, InstrType_LABEL, InstrNameType_LABEL, for_start_label);
 
     if (for_node->condition)
-        cond_reg = get_expr_instructions(instrs, for_node->condition, false);
+        cond_reg = get_expr_instructions(ctx, instrs, for_node->condition,
+        false);
 
     instr_reg_and_imm32(instrs, InstrType_CMP, cond_reg.reg_size,
         reg_idx_to_operand_t(cond_reg.reg_idx), 0, 0);
-    instr_string(instrs, InstrType_JE, for_end_label[0]);
+    instr_name(instrs, InstrType_JE, InstrNameType_LABEL, for_end_label);
 
-    free_reg(instrs, cond_reg);
+    free_reg(ctx, instrs, cond_reg);
 
     if (for_node->body_in_block)
         create_stack_frame(instrs, for_node->body->var_bytes);
-    get_block_instructions(instrs, for_node->body);
+    get_block_instructions(ctx, instrs, for_node->body);
     if (for_node->body_in_block)
         destroy_stack_frame(instrs);
 
     if (for_node->inc)
-        free_reg(instrs, get_expr_instructions(instrs, for_node->inc, false));
-    instr_string(instrs, InstrType_JMP, for_start_label[1]);
+        free_reg(ctx, instrs, get_expr_instructions(ctx, instrs,
+        for_node->inc, false));
+    instr_name(instrs, InstrType_JMP, InstrNameType_LABEL, for_start_label);
 
-    instr_string(instrs, InstrType_LABEL, for_end_label[1]);
+    instr_name(instrs, InstrType_LABEL, InstrNameType_LABEL, for_end_label);
 
 }
 
-static void get_block_instructions(struct InstrList *instrs,
-        const struct BlockNode *block) {
+/* the nodes of block from first_node on */
+static void get_nodes_instructions(struct CompilerCtx *ctx,
+        struct InstrList *instrs,
+        const struct BlockNode *block, u32 first_node) {
 
-    unsigned i;
+    u32 i;
 
-    for (i = 0; i < block->nodes.size; i++) {
+    for (i = first_node; i < block->nodes.size; i++) {
 
         void *node_struct = block->nodes.elems[i].node_struct;
 
         if (block->nodes.elems[i].type == ASTType_EXPR)
-            free_reg(instrs, get_expr_instructions(instrs,
+            free_reg(ctx, instrs, get_expr_instructions(ctx, instrs,
                         ((const struct ExprNode*)node_struct)->expr, false));
         else if (block->nodes.elems[i].type == ASTType_VAR_DECL)
-            get_var_decl_instructions(instrs, node_struct);
+            get_var_decl_instructions(ctx, instrs, node_struct);
         else if (block->nodes.elems[i].type == ASTType_FUNC)
-            get_func_decl_instructions(instrs, node_struct, block);
+            get_func_decl_instructions(ctx, instrs, node_struct, block);
         else if (block->nodes.elems[i].type == ASTType_BLOCK) {
             create_stack_frame(instrs,
                     ((const struct BlockNode*)node_struct)->var_bytes);
-            get_block_instructions(instrs, node_struct);
+            get_block_instructions(ctx, instrs, node_struct);
             destroy_stack_frame(instrs);
         }
         else if (block->nodes.elems[i].type == ASTType_RETURN) {
-            get_ret_stmt_instructions(instrs, node_struct);
+            get_ret_stmt_instructions(ctx, instrs, node_struct);
         }
         else if (block->nodes.elems[i].type == ASTType_IF_STMT) {
-            get_if_stmt_instructions(instrs, node_struct);
+            get_if_stmt_instructions(ctx, instrs, node_struct);
         }
         else if (block->nodes.elems[i].type == ASTType_WHILE_STMT) {
-            get_while_stmt_instructions(instrs, node_struct);
+            get_while_stmt_instructions(ctx, instrs, node_struct);
         }
         else if (block->nodes.elems[i].type == ASTType_FOR_STMT) {
-            get_for_stmt_instructions(instrs, node_struct);
+            get_for_stmt_instructions(ctx, instrs, node_struct);
         }
 
         else if (block->nodes.elems[i].type == ASTType_DEBUG_RAX) {
@@ -1260,14 +1254,42 @@ static void get_block_instructions(struct InstrList *instrs,
 
 }
 
-struct InstrList IR_get_instructions(const struct BlockNode *ast) {
+static void get_block_instructions(struct CompilerCtx *ctx,
+        struct InstrList *instrs,
+        const struct BlockNode *block) {
+
+    get_nodes_instructions(ctx, instrs, block, 0);
+
+}
+
+const struct InstrList* IR_get_instructions(struct CompilerCtx *ctx,
+        const struct BlockNode *ast, u32 first_node) {
+
+    struct InstrList *instrs = &ctx->ir.instrs;
+    u32 n_tokens;
+
+    InstrList_clear(instrs, NULL);
+    /* code gets up to about 1.2 instructions per token, global data a lot
+     * fewer, so the list doesn't have to grow along the way */
+    n_tokens = ctx->exprs.tokens->size;
+    InstrList_reserve(instrs, n_tokens + n_tokens/4 + 16);
+    get_nodes_instructions(ctx, instrs, ast, first_node);
+
+    return instrs;
+
+}
+
+const struct InstrList* IR_get_func_instructions(struct CompilerCtx *ctx,
+        const struct FuncDeclNode *func) {
 
-    struct InstrList instrs = InstrList_init();
+    struct InstrList *instrs = &ctx->ir.instrs;
 
-    get_block_instructions(&instrs, ast);
+    InstrList_clear(instrs, NULL);
+    /* the translation unit is only needed for funcs without a body */
+    get_func_decl_instructions(ctx, instrs, func, NULL);
 
     return instrs;
 
 }
 
-m_define_VectorImpl_funcs(InstrList, struct Instruction)
+m_define_VectorImpl_funcs(InstrList, struct Instruction, MemTag_IR)
@@ -3,6 +3,8 @@
 #include "../vector_impl.h"
 #include "../ast.h"
 
+struct CompilerCtx;
+
 /* when changing make sure to update:
  *  expr_to_instr_t() in ir.c, instr_type_to_asm
  *  in code_gen.c, regular_2_oper_instr in code_gen.c
@@ -128,18 +130,37 @@ enum InstrSize {
 unsigned InstrSize_to_bytes(enum InstrSize size);
 enum InstrSize InstrSize_bytes_to(unsigned bytes);
 
+/* what an instruction's name refers to. used by labels, jumps, calls and the
+ * like */
+enum InstrNameType {
+
+    InstrNameType_NONE,
+
+    /* a label the compiler made up, written as _L<name>$ */
+    InstrNameType_LABEL,
+    /* written as array_lit_<name>$ */
+    InstrNameType_ARRAY_LIT,
+    /* name is an id in the context's interner, like a function name */
+    InstrNameType_SYM
+
+};
+
+/* owns nothing, so an InstrList is just one flat array */
 struct Instruction {
 
     struct InstrOperand lhs, rhs;
-    enum InstrType type;
-    enum InstrSize instr_size;
     i32 offset;
-    char *string;
+    u32 name;
+    /* enum InstrType */
+    u8 type;
+    /* enum InstrSize */
+    u8 instr_size;
+    /* enum InstrNameType */
+    u8 name_type;
 
 };
 
 struct Instruction Instruction_init(void);
-void Instruction_free(struct Instruction instr);
 
 struct InstrList {
 
@@ -151,4 +172,12 @@ struct InstrList {
 
 m_declare_VectorImpl_funcs(InstrList, struct Instruction)
 
-struct InstrList IR_get_instructions(const struct BlockNode *ast);
+/* the list is ctx->ir.instrs, so it only stays valid until the next call.
+ * only the top level nodes of ast from first_node on get generated, with
+ * -fstream-funcs the ones before that already have been */
+const struct InstrList* IR_get_instructions(struct CompilerCtx *ctx,
+        const struct BlockNode *ast, u32 first_node);
+/* just the instructions of a single function definition, for
+ * -fstream-funcs */
+const struct InstrList* IR_get_func_instructions(struct CompilerCtx *ctx,
+        const struct FuncDeclNode *func);
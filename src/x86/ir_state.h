@@ -0,0 +1,42 @@
+#pragma once
+
+/* the state the x86 backend keeps while generating the code for a
+ * translation unit. lives in the CompilerCtx. the buffers in it are reused
+ * for every function and every translation unit the context compiles, so
+ * once they've grown big enough the backend stops allocating. */
+
+#include "../bool.h"
+#include "../comp_dependent/ints.h"
+#include "../out_buf.h"
+#include "../array_lit.h"
+#include "ir.h"
+
+/* ax, bx and cx */
+#define m_n_gp_regs 3
+
+struct IRState {
+
+    u32 label_counter;
+    u32 array_lit_counter;
+
+    unsigned next_reg_to_leak;
+
+    /* is the register currently holding a value? */
+    bool gp_reg_used[m_n_gp_regs];
+
+    /* -fstream-funcs. the array literals of the funcs that have already been
+     * generated, they get written out in .rodata once everything else is */
+    struct OutBuf rodata;
+    u32 n_streamed_array_lits;
+
+    /* what IR_get_instructions and IR_get_func_instructions fill in */
+    struct InstrList instrs;
+    /* where the code generator collects the array literals */
+    struct ArrayLitList array_lits;
+
+};
+
+struct IRState IRState_init(void);
+/* gets ready for another translation unit, keeping the buffers */
+void IRState_reset(struct IRState *self);
+void IRState_free(struct IRState *self);
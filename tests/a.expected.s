@@ -0,0 +1,321 @@
+[BITS 32]
+
+extern memcpy
+extern printf
+
+section .text
+global main
+extern strtol
+
+extern printf
+
+global main
+
+main:
+
+push ebx
+
+push esi
+
+push edi
+
+push ebp
+
+mov ebp, esp
+
+sub esp, dword 8
+
+mov eax, [ebp+-8]
+
+mov edx, 5
+mul edx
+
+mov eax, [ebp+20]
+
+cmp eax, dword 2
+
+setl al
+
+and eax, dword 255
+
+cmp eax, dword 0
+
+je _L0$
+
+push ebp
+
+mov ebp, esp
+
+sub esp, dword 0
+
+sub esp, dword 4
+
+mov ebx, array_lit_0$
+
+mov [esp+0], ebx
+
+call printf
+
+add esp, dword 4
+
+mov eax, dword 1
+
+mov esp, ebp
+
+pop ebp
+
+mov esp, ebp
+
+pop ebp
+
+pop edi
+
+pop esi
+
+pop ebx
+
+ret
+
+mov esp, ebp
+
+pop ebp
+
+_L0$:
+
+lea eax, [ebp+-8]
+
+mov ebx, eax
+
+sub esp, dword 12
+
+mov ecx, [ebp+24]
+
+add ecx, dword 4
+
+mov ecx, [ecx+0]
+
+mov [esp+0], ecx
+
+lea ecx, [ebp+-4]
+
+mov [esp+4], ecx
+
+mov ecx, dword 0
+
+mov [esp+8], ecx
+
+call strtol
+
+add esp, dword 12
+
+xchg eax, ebx
+
+mov [eax+0], ebx
+
+sub esp, dword 12
+
+mov ebx, array_lit_1$
+
+mov [esp+0], ebx
+
+mov ebx, [ebp+-8]
+
+mov [esp+4], ebx
+
+mov ebx, eax
+
+sub esp, dword 4
+
+mov ecx, [ebp+-8]
+
+mov [esp+0], ecx
+
+call fibonacci
+
+add esp, dword 4
+
+xchg eax, ebx
+
+mov [esp+8], ebx
+
+call printf
+
+add esp, dword 12
+
+sub esp, dword 8
+
+mov ebx, array_lit_2$
+
+mov [esp+0], ebx
+
+mov ebx, array_lit_3$
+
+mov [esp+4], ebx
+
+call printf
+
+add esp, dword 8
+
+mov esp, ebp
+
+pop ebp
+
+pop edi
+
+pop esi
+
+pop ebx
+
+ret
+
+fibonacci:
+
+push ebx
+
+push esi
+
+push edi
+
+push ebp
+
+mov ebp, esp
+
+sub esp, dword 16
+
+mov eax, dword 0
+
+mov [ebp+-4], eax
+
+mov eax, dword 1
+
+mov [ebp+-8], eax
+
+mov eax, dword 0
+
+mov [ebp+-16], eax
+
+mov eax, [ebp+20]
+
+cmp eax, dword 2
+
+setb al
+
+and eax, dword 255
+
+cmp eax, dword 0
+
+je _L1$
+
+mov eax, [ebp+20]
+
+mov esp, ebp
+
+pop ebp
+
+pop edi
+
+pop esi
+
+pop ebx
+
+ret
+
+_L1$:
+
+lea eax, [ebp+-16]
+
+mov dword [eax+0], 0
+
+_L2$:
+
+mov eax, [ebp+-16]
+
+mov ebx, [ebp+20]
+
+sub ebx, dword 1
+
+cmp eax, ebx
+
+setb al
+
+and eax, dword 255
+
+cmp eax, dword 0
+
+je _L3$
+
+push ebp
+
+mov ebp, esp
+
+sub esp, dword 0
+
+lea eax, [ebp+8]
+
+mov ebx, [ebp+16]
+
+mov ecx, [ebp+12]
+
+add ebx, ecx
+
+mov [eax+0], ebx
+
+lea eax, [ebp+16]
+
+mov ebx, [ebp+12]
+
+mov [eax+0], ebx
+
+lea eax, [ebp+12]
+
+mov ebx, [ebp+8]
+
+mov [eax+0], ebx
+
+mov esp, ebp
+
+pop ebp
+
+lea eax, [ebp+-16]
+
+mov ebx, [eax+0]
+
+inc dword [eax]
+
+jmp _L2$
+
+_L3$:
+
+mov eax, [ebp+-12]
+
+mov esp, ebp
+
+pop ebp
+
+pop edi
+
+pop esi
+
+pop ebx
+
+ret
+
+mov esp, ebp
+
+pop ebp
+
+pop edi
+
+pop esi
+
+pop ebx
+
+ret
+
+
+section .rodata
+msg$: db `result = %d\n\0`
+array_lit_0$: db 103, 105, 118, 101, 32, 97, 110, 32, 97, 114, 103, 117, 109, 101, 110, 116, 32, 99, 111, 110, 116, 97, 105, 110, 105, 110, 103, 32, 119, 104, 105, 99, 104, 32, 102, 105, 98, 111, 110, 97, 99, 99, 105, 32, 110, 117, 109, 98, 101, 114, 32, 116, 111, 32, 103, 101, 116, 46, 10, 0
+array_lit_1$: db 102, 105, 98, 111, 110, 97, 99, 99, 105, 32, 110, 114, 46, 32, 37, 100, 32, 105, 115, 58, 32, 37, 117, 10, 0
+array_lit_2$: db 109, 95, 116, 101, 115, 116, 95, 109, 97, 99, 114, 111, 32, 61, 32, 37, 115, 10, 0
+array_lit_3$: db 116, 104, 105, 115, 32, 105, 115, 32, 97, 32, 109, 97, 99, 114, 111, 0
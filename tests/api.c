@@ -0,0 +1,123 @@
+/* drives the library interface in src/mcc.h. it's given the tests dir, and
+ * checks that compiling a.c from memory gives a.expected.s, that an error
+ * comes back in the result, and that running out of memory in the compiler
+ * jumps back instead of exiting */
+
+#include "mcc.h"
+#include "safe_mem.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int n_failed = 0;
+
+static void check(int ok, const char *what) {
+
+    if (!ok) {
+        fprintf(stderr, "failed: %s\n", what);
+        ++n_failed;
+    }
+
+}
+
+/* reads the file at dir/name into a malloc'd buffer */
+static char* read_file(const char *dir, const char *name, size_t *len) {
+
+    char path[4096];
+    FILE *file = NULL;
+    char *buf = NULL;
+    long size;
+
+    sprintf(path, "%.2000s/%.1000s", dir, name);
+    file = fopen(path, "rb");
+    if (!file) {
+        perror(path);
+        exit(EXIT_FAILURE);
+    }
+
+    fseek(file, 0, SEEK_END);
+    size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    buf = malloc(size+1);
+    if (!buf || fread(buf, 1, size, file) != (size_t)size) {
+        perror(path);
+        exit(EXIT_FAILURE);
+    }
+    buf[size] = '\0';
+    fclose(file);
+
+    *len = size;
+    return buf;
+
+}
+
+static void test_compile(const char *tests_dir) {
+
+    struct MccOptions options = MccOptions_init();
+    struct MccResult result;
+    size_t src_len;
+    size_t expected_len;
+    char *src = read_file(tests_dir, "a.c", &src_len);
+    char *expected = read_file(tests_dir, "a.expected.s", &expected_len);
+
+    options.optimize = 1;
+    check(Mcc_compile(src, src_len, "a.c", &options, &result) == 0,
+            "a.c compiles");
+    check(result.asm_text && result.asm_len == expected_len &&
+            memcmp(result.asm_text, expected, expected_len) == 0,
+            "a.c gives a.expected.s");
+    check(result.diagnostics != NULL, "a.c has diagnostics");
+    MccResult_free(&result);
+
+    free(src);
+    free(expected);
+
+}
+
+static void test_error(void) {
+
+    const char *src = "int main() {\n    return x;\n}\n";
+    struct MccResult result;
+
+    check(Mcc_compile(src, strlen(src), "err.c", NULL, &result) != 0,
+            "err.c fails");
+    check(result.error_occurred && !result.asm_text,
+            "err.c has no assembly");
+    check(result.diagnostics && strstr(result.diagnostics, "err.c") != NULL,
+            "err.c's diagnostics name it");
+    MccResult_free(&result);
+
+}
+
+static void test_trap(void) {
+
+    struct SafeMemTrap trap;
+    struct SafeMemTrap *old_trap = SafeMem_set_trap(&trap);
+    volatile int jumped = 0;
+
+    if (setjmp(trap.jmp))
+        jumped = 1;
+    else
+        SafeMem_fatal("out of memory");
+
+    check(jumped && strcmp(trap.msg, "out of memory") == 0,
+            "SafeMem_fatal jumps to the trap");
+    check(SafeMem_set_trap(old_trap) == NULL,
+            "the jump takes the trap away");
+
+}
+
+int main(int argc, char **argv) {
+
+    if (argc != 2) {
+        fprintf(stderr, "usage: mcc-api-test <tests dir>\n");
+        return EXIT_FAILURE;
+    }
+
+    test_compile(argv[1]);
+    test_error();
+    test_trap();
+
+    return n_failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+
+}
@@ -0,0 +1,19 @@
+#!/bin/bash
+
+# compiles a.c and globals.c and checks the assembly is byte for byte the
+# same as a.expected.s and globals.expected.s, with and without
+# -fstream-funcs. globals.c has initialized globals between the functions,
+# which have to stay where they are when streaming. pass the mcc to use, it
+# defaults to the one build.sh uses
+
+SCRIPT_DIR=$( cd -- "$( dirname -- "${BASH_SOURCE[0]}" )" &> /dev/null && pwd )
+MCC=${1:-$SCRIPT_DIR/../bin/mcc}
+OUT=$(mktemp)
+trap 'rm -f $OUT' EXIT
+
+for NAME in a globals; do
+    for FLAGS in "" "-fstream-funcs"; do
+        $MCC $SCRIPT_DIR/$NAME.c -o $OUT -O $FLAGS > /dev/null || exit 1
+        cmp $OUT $SCRIPT_DIR/$NAME.expected.s || exit 1
+    done
+done
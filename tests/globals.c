@@ -0,0 +1,19 @@
+int g = 5;
+int squares[3] = {1, 4, 9};
+
+int get_g(void) {
+    return g;
+}
+
+int printf(char *str, ...);
+
+int twice = 2*3;
+
+int main(void) {
+
+    int local[2] = {7, 8};
+
+    printf("%d %d\n", get_g(), squares[1]);
+    return local[0];
+
+}
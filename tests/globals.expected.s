@@ -0,0 +1,161 @@
+[BITS 32]
+
+extern memcpy
+extern printf
+
+section .text
+global main
+mov eax, dword 5
+
+mov [ebp+-4], eax
+
+lea eax, [ebp+-16]
+
+push dword 12
+
+push array_lit_0$
+
+push eax
+
+call memcpy
+
+global get_g
+
+get_g:
+
+push ebx
+
+push esi
+
+push edi
+
+push ebp
+
+mov ebp, esp
+
+sub esp, dword 0
+
+mov eax, [ebp+-4]
+
+mov esp, ebp
+
+pop ebp
+
+pop edi
+
+pop esi
+
+pop ebx
+
+ret
+
+mov esp, ebp
+
+pop ebp
+
+pop edi
+
+pop esi
+
+pop ebx
+
+ret
+
+extern printf
+
+mov eax, dword 6
+
+mov [ebp+-20], eax
+
+global main
+
+main:
+
+push ebx
+
+push esi
+
+push edi
+
+push ebp
+
+mov ebp, esp
+
+sub esp, dword 8
+
+lea eax, [ebp+-8]
+
+push dword 8
+
+push array_lit_1$
+
+push eax
+
+call memcpy
+
+sub esp, dword 12
+
+mov ebx, array_lit_2$
+
+mov [esp+0], ebx
+
+mov ebx, eax
+
+sub esp, dword 0
+
+call get_g
+
+add esp, dword 0
+
+xchg eax, ebx
+
+mov [esp+4], ebx
+
+lea ebx, [ebp+-16]
+
+add ebx, dword 4
+
+mov ebx, [ebx+0]
+
+mov [esp+8], ebx
+
+call printf
+
+add esp, dword 12
+
+lea eax, [ebp+-8]
+
+add eax, dword 0
+
+mov eax, [eax+0]
+
+mov esp, ebp
+
+pop ebp
+
+pop edi
+
+pop esi
+
+pop ebx
+
+ret
+
+mov esp, ebp
+
+pop ebp
+
+pop edi
+
+pop esi
+
+pop ebx
+
+ret
+
+
+section .rodata
+msg$: db `result = %d\n\0`
+array_lit_0$: dd 1, 4, 9
+array_lit_1$: dd 7, 8
+array_lit_2$: db 37, 100, 32, 37, 100, 10, 0